@@ -0,0 +1,11 @@
+// Surface colour of the fragment being shaded. The includer declares TexCoord, TextureLayer and the DrawData block.
+
+uniform sampler2D Texture;
+uniform sampler2DArray materialTextures;
+
+vec4 SampleAlbedo() {
+    // Uniform for the whole draw, so the branch costs nothing. Models packed into the arrays pick their layer per vertex.
+    if ( drawMaterial.z > 0.5 ) return texture(materialTextures, vec3(TexCoord, TextureLayer));
+
+    return texture(Texture, TexCoord);
+}
\ No newline at end of file
@@ -0,0 +1,6 @@
+// Per-draw values the CPU writes into the dynamic ring buffer, each draw binds its own slice of it (DrawData in main.cpp)
+layout (std140) uniform DrawData {
+    mat4 model;
+    mat4 normalMatrix;  // inverse transpose of the model matrix, computed once per draw instead of per vertex
+    vec4 drawMaterial;  // x specular intensity, y shininess, z 1 when the albedo comes from the material texture arrays
+};
\ No newline at end of file
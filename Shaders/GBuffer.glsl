@@ -0,0 +1,38 @@
+// G-buffer layout written by gbuffer.frag and decoded by the deferred lighting passes:
+// albedo RGBA8, normal RGB16F, specular intensity and shininess RG16F, depth from the depth-stencil attachment.
+// Declares the surface globals Lighting.glsl shades, ReadGBuffer() fills them for the current pixel.
+
+uniform sampler2D gAlbedo;
+uniform sampler2D gNormal;
+uniform sampler2D gSpecular;
+uniform sampler2D gDepth;
+
+uniform vec2 gBufferSize;
+uniform mat4 inverseViewProjection;
+uniform mat4 view;
+
+vec3 FragPos;
+vec3 Normal;
+float ViewDepth;
+Material material;
+
+bool ReadGBuffer(out vec3 albedo) {
+    vec2 uv = gl_FragCoord.xy / gBufferSize;
+    float depth = texture(gDepth, uv).r;
+
+    // Nothing was drawn here, the skybox is already in the output
+    if ( depth == 1.0 ) return false;
+
+    vec4 position = inverseViewProjection * vec4(vec3(uv, depth) * 2.0 - 1.0, 1.0);
+    FragPos = position.xyz / position.w;
+
+    Normal = texture(gNormal, uv).xyz;
+    ViewDepth = -(view * vec4(FragPos, 1.0)).z;
+
+    vec2 specular = texture(gSpecular, uv).rg;
+    material = Material(specular.r, specular.g);
+
+    albedo = texture(gAlbedo, uv).rgb;
+
+    return true;
+}
\ No newline at end of file
@@ -0,0 +1,263 @@
+// Light and shadow math shared by the forward and deferred shaders. The includer declares the surface
+// being shaded before including: FragPos, Normal, ViewDepth and material, either
+// as inputs from the vertex shader or as globals filled from the G-buffer.
+
+#ifndef SHADOWS
+#define SHADOWS 1
+#endif
+
+// Rotated Poisson taps for the directional and omni maps, see PCF_QUALITIES
+#ifndef DIRECTIONAL_PCF_SAMPLES
+#define DIRECTIONAL_PCF_SAMPLES 8
+#endif
+
+#ifndef OMNI_PCF_SAMPLES
+#define OMNI_PCF_SAMPLES 12
+#endif
+
+// The directional light reads blurred exponential shadow maps instead of comparing depths
+#ifndef SHADOW_PREFILTERED
+#define SHADOW_PREFILTERED 0
+#endif
+
+#ifndef OMNI_SHADOW_MAP_COUNT
+#define OMNI_SHADOW_MAP_COUNT (MAX_POINT_LIGHTS + MAX_SPOT_LIGHTS)
+#endif
+
+// One layer per cascade, a cascade covers view depths up to its split, see DirectionalLight::UpdateCascades
+#if SHADOW_PREFILTERED
+uniform sampler2DArray directionalShadowMap;
+#else
+uniform sampler2DArrayShadow directionalShadowMap;
+#endif
+uniform mat4 cascadeTransforms[SHADOW_CASCADES];
+uniform float cascadeSplits[SHADOW_CASCADES];
+
+uniform OmniShadowMap omniShadowMaps[OMNI_SHADOW_MAP_COUNT];
+
+// Shadowless lights assigned to froxels on the CPU, see LightClusters. The grid holds an offset into the
+// index list and a count per cluster, every light takes four texels: position and range, colour and
+// diffuse intensity, attenuation and spot cosine (-2 for point lights), direction.
+uniform usamplerBuffer clusterGrid;
+uniform usamplerBuffer clusterLightIndices;
+uniform samplerBuffer clusterLights;
+uniform uvec3 clusterDims;
+uniform vec2 clusterScreenSize;
+uniform float clusterZScale;
+uniform float clusterZBias;
+
+uniform vec3 eyePosition;
+
+// Spread of the directional taps in texels, the omni one is scaled with the view distance
+const float DIRECTIONAL_FILTER_RADIUS = 1.5;
+
+// Share of the shadow distance, at the far end of the last cascade, over which directional shadows fade to nothing
+const float SHADOW_FADE_FRACTION = 0.1;
+
+const vec2 poissonDisk[16] = vec2[] (
+    vec2(-0.94201624, -0.39906216), vec2( 0.94558609, -0.76890725), vec2(-0.09418410, -0.92938870), vec2( 0.34495938,  0.29387760),
+    vec2(-0.91588581,  0.45771432), vec2(-0.81544232, -0.87912464), vec2(-0.38277543,  0.27676845), vec2( 0.97484398,  0.75648379),
+    vec2( 0.44323325, -0.97511554), vec2( 0.53742981, -0.47373420), vec2(-0.26496911, -0.41893023), vec2( 0.79197514,  0.19090188),
+    vec2(-0.24188840,  0.99706507), vec2(-0.81409955,  0.91437590), vec2( 0.19984126,  0.78641367), vec2( 0.14383161, -0.14100790)
+);
+
+// Turns the disk per pixel, the banding of a few fixed taps becomes fine noise
+mat2 PoissonRotation() {
+    float noise = fract(52.9829189 * fract(dot(gl_FragCoord.xy, vec2(0.06711056, 0.00583715))));
+    float angle = 6.28318531 * noise;
+
+    return mat2(cos(angle), sin(angle), -sin(angle), cos(angle));
+}
+
+float CalcDirectionalShadowFactor(DirectionalLight light) {
+#if SHADOWS
+    int cascade = 0;
+
+    while ( cascade < SHADOW_CASCADES && ViewDepth > cascadeSplits[cascade] ) cascade++;
+
+    // Past the shadow distance
+    if ( cascade == SHADOW_CASCADES ) return 0.0;
+
+    vec4 lightSpacePos = cascadeTransforms[cascade] * vec4(FragPos, 1.0);
+    vec3 projCoords = ( lightSpacePos.xyz / lightSpacePos.w ) * 0.5 + 0.5;
+
+    if ( projCoords.z > 1.0 ) return 0.0;
+
+#if SHADOW_PREFILTERED
+    // The blurred moment is the average of exp(c * occluder), scaling it by exp(-c * receiver) gives the lit fraction
+    float moment = texture(directionalShadowMap, vec3(projCoords.xy, cascade)).r;
+    float visibility = clamp(moment * exp(-float(ESM_EXPONENT) * projCoords.z), 0.0, 1.0);
+#else
+    vec3 normal = normalize(Normal);
+    vec3 lightDir = normalize(light.direction);
+
+    float bias = max(0.05 * ( 1 - dot(normal, lightDir) ), 0.005);
+    float reference = projCoords.z - bias;
+
+    // Every fetch compares in hardware and already filters 2x2 texels
+#if DIRECTIONAL_PCF_SAMPLES == 1
+    float visibility = texture(directionalShadowMap, vec4(projCoords.xy, cascade, reference));
+#else
+    vec2 texelSize = 1.0 / textureSize(directionalShadowMap, 0).xy;
+    mat2 rotation = PoissonRotation();
+    float visibility = 0.0;
+
+    for ( int i = 0; i < DIRECTIONAL_PCF_SAMPLES; i++ ) {
+        vec2 offset = rotation * poissonDisk[i] * DIRECTIONAL_FILTER_RADIUS * texelSize;
+        visibility += texture(directionalShadowMap, vec4(projCoords.xy + offset, cascade, reference));
+    }
+
+    visibility /= float(DIRECTIONAL_PCF_SAMPLES);
+#endif
+#endif
+
+    // Eased out towards the last split instead of stopping with a hard edge
+    float shadowDistance = cascadeSplits[SHADOW_CASCADES - 1];
+    float fade = clamp(( shadowDistance - ViewDepth ) / ( shadowDistance * SHADOW_FADE_FRACTION ), 0.0, 1.0);
+
+    return ( 1.0 - visibility ) * fade;
+#else
+    return 0.0;
+#endif
+}
+
+float CalcOmniShadowFactor(PointLight light, int shadowIndex) {
+#if SHADOWS
+    vec3 fragToLight = FragPos - light.position;
+    float farPlane = omniShadowMaps[shadowIndex].farPlane;
+
+    // The maps store distance over the far plane
+    float bias = 0.05;
+    float reference = ( length(fragToLight) - bias ) / farPlane;
+
+#if OMNI_PCF_SAMPLES == 1
+    float visibility = texture(omniShadowMaps[shadowIndex].shadowMap, vec4(fragToLight, reference));
+#else
+    float viewDistance = length(eyePosition - FragPos);
+    float diskRadius = ( 1.0 + ( viewDistance / farPlane ) ) / 25.0;
+
+    // The disk lies in the plane facing the light, so every tap moves across the cube face rather than into it
+    vec3 axis = normalize(fragToLight);
+    vec3 tangent = normalize(cross(axis, abs(axis.y) < 0.99 ? vec3(0.0, 1.0, 0.0) : vec3(1.0, 0.0, 0.0)));
+    vec3 bitangent = cross(axis, tangent);
+    mat2 rotation = PoissonRotation();
+    float visibility = 0.0;
+
+    for ( int i = 0; i < OMNI_PCF_SAMPLES; i++ ) {
+        vec2 offset = rotation * poissonDisk[i] * diskRadius;
+        vec3 direction = fragToLight + tangent * offset.x + bitangent * offset.y;
+
+        visibility += texture(omniShadowMaps[shadowIndex].shadowMap, vec4(direction, reference));
+    }
+
+    visibility /= float(OMNI_PCF_SAMPLES);
+#endif
+
+    return 1.0 - visibility;
+#else
+    return 0.0;
+#endif
+}
+
+vec4 CalcLightByDirection(Light light, vec3 direction, float shadowFactor) {
+    vec4 ambientColour = vec4(light.colour, 1.0f) * light.ambientIntensity;
+
+    float diffuseFactor = max( dot( normalize(Normal), normalize(direction) ), 0.0f);
+    vec4 diffuseColour = vec4(light.colour * light.diffuseIntensity * diffuseFactor, 1.0f);
+
+    vec4 specularColour = vec4(0, 0, 0, 0);
+
+    if( diffuseFactor > 0.0f ) {
+        vec3 fragToEye = normalize(eyePosition - FragPos);
+        vec3 reflectedVertex = normalize(reflect(direction, normalize(Normal)));
+
+        float specularFactor = dot(fragToEye, reflectedVertex);
+
+        if( specularFactor > 0.0f ) {
+            specularFactor = pow(specularFactor, material.shininess);
+            specularColour = vec4(light.colour * material.specularIntensity * specularFactor, 1.0f);
+        }
+    }
+
+    return ( ambientColour + ( 1.0 - shadowFactor ) * ( diffuseColour + specularColour ) );
+}
+
+vec4 CalcPointLight(PointLight pLight, int shadowIndex) {
+    vec3 direction = FragPos - pLight.position;
+    float distance = length(direction);
+    direction = normalize(direction);
+
+    float shadowFactor = CalcOmniShadowFactor(pLight, shadowIndex);
+
+    vec4 colour = CalcLightByDirection(pLight.base, direction, shadowFactor);
+    float attenuation = pLight.exponent * distance * distance +
+        pLight.linear * distance +
+        pLight.constant;
+
+    return (colour / attenuation);
+}
+
+vec4 CalcSpotLight(SpotLight sLight, int shadowIndex) {
+    vec3 rayDirection = normalize(FragPos - sLight.base.position);
+    float slFactor = dot(rayDirection, sLight.direction);
+
+    if( slFactor > sLight.edge ) {
+        vec4 colour = CalcPointLight(sLight.base, shadowIndex);
+
+        return colour * (1.0f - (1.0f - slFactor)*(1.0f/(1.0f - sLight.edge)));
+
+    } else {
+        return vec4(0, 0, 0, 0);
+    }
+}
+
+vec4 CalcClusteredLight(int index) {
+    vec4 positionRange = texelFetch(clusterLights, index * 4);
+    vec4 colourIntensity = texelFetch(clusterLights, index * 4 + 1);
+    vec4 attenuationEdge = texelFetch(clusterLights, index * 4 + 2);
+
+    vec3 direction = FragPos - positionRange.xyz;
+    float distance = length(direction);
+
+    if ( distance >= positionRange.w ) return vec4(0, 0, 0, 0);
+
+    direction = normalize(direction);
+
+    float spotFactor = 1.0;
+
+    if ( attenuationEdge.w > -1.0 ) {
+        float slFactor = dot(direction, texelFetch(clusterLights, index * 4 + 3).xyz);
+
+        if ( slFactor <= attenuationEdge.w ) return vec4(0, 0, 0, 0);
+
+        spotFactor = 1.0f - (1.0f - slFactor)*(1.0f/(1.0f - attenuationEdge.w));
+    }
+
+    Light light = Light(colourIntensity.rgb, 0.0, colourIntensity.a);
+    vec4 colour = CalcLightByDirection(light, direction, 0.0);
+
+    float attenuation = attenuationEdge.z * distance * distance +
+        attenuationEdge.y * distance +
+        attenuationEdge.x;
+
+    // Fades out towards the range the clusters were built with, so the light doesn't end on a cluster border
+    float window = clamp(1.0 - pow(distance / positionRange.w, 4.0), 0.0, 1.0);
+
+    return colour / attenuation * window * window * spotFactor;
+}
+
+vec4 CalcClusteredLights() {
+    uvec2 tile = uvec2(gl_FragCoord.xy / clusterScreenSize * vec2(clusterDims.xy));
+    uint slice = uint(max(log(ViewDepth) * clusterZScale - clusterZBias, 0.0));
+    uvec3 cluster = min(uvec3(tile, slice), clusterDims - 1u);
+
+    uvec2 list = texelFetch(clusterGrid, int(cluster.x + clusterDims.x * ( cluster.y + clusterDims.y * cluster.z ))).xy;
+
+    vec4 totalColour = vec4(0, 0, 0, 0);
+
+    for( uint i = 0u; i < list.y; i++ ) {
+        totalColour += CalcClusteredLight(int(texelFetch(clusterLightIndices, int(list.x + i)).r));
+    }
+
+    return totalColour;
+}
\ No newline at end of file
@@ -0,0 +1,36 @@
+// Light structs shared by the lighting shaders. MAX_POINT_LIGHTS and MAX_SPOT_LIGHTS are injected from Constans.h.
+
+struct Light {
+    vec3 colour;
+    float ambientIntensity;
+    float diffuseIntensity;
+};
+
+struct DirectionalLight {
+    Light base;
+    vec3 direction;
+};
+
+struct PointLight {
+    Light base;
+    vec3 position;
+    float constant;
+    float linear;
+    float exponent;
+};
+
+struct SpotLight {
+    PointLight base;
+    vec3 direction;
+    float edge;
+};
+
+struct OmniShadowMap {
+    samplerCubeShadow shadowMap;
+    float farPlane;
+};
+
+struct Material {
+    float specularIntensity;
+    float shininess;
+};
\ No newline at end of file
@@ -0,0 +1,22 @@
+#version 330
+
+out vec4 colour;
+
+#include "Lights.glsl"
+#include "GBuffer.glsl"
+
+uniform DirectionalLight directionalLight;
+
+#include "Lighting.glsl"
+
+void main() {
+    vec3 albedo;
+
+    if ( !ReadGBuffer(albedo) ) discard;
+
+    float shadowFactor = CalcDirectionalShadowFactor(directionalLight);
+    vec4 finalColour = CalcLightByDirection(directionalLight.base, directionalLight.direction, shadowFactor);
+    finalColour += CalcClusteredLights();
+
+    colour = vec4(albedo, 1.0) * finalColour;
+}
\ No newline at end of file
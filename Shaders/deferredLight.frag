@@ -0,0 +1,32 @@
+#version 330
+
+out vec4 colour;
+
+// One shadowed light per draw, its cube map always sits in the first slot
+#define OMNI_SHADOW_MAP_COUNT 1
+
+#include "Lights.glsl"
+#include "GBuffer.glsl"
+
+uniform PointLight pointLights[1];
+uniform SpotLight spotLights[1];
+uniform bool isSpotLight;
+
+// Where the light volume ends, the light fades to nothing there whether it's drawn as a volume or full screen
+uniform float lightRange;
+
+#include "Lighting.glsl"
+
+void main() {
+    vec3 albedo;
+
+    if ( !ReadGBuffer(albedo) ) discard;
+
+    vec4 lightColour = isSpotLight ? CalcSpotLight(spotLights[0], 0) : CalcPointLight(pointLights[0], 0);
+
+    // The same window as the clustered lights, the volume's edge doesn't show
+    vec3 position = isSpotLight ? spotLights[0].base.position : pointLights[0].position;
+    float window = clamp(1.0 - pow(length(FragPos - position) / lightRange, 4.0), 0.0, 1.0);
+
+    colour = vec4(albedo, 1.0) * lightColour * window * window;
+}
\ No newline at end of file
@@ -0,0 +1,19 @@
+#version 330
+
+layout (location = 0) in vec3 pos;
+
+uniform mat4 model;
+uniform mat4 projection;
+uniform mat4 view;
+
+uniform bool fullScreen;
+
+void main() {
+    if ( fullScreen ) {
+        // One triangle covering the screen, drawn without a vertex buffer
+        vec2 corner = vec2(( gl_VertexID << 1 ) & 2, gl_VertexID & 2);
+        gl_Position = vec4(corner * 2.0 - 1.0, 0.0, 1.0);
+    } else {
+        gl_Position = projection * view * model * vec4(pos, 1.0);
+    }
+}
\ No newline at end of file
@@ -0,0 +1,4 @@
+#version 330
+
+// The stencil pass only needs the depth test on the light volume, nothing is written to colour
+void main() {  }
\ No newline at end of file
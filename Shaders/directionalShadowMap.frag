@@ -1,5 +1,8 @@
 #version 330
 
-void main() {
+// Only stored when the prefiltered quality attaches a moments layer, otherwise the depth is all that's kept
+layout (location = 0) out float moment;
 
+void main() {
+    moment = exp(float(ESM_EXPONENT) * gl_FragCoord.z);
 }
\ No newline at end of file
@@ -2,7 +2,8 @@
 
 layout (location = 0) in vec3 pos;
 
-uniform mat4 model;
+#include "DrawData.glsl"
+
 uniform mat4 directionalLightTransform;
 
 void main() {
@@ -0,0 +1,20 @@
+#version 330
+
+in vec2 TexCoord;
+in vec3 Normal;
+flat in float TextureLayer;
+
+layout (location = 0) out vec4 gAlbedo;
+layout (location = 1) out vec3 gNormal;
+layout (location = 2) out vec2 gSpecular;
+
+#include "Lights.glsl"
+
+#include "DrawData.glsl"
+#include "Albedo.glsl"
+
+void main() {
+    gAlbedo = SampleAlbedo();
+    gNormal = Normal;
+    gSpecular = drawMaterial.xy;
+}
\ No newline at end of file
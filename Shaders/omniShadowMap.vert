@@ -2,7 +2,7 @@
 
 layout (location = 0) in vec3 pos;
 
-uniform mat4 model;
+#include "DrawData.glsl"
 
 void main() {
     gl_Position = model * vec4(pos, 1.0);
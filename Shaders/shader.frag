@@ -4,174 +4,36 @@ in vec4 vCol;
 in vec2 TexCoord;
 in vec3 Normal;
 in vec3 FragPos;
-in vec4 DirectionalLightSpacePos;
+in float ViewDepth;
+flat in float TextureLayer;
 
 out vec4 colour;
 
-const int MAX_POINT_LIGHTS = 3;
-const int MAX_SPOT_LIGHTS = 3;
-
-struct Light {
-    vec3 colour;
-    float ambientIntensity;
-    float diffuseIntensity;
-};
-
-struct DirectionalLight {
-    Light base;
-    vec3 direction;
-};
-
-struct PointLight {
-    Light base;
-    vec3 position;
-    float constant;
-    float linear;
-    float exponent;
-};
-
-struct SpotLight {
-    PointLight base;
-    vec3 direction;
-    float edge;
-};
-
-struct OmniShadowMap {
-    samplerCube shadowMap;
-    float farPlane;
-};
-
-struct Material {
-    float specularIntensity;
-    float shininess;
-};
+#include "Lights.glsl"
 
+// Specialized variants get their light counts as constants so the light loops unroll, the generic build reads them from uniforms
+#ifdef POINT_LIGHT_COUNT
+#define pointLightCount POINT_LIGHT_COUNT
+#else
 uniform int pointLightCount;
+#endif
+
+#ifdef SPOT_LIGHT_COUNT
+#define spotLightCount SPOT_LIGHT_COUNT
+#else
 uniform int spotLightCount;
+#endif
 
 uniform DirectionalLight directionalLight;
 uniform PointLight pointLights[MAX_POINT_LIGHTS];
 uniform SpotLight spotLights[MAX_SPOT_LIGHTS];
 
-uniform sampler2D Texture;
-uniform sampler2D directionalShadowMap;
-
-uniform OmniShadowMap omniShadowMaps[MAX_SPOT_LIGHTS + MAX_SPOT_LIGHTS];
-
-uniform Material material;
-
-uniform vec3 eyePosition;
-
-vec3 gridSamplingDisk[20] = vec3[] (
-    vec3(1, 1,  1), vec3( 1, -1,  1), vec3(-1, -1,  1), vec3(-1, 1,  1),
-    vec3(1, 1, -1), vec3( 1, -1, -1), vec3(-1, -1, -1), vec3(-1, 1, -1),
-    vec3(1, 1,  0), vec3( 1, -1,  0), vec3(-1, -1,  0), vec3(-1, 1,  0),
-    vec3(1, 0,  1), vec3(-1,  0,  1), vec3( 1,  0, -1), vec3(-1, 0, -1),
-    vec3(0, 1,  1), vec3( 0, -1,  1), vec3( 0, -1, -1), vec3( 0, 1, -1)
-);
-
-float CalcDirectionalShadowFactor(DirectionalLight light) {
-    vec3 projCoords = DirectionalLightSpacePos.xyz / DirectionalLightSpacePos.w;
-    projCoords = ( projCoords * 0.5 ) + 0.5;
-
-    float current = projCoords.z;
-
-    vec3 normal = normalize(Normal);
-    vec3 lightDir = normalize(light.direction);
-
-    float bias = max(0.05 * ( 1 - dot(normal, lightDir) ), 0.005);
-
-    float shadow = 0.0;
-    vec2 texelSize = 1.0 / textureSize(directionalShadowMap, 0);
-
-    for ( int x = -1; x <= 1; x++ ) {
-        for ( int y = -1; y <= 1; y++ ) {
-            float pcfDepth = texture(directionalShadowMap, projCoords.xy + vec2(x, y) * texelSize).r;
-            shadow += current - bias > pcfDepth ? 1.0 : 0.0;
-        }
-    }
-
-    shadow /= 9.0;
-
-    if ( projCoords.z > 1.0 ) shadow = 0;
-
-    return shadow;
-}
-
-float CalcOmniShadowFactor(PointLight light, int shadowIndex) {
-    vec3 fragToLight = FragPos - light.position;
-    float current = length(fragToLight);
-
-    float shadow = 0.0;
-    float bias = 0.05;
-    int samples = 20;
-
-    float viewDistance = length(eyePosition - FragPos);
-    float diskRadius = ( 1.0 + ( viewDistance / omniShadowMaps[shadowIndex].farPlane ) ) / 25.0;
-
-    for ( int i = 0; i < samples; i++ ) {
-        float closest = texture(omniShadowMaps[shadowIndex].shadowMap, fragToLight + gridSamplingDisk[i] * diskRadius).r;
-        closest *= omniShadowMaps[shadowIndex].farPlane;
-
-        if ( current - bias > closest ) shadow += 1.0;
-    }
-
-    shadow /= float(samples);
-
-    return shadow;
-}
-
-vec4 CalcLightByDirection(Light light, vec3 direction, float shadowFactor) {
-    vec4 ambientColour = vec4(light.colour, 1.0f) * light.ambientIntensity;
-
-    float diffuseFactor = max( dot( normalize(Normal), normalize(direction) ), 0.0f);
-    vec4 diffuseColour = vec4(light.colour * light.diffuseIntensity * diffuseFactor, 1.0f);
-
-    vec4 specularColour = vec4(0, 0, 0, 0);
-
-    if( diffuseFactor > 0.0f ) {
-        vec3 fragToEye = normalize(eyePosition - FragPos);
-        vec3 reflectedVertex = normalize(reflect(direction, normalize(Normal)));
-
-        float specularFactor = dot(fragToEye, reflectedVertex);
-
-        if( specularFactor > 0.0f ) {
-            specularFactor = pow(specularFactor, material.shininess);
-            specularColour = vec4(light.colour * material.specularIntensity * specularFactor, 1.0f);
-        }
-    }
-
-    return ( ambientColour + ( 1.0 - shadowFactor ) * ( diffuseColour + specularColour ) );
-}
-
-vec4 CalcPointLight(PointLight pLight, int shadowIndex) {
-    vec3 direction = FragPos - pLight.position;
-    float distance = length(direction);
-    direction = normalize(direction);
-
-    float shadowFactor = CalcOmniShadowFactor(pLight, shadowIndex);
-
-    vec4 colour = CalcLightByDirection(pLight.base, direction, shadowFactor);
-    float attenuation = pLight.exponent * distance * distance +
-        pLight.linear * distance +
-        pLight.constant;
-
-    return (colour / attenuation);
-}
+#include "DrawData.glsl"
+#include "Albedo.glsl"
 
-vec4 CalcSpotLight(SpotLight sLight, int shadowIndex) {
-    vec3 rayDirection = normalize(FragPos - sLight.base.position);
-    float slFactor = dot(rayDirection, sLight.direction);
+Material material;
 
-    if( slFactor > sLight.edge ) {
-        vec4 colour = CalcPointLight(sLight.base, shadowIndex);
-
-        return colour * (1.0f - (1.0f - slFactor)*(1.0f/(1.0f - sLight.edge)));
-
-    } else {
-        return vec4(0, 0, 0, 0);
-    }
-}
+#include "Lighting.glsl"
 
 vec4 CalcPointLights() {
     vec4 totalColour = vec4(0, 0, 0, 0);
@@ -194,10 +56,13 @@ vec4 CalcSpotLights() {
 }
 
 void main() {
+    material = Material(drawMaterial.x, drawMaterial.y);
+
     float shadowFactor = CalcDirectionalShadowFactor(directionalLight);
     vec4 finalColour = CalcLightByDirection(directionalLight.base, directionalLight.direction, shadowFactor);
     finalColour += CalcPointLights();
     finalColour += CalcSpotLights();
+    finalColour += CalcClusteredLights();
 
-    colour = texture(Texture, TexCoord) * finalColour;
+    colour = SampleAlbedo() * finalColour;
 }
\ No newline at end of file
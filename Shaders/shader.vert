@@ -3,28 +3,33 @@
 layout (location = 0) in vec3 pos;
 layout (location = 1) in vec2 tex;
 layout (location = 2) in vec3 norm;
+layout (location = 3) in float layer;
 
 out vec4 vCol;
 out vec2 TexCoord;
 out vec3 Normal;
 out vec3 FragPos;
-out vec4 DirectionalLightSpacePos;
+out float ViewDepth;
+flat out float TextureLayer;
+
+#include "DrawData.glsl"
 
-uniform mat4 model;
 uniform mat4 projection;
 uniform mat4 view;
-uniform mat4 directionalLightTransform;
 
 void main() {
-    gl_Position = projection * view * model * vec4(pos, 1.0);
+    vec4 viewPos = view * model * vec4(pos, 1.0);
+    gl_Position = projection * viewPos;
 
-    DirectionalLightSpacePos = directionalLightTransform * model * vec4(pos, 1.0);
+    // Positive distance along the view axis, picks the depth slice of the light clusters and the shadow cascade
+    ViewDepth = -viewPos.z;
 
     vCol = vec4(clamp(pos, 0.0f, 1.0f), 1.0f);
 
     TexCoord = tex;
+    TextureLayer = layer;
 
-    Normal = mat3(transpose(inverse(model))) * norm;
+    Normal = mat3(normalMatrix) * norm;
 
     FragPos = (model * vec4(pos, 1.0)).xyz;
 }
\ No newline at end of file
@@ -0,0 +1,22 @@
+#version 330
+
+// 9 tap Gaussian along one axis in 5 fetches, the offsets land between texels so linear filtering adds the pairs
+uniform sampler2DArray source;
+uniform int layer;
+uniform vec2 direction;
+
+out float moment;
+
+const float offsets[3] = float[] (0.0, 1.3846153846, 3.2307692308);
+const float weights[3] = float[] (0.2270270270, 0.3162162162, 0.0702702703);
+
+void main() {
+    vec2 uv = gl_FragCoord.xy / vec2(textureSize(source, 0).xy);
+
+    moment = texture(source, vec3(uv, layer)).r * weights[0];
+
+    for ( int i = 1; i < 3; i++ ) {
+        moment += texture(source, vec3(uv + direction * offsets[i], layer)).r * weights[i];
+        moment += texture(source, vec3(uv - direction * offsets[i], layer)).r * weights[i];
+    }
+}
\ No newline at end of file
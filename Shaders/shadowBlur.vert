@@ -0,0 +1,7 @@
+#version 330
+
+void main() {
+    // One triangle covering the target, drawn without a vertex buffer
+    vec2 corner = vec2(( gl_VertexID << 1 ) & 2, gl_VertexID & 2);
+    gl_Position = vec4(corner * 2.0 - 1.0, 0.0, 1.0);
+}
\ No newline at end of file
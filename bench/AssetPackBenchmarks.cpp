@@ -0,0 +1,49 @@
+#include <benchmark/benchmark.h>
+
+#include "SyntheticData.h"
+#include "AssetPack.h"
+#include "FileSystem.h"
+
+// The same synthetic shader read loose, from a pack as is (a view into the mapping) and from a pack LZ4 compressed
+static void BM_LooseFileRead(benchmark::State& _state) {
+    std::string filePath = WriteSyntheticShader(_state.range(0));
+
+    for ( auto _ : _state ) {
+        std::vector<unsigned char> data;
+        FileSystem::ReadLooseFile(filePath, data);
+        benchmark::DoNotOptimize(data.data());
+    }
+
+    RemoveSyntheticFile(filePath);
+
+    _state.SetBytesProcessed(_state.iterations() * _state.range(0));
+}
+BENCHMARK(BM_LooseFileRead)->RangeMultiplier(8)->Range(1 << 10, 1 << 20)->Unit(benchmark::kMicrosecond);
+
+static void BM_AssetPackRead(benchmark::State& _state) {
+    std::string filePath = WriteSyntheticShader(_state.range(0));
+    std::string packPath = filePath + ".pak";
+
+    std::vector<unsigned char> data;
+    FileSystem::ReadLooseFile(filePath, data);
+
+    AssetPackWriter writer;
+    writer.Add(filePath, std::move(data), _state.range(1) != 0);
+    writer.Write(packPath);
+
+    AssetPack pack;
+    pack.Open(packPath);
+
+    for ( auto _ : _state ) {
+        FileData file;
+        pack.Read(filePath, file);
+        benchmark::DoNotOptimize(file.data);
+    }
+
+    pack.Close();
+    RemoveSyntheticFile(packPath);
+    RemoveSyntheticFile(filePath);
+
+    _state.SetBytesProcessed(_state.iterations() * _state.range(0));
+}
+BENCHMARK(BM_AssetPackRead)->ArgsProduct({ { 1 << 10, 1 << 13, 1 << 16, 1 << 19 }, { 0, 1 } })->Unit(benchmark::kMicrosecond);
@@ -0,0 +1,77 @@
+#include <cmath>
+
+#include <benchmark/benchmark.h>
+
+#include "glm/gtc/matrix_transform.hpp"
+
+#include "PointLight.h"
+#include "LightClusters.h"
+#include "Shader.h"
+
+static void BM_PointLightCalcLightTransform(benchmark::State& _state) {
+    glm::mat4 lightProj = glm::perspective(glm::radians(90.0f), 1.0f, 0.1f, 100.0f);
+    std::vector<glm::vec3> positions(_state.range(0));
+
+    for ( size_t i = 0; i < positions.size(); i++ ) {
+        positions[i] = glm::vec3(i * 0.5f, 2.0f, -( i * 0.25f ));
+    }
+
+    for ( auto _ : _state ) {
+        for ( const auto& position : positions ) {
+            auto transforms = PointLight::CalcLightTransform(lightProj, position);
+            benchmark::DoNotOptimize(transforms.data());
+        }
+    }
+
+    _state.SetItemsProcessed(_state.iterations() * positions.size());
+}
+BENCHMARK(BM_PointLightCalcLightTransform)->RangeMultiplier(4)->Range(1, 1024);
+
+// Stands in for the driver so the uniform name building can be measured without a GL context
+static GLint GLAPIENTRY NullGetUniformLocation(GLuint, const GLchar* _name) {
+    benchmark::DoNotOptimize(_name);
+    return 0;
+}
+
+static void BM_PointLightGetUPointLight(benchmark::State& _state) {
+    auto previous = __glewGetUniformLocation;
+    __glewGetUniformLocation = NullGetUniformLocation;
+
+    Shader shader;
+    std::vector<UniformPointLight> uniformPointLight(_state.range(0));
+
+    for ( auto _ : _state ) {
+        PointLight::GetUPointLight(shader, uniformPointLight);
+        benchmark::DoNotOptimize(uniformPointLight.data());
+    }
+
+    __glewGetUniformLocation = previous;
+
+    _state.SetItemsProcessed(_state.iterations() * uniformPointLight.size());
+}
+BENCHMARK(BM_PointLightGetUPointLight)->RangeMultiplier(4)->Range(1, 256);
+
+static void BM_LightClustersAssign(benchmark::State& _state) {
+    LightClusters clusters;
+    clusters.SetProjection(glm::perspective(glm::radians(60.0f), 1366.0f / 768.0f, 0.1f, 100.0f), 0.1f, 100.0f);
+
+    glm::mat4 view = glm::lookAt(glm::vec3(0.0f, 1.0f, 5.0f), glm::vec3(0.0f), glm::vec3(0.0f, 1.0f, 0.0f));
+    std::vector<ClusterLight> lights(_state.range(0));
+
+    for ( size_t i = 0; i < lights.size(); i++ ) {
+        float angle = i * 2.39996f;
+        float distance = 1.0f + i * 0.05f;
+
+        lights[i] = { glm::vec3(std::cos(angle) * distance, -1.5f, std::sin(angle) * distance), glm::vec3(1.0f, 0.8f, 0.6f), 0.4f,
+                      1.0f, 0.7f, 1.8f, glm::vec3(0.0f, -1.0f, 0.0f), i % 4 == 0 ? 30.0f : 0.0f };
+    }
+
+    for ( auto _ : _state ) {
+        clusters.Assign(view, lights);
+        benchmark::DoNotOptimize(clusters.GetIndexCount());
+    }
+
+    _state.SetItemsProcessed(_state.iterations() * lights.size());
+    _state.counters["indices"] = clusters.GetIndexCount();
+}
+BENCHMARK(BM_LightClustersAssign)->RangeMultiplier(4)->Range(16, 4096)->UseRealTime();
\ No newline at end of file
@@ -0,0 +1,47 @@
+#include <memory>
+
+#include <benchmark/benchmark.h>
+
+#include <assimp/scene.h>
+
+#include "SyntheticData.h"
+#include "Mesh.h"
+#include "Model.h"
+#include "NormalGenerator.h"
+
+static void BM_GenerateNormals(benchmark::State& _state) {
+    std::vector<Shape> vertices;
+    std::vector<GLuint> indices;
+    MakeGridMesh(_state.range(0), vertices, indices);
+
+    auto weighting = static_cast<NormalWeighting>(_state.range(1));
+
+    for ( auto _ : _state ) {
+        NormalGenerator::Generate(indices, vertices, weighting);
+        benchmark::DoNotOptimize(vertices.data());
+    }
+
+    _state.SetItemsProcessed(_state.iterations() * ( indices.size() / 3 ));
+    _state.counters["triangles"] = indices.size() / 3;
+}
+BENCHMARK(BM_GenerateNormals)
+        ->ArgsProduct({ benchmark::CreateRange(16, 2048, 4), { static_cast<int64_t>(NormalWeighting::Uniform),
+                static_cast<int64_t>(NormalWeighting::Area), static_cast<int64_t>(NormalWeighting::Angle) } })
+        ->ArgNames({ "quads", "weighting" })->Unit(benchmark::kMicrosecond)->UseRealTime();
+
+static void BM_ModelConvertMesh(benchmark::State& _state) {
+    std::unique_ptr<aiMesh> mesh(MakeAssimpGridMesh(_state.range(0)));
+
+    for ( auto _ : _state ) {
+        std::vector<Shape> vertices;
+        std::vector<unsigned int> indices;
+
+        Model::ConvertMesh(mesh.get(), vertices, indices);
+        benchmark::DoNotOptimize(vertices.data());
+        benchmark::DoNotOptimize(indices.data());
+    }
+
+    _state.SetItemsProcessed(_state.iterations() * mesh->mNumVertices);
+    _state.counters["vertices"] = mesh->mNumVertices;
+}
+BENCHMARK(BM_ModelConvertMesh)->RangeMultiplier(4)->Range(16, 1024)->Unit(benchmark::kMicrosecond);
@@ -0,0 +1,90 @@
+#include <cmath>
+
+#include <benchmark/benchmark.h>
+
+#include "glm/gtc/matrix_transform.hpp"
+
+#include "OcclusionCuller.h"
+
+namespace {
+    // A wall of quads across the view, split into cells so the occluder is made of many small triangles
+    void MakeWall(int _cells, std::vector<glm::vec3>& _positions, std::vector<GLuint>& _indices) {
+        _positions.clear();
+        _indices.clear();
+
+        for ( int y = 0; y <= _cells; y++ ) {
+            for ( int x = 0; x <= _cells; x++ ) {
+                _positions.push_back(glm::vec3(-20.0f + 40.0f * x / _cells, -10.0f + 20.0f * y / _cells, -10.0f));
+            }
+        }
+
+        for ( int y = 0; y < _cells; y++ ) {
+            for ( int x = 0; x < _cells; x++ ) {
+                GLuint corner = y * ( _cells + 1 ) + x;
+                _indices.insert(_indices.end(), { corner, corner + 1, corner + _cells + 1, corner + 1, corner + _cells + 2, corner + _cells + 1 });
+            }
+        }
+    }
+
+    glm::mat4 MakeCameraViewProjection() {
+        return glm::perspective(glm::radians(60.0f), 1366.0f / 768.0f, 0.1f, 100.0f)
+             * glm::lookAt(glm::vec3(0.0f), glm::vec3(0.0f, 0.0f, -1.0f), glm::vec3(0.0f, 1.0f, 0.0f));
+    }
+}
+
+static void BM_OcclusionRasterize(benchmark::State& _state) {
+    std::vector<glm::vec3> positions;
+    std::vector<GLuint> indices;
+    MakeWall(_state.range(0), positions, indices);
+
+    OcclusionCuller culler;
+    glm::mat4 viewProjection = MakeCameraViewProjection();
+
+    for ( auto _ : _state ) {
+        culler.Begin(viewProjection);
+        culler.AddOccluder(positions, indices, glm::mat4(1.0f));
+        culler.Rasterize();
+        benchmark::ClobberMemory();
+    }
+
+    _state.SetItemsProcessed(_state.iterations() * indices.size() / 3);
+}
+BENCHMARK(BM_OcclusionRasterize)->RangeMultiplier(4)->Range(4, 64);
+
+// Boxes half in front of the wall and half behind it, most of the hidden ones settled on the tile depths
+static void BM_OcclusionTestBoxes(benchmark::State& _state) {
+    std::vector<glm::vec3> positions;
+    std::vector<GLuint> indices;
+    MakeWall(16, positions, indices);
+
+    OcclusionCuller culler;
+    culler.Begin(MakeCameraViewProjection());
+    culler.AddOccluder(positions, indices, glm::mat4(1.0f));
+    culler.Rasterize();
+
+    size_t count = _state.range(0), visible = 0;
+    std::vector<glm::vec3> boundsMin(count), boundsMax(count);
+
+    for ( size_t i = 0; i < count; i++ ) {
+        glm::vec3 center(std::fmod(i * 0.618034f, 1.0f) * 16.0f - 8.0f, std::fmod(i * 0.414214f, 1.0f) * 8.0f - 4.0f,
+                         -5.0f - std::fmod(i * 0.732051f, 1.0f) * 15.0f);
+        glm::vec3 extent(0.25f + std::fmod(i * 0.236068f, 1.0f) * 0.5f);
+
+        boundsMin[i] = center - extent;
+        boundsMax[i] = center + extent;
+    }
+
+    for ( auto _ : _state ) {
+        visible = 0;
+
+        for ( size_t i = 0; i < count; i++ ) {
+            visible += culler.IsVisible(boundsMin[i], boundsMax[i]);
+        }
+
+        benchmark::DoNotOptimize(visible);
+    }
+
+    _state.SetItemsProcessed(_state.iterations() * count);
+    _state.counters["visible"] = visible;
+}
+BENCHMARK(BM_OcclusionTestBoxes)->RangeMultiplier(4)->Range(256, 4096);
\ No newline at end of file
@@ -0,0 +1,111 @@
+#include <cmath>
+
+#include <benchmark/benchmark.h>
+
+#include "SyntheticData.h"
+#include "TriangleBVH.h"
+
+namespace {
+    void MakeGridBVH(size_t _quads, TriangleBVH& _bvh) {
+        std::vector<Shape> vertices;
+        std::vector<GLuint> indices;
+        MakeGridMesh(_quads, vertices, indices);
+
+        std::vector<glm::vec3> positions;
+
+        for ( const Shape& vertex : vertices ) {
+            positions.push_back(vertex.position);
+        }
+
+        _bvh.Build(positions, indices);
+    }
+
+    // Rays from above the wavy grid at a slant, a fixed set so every run traces the same ones
+    void MakeRays(size_t _count, std::vector<glm::vec3>& _origins, std::vector<glm::vec3>& _directions) {
+        _origins.resize(_count);
+        _directions.resize(_count);
+
+        for ( size_t i = 0; i < _count; i++ ) {
+            _origins[i] = glm::vec3(std::fmod(i * 0.618034f, 1.0f) * 20.0f - 10.0f, 5.0f, std::fmod(i * 0.414214f, 1.0f) * 20.0f - 10.0f);
+            _directions[i] = glm::normalize(glm::vec3(std::fmod(i * 0.732051f, 1.0f) - 0.5f, -1.0f, std::fmod(i * 0.236068f, 1.0f) - 0.5f));
+        }
+    }
+
+    const size_t RAYS = 4096;
+}
+
+static void BM_TriangleBVHBuild(benchmark::State& _state) {
+    std::vector<Shape> vertices;
+    std::vector<GLuint> indices;
+    MakeGridMesh(_state.range(0), vertices, indices);
+
+    std::vector<glm::vec3> positions;
+
+    for ( const Shape& vertex : vertices ) {
+        positions.push_back(vertex.position);
+    }
+
+    TriangleBVH bvh;
+
+    for ( auto _ : _state ) {
+        bvh.Build(positions, indices);
+        benchmark::DoNotOptimize(bvh.GetNodeCount());
+    }
+
+    _state.SetItemsProcessed(_state.iterations() * ( indices.size() / 3 ));
+    _state.counters["triangles"] = indices.size() / 3;
+    _state.counters["bytes"] = bvh.GetMemoryBytes();
+}
+BENCHMARK(BM_TriangleBVHBuild)->RangeMultiplier(4)->Range(16, 1024)->Unit(benchmark::kMillisecond)->UseRealTime();
+
+// Closest hit, items per second is rays per second on one core
+static void BM_TriangleBVHRaycast(benchmark::State& _state) {
+    TriangleBVH bvh;
+    MakeGridBVH(_state.range(0), bvh);
+
+    std::vector<glm::vec3> origins, directions;
+    MakeRays(RAYS, origins, directions);
+
+    size_t hits = 0;
+
+    for ( auto _ : _state ) {
+        hits = 0;
+
+        for ( size_t i = 0; i < RAYS; i++ ) {
+            RayHit hit;
+            hits += bvh.Raycast(origins[i], directions[i], 100.0f, hit);
+        }
+
+        benchmark::DoNotOptimize(hits);
+    }
+
+    _state.SetItemsProcessed(_state.iterations() * RAYS);
+    _state.counters["triangles"] = bvh.GetTriangleCount();
+    _state.counters["hits"] = hits;
+}
+BENCHMARK(BM_TriangleBVHRaycast)->RangeMultiplier(4)->Range(16, 1024);
+
+// Any hit, what line of sight checks pay
+static void BM_TriangleBVHOccluded(benchmark::State& _state) {
+    TriangleBVH bvh;
+    MakeGridBVH(_state.range(0), bvh);
+
+    std::vector<glm::vec3> origins, directions;
+    MakeRays(RAYS, origins, directions);
+
+    size_t occluded = 0;
+
+    for ( auto _ : _state ) {
+        occluded = 0;
+
+        for ( size_t i = 0; i < RAYS; i++ ) {
+            occluded += bvh.Occluded(origins[i], directions[i], 100.0f);
+        }
+
+        benchmark::DoNotOptimize(occluded);
+    }
+
+    _state.SetItemsProcessed(_state.iterations() * RAYS);
+    _state.counters["occluded"] = occluded;
+}
+BENCHMARK(BM_TriangleBVHOccluded)->RangeMultiplier(4)->Range(16, 1024);
\ No newline at end of file
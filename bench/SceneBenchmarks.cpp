@@ -0,0 +1,109 @@
+#include <cmath>
+
+#include <benchmark/benchmark.h>
+
+#include "glm/gtc/matrix_transform.hpp"
+
+#include "SceneBVH.h"
+
+namespace {
+    // Boxes scattered over a square field a few units high, spread so the camera sees about the same share at every size
+    void MakeSceneBoxes(size_t _count, std::vector<glm::vec3>& _boundsMin, std::vector<glm::vec3>& _boundsMax) {
+        float side = std::sqrt(static_cast<float>(_count)) * 4.0f;
+
+        _boundsMin.resize(_count);
+        _boundsMax.resize(_count);
+
+        for ( size_t i = 0; i < _count; i++ ) {
+            glm::vec3 center(std::fmod(i * 0.618034f, 1.0f) * side - side * 0.5f, std::fmod(i * 0.414214f, 1.0f) * 4.0f,
+                             std::fmod(i * 0.732051f, 1.0f) * side - side * 0.5f);
+            glm::vec3 extent(0.5f + std::fmod(i * 0.236068f, 1.0f));
+
+            _boundsMin[i] = center - extent;
+            _boundsMax[i] = center + extent;
+        }
+    }
+
+    glm::mat4 MakeCameraViewProjection() {
+        return glm::perspective(glm::radians(60.0f), 1366.0f / 768.0f, 0.1f, 100.0f)
+             * glm::lookAt(glm::vec3(0.0f, 2.0f, 0.0f), glm::vec3(0.0f, 0.0f, -1.0f), glm::vec3(0.0f, 1.0f, 0.0f));
+    }
+}
+
+static void BM_SceneLinearFrustumCull(benchmark::State& _state) {
+    std::vector<glm::vec3> boundsMin, boundsMax;
+    MakeSceneBoxes(_state.range(0), boundsMin, boundsMax);
+
+    Frustum frustum(MakeCameraViewProjection());
+    std::vector<uint32_t> visible;
+
+    for ( auto _ : _state ) {
+        visible.clear();
+
+        for ( size_t i = 0; i < boundsMin.size(); i++ ) {
+            if ( frustum.Intersects(boundsMin[i], boundsMax[i]) ) visible.push_back(i);
+        }
+
+        benchmark::DoNotOptimize(visible.data());
+    }
+
+    _state.SetItemsProcessed(_state.iterations() * boundsMin.size());
+    _state.counters["visible"] = visible.size();
+}
+BENCHMARK(BM_SceneLinearFrustumCull)->RangeMultiplier(4)->Range(256, 65536);
+
+static void BM_SceneBVHFrustumQuery(benchmark::State& _state) {
+    std::vector<glm::vec3> boundsMin, boundsMax;
+    MakeSceneBoxes(_state.range(0), boundsMin, boundsMax);
+
+    SceneBVH bvh;
+
+    for ( size_t i = 0; i < boundsMin.size(); i++ ) {
+        bvh.Insert(boundsMin[i], boundsMax[i], i);
+    }
+
+    Frustum frustum(MakeCameraViewProjection());
+    std::vector<uint32_t> visible;
+
+    for ( auto _ : _state ) {
+        bvh.Query(frustum, visible);
+        benchmark::DoNotOptimize(visible.data());
+    }
+
+    _state.SetItemsProcessed(_state.iterations() * boundsMin.size());
+    _state.counters["visible"] = visible.size();
+    _state.counters["visited"] = bvh.GetVisitedCount();
+}
+BENCHMARK(BM_SceneBVHFrustumQuery)->RangeMultiplier(4)->Range(256, 65536);
+
+// One object in a hundred moves every frame, the refits plus the camera query that follows
+static void BM_SceneBVHRefit(benchmark::State& _state) {
+    std::vector<glm::vec3> boundsMin, boundsMax;
+    MakeSceneBoxes(_state.range(0), boundsMin, boundsMax);
+
+    SceneBVH bvh;
+    std::vector<int> proxies(boundsMin.size());
+
+    for ( size_t i = 0; i < boundsMin.size(); i++ ) {
+        proxies[i] = bvh.Insert(boundsMin[i], boundsMax[i], i);
+    }
+
+    Frustum frustum(MakeCameraViewProjection());
+    std::vector<uint32_t> visible;
+    float angle = 0.0f;
+
+    for ( auto _ : _state ) {
+        angle += 0.1f;
+        glm::vec3 offset(std::cos(angle) * 0.5f, 0.0f, std::sin(angle) * 0.5f);
+
+        for ( size_t i = 0; i < proxies.size(); i += 100 ) {
+            bvh.Update(proxies[i], boundsMin[i] + offset, boundsMax[i] + offset);
+        }
+
+        bvh.Query(frustum, visible);
+        benchmark::DoNotOptimize(visible.data());
+    }
+
+    _state.SetItemsProcessed(_state.iterations() * ( proxies.size() + 99 ) / 100);
+}
+BENCHMARK(BM_SceneBVHRefit)->RangeMultiplier(4)->Range(256, 65536);
\ No newline at end of file
@@ -0,0 +1,18 @@
+#include <benchmark/benchmark.h>
+
+#include "SyntheticData.h"
+#include "Shader.h"
+
+static void BM_ShaderReadFile(benchmark::State& _state) {
+    std::string filePath = WriteSyntheticShader(_state.range(0));
+
+    for ( auto _ : _state ) {
+        std::string content = Shader::ReadFile(filePath);
+        benchmark::DoNotOptimize(content.data());
+    }
+
+    RemoveSyntheticFile(filePath);
+
+    _state.SetBytesProcessed(_state.iterations() * _state.range(0));
+}
+BENCHMARK(BM_ShaderReadFile)->RangeMultiplier(8)->Range(1 << 10, 1 << 20)->Unit(benchmark::kMicrosecond);
@@ -0,0 +1,101 @@
+#include <cmath>
+#include <cstdio>
+#include <fstream>
+
+#include <assimp/scene.h>
+
+#include "SyntheticData.h"
+
+void MakeGridMesh(size_t _quads, std::vector<Shape>& _vertices, std::vector<GLuint>& _indices) {
+    size_t side = _quads + 1;
+
+    _vertices.clear();
+    _indices.clear();
+    _vertices.reserve(side * side);
+    _indices.reserve(_quads * _quads * 6);
+
+    for ( size_t z = 0; z < side; z++ ) {
+        for ( size_t x = 0; x < side; x++ ) {
+            GLfloat u = static_cast<GLfloat>(x) / _quads, v = static_cast<GLfloat>(z) / _quads;
+            _vertices.emplace_back(u * 20.0f - 10.0f, std::sin(u * 12.0f) * std::cos(v * 9.0f), v * 20.0f - 10.0f,
+                                   u, v, 0.0f, 0.0f, 0.0f);
+        }
+    }
+
+    for ( size_t z = 0; z < _quads; z++ ) {
+        for ( size_t x = 0; x < _quads; x++ ) {
+            GLuint i0 = z * side + x, i1 = i0 + 1, i2 = i0 + side, i3 = i2 + 1;
+            _indices.insert(_indices.end(), { i0, i2, i1, i1, i2, i3 });
+        }
+    }
+}
+
+aiMesh* MakeAssimpGridMesh(size_t _quads) {
+    std::vector<Shape> vertices;
+    std::vector<GLuint> indices;
+    MakeGridMesh(_quads, vertices, indices);
+
+    auto mesh = new aiMesh();
+    mesh->mNumVertices = vertices.size();
+    mesh->mVertices = new aiVector3D[vertices.size()];
+    mesh->mNormals = new aiVector3D[vertices.size()];
+    mesh->mTextureCoords[0] = new aiVector3D[vertices.size()];
+
+    for ( size_t i = 0; i < vertices.size(); i++ ) {
+        mesh->mVertices[i] = aiVector3D(vertices[i].position.x, vertices[i].position.y, vertices[i].position.z);
+        mesh->mNormals[i] = aiVector3D(0.0f, 1.0f, 0.0f);
+        mesh->mTextureCoords[0][i] = aiVector3D(vertices[i].texCoord.x, vertices[i].texCoord.y, 0.0f);
+    }
+
+    mesh->mNumFaces = indices.size() / 3;
+    mesh->mFaces = new aiFace[mesh->mNumFaces];
+
+    for ( size_t i = 0; i < mesh->mNumFaces; i++ ) {
+        mesh->mFaces[i].mNumIndices = 3;
+        mesh->mFaces[i].mIndices = new unsigned int[3] { indices[i * 3], indices[i * 3 + 1], indices[i * 3 + 2] };
+    }
+
+    return mesh;
+}
+
+std::string WriteSyntheticTGA(size_t _size, int _channels) {
+    std::string filePath = "bench_texture_" + std::to_string(_size) + "_" + std::to_string(_channels) + ".tga";
+    std::ofstream file(filePath, std::ios::binary);
+
+    // Uncompressed true-colour header, origin at the top left
+    unsigned char header[18] = { 0, 0, 2 };
+    header[12] = _size & 0xFF; header[13] = (_size >> 8) & 0xFF;
+    header[14] = _size & 0xFF; header[15] = (_size >> 8) & 0xFF;
+    header[16] = _channels * 8;
+    header[17] = 0x20;
+    file.write(reinterpret_cast<const char*>(header), sizeof(header));
+
+    std::vector<unsigned char> row(_size * _channels);
+    unsigned int seed = 0x9E3779B9u;
+
+    for ( size_t y = 0; y < _size; y++ ) {
+        for ( size_t i = 0; i < row.size(); i++ ) {
+            seed = seed * 1664525u + 1013904223u;
+            row[i] = static_cast<unsigned char>(( ( i / _channels ) ^ y ) + ( seed >> 28 ));
+        }
+
+        file.write(reinterpret_cast<const char*>(row.data()), row.size());
+    }
+
+    return filePath;
+}
+
+std::string WriteSyntheticShader(size_t _bytes) {
+    std::string filePath = "bench_shader_" + std::to_string(_bytes) + ".glsl";
+    std::ofstream file(filePath);
+
+    const std::string line = "    totalColour += CalcPointLight(pointLights[i], i) * attenuation;\n";
+
+    for ( size_t written = 0; written < _bytes; written += line.size() ) {
+        file << line;
+    }
+
+    return filePath;
+}
+
+void RemoveSyntheticFile(const std::string& _filePath) { std::remove(_filePath.c_str()); }
@@ -0,0 +1,27 @@
+#ifndef SYNTHETIC_DATA_H
+#define SYNTHETIC_DATA_H
+
+#include <vector>
+#include <string>
+
+#include <GL/glew.h>
+
+#include "Mesh.h"
+
+struct aiMesh;
+
+// Builds a wavy grid of _quads x _quads quads with zeroed normals, the same layout createObjects() feeds to the normal pass
+void MakeGridMesh(size_t _quads, std::vector<Shape>& _vertices, std::vector<GLuint>& _indices);
+
+// Builds an assimp mesh of _quads x _quads quads with normals and one UV channel, as the importer would hand it to Model
+aiMesh* MakeAssimpGridMesh(size_t _quads);
+
+// Writes a _size x _size uncompressed 24 or 32 bit TGA with a noisy pattern and returns its path
+std::string WriteSyntheticTGA(size_t _size, int _channels);
+
+// Writes _bytes of GLSL-looking text and returns its path
+std::string WriteSyntheticShader(size_t _bytes);
+
+void RemoveSyntheticFile(const std::string& _filePath);
+
+#endif
@@ -0,0 +1,43 @@
+#include <vector>
+
+#include <benchmark/benchmark.h>
+
+#include "SyntheticData.h"
+#include "Texture.h"
+#include "TextureStreamer.h"
+
+static void BM_TextureReadImage(benchmark::State& _state) {
+    std::string filePath = WriteSyntheticTGA(_state.range(0), _state.range(1));
+    int width, height, bitDepth;
+
+    for ( auto _ : _state ) {
+        unsigned char* data = Texture::ReadImage(filePath, width, height, bitDepth);
+        benchmark::DoNotOptimize(data);
+        Texture::FreeImage(data);
+    }
+
+    RemoveSyntheticFile(filePath);
+
+    _state.SetBytesProcessed(_state.iterations() * _state.range(0) * _state.range(0) * _state.range(1));
+}
+BENCHMARK(BM_TextureReadImage)->ArgsProduct({ { 64, 256, 1024, 2048 }, { 3, 4 } })->Unit(benchmark::kMicrosecond);
+
+
+// What a streaming worker does after the decode, full chain from level 0
+static void BM_TextureBuildMipChain(benchmark::State& _state) {
+    int size = static_cast<int>(_state.range(0));
+    int channels = static_cast<int>(_state.range(1));
+    std::vector<unsigned char> pixels(static_cast<size_t>(size) * size * channels);
+
+    for ( size_t i = 0; i < pixels.size(); i++ ) pixels[i] = static_cast<unsigned char>(i * 31 + ( i >> 7 ));
+
+    MipChain chain;
+
+    for ( auto _ : _state ) {
+        TextureStreamer::BuildMipChain(pixels.data(), size, size, channels, 0, chain);
+        benchmark::DoNotOptimize(chain.images.data());
+    }
+
+    _state.SetBytesProcessed(_state.iterations() * pixels.size());
+}
+BENCHMARK(BM_TextureBuildMipChain)->ArgsProduct({ { 256, 1024, 2048 }, { 3, 4 } })->Unit(benchmark::kMicrosecond);
\ No newline at end of file
@@ -0,0 +1,50 @@
+#include <atomic>
+#include <chrono>
+#include <thread>
+#include <vector>
+
+#include <benchmark/benchmark.h>
+
+#include "ThreadPool.h"
+
+// A frame's ParallelFor while long background jobs (imports, image decodes) sit in the queue. The caller must only work
+// on its own ranges, so its time stays that of the split work and BackgroundJobsRunInline stays at zero.
+static void BM_ParallelForWithBackgroundJobs(benchmark::State& _state) {
+    ThreadPool& pool = ThreadPool::Get();
+    std::thread::id caller = std::this_thread::get_id();
+    std::atomic<size_t> ranInline(0), finished(0);
+    size_t submitted = 0;
+    std::vector<float> values(1 << 16, 1.0f);
+
+    for ( auto _ : _state ) {
+        _state.PauseTiming();
+
+        for ( int64_t i = 0; i < _state.range(0); i++, submitted++ ) {
+            pool.Submit([&]() {
+                if ( std::this_thread::get_id() == caller ) ranInline++;
+
+                std::this_thread::sleep_for(std::chrono::milliseconds(2));
+                finished++;
+            });
+        }
+
+        _state.ResumeTiming();
+
+        pool.ParallelFor(values.size(), 1024, [&](size_t, size_t _begin, size_t _end) {
+            for ( size_t i = _begin; i < _end; i++ ) {
+                values[i] = values[i] * 0.5f + 1.0f;
+            }
+        });
+
+        benchmark::DoNotOptimize(values.data());
+    }
+
+    while ( finished.load() != submitted ) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }
+
+    _state.counters["BackgroundJobsRunInline"] = static_cast<double>(ranInline.load());
+
+    if ( ranInline.load() != 0 ) _state.SkipWithError("ParallelFor ran a background job on the calling thread");
+}
+BENCHMARK(BM_ParallelForWithBackgroundJobs)->Arg(0)->Arg(4)->Unit(benchmark::kMicrosecond)->UseRealTime();
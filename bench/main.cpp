@@ -0,0 +1,33 @@
+#include <cstring>
+#include <string>
+#include <vector>
+
+#include <benchmark/benchmark.h>
+
+// Unless told otherwise, results also go to benchmarks.json so runs can be compared across releases
+int main(int _argc, char** _argv) {
+    std::vector<char*> args(_argv, _argv + _argc);
+    std::string outArg = "--benchmark_out=benchmarks.json";
+    std::string formatArg = "--benchmark_out_format=json";
+
+    bool hasOut = false;
+
+    for ( int i = 1; i < _argc; i++ ) {
+        if ( std::strncmp(_argv[i], "--benchmark_out=", 16) == 0 ) hasOut = true;
+    }
+
+    if ( !hasOut ) {
+        args.push_back(&outArg[0]);
+        args.push_back(&formatArg[0]);
+    }
+
+    int argc = args.size();
+    benchmark::Initialize(&argc, args.data());
+
+    if ( benchmark::ReportUnrecognizedArguments(argc, args.data()) ) return 1;
+
+    benchmark::RunSpecifiedBenchmarks();
+    benchmark::Shutdown();
+
+    return 0;
+}
@@ -0,0 +1,36 @@
+#include <cstdlib>
+#include <new>
+
+#include "AllocationCounter.h"
+
+#ifdef TRACK_ALLOCATIONS
+
+namespace {
+    // Per thread, the pool's workers decode and import with the heap while the frame is checked
+    thread_local size_t threadAllocations = 0;
+}
+
+// The array and nothrow forms call these, replacing the two is enough to see every new and delete
+void* operator new(size_t _bytes) {
+    threadAllocations++;
+
+    if ( void* memory = std::malloc(_bytes ? _bytes : 1) ) return memory;
+
+    throw std::bad_alloc();
+}
+
+void operator delete(void* _memory) noexcept { std::free(_memory); }
+
+void operator delete(void* _memory, size_t) noexcept { std::free(_memory); }
+
+bool AllocationCounter::IsEnabled() { return true; }
+
+size_t AllocationCounter::GetThreadCount() { return threadAllocations; }
+
+#else
+
+bool AllocationCounter::IsEnabled() { return false; }
+
+size_t AllocationCounter::GetThreadCount() { return 0; }
+
+#endif
\ No newline at end of file
@@ -0,0 +1,14 @@
+#ifndef ALLOCATION_COUNTER_H
+#define ALLOCATION_COUNTER_H
+
+#include <cstddef>
+
+// Heap allocations made by the calling thread. Builds with TRACK_ALLOCATIONS replace the global operator new to count
+// them, every other build leaves the allocator alone and the count stays at zero.
+class AllocationCounter {
+    public:
+        static bool IsEnabled();
+        static size_t GetThreadCount();
+};
+
+#endif
\ No newline at end of file
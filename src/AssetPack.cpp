@@ -0,0 +1,375 @@
+#include <cstdio>
+#include <cstring>
+#include <iostream>
+#include <algorithm>
+
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#define NOMINMAX
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#endif
+
+#include "AssetPack.h"
+#include "Lz4.h"
+
+namespace {
+    const uint32_t PACK_MAGIC = 0x4B415041; // "APAK"
+    const uint32_t PACK_VERSION = 1;
+
+    // Page sized, an entry never shares a page with the one before it
+    const uint64_t ENTRY_ALIGNMENT = 4096;
+
+    const uint32_t ENTRY_COMPRESSED = 1;
+
+    // Little endian on disk, like every machine the game runs on. The table of contents follows it directly, then
+    // the names, then the entries from the next aligned offset.
+    struct PackHeader {
+        uint32_t magic;
+        uint32_t version;
+        uint32_t entryCount;
+        uint32_t namesSize;
+        uint64_t entriesOffset;
+        uint64_t namesOffset;
+    };
+
+    uint64_t AlignUp(uint64_t _offset) { return ( _offset + ENTRY_ALIGNMENT - 1 ) / ENTRY_ALIGNMENT * ENTRY_ALIGNMENT; }
+}
+
+struct AssetPack::Entry {
+    uint64_t hash;
+    uint64_t offset;            // from the start of the file, a multiple of ENTRY_ALIGNMENT
+    uint64_t storedSize;
+    uint64_t size;              // once decompressed
+    uint32_t nameOffset;        // into the names, not terminated
+    uint32_t nameLength;
+    uint32_t flags;
+    uint32_t reserved;
+};
+
+AssetPack::AssetPack() : mapped(nullptr), mappedSize(0), entries(nullptr), entryCount(0), names(nullptr), namesSize(0)
+#ifdef _WIN32
+        , file(INVALID_HANDLE_VALUE), mapping(nullptr)
+#endif
+        {  }
+
+AssetPack::~AssetPack() {
+    Close();
+}
+
+bool AssetPack::Open(const std::string& _filePath) {
+    Close();
+    filePath = _filePath;
+
+#ifdef _WIN32
+    file = CreateFileA(_filePath.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_FLAG_RANDOM_ACCESS, nullptr);
+
+    if ( file == INVALID_HANDLE_VALUE ) return false;
+
+    LARGE_INTEGER size;
+
+    if ( !GetFileSizeEx(file, &size) || size.QuadPart == 0 ) {
+        Close();
+        return false;
+    }
+
+    mapping = CreateFileMappingA(file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+
+    if ( mapping ) mapped = static_cast<const unsigned char*>(MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0));
+
+    mappedSize = static_cast<size_t>(size.QuadPart);
+#else
+    int descriptor = open(_filePath.c_str(), O_RDONLY);
+
+    if ( descriptor < 0 ) return false;
+
+    struct stat status {};
+
+    if ( fstat(descriptor, &status) == 0 && status.st_size > 0 ) {
+        void* view = mmap(nullptr, static_cast<size_t>(status.st_size), PROT_READ, MAP_PRIVATE, descriptor, 0);
+
+        if ( view != MAP_FAILED ) {
+            mapped = static_cast<const unsigned char*>(view);
+            mappedSize = static_cast<size_t>(status.st_size);
+        }
+    }
+
+    // The mapping keeps the file open on its own
+    close(descriptor);
+#endif
+
+    if ( !mapped ) {
+        std::cerr << "Fail to map asset pack " << _filePath << '\n';
+        Close();
+        return false;
+    }
+
+    if ( !Validate() ) {
+        Close();
+        return false;
+    }
+
+    return true;
+}
+
+// Every offset and size is checked once here, lookups and reads trust them afterwards
+bool AssetPack::Validate() {
+    PackHeader header {};
+
+    if ( mappedSize < sizeof(header) ) {
+        std::cerr << "Asset pack " << filePath << " is truncated\n";
+        return false;
+    }
+
+    std::memcpy(&header, mapped, sizeof(header));
+
+    if ( header.magic != PACK_MAGIC || header.version != PACK_VERSION ) {
+        std::cerr << "Asset pack " << filePath << " has an unknown format\n";
+        return false;
+    }
+
+    if ( header.entriesOffset % alignof(Entry) != 0 || header.entriesOffset > mappedSize
+            || header.entryCount > ( mappedSize - header.entriesOffset ) / sizeof(Entry)
+            || header.namesOffset > mappedSize || header.namesSize > mappedSize - header.namesOffset ) {
+        std::cerr << "Asset pack " << filePath << " has a corrupt table of contents\n";
+        return false;
+    }
+
+    entries = reinterpret_cast<const Entry*>(mapped + header.entriesOffset);
+    entryCount = header.entryCount;
+    names = reinterpret_cast<const char*>(mapped + header.namesOffset);
+    namesSize = header.namesSize;
+
+    for ( size_t i = 0; i < entryCount; i++ ) {
+        const Entry& entry = entries[i];
+
+        bool inside = entry.offset <= mappedSize && entry.storedSize <= mappedSize - entry.offset
+                && entry.nameOffset <= namesSize && entry.nameLength <= namesSize - entry.nameOffset;
+        bool sorted = i == 0 || entries[i - 1].hash <= entry.hash;
+        // A compressed size is checked before Read allocates for it, a hostile pack can't ask for any amount of memory
+        bool stored = ( entry.flags & ENTRY_COMPRESSED ) ? entry.size <= Lz4::DecompressBound(entry.storedSize)
+                                                         : entry.storedSize == entry.size;
+
+        if ( !inside || !sorted || !stored ) {
+            std::cerr << "Asset pack " << filePath << " has a corrupt entry " << i << '\n';
+            return false;
+        }
+    }
+
+    return true;
+}
+
+void AssetPack::Close() {
+#ifdef _WIN32
+    if ( mapped ) UnmapViewOfFile(mapped);
+    if ( mapping ) CloseHandle(mapping);
+    if ( file != INVALID_HANDLE_VALUE ) CloseHandle(file);
+
+    mapping = nullptr;
+    file = INVALID_HANDLE_VALUE;
+#else
+    if ( mapped ) munmap(const_cast<unsigned char*>(mapped), mappedSize);
+#endif
+
+    mapped = nullptr;
+    mappedSize = 0;
+    entries = nullptr;
+    entryCount = 0;
+    names = nullptr;
+    namesSize = 0;
+}
+
+const AssetPack::Entry* AssetPack::Find(const std::string& _path) const {
+    uint64_t hash = HashPath(_path);
+
+    const Entry* first = std::lower_bound(entries, entries + entryCount, hash, [](const Entry& _entry, uint64_t _hash) {
+        return _entry.hash < _hash;
+    });
+
+    // Paths sharing a hash sit next to each other, the name tells them apart
+    for ( const Entry* entry = first; entry != entries + entryCount && entry->hash == hash; entry++ ) {
+        if ( entry->nameLength == _path.size() && _path.compare(0, _path.size(), names + entry->nameOffset, entry->nameLength) == 0 ) {
+            return entry;
+        }
+    }
+
+    return nullptr;
+}
+
+bool AssetPack::Contains(const std::string& _path) const { return Find(_path) != nullptr; }
+
+bool AssetPack::Read(const std::string& _path, FileData& _file) const {
+    const Entry* entry = Find(_path);
+
+    if ( !entry ) return false;
+
+    const unsigned char* stored = mapped + entry->offset;
+
+    if ( !( entry->flags & ENTRY_COMPRESSED ) ) {
+        _file.storage.clear();
+        _file.data = stored;
+        _file.size = entry->size;
+        return true;
+    }
+
+    _file.storage.resize(entry->size);
+
+    if ( !Lz4::Decompress(stored, entry->storedSize, _file.storage.data(), _file.storage.size()) ) {
+        std::cerr << "Asset pack " << filePath << " has a corrupt " << _path << '\n';
+        _file.storage.clear();
+        return false;
+    }
+
+    _file.data = _file.storage.data();
+    _file.size = _file.storage.size();
+
+    return true;
+}
+
+size_t AssetPack::GetEntryCount() const { return entryCount; }
+
+// FNV-1a, the same on every platform and every run, the table of contents is sorted by it
+uint64_t AssetPack::HashPath(const std::string& _path) {
+    uint64_t hash = 0xCBF29CE484222325ull;
+
+    for ( unsigned char character : _path ) {
+        hash ^= character;
+        hash *= 0x100000001B3ull;
+    }
+
+    return hash;
+}
+
+void AssetPackWriter::Add(const std::string& _path, std::vector<unsigned char> _data, bool _compress) {
+    File added { FileSystem::NormalizePath(_path), 0, {}, _data.size(), false };
+    added.hash = AssetPack::HashPath(added.path);
+
+    if ( _compress && !_data.empty() ) {
+        std::vector<unsigned char> compressed(Lz4::CompressBound(_data.size()));
+        size_t size = Lz4::Compress(_data.data(), _data.size(), compressed.data(), compressed.size());
+
+        // Images that are already compressed (PNG, JPEG) don't shrink, they're kept as is and read without a copy
+        if ( size && size <= _data.size() - _data.size() / 8 ) {
+            compressed.resize(size);
+            added.data = std::move(compressed);
+            added.compressed = true;
+        }
+    }
+
+    if ( !added.compressed ) added.data = std::move(_data);
+
+    for ( File& file : files ) {
+        if ( file.path == added.path ) {
+            file = std::move(added);
+            return;
+        }
+    }
+
+    files.push_back(std::move(added));
+}
+
+bool AssetPackWriter::Write(const std::string& _filePath) const {
+    std::vector<const File*> sorted;
+
+    for ( const File& file : files ) {
+        sorted.push_back(&file);
+    }
+
+    std::sort(sorted.begin(), sorted.end(), [](const File* _a, const File* _b) {
+        return _a->hash != _b->hash ? _a->hash < _b->hash : _a->path < _b->path;
+    });
+
+    std::string names;
+    std::vector<AssetPack::Entry> entries(sorted.size());
+
+    for ( size_t i = 0; i < sorted.size(); i++ ) {
+        AssetPack::Entry& entry = entries[i];
+        entry.hash = sorted[i]->hash;
+        entry.storedSize = sorted[i]->data.size();
+        entry.size = sorted[i]->size;
+        entry.nameOffset = static_cast<uint32_t>(names.size());
+        entry.nameLength = static_cast<uint32_t>(sorted[i]->path.size());
+        entry.flags = sorted[i]->compressed ? ENTRY_COMPRESSED : 0;
+        entry.reserved = 0;
+
+        names += sorted[i]->path;
+    }
+
+    PackHeader header { PACK_MAGIC, PACK_VERSION, static_cast<uint32_t>(entries.size()), static_cast<uint32_t>(names.size()),
+                        sizeof(PackHeader), sizeof(PackHeader) + entries.size() * sizeof(AssetPack::Entry) };
+
+    uint64_t offset = AlignUp(header.namesOffset + names.size());
+
+    for ( AssetPack::Entry& entry : entries ) {
+        entry.offset = offset;
+        offset = AlignUp(offset + entry.storedSize);
+    }
+
+    // Written to a temporary name first so a failed write never leaves a truncated pack behind
+    std::string tempPath = _filePath + ".tmp";
+    std::FILE* file = std::fopen(tempPath.c_str(), "wb");
+
+    if ( !file ) {
+        std::cerr << "Fail to write asset pack " << tempPath << '\n';
+        return false;
+    }
+
+    static const unsigned char padding[ENTRY_ALIGNMENT] = {};
+
+    bool written = std::fwrite(&header, sizeof(header), 1, file) == 1
+            && std::fwrite(entries.data(), sizeof(AssetPack::Entry), entries.size(), file) == entries.size()
+            && std::fwrite(names.data(), 1, names.size(), file) == names.size();
+
+    uint64_t position = header.namesOffset + names.size();
+
+    for ( size_t i = 0; written && i < entries.size(); i++ ) {
+        const std::vector<unsigned char>& data = sorted[i]->data;
+
+        written = std::fwrite(padding, 1, entries[i].offset - position, file) == entries[i].offset - position
+                && std::fwrite(data.data(), 1, data.size(), file) == data.size();
+
+        position = entries[i].offset + data.size();
+    }
+
+    written = std::fclose(file) == 0 && written;
+
+    if ( !written ) {
+        std::cerr << "Fail to write asset pack " << tempPath << '\n';
+        std::remove(tempPath.c_str());
+        return false;
+    }
+
+    std::remove(_filePath.c_str());
+
+    if ( std::rename(tempPath.c_str(), _filePath.c_str()) != 0 ) {
+        std::cerr << "Fail to write asset pack " << _filePath << '\n';
+        std::remove(tempPath.c_str());
+        return false;
+    }
+
+    return true;
+}
+
+size_t AssetPackWriter::GetStoredBytes() const {
+    size_t bytes = 0;
+
+    for ( const File& file : files ) {
+        bytes += file.data.size();
+    }
+
+    return bytes;
+}
+
+size_t AssetPackWriter::GetOriginalBytes() const {
+    size_t bytes = 0;
+
+    for ( const File& file : files ) {
+        bytes += file.size;
+    }
+
+    return bytes;
+}
\ No newline at end of file
@@ -0,0 +1,68 @@
+#ifndef ASSET_PACK_H
+#define ASSET_PACK_H
+
+#include <string>
+#include <vector>
+#include <cstdint>
+
+#include "FileSystem.h"
+
+// One file holding many assets, memory mapped so opening it is the only file open and an entry stored as is reads
+// with no copy. The table of contents is sorted by the FNV-1a hash of each path, a lookup is a binary search plus a
+// name compare. Entries start on 4 KB boundaries, page aligned in the mapping, and may be LZ4 compressed. Written by
+// AssetPackWriter, see tools/AssetPacker.cpp.
+class AssetPack {
+    public:
+        AssetPack();
+        ~AssetPack();
+        AssetPack(const AssetPack&) = delete;
+        AssetPack& operator=(const AssetPack&) = delete;
+        bool Open(const std::string& _filePath);
+        void Close();
+        bool Contains(const std::string& _path) const;
+        bool Read(const std::string& _path, FileData& _file) const;
+        size_t GetEntryCount() const;
+        static uint64_t HashPath(const std::string& _path);
+
+    private:
+        friend class AssetPackWriter;
+
+        struct Entry;
+
+        const unsigned char* mapped;
+        size_t mappedSize;
+        const Entry* entries;
+        size_t entryCount;
+        const char* names;
+        size_t namesSize;
+        std::string filePath;
+#ifdef _WIN32
+        void* file;
+        void* mapping;
+#endif
+
+        const Entry* Find(const std::string& _path) const;
+        bool Validate();
+};
+
+// Collects files in memory and writes them out as a pack
+class AssetPackWriter {
+    public:
+        void Add(const std::string& _path, std::vector<unsigned char> _data, bool _compress);
+        bool Write(const std::string& _filePath) const;
+        size_t GetStoredBytes() const;
+        size_t GetOriginalBytes() const;
+
+    private:
+        struct File {
+            std::string path;
+            uint64_t hash;
+            std::vector<unsigned char> data;    // as stored, compressed or not
+            uint64_t size;
+            bool compressed;
+        };
+
+        std::vector<File> files;
+};
+
+#endif
\ No newline at end of file
@@ -0,0 +1,95 @@
+#include <iostream>
+#include <cmath>
+
+#include "CascadedShadowMap.h"
+#include "GLState.h"
+#include "Constans.h"
+
+namespace {
+    // Moment of a texel nothing was drawn into, exp(ESM_EXPONENT) at the far plane
+    const float EMPTY_MOMENT = std::exp(static_cast<float>(ESM_EXPONENT));
+}
+
+CascadedShadowMap::CascadedShadowMap() : ShadowMap(), moments(0) {  }
+
+CascadedShadowMap::~CascadedShadowMap() = default;
+
+FrameTextureDesc CascadedShadowMap::GetDescription() const {
+    return { GL_TEXTURE_2D_ARRAY, GL_DEPTH_COMPONENT24, shadowWidth, shadowHeight, SHADOW_CASCADES };
+}
+
+void CascadedShadowMap::SetTextureParameters() {
+    GLState::Get().BindTexture(GL_TEXTURE_2D_ARRAY, shadowMap);
+
+    glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_BORDER);
+    glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_BORDER);
+
+    float borderColor[] = { 1.0f, 1.0f, 1.0f, 1.0f };
+    glTexParameterfv(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_BORDER_COLOR, borderColor);
+
+    glTexParameterf(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+    glTexParameterf(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+
+    glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_COMPARE_MODE, GL_COMPARE_REF_TO_TEXTURE);
+    glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_COMPARE_FUNC, GL_LEQUAL);
+
+    GLState::Get().BindTexture(GL_TEXTURE_2D_ARRAY, 0);
+}
+
+FrameTextureDesc CascadedShadowMap::GetMomentsDescription() const {
+    return { GL_TEXTURE_2D_ARRAY, GL_R32F, shadowWidth, shadowHeight, SHADOW_CASCADES };
+}
+
+// WriteLayer attaches the layers, only new storage needs its sampling state
+void CascadedShadowMap::AttachMoments(GLuint _texture, bool _newStorage) {
+    if ( _texture == moments && !_newStorage ) return;
+
+    moments = _texture;
+
+    if ( !moments ) return;
+
+    GLState::Get().BindTexture(GL_TEXTURE_2D_ARRAY, moments);
+
+    glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+    glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+    glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+    glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+
+    GLState::Get().BindTexture(GL_TEXTURE_2D_ARRAY, 0);
+}
+
+GLuint CascadedShadowMap::GetMoments() const { return moments; }
+
+// Binds and clears one cascade
+bool CascadedShadowMap::WriteLayer(GLuint _layer) {
+    GLState::Get().BindFramebuffer(GL_FRAMEBUFFER, FBO);
+
+    // glFramebufferTextureLayer — attach a single layer of an array texture, the cascades are rendered one at a time
+    glFramebufferTextureLayer(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, shadowMap, 0, _layer);
+
+    // The matching moments layer takes the colour output of the depth shader, without one nothing but depth is written
+    glFramebufferTextureLayer(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, moments, 0, moments ? _layer : 0);
+    glDrawBuffer(moments ? GL_COLOR_ATTACHMENT0 : GL_NONE);
+
+    GLenum status = glCheckFramebufferStatus(GL_FRAMEBUFFER);
+
+    if ( status != GL_FRAMEBUFFER_COMPLETE ) {
+        std::cerr << "Framebuffer Error: " << status << '\n';
+        return false;
+    }
+
+    glClear(GL_DEPTH_BUFFER_BIT);
+
+    if ( moments ) {
+        GLfloat empty[4] = { EMPTY_MOMENT, 0.0f, 0.0f, 0.0f };
+
+        // glClearBufferfv — clear an individual buffer of the framebuffer
+        glClearBufferfv(GL_COLOR, 0, empty);
+    }
+
+    return true;
+}
+
+void CascadedShadowMap::Read(GLenum _textureUnit) {
+    GLState::Get().BindTexture(_textureUnit - GL_TEXTURE0, GL_TEXTURE_2D_ARRAY, moments ? moments : shadowMap);
+}
\ No newline at end of file
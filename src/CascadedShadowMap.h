@@ -0,0 +1,27 @@
+#ifndef CASCADED_SHADOW_MAP_H
+#define CASCADED_SHADOW_MAP_H
+
+#include "ShadowMap.h"
+
+// One depth layer per cascade of the directional light, rendered layer by layer through the same framebuffer.
+// With moments attached every layer also gets an exponential shadow map, which ShadowBlur prefilters and Read
+// binds in place of the depth.
+class CascadedShadowMap : public ShadowMap {
+    public:
+        CascadedShadowMap();
+        ~CascadedShadowMap();
+        FrameTextureDesc GetDescription() const override;
+        FrameTextureDesc GetMomentsDescription() const;
+        void AttachMoments(GLuint _texture, bool _newStorage);
+        GLuint GetMoments() const;
+        bool WriteLayer(GLuint _layer);
+        void Read(GLenum _textureUnit) override;
+
+    protected:
+        void SetTextureParameters() override;
+
+    private:
+        GLuint moments;
+};
+
+#endif
\ No newline at end of file
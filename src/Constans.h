@@ -4,4 +4,17 @@
 const int MAX_POINT_LIGHTS = 3;
 const int MAX_SPOT_LIGHTS = 3;
 
+// Layers of the directional shadow map array, each covers a slice of the camera frustum
+const int SHADOW_CASCADES = 3;
+
+// Sharpness of the exponential shadow maps used by the prefiltered shadow quality, exp(80) still fits a 32 bit float
+const int ESM_EXPONENT = 80;
+
+// Shadowless lights shaded through the cluster lists, the cap only bounds the per-frame upload
+const int MAX_CLUSTERED_LIGHTS = 4096;
+const int MAX_LIGHTS_PER_CLUSTER = 128;
+
+// Uniform buffer binding point of the DrawData block, every draw binds its slice of the dynamic ring here
+const int DRAW_DATA_BINDING = 0;
+
 #endif
\ No newline at end of file
@@ -0,0 +1,319 @@
+#include <cmath>
+
+#include "glm/gtc/matrix_transform.hpp"
+#include "glm/gtc/type_ptr.hpp"
+#include "glm/gtc/constants.hpp"
+
+#include "DeferredRenderer.h"
+#include "GLState.h"
+#include "Shader.h"
+#include "ShaderBatch.h"
+#include "ShadowMap.h"
+#include "LightClusters.h"
+#include "Mesh.h"
+#include "SkyBox.h"
+
+namespace {
+    // The G-buffer inputs take units 0-3, the shadow map of the light being drawn the next one
+    const GLuint GBUFFER_TEXTURE_UNIT = 0;
+    const GLuint SHADOW_TEXTURE_UNIT = 4;
+
+    const int VOLUME_STACKS = 8;
+    const int VOLUME_SLICES = 12;
+
+    // Keeps the near plane from cutting into a volume the camera is just outside of
+    const float VOLUME_CAMERA_MARGIN = 0.5f;
+
+    // A light volume ends where the light falls below five steps of an 8 bit channel, the shader fades it to nothing
+    // there. With one step the scene's point lights would reach about 50 units and cover the whole view.
+    const float VOLUME_CUTOFF = 5.0f / 256.0f;
+}
+
+DeferredRenderer::DeferredRenderer(GLuint _width, GLuint _height) : fullScreenVAO(0) {
+    gBuffer.Init(_width, _height);
+
+    directionalShaders = std::make_unique<ShaderPermutations>("Shaders/deferredLight.vert", "Shaders/deferredDirectional.frag");
+    lightShaders = std::make_unique<ShaderPermutations>("Shaders/deferredLight.vert", "Shaders/deferredLight.frag");
+
+    lightVolume = CreateLightVolume();
+
+    // Core profile refuses to draw without a vertex array, even when the vertex shader doesn't fetch anything
+    glGenVertexArrays(1, &fullScreenVAO);
+}
+
+DeferredRenderer::~DeferredRenderer() {
+    if ( fullScreenVAO ) {
+        GLState::Get().DeleteVertexArrays(1, &fullScreenVAO);
+    }
+}
+
+void DeferredRenderer::CreateShaders(ShaderBatch& _batch) {
+    geometryShader = std::make_unique<Shader>();
+    _batch.Add(geometryShader.get(), "Shaders/shader.vert", "Shaders/gbuffer.frag");
+
+    stencilShader = std::make_unique<Shader>();
+    _batch.Add(stencilShader.get(), "Shaders/deferredLight.vert", "Shaders/deferredStencil.frag");
+
+    // The lighting passes only vary with the shadow toggle and PCF quality, light counts are always zero (see main.cpp)
+    for ( int quality = 0; quality < PCF_QUALITY_COUNT; quality++ ) {
+        for ( bool shadows : { true, false } ) {
+            directionalShaders->Precompile({ 0, 0, shadows, quality });
+            lightShaders->Precompile({ 0, 0, shadows, quality });
+        }
+    }
+}
+
+bool DeferredRenderer::IsReady() const {
+    return geometryShader && geometryShader->GetStatus() == ShaderStatus::Ready;
+}
+
+Shader* DeferredRenderer::BeginGeometryPass(const glm::mat4& _projection, const glm::mat4& _viewMatrix) {
+    if ( !geometryShader || !geometryShader->UseShader() ) return nullptr;
+
+    gBuffer.WriteGeometry();
+
+    GLState::Get().Viewport(0, 0, gBuffer.GetWidth(), gBuffer.GetHeight());
+
+    GLState::Get().Enable(GL_DEPTH_TEST);
+    GLState::Get().DepthMask(GL_TRUE);
+
+    glClearColor(0.0f, 0.0f, 0.0f, 0.0f);
+    glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT | GL_STENCIL_BUFFER_BIT);
+
+    glUniformMatrix4fv(geometryShader->GetProjectionLocation(), 1, GL_FALSE, glm::value_ptr(_projection));
+    glUniformMatrix4fv(geometryShader->GetViewLocation(), 1, GL_FALSE, glm::value_ptr(_viewMatrix));
+    ShadowMap::SetTexture(1, geometryShader.get());
+
+    return geometryShader.get();
+}
+
+void DeferredRenderer::DirectionalPass(const DeferredLights& _lights, const ShaderPermutationKey& _key, const glm::mat4& _projection,
+        const glm::mat4& _viewMatrix, const glm::vec3& _eyePosition, SkyBox* _skyBox) {
+    gBuffer.WriteOutput();
+    GLState::Get().Viewport(0, 0, gBuffer.GetWidth(), gBuffer.GetHeight());
+
+    glClearColor(0.0f, 0.0f, 0.0f, 1.0f);
+    glClear(GL_COLOR_BUFFER_BIT);
+
+    // The sky goes in first, the lighting passes discard every pixel the geometry pass didn't touch
+    GLState::Get().Disable(GL_DEPTH_TEST);
+    _skyBox->DrawSkyBox(_viewMatrix, _projection);
+
+    Shader* shader = directionalShaders->Get(_key);
+
+    if ( shader->UseShader() ) {
+        LightUniforms& uniforms = GetLightUniforms(shader);
+
+        SetGBufferUniforms(shader, _projection, _viewMatrix, _eyePosition);
+
+        DirectionalLight::SetDirectionalLight(*_lights.directionalLight, uniforms.directionalLight);
+        _lights.directionalLight->UseCascades(shader);
+
+        _lights.directionalLight->GetShadowMap()->Read(GL_TEXTURE0 + SHADOW_TEXTURE_UNIT);
+        ShadowMap::SetDirectionalShadowMap(SHADOW_TEXTURE_UNIT, shader);
+
+        _lights.clusters->Bind(_lights.clusterTextureUnit, gBuffer.GetWidth(), gBuffer.GetHeight(), shader);
+
+        DrawFullScreen();
+    }
+
+    GLState::Get().Enable(GL_DEPTH_TEST);
+}
+
+void DeferredRenderer::LightPass(PointLight& _light, bool _isSpot, const ShaderPermutationKey& _key, const glm::mat4& _projection,
+        const glm::mat4& _viewMatrix, const glm::vec3& _eyePosition) {
+    Shader* shader = lightShaders->Get(_key);
+
+    if ( !shader->UseShader() ) return;
+
+    // Nothing past the shadow's far plane is lit either, a light without falloff stops there
+    GLfloat range = std::min(_light.CalcRange(VOLUME_CUTOFF), _light.GetFarPlane());
+
+    if ( range <= 0.0f ) return;
+
+    // Far plane of the camera projection, a volume past it would lose its back faces to clipping and never mark the
+    // stencil. The same goes for a volume around the camera, whose front faces the near plane cuts away.
+    GLfloat farPlane = _projection[3][2] / ( _projection[2][2] + 1.0f );
+    GLfloat volumeRadius = range / ( std::cos(glm::pi<float>() / VOLUME_SLICES) * std::cos(glm::pi<float>() / VOLUME_STACKS) );
+    GLfloat lightDepth = -( _viewMatrix * glm::vec4(_light.GetPosition(), 1.0f) ).z;
+
+    bool useVolume = lightDepth + volumeRadius < farPlane
+            && glm::length(_eyePosition - _light.GetPosition()) > volumeRadius + VOLUME_CAMERA_MARGIN
+            && stencilShader->GetStatus() == ShaderStatus::Ready;
+
+    glm::mat4 model(1.0f);
+    model = glm::translate(model, _light.GetPosition());
+    model = glm::scale(model, glm::vec3(range));
+
+    gBuffer.WriteOutput();
+    GLState::Get().Viewport(0, 0, gBuffer.GetWidth(), gBuffer.GetHeight());
+
+    // Every shadowed light adds its share on top
+    GLState::Get().Enable(GL_BLEND);
+    GLState::Get().BlendEquation(GL_FUNC_ADD);
+    GLState::Get().BlendFunc(GL_ONE, GL_ONE);
+
+    if ( useVolume ) {
+        // Stencil pass: only pixels whose surface lies between the front and back faces of the volume end up non-zero
+        stencilShader->UseShader();
+
+        glUniformMatrix4fv(stencilShader->GetModelLocation(), 1, GL_FALSE, glm::value_ptr(model));
+        glUniformMatrix4fv(stencilShader->GetProjectionLocation(), 1, GL_FALSE, glm::value_ptr(_projection));
+        glUniformMatrix4fv(stencilShader->GetViewLocation(), 1, GL_FALSE, glm::value_ptr(_viewMatrix));
+        glUniform1i(stencilShader->GetUniformLocation("fullScreen"), 0);
+
+        glDrawBuffer(GL_NONE);
+        GLState::Get().Disable(GL_BLEND);
+
+        GLState::Get().Enable(GL_STENCIL_TEST);
+        glClear(GL_STENCIL_BUFFER_BIT);
+
+        GLState::Get().Enable(GL_DEPTH_TEST);
+        GLState::Get().DepthMask(GL_FALSE);
+        GLState::Get().Disable(GL_CULL_FACE);
+
+        // glStencilOpSeparate — set front and/or back stencil test actions
+        glStencilFunc(GL_ALWAYS, 0, 0);
+        glStencilOpSeparate(GL_BACK, GL_KEEP, GL_INCR_WRAP, GL_KEEP);
+        glStencilOpSeparate(GL_FRONT, GL_KEEP, GL_DECR_WRAP, GL_KEEP);
+
+        lightVolume->RenderMesh();
+
+        gBuffer.WriteOutput();
+        GLState::Get().Enable(GL_BLEND);
+
+        glStencilFunc(GL_NOTEQUAL, 0, 0xFF);
+        glStencilOp(GL_KEEP, GL_KEEP, GL_KEEP);
+
+        // Back faces so the light still shades when the near plane cuts through the front of the volume
+        GLState::Get().Disable(GL_DEPTH_TEST);
+        GLState::Get().Enable(GL_CULL_FACE);
+        GLState::Get().CullFace(GL_FRONT);
+
+        shader->UseShader();
+    }
+
+    LightUniforms& uniforms = GetLightUniforms(shader);
+
+    SetGBufferUniforms(shader, _projection, _viewMatrix, _eyePosition);
+
+    glUniformMatrix4fv(shader->GetModelLocation(), 1, GL_FALSE, glm::value_ptr(model));
+    glUniform1i(shader->GetUniformLocation("fullScreen"), useVolume ? 0 : 1);
+    glUniform1i(shader->GetUniformLocation("isSpotLight"), _isSpot ? 1 : 0);
+    glUniform1f(shader->GetUniformLocation("lightRange"), range);
+
+    if ( _isSpot ) {
+        const UniformSpotLight& uniform = uniforms.spotLights[0];
+        static_cast<SpotLight&>(_light).UseLight(uniform.uniformAmbientIntensity, uniform.uniformColour, uniform.uniformDiffuseIntensity,
+                uniform.uniformPosition, uniform.uniformDirection, uniform.uniformConstant, uniform.uniformLinear,
+                uniform.uniformExponent, uniform.uniformEdge);
+    } else {
+        const UniformPointLight& uniform = uniforms.pointLights[0];
+        _light.UseLight(uniform.uniformAmbientIntensity, uniform.uniformColour, uniform.uniformDiffuseIntensity,
+                uniform.uniformPosition, uniform.uniformConstant, uniform.uniformLinear, uniform.uniformExponent);
+    }
+
+    _light.GetShadowMap()->Read(GL_TEXTURE0 + SHADOW_TEXTURE_UNIT);
+    glUniform1i(uniforms.omniShadowMaps[0].shadowMap, SHADOW_TEXTURE_UNIT);
+    glUniform1f(uniforms.omniShadowMaps[0].farPlane, _light.GetFarPlane());
+
+    if ( useVolume ) {
+        lightVolume->RenderMesh();
+
+        GLState::Get().CullFace(GL_BACK);
+        GLState::Get().Disable(GL_CULL_FACE);
+        GLState::Get().Disable(GL_STENCIL_TEST);
+    } else {
+        GLState::Get().Disable(GL_DEPTH_TEST);
+        DrawFullScreen();
+    }
+
+    GLState::Get().Disable(GL_BLEND);
+    GLState::Get().Enable(GL_DEPTH_TEST);
+    GLState::Get().DepthMask(GL_TRUE);
+}
+
+void DeferredRenderer::Present(GLuint _width, GLuint _height) {
+    gBuffer.BlitOutput(_width, _height);
+}
+
+DeferredRenderer::LightUniforms& DeferredRenderer::GetLightUniforms(Shader* _shader) {
+    auto found = lightUniforms.find(_shader);
+
+    if ( found != lightUniforms.end() ) return found->second;
+
+    LightUniforms& uniforms = lightUniforms[_shader];
+
+    DirectionalLight::GetUDirectionalLight(*_shader, uniforms.directionalLight);
+
+    uniforms.pointLights = std::vector<UniformPointLight>(1);
+    PointLight::GetUPointLight(*_shader, uniforms.pointLights);
+
+    uniforms.spotLights = std::vector<UniformSpotLight>(1);
+    SpotLight::GetUPointLight(*_shader, uniforms.spotLights);
+
+    uniforms.omniShadowMaps = std::vector<UniformOmniShadowMap>(1);
+    OmniShadowMap::GetUniformsOmniShadowMap(uniforms.omniShadowMaps, _shader);
+
+    return uniforms;
+}
+
+void DeferredRenderer::SetGBufferUniforms(Shader* _shader, const glm::mat4& _projection, const glm::mat4& _viewMatrix,
+        const glm::vec3& _eyePosition) {
+    gBuffer.Read(GBUFFER_TEXTURE_UNIT);
+
+    const char* samplers[4] = { "gAlbedo", "gNormal", "gSpecular", "gDepth" };
+
+    for ( GLuint i = 0; i < 4; i++ ) {
+        glUniform1i(_shader->GetUniformLocation(samplers[i]), GBUFFER_TEXTURE_UNIT + i);
+    }
+
+    glm::mat4 inverseViewProjection = glm::inverse(_projection * _viewMatrix);
+
+    glUniform2f(_shader->GetUniformLocation("gBufferSize"), gBuffer.GetWidth(), gBuffer.GetHeight());
+    glUniformMatrix4fv(_shader->GetUniformLocation("inverseViewProjection"), 1, GL_FALSE, glm::value_ptr(inverseViewProjection));
+    glUniformMatrix4fv(_shader->GetProjectionLocation(), 1, GL_FALSE, glm::value_ptr(_projection));
+    glUniformMatrix4fv(_shader->GetViewLocation(), 1, GL_FALSE, glm::value_ptr(_viewMatrix));
+    glUniform3f(_shader->GetUniformLocation("eyePosition"), _eyePosition.x, _eyePosition.y, _eyePosition.z);
+    glUniform1i(_shader->GetUniformLocation("fullScreen"), 1);
+}
+
+void DeferredRenderer::DrawFullScreen() const {
+    GLState::Get().BindVertexArray(fullScreenVAO);
+    glDrawArrays(GL_TRIANGLES, 0, 3);
+    GLState::Get().BindVertexArray(0);
+}
+
+std::unique_ptr<Mesh> DeferredRenderer::CreateLightVolume() {
+    std::vector<Shape> vertices;
+    std::vector<GLuint> indices;
+
+    // Unit UV sphere pushed out far enough that its flat faces still enclose the unit sphere
+    float inflate = 1.0f / ( std::cos(glm::pi<float>() / VOLUME_SLICES) * std::cos(glm::pi<float>() / VOLUME_STACKS) );
+
+    for ( int stack = 0; stack <= VOLUME_STACKS; stack++ ) {
+        float theta = stack * glm::pi<float>() / VOLUME_STACKS;
+
+        for ( int slice = 0; slice <= VOLUME_SLICES; slice++ ) {
+            float phi = slice * 2.0f * glm::pi<float>() / VOLUME_SLICES;
+            glm::vec3 position = glm::vec3(std::sin(theta) * std::cos(phi), std::cos(theta), std::sin(theta) * std::sin(phi)) * inflate;
+
+            vertices.emplace_back(position.x, position.y, position.z, 0.0f, 0.0f, 0.0f, 0.0f, 0.0f);
+        }
+    }
+
+    // Counter-clockwise seen from outside, the light pass culls the front faces
+    for ( int stack = 0; stack < VOLUME_STACKS; stack++ ) {
+        for ( int slice = 0; slice < VOLUME_SLICES; slice++ ) {
+            GLuint top = stack * ( VOLUME_SLICES + 1 ) + slice;
+            GLuint bottom = top + VOLUME_SLICES + 1;
+
+            indices.insert(indices.end(), { top, top + 1, bottom, top + 1, bottom + 1, bottom });
+        }
+    }
+
+    auto mesh = std::make_unique<Mesh>();
+    mesh->CreateMesh(vertices, indices);
+
+    return mesh;
+}
\ No newline at end of file
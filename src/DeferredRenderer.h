@@ -0,0 +1,72 @@
+#ifndef DEFERRED_RENDERER_H
+#define DEFERRED_RENDERER_H
+
+#include <vector>
+#include <memory>
+#include <unordered_map>
+
+#include <GL/glew.h>
+
+#include "glm/glm.hpp"
+
+#include "GBuffer.h"
+#include "ShaderPermutations.h"
+#include "DirectionalLight.h"
+#include "PointLight.h"
+#include "SpotLight.h"
+#include "OmniShadowMap.h"
+
+class Shader;
+class ShaderBatch;
+class Mesh;
+class SkyBox;
+class LightClusters;
+
+struct DeferredLights {
+    DirectionalLight* directionalLight;
+    const LightClusters* clusters;
+    GLuint clusterTextureUnit;
+};
+
+// Alternative to the forward RenderPass for scenes with heavy overdraw: the scene is rasterised once into
+// the G-buffer, then every light only shades the pixels it can reach. The directional and clustered lights
+// run as one full-screen pass, each shadowed point and spot light is bounded by a stencil-tested sphere.
+// Every pass sets up its own state, so the frame graph is free to put shadow passes in between.
+class DeferredRenderer {
+    public:
+        DeferredRenderer(GLuint _width, GLuint _height);
+        ~DeferredRenderer();
+        void CreateShaders(ShaderBatch& _batch);
+        bool IsReady() const;
+        Shader* BeginGeometryPass(const glm::mat4& _projection, const glm::mat4& _viewMatrix);
+        void DirectionalPass(const DeferredLights& _lights, const ShaderPermutationKey& _key, const glm::mat4& _projection,
+                const glm::mat4& _viewMatrix, const glm::vec3& _eyePosition, SkyBox* _skyBox);
+        void LightPass(PointLight& _light, bool _isSpot, const ShaderPermutationKey& _key, const glm::mat4& _projection,
+                const glm::mat4& _viewMatrix, const glm::vec3& _eyePosition);
+        void Present(GLuint _width, GLuint _height);
+
+    private:
+        struct LightUniforms {
+            UniformDirectionalLight directionalLight{};
+            std::vector<UniformPointLight> pointLights;
+            std::vector<UniformSpotLight> spotLights;
+            std::vector<UniformOmniShadowMap> omniShadowMaps;
+        };
+
+        GBuffer gBuffer;
+        std::unique_ptr<Shader> geometryShader;
+        std::unique_ptr<Shader> stencilShader;
+        std::unique_ptr<ShaderPermutations> directionalShaders;
+        std::unique_ptr<ShaderPermutations> lightShaders;
+        std::unordered_map<Shader*, LightUniforms> lightUniforms;
+        std::unique_ptr<Mesh> lightVolume;
+        GLuint fullScreenVAO;
+
+        LightUniforms& GetLightUniforms(Shader* _shader);
+        void SetGBufferUniforms(Shader* _shader, const glm::mat4& _projection, const glm::mat4& _viewMatrix,
+                const glm::vec3& _eyePosition);
+        void DrawFullScreen() const;
+        static std::unique_ptr<Mesh> CreateLightVolume();
+};
+
+#endif
\ No newline at end of file
@@ -1,11 +1,29 @@
+#include <cmath>
+#include <algorithm>
+
 #include "glm/gtc/matrix_transform.hpp"
+#include "glm/gtc/type_ptr.hpp"
 
 #include "DirectionalLight.h"
+#include "CascadedShadowMap.h"
 #include "Shader.h"
 
+namespace {
+    // Directional shadows end at this view depth however far the camera sees, fading out over the last part of the final
+    // cascade (see Lighting.glsl). The cascades share what is left.
+    const float SHADOW_DISTANCE = 60.0f;
+
+    // Blend between logarithmic and uniform splits, 1 gives all resolution to the near cascades
+    const float SPLIT_LAMBDA = 0.75f;
+
+    // Depth kept in front of a cascade for casters outside the camera frustum, tall objects off screen still shadow it
+    const float CASTER_DISTANCE = 50.0f;
+}
+
 DirectionalLight::DirectionalLight(GLuint _width, GLuint _height, const glm::vec3& _colour, GLfloat _aIntensity, GLfloat _dIntensity, const glm::vec3& _direction)
-        : Light(_width, _height, _colour, _aIntensity, _dIntensity), direction(_direction) {
-    lightProj = glm::ortho(-20.0f, 20.0f, -20.0f, 20.0f, 0.1f, 100.0f);
+        : Light(_width, _height, _colour, _aIntensity, _dIntensity), direction(_direction), cascades(), shadowCascades() {
+    shadowMap = std::make_shared<CascadedShadowMap>();
+    shadowMap->Init(_width, _height);
 }
 
 DirectionalLight::~DirectionalLight() = default;
@@ -31,6 +49,93 @@ void DirectionalLight::SetDirectionalLight(DirectionalLight &_dLight, const Unif
                      _uDirectionalLight.uniformDiffuseIntensity, _uDirectionalLight.uniformDirection);
 }
 
-glm::mat4 DirectionalLight::CalcLightTransform() {
-    return lightProj * glm::lookAt(-direction, glm::vec3(0.0f, 0.0f, 0.0f), glm::vec3(0.0f, 1.0f, 0.0f));
+void DirectionalLight::UpdateCascades(const glm::mat4& _projection, const glm::mat4& _view, GLfloat _near, GLfloat _far) {
+    float shadowFar = std::min(_far, SHADOW_DISTANCE);
+
+    // Frustum corners in world space, a slice at any depth lies on the rays from the near to the far corners
+    glm::mat4 inverseViewProjection = glm::inverse(_projection * _view);
+    glm::vec3 nearCorners[4], farCorners[4];
+
+    for ( int i = 0; i < 4; i++ ) {
+        glm::vec2 ndc(i & 1 ? 1.0f : -1.0f, i & 2 ? 1.0f : -1.0f);
+        glm::vec4 nearCorner = inverseViewProjection * glm::vec4(ndc, -1.0f, 1.0f);
+        glm::vec4 farCorner = inverseViewProjection * glm::vec4(ndc, 1.0f, 1.0f);
+
+        nearCorners[i] = glm::vec3(nearCorner) / nearCorner.w;
+        farCorners[i] = glm::vec3(farCorner) / farCorner.w;
+    }
+
+    // The light looks along its direction from the world origin, cascades only move their ortho window inside that view
+    glm::vec3 lightDirection = glm::normalize(direction);
+    glm::vec3 up = std::abs(lightDirection.y) > 0.99f ? glm::vec3(0.0f, 0.0f, 1.0f) : glm::vec3(0.0f, 1.0f, 0.0f);
+    glm::mat4 lightView = glm::lookAt(glm::vec3(0.0f), lightDirection, up);
+
+    float resolution = static_cast<float>(shadowMap->GetShadowWidth());
+    float sliceNear = _near;
+
+    for ( int c = 0; c < SHADOW_CASCADES; c++ ) {
+        float p = static_cast<float>(c + 1) / SHADOW_CASCADES;
+        float logSplit = _near * std::pow(shadowFar / _near, p);
+        float uniformSplit = _near + ( shadowFar - _near ) * p;
+        float sliceFar = SPLIT_LAMBDA * logSplit + ( 1.0f - SPLIT_LAMBDA ) * uniformSplit;
+
+        float t0 = ( sliceNear - _near ) / ( _far - _near );
+        float t1 = ( sliceFar - _near ) / ( _far - _near );
+
+        glm::vec3 corners[8];
+        glm::vec3 center(0.0f);
+
+        for ( int i = 0; i < 4; i++ ) {
+            corners[i] = glm::mix(nearCorners[i], farCorners[i], t0);
+            corners[i + 4] = glm::mix(nearCorners[i], farCorners[i], t1);
+        }
+
+        for ( const glm::vec3& corner : corners ) center += corner / 8.0f;
+
+        // A bounding sphere keeps the window size constant while the camera turns, rounding it keeps it constant while it moves
+        float radius = 0.0f;
+
+        for ( const glm::vec3& corner : corners ) radius = std::max(radius, glm::length(corner - center));
+
+        radius = std::ceil(radius * 16.0f) / 16.0f;
+
+        // Snapping the window to whole texels stops the shadow edges from crawling as the camera moves
+        glm::vec3 lightCenter = glm::vec3(lightView * glm::vec4(center, 1.0f));
+        float texelSize = 2.0f * radius / resolution;
+
+        lightCenter.x = std::floor(lightCenter.x / texelSize) * texelSize;
+        lightCenter.y = std::floor(lightCenter.y / texelSize) * texelSize;
+
+        ShadowCascade& cascade = cascades[c];
+
+        cascade.view = lightView;
+        cascade.boundsMin = lightCenter - glm::vec3(radius, radius, radius);
+        cascade.boundsMax = lightCenter + glm::vec3(radius, radius, radius + CASTER_DISTANCE);
+
+        // The light view looks down -z, the near plane is the far end of the bounds
+        cascade.projection = glm::ortho(cascade.boundsMin.x, cascade.boundsMax.x, cascade.boundsMin.y, cascade.boundsMax.y,
+                -cascade.boundsMax.z, -cascade.boundsMin.z);
+        cascade.transform = cascade.projection * cascade.view;
+        cascade.splitDepth = sliceFar;
+
+        sliceNear = sliceFar;
+    }
+}
+
+const ShadowCascade& DirectionalLight::GetCascade(size_t _index) const { return cascades[_index]; }
+
+void DirectionalLight::CommitCascade(size_t _index) { shadowCascades[_index] = cascades[_index]; }
+
+void DirectionalLight::UseCascades(Shader* _shader) const {
+    glm::mat4 transforms[SHADOW_CASCADES];
+    GLfloat splits[SHADOW_CASCADES];
+
+    // A layer the shadow scheduler didn't redraw this frame is looked up with the window it was drawn with
+    for ( int i = 0; i < SHADOW_CASCADES; i++ ) {
+        transforms[i] = shadowCascades[i].transform;
+        splits[i] = shadowCascades[i].splitDepth;
+    }
+
+    glUniformMatrix4fv(_shader->GetUniformLocation("cascadeTransforms"), SHADOW_CASCADES, GL_FALSE, glm::value_ptr(transforms[0]));
+    glUniform1fv(_shader->GetUniformLocation("cascadeSplits"), SHADOW_CASCADES, splits);
 }
\ No newline at end of file
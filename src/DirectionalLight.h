@@ -4,6 +4,7 @@
 class Shader;
 
 #include "Light.h"
+#include "Constans.h"
 
 struct UniformDirectionalLight {
     GLuint uniformColour;
@@ -13,6 +14,15 @@ struct UniformDirectionalLight {
     GLuint uniformDirection;
 };
 
+// Orthographic shadow volume around one slice of the camera frustum, bounds are in light view space
+struct ShadowCascade {
+    glm::mat4 view;
+    glm::mat4 projection;
+    glm::mat4 transform;
+    glm::vec3 boundsMin, boundsMax;
+    GLfloat splitDepth;         // farthest view depth the cascade shades
+};
+
 class DirectionalLight : public Light {
     public:
         DirectionalLight(GLuint _width, GLuint _height, const glm::vec3& _colour, GLfloat _aIntensity, GLfloat _dIntensity,
@@ -27,10 +37,18 @@ class DirectionalLight : public Light {
 
         static void SetDirectionalLight(DirectionalLight& _dLight, const UniformDirectionalLight& _uDirectionalLight);
 
-        glm::mat4 CalcLightTransform();
+        void UpdateCascades(const glm::mat4& _projection, const glm::mat4& _view, GLfloat _near, GLfloat _far);
+
+        const ShadowCascade& GetCascade(size_t _index) const;
+
+        void CommitCascade(size_t _index);
+
+        void UseCascades(Shader* _shader) const;
 
     private:
         glm::vec3 direction;
+        ShadowCascade cascades[SHADOW_CASCADES];
+        ShadowCascade shadowCascades[SHADOW_CASCADES];     // what each layer of the shadow map was last drawn with
 };
 
 #endif
\ No newline at end of file
@@ -0,0 +1,141 @@
+#include <iostream>
+#include <cstring>
+#include <algorithm>
+
+#include "DynamicRingBuffer.h"
+#include "GLState.h"
+#include "GpuMemory.h"
+
+namespace {
+    // A frame never waits this long on a healthy GPU, the loop only exists so a lost context doesn't hang here
+    const GLuint64 FENCE_TIMEOUT = 1000000000;
+}
+
+DynamicRingBuffer::DynamicRingBuffer(GLenum _target, size_t _regionBytes) : target(_target), buffer(0), mapped(nullptr), regionBytes(0),
+        alignment(16), head(0), region(0), fences(), stalls(0) {
+    GLint offsetAlignment = 0;
+
+    if ( target == GL_UNIFORM_BUFFER ) glGetIntegerv(GL_UNIFORM_BUFFER_OFFSET_ALIGNMENT, &offsetAlignment);
+    if ( target == GL_SHADER_STORAGE_BUFFER ) glGetIntegerv(GL_SHADER_STORAGE_BUFFER_OFFSET_ALIGNMENT, &offsetAlignment);
+
+    alignment = std::max<size_t>(alignment, offsetAlignment);
+
+    Create(_regionBytes);
+}
+
+DynamicRingBuffer::~DynamicRingBuffer() { Destroy(); }
+
+void DynamicRingBuffer::Create(size_t _regionBytes) {
+    regionBytes = ( _regionBytes + alignment - 1 ) / alignment * alignment;
+
+    GLbitfield flags = GL_MAP_WRITE_BIT | GL_MAP_PERSISTENT_BIT | GL_MAP_COHERENT_BIT;
+
+    glGenBuffers(1, &buffer);
+    GLState::Get().BindBuffer(target, buffer);
+
+    // glBufferStorage — immutable storage that may stay mapped while the GPU reads it, coherent so writes need no flush
+    glBufferStorage(target, regionBytes * REGION_COUNT, nullptr, flags);
+    mapped = static_cast<unsigned char*>(glMapBufferRange(target, 0, regionBytes * REGION_COUNT, flags));
+
+    GLState::Get().BindBuffer(target, 0);
+
+    GpuMemory::Get().TrackBuffer(buffer, regionBytes * REGION_COUNT, GpuMemoryCategory::DrawData, "DynamicRingBuffer");
+
+    if ( !mapped ) std::cerr << "Failed to map dynamic ring buffer\n";
+}
+
+void DynamicRingBuffer::Destroy() {
+    for ( GLsync& fence : fences ) {
+        if ( fence ) glDeleteSync(fence);
+        fence = nullptr;
+    }
+
+    if ( buffer ) {
+        GLState::Get().BindBuffer(target, buffer);
+        glUnmapBuffer(target);
+        GLState::Get().BindBuffer(target, 0);
+
+        GpuMemory::Get().ReleaseBuffer(buffer);
+        GLState::Get().DeleteBuffers(1, &buffer);
+    }
+
+    buffer = 0;
+    mapped = nullptr;
+}
+
+void DynamicRingBuffer::BeginFrame() {
+    region = ( region + 1 ) % REGION_COUNT;
+    head = 0;
+
+    GLsync& fence = fences[region];
+
+    if ( !fence ) return;
+
+    // glClientWaitSync — the region was last written three frames ago, normally the GPU is long done with it
+    GLenum result = glClientWaitSync(fence, 0, 0);
+
+    if ( result == GL_TIMEOUT_EXPIRED ) {
+        stalls++;
+
+        do {
+            result = glClientWaitSync(fence, GL_SYNC_FLUSH_COMMANDS_BIT, FENCE_TIMEOUT);
+        } while ( result == GL_TIMEOUT_EXPIRED );
+    }
+
+    glDeleteSync(fence);
+    fence = nullptr;
+}
+
+void DynamicRingBuffer::EndFrame() {
+    if ( fences[region] ) glDeleteSync(fences[region]);
+
+    // glFenceSync — signalled once every command reading this frame's region has finished
+    fences[region] = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+}
+
+GLintptr DynamicRingBuffer::Allocate(size_t _bytes, void*& _data) {
+    size_t size = ( _bytes + alignment - 1 ) / alignment * alignment;
+
+    if ( head + size > regionBytes ) {
+        // Draws already issued keep reading the old buffer, GL frees it once they're done. Its fences guard
+        // memory nobody writes any more, so the new buffer starts without any.
+        std::cerr << "Dynamic ring buffer region of " << regionBytes << " bytes full, growing\n";
+
+        int current = region;
+
+        Destroy();
+        Create(std::max(regionBytes * 2, size));
+
+        region = current;
+        head = 0;
+    }
+
+    GLintptr offset = region * regionBytes + head;
+
+    head += size;
+
+    _data = mapped ? mapped + offset : nullptr;
+
+    return offset;
+}
+
+GLintptr DynamicRingBuffer::Write(const void* _data, size_t _bytes) {
+    void* destination = nullptr;
+    GLintptr offset = Allocate(_bytes, destination);
+
+    // Write-combined memory, only ever written front to back and never read back
+    if ( destination ) std::memcpy(destination, _data, _bytes);
+
+    return offset;
+}
+
+void DynamicRingBuffer::BindRange(GLuint _index, GLintptr _offset, size_t _bytes) const {
+    // glBindBufferRange — one call replaces the uniform uploads a draw used to make
+    GLState::Get().BindBufferRange(target, _index, buffer, _offset, _bytes);
+}
+
+GLuint DynamicRingBuffer::GetBuffer() const { return buffer; }
+
+size_t DynamicRingBuffer::GetRegionBytes() const { return regionBytes; }
+
+size_t DynamicRingBuffer::GetStallCount() const { return stalls; }
\ No newline at end of file
@@ -0,0 +1,41 @@
+#ifndef DYNAMIC_RING_BUFFER_H
+#define DYNAMIC_RING_BUFFER_H
+
+#include <cstddef>
+
+#include <GL/glew.h>
+
+// Persistently mapped buffer split into one region per frame in flight. The CPU writes a frame's dynamic data
+// straight into its region and draws reference it by offset, a fence per region keeps the CPU from overwriting
+// data the GPU hasn't read yet.
+class DynamicRingBuffer {
+    public:
+        DynamicRingBuffer(GLenum _target, size_t _regionBytes);
+        ~DynamicRingBuffer();
+        void BeginFrame();
+        void EndFrame();
+        GLintptr Allocate(size_t _bytes, void*& _data);
+        GLintptr Write(const void* _data, size_t _bytes);
+        void BindRange(GLuint _index, GLintptr _offset, size_t _bytes) const;
+        GLuint GetBuffer() const;
+        size_t GetRegionBytes() const;
+        size_t GetStallCount() const;
+
+    private:
+        static const int REGION_COUNT = 3;
+
+        GLenum target;
+        GLuint buffer;
+        unsigned char* mapped;
+        size_t regionBytes;
+        size_t alignment;
+        size_t head;
+        int region;
+        GLsync fences[REGION_COUNT];
+        size_t stalls;
+
+        void Create(size_t _regionBytes);
+        void Destroy();
+};
+
+#endif
\ No newline at end of file
@@ -0,0 +1,137 @@
+#include <cstdio>
+#include <iostream>
+
+#include "FileSystem.h"
+#include "AssetPack.h"
+
+FileSystem::FileSystem() = default;
+
+FileSystem::~FileSystem() = default;
+
+FileSystem& FileSystem::Get() {
+    static FileSystem fileSystem;
+    return fileSystem;
+}
+
+// A missing pack isn't an error, the loose files are read instead
+bool FileSystem::Mount(const std::string& _packPath) {
+    auto pack = std::make_unique<AssetPack>();
+
+    if ( !pack->Open(_packPath) ) return false;
+
+    packs.push_back(std::move(pack));
+
+    return true;
+}
+
+void FileSystem::UnmountAll() { packs.clear(); }
+
+bool FileSystem::Exists(const std::string& _path) const {
+    std::string path = NormalizePath(_path);
+
+    for ( auto pack = packs.rbegin(); pack != packs.rend(); ++pack ) {
+        if ( ( *pack )->Contains(path) ) return true;
+    }
+
+    std::FILE* file = std::fopen(path.c_str(), "rb");
+
+    if ( file ) std::fclose(file);
+
+    return file != nullptr;
+}
+
+bool FileSystem::ReadFile(const std::string& _path, FileData& _file) const {
+    std::string path = NormalizePath(_path);
+
+    for ( auto pack = packs.rbegin(); pack != packs.rend(); ++pack ) {
+        if ( ( *pack )->Read(path, _file) ) return true;
+    }
+
+    if ( !ReadLooseFile(path, _file.storage) ) return false;
+
+    _file.data = _file.storage.data();
+    _file.size = _file.storage.size();
+
+    return true;
+}
+
+bool FileSystem::ReadText(const std::string& _path, std::string& _text) const {
+    FileData file;
+
+    if ( !ReadFile(_path, file) ) return false;
+
+    _text.assign(reinterpret_cast<const char*>(file.data), file.size);
+
+    return true;
+}
+
+bool FileSystem::ReadLooseFile(const std::string& _path, std::vector<unsigned char>& _data) {
+    std::FILE* file = std::fopen(_path.c_str(), "rb");
+
+    if ( !file ) return false;
+
+    // Unbuffered, so the whole file lands in the vector with a single read instead of going through the stdio buffer
+    std::setvbuf(file, nullptr, _IONBF, 0);
+
+    std::fseek(file, 0, SEEK_END);
+    long size = std::ftell(file);
+    std::fseek(file, 0, SEEK_SET);
+
+    _data.resize(size > 0 ? size : 0);
+    size_t read = size > 0 ? std::fread(_data.data(), 1, _data.size(), file) : 0;
+
+    std::fclose(file);
+
+    return read == _data.size();
+}
+
+// Forward slashes, no "." components and ".." folded into the directory before it, the form paths are packed in
+std::string FileSystem::NormalizePath(const std::string& _path) {
+    std::vector<std::string> parts;
+    std::string part;
+
+    for ( size_t i = 0; i <= _path.size(); i++ ) {
+        char character = i < _path.size() ? _path[i] : '/';
+
+        if ( character != '/' && character != '\\' ) {
+            part += character;
+            continue;
+        }
+
+        if ( part == ".." && !parts.empty() && parts.back() != ".." ) {
+            parts.pop_back();
+        } else if ( !part.empty() && part != "." ) {
+            parts.push_back(part);
+        }
+
+        part.clear();
+    }
+
+    std::string normalized = !_path.empty() && ( _path[0] == '/' || _path[0] == '\\' ) ? "/" : "";
+
+    for ( size_t i = 0; i < parts.size(); i++ ) {
+        if ( i > 0 ) normalized += '/';
+        normalized += parts[i];
+    }
+
+    return normalized;
+}
+
+std::string FileSystem::JoinPath(const std::string& _directory, const std::string& _file) {
+    if ( _directory.empty() ) return NormalizePath(_file);
+
+    return NormalizePath(_directory + '/' + _file);
+}
+
+// Either separator, material files written on Windows name their textures with backslashes
+std::string FileSystem::GetFileName(const std::string& _path) {
+    size_t separator = _path.find_last_of("/\\");
+
+    return separator == std::string::npos ? _path : _path.substr(separator + 1);
+}
+
+std::string FileSystem::GetDirectory(const std::string& _path) {
+    size_t separator = _path.find_last_of("/\\");
+
+    return separator == std::string::npos ? "" : _path.substr(0, separator);
+}
\ No newline at end of file
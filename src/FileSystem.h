@@ -0,0 +1,42 @@
+#ifndef FILE_SYSTEM_H
+#define FILE_SYSTEM_H
+
+#include <string>
+#include <vector>
+#include <memory>
+
+class AssetPack;
+
+// A file's bytes, pointing straight into a mapped pack for an entry stored as is, otherwise at storage
+struct FileData {
+    const unsigned char* data = nullptr;
+    size_t size = 0;
+    std::vector<unsigned char> storage;
+};
+
+// Every loader reads through here. Mounted packs are searched newest first and a path none of them holds is read from
+// disk, so loose files keep working and can stand in for a pack while they're being edited. Paths are relative to the
+// working directory with forward slashes, the way the code spells them. Packs are mounted before anything loads,
+// reads from the thread pool don't lock.
+class FileSystem {
+    public:
+        static FileSystem& Get();
+        bool Mount(const std::string& _packPath);
+        void UnmountAll();
+        bool Exists(const std::string& _path) const;
+        bool ReadFile(const std::string& _path, FileData& _file) const;
+        bool ReadText(const std::string& _path, std::string& _text) const;
+        static bool ReadLooseFile(const std::string& _path, std::vector<unsigned char>& _data);
+        static std::string NormalizePath(const std::string& _path);
+        static std::string JoinPath(const std::string& _directory, const std::string& _file);
+        static std::string GetFileName(const std::string& _path);
+        static std::string GetDirectory(const std::string& _path);
+
+    private:
+        std::vector<std::unique_ptr<AssetPack>> packs;
+
+        FileSystem();
+        ~FileSystem();
+};
+
+#endif
\ No newline at end of file
@@ -0,0 +1,56 @@
+#include <cstdint>
+#include <algorithm>
+
+#include "FrameArena.h"
+
+namespace {
+    uintptr_t AlignUp(uintptr_t _address, size_t _alignment) {
+        return ( _address + _alignment - 1 ) & ~static_cast<uintptr_t>(_alignment - 1);
+    }
+}
+
+FrameArena::FrameArena(size_t _bytes) : block(new unsigned char[_bytes]), capacity(_bytes), used(0), peak(0), overflowBytes(0) {  }
+
+FrameArena::~FrameArena() = default;
+
+void* FrameArena::Allocate(size_t _bytes, size_t _alignment) {
+    uintptr_t start = reinterpret_cast<uintptr_t>(block.get());
+    uintptr_t aligned = AlignUp(start + used, _alignment);
+
+    if ( aligned + _bytes <= start + capacity ) {
+        used = aligned + _bytes - start;
+        return reinterpret_cast<void*>(aligned);
+    }
+
+    // Good for this frame only, Reset() grows the block so the next frame fits without it
+    size_t bytes = _bytes + _alignment;
+    overflow.emplace_back(new unsigned char[bytes]);
+    overflowBytes += bytes;
+
+    return reinterpret_cast<void*>(AlignUp(reinterpret_cast<uintptr_t>(overflow.back().get()), _alignment));
+}
+
+void FrameArena::Reset() {
+    size_t frameBytes = used + overflowBytes;
+    peak = std::max(peak, frameBytes);
+
+    if ( !overflow.empty() ) {
+        size_t grown = std::max<size_t>(capacity, 1);
+
+        while ( grown < frameBytes ) grown *= 2;
+
+        block.reset(new unsigned char[grown]);
+        capacity = grown;
+
+        overflow.clear();
+        overflowBytes = 0;
+    }
+
+    used = 0;
+}
+
+size_t FrameArena::GetCapacity() const { return capacity; }
+
+size_t FrameArena::GetUsedBytes() const { return used + overflowBytes; }
+
+size_t FrameArena::GetPeakBytes() const { return peak; }
\ No newline at end of file
@@ -0,0 +1,42 @@
+#ifndef FRAME_ARENA_H
+#define FRAME_ARENA_H
+
+#include <vector>
+#include <memory>
+#include <new>
+#include <utility>
+
+// Linear allocator for memory that only lives until the end of the frame. Allocating bumps an offset and Reset()
+// hands everything back at once. A frame that needs more than the block holds spills into blocks of its own, the
+// next Reset() then swaps the block for one that fits that frame, so once the frames settle the arena never touches
+// the heap again. Nothing placed in it is destroyed, whoever puts an object with a destructor here runs it.
+class FrameArena {
+    public:
+        explicit FrameArena(size_t _bytes);
+        ~FrameArena();
+        FrameArena(const FrameArena&) = delete;
+        FrameArena& operator=(const FrameArena&) = delete;
+        void* Allocate(size_t _bytes, size_t _alignment);
+        void Reset();
+        size_t GetCapacity() const;
+        size_t GetUsedBytes() const;
+        size_t GetPeakBytes() const;
+
+        template<typename T>
+        T* AllocateArray(size_t _count) {
+            return static_cast<T*>(Allocate(sizeof(T) * _count, alignof(T)));
+        }
+
+        template<typename T, typename... Args>
+        T* New(Args&&... _args) {
+            return new (Allocate(sizeof(T), alignof(T))) T(std::forward<Args>(_args)...);
+        }
+
+    private:
+        std::unique_ptr<unsigned char[]> block;
+        size_t capacity, used, peak;
+        std::vector<std::unique_ptr<unsigned char[]>> overflow;
+        size_t overflowBytes;
+};
+
+#endif
\ No newline at end of file
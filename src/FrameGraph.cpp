@@ -0,0 +1,278 @@
+#include <iostream>
+#include <limits>
+#include <algorithm>
+
+#include "FrameGraph.h"
+
+namespace {
+    const size_t UNUSED = std::numeric_limits<size_t>::max();
+
+    // Pass functions and resource lists of a frame, the arena grows if a frame needs more
+    const size_t ARENA_BYTES = 16 * 1024;
+}
+
+// Only valid for the call the braced list is written in, which is as long as AddPass needs it
+FrameResourceList::FrameResourceList(std::initializer_list<FrameResource> _resources) : count(_resources.size()) {
+    data = _resources.begin();
+}
+
+FrameResourceList::FrameResourceList(const FrameResource* _data, size_t _count) : data(_data), count(_count) {  }
+
+const FrameResource* FrameResourceList::begin() const { return data; }
+
+const FrameResource* FrameResourceList::end() const { return data + count; }
+
+size_t FrameResourceList::size() const { return count; }
+
+FrameGraph::FrameGraph() : resourceCount(0), compiled(false), executedPasses(0), arena(ARENA_BYTES) {  }
+
+FrameGraph::~FrameGraph() {
+    Reset();
+}
+
+FrameGraph::Resource& FrameGraph::AddResource() {
+    if ( resourceCount == resources.size() ) resources.emplace_back();
+
+    Resource& resource = resources[resourceCount++];
+    resource.readers.clear();
+    resource.writers.clear();
+    resource.firstUse = UNUSED;
+    resource.lastUse = UNUSED;
+
+    return resource;
+}
+
+FrameResource FrameGraph::Create(const char* _name, const FrameTextureDesc& _desc) {
+    Resource& resource = AddResource();
+    resource.name = _name;
+    resource.desc = _desc;
+    resource.imported = false;
+    resource.output = false;
+    resource.texture = 0;
+
+    return resourceCount - 1;
+}
+
+FrameResource FrameGraph::Import(const char* _name, bool _output, GLuint _texture) {
+    // Imported resources live outside the graph (the back buffer, the G-buffer, cached shadow maps), they only order the
+    // passes that touch them. GetTexture hands back whatever texture came with them.
+    Resource& resource = AddResource();
+    resource.name = _name;
+    resource.desc = FrameTextureDesc{};
+    resource.imported = true;
+    resource.output = _output;
+    resource.texture = _texture;
+
+    return resourceCount - 1;
+}
+
+FrameResourceList FrameGraph::CopyList(FrameResourceList _list) {
+    FrameResource* copy = arena.AllocateArray<FrameResource>(_list.size());
+    std::copy(_list.begin(), _list.end(), copy);
+
+    return { copy, _list.size() };
+}
+
+void FrameGraph::AddPass(const char* _name, FrameResourceList _reads, FrameResourceList _writes, void* _function, PassInvoke _invoke,
+        PassDestroy _destroy) {
+    size_t index = passes.size();
+
+    passes.push_back({ _name, CopyList(_reads), CopyList(_writes), _function, _invoke, _destroy, false });
+
+    for ( FrameResource read : _reads ) {
+        resources[read].readers.push_back(index);
+    }
+
+    for ( FrameResource write : _writes ) {
+        resources[write].writers.push_back(index);
+    }
+
+    compiled = false;
+}
+
+void FrameGraph::Compile() {
+    Cull();
+    Sort();
+
+    // A transient texture is needed from the first pass that touches it to the last one
+    for ( size_t position = 0; position < order.size(); position++ ) {
+        const Pass& pass = passes[order[position]];
+
+        for ( const auto* list : { &pass.reads, &pass.writes } ) {
+            for ( FrameResource resource : *list ) {
+                Resource& entry = resources[resource];
+
+                if ( entry.firstUse == UNUSED ) entry.firstUse = position;
+                entry.lastUse = position;
+            }
+        }
+    }
+
+    compiled = true;
+}
+
+void FrameGraph::Cull() {
+    // Reference counting from the outputs backwards: a resource nobody reads takes a reference away from its writers,
+    // and a pass left without references is culled, which in turn releases what it read
+    passReferences.assign(passes.size(), 0);
+    resourceReferences.assign(resourceCount, 0);
+    unreferenced.clear();
+
+    for ( size_t i = 0; i < passes.size(); i++ ) {
+        passReferences[i] = passes[i].writes.size();
+    }
+
+    // A pass updating a resource in place doesn't keep it alive, only readers further down do
+    for ( size_t i = 0; i < resourceCount; i++ ) {
+        for ( size_t reader : resources[i].readers ) {
+            if ( !Writes(passes[reader], i) ) resourceReferences[i]++;
+        }
+
+        if ( resourceReferences[i] == 0 && !resources[i].output ) unreferenced.push_back(i);
+    }
+
+    while ( !unreferenced.empty() ) {
+        FrameResource resource = unreferenced.back();
+        unreferenced.pop_back();
+
+        for ( size_t writer : resources[resource].writers ) {
+            if ( passReferences[writer] == 0 || --passReferences[writer] != 0 ) continue;
+
+            for ( FrameResource read : passes[writer].reads ) {
+                if ( Writes(passes[writer], read) ) continue;
+
+                if ( --resourceReferences[read] == 0 && !resources[read].output ) unreferenced.push_back(read);
+            }
+        }
+    }
+
+    for ( size_t i = 0; i < passes.size(); i++ ) {
+        passes[i].culled = passReferences[i] == 0;
+    }
+}
+
+void FrameGraph::Sort() {
+    size_t count = passes.size();
+
+    if ( dependents.size() < count ) dependents.resize(count);
+
+    for ( size_t i = 0; i < count; i++ ) {
+        dependents[i].clear();
+    }
+
+    dependencies.assign(count, 0);
+
+    auto addEdge = [&](size_t _from, size_t _to) {
+        if ( _from == _to || passes[_from].culled ) return;
+
+        dependents[_from].push_back(_to);
+        dependencies[_to]++;
+    };
+
+    for ( size_t i = 0; i < count; i++ ) {
+        const Pass& pass = passes[i];
+
+        if ( pass.culled ) continue;
+
+        for ( FrameResource write : pass.writes ) {
+            // Writers of the same resource keep their declaration order
+            for ( size_t writer : resources[write].writers ) {
+                if ( writer < i ) addEdge(writer, i);
+            }
+        }
+
+        for ( FrameResource read : pass.reads ) {
+            bool alsoWrites = Writes(pass, read);
+
+            // A pure reader sees every write of the frame, a read-modify-write pass only the ones declared before it
+            for ( size_t writer : resources[read].writers ) {
+                if ( !alsoWrites || writer < i ) addEdge(writer, i);
+            }
+        }
+    }
+
+    order.clear();
+
+    scheduled.assign(count, false);
+
+    // Kahn's algorithm, taking the earliest declared ready pass so independent passes keep the order they were added in
+    while ( true ) {
+        size_t next = UNUSED;
+
+        for ( size_t i = 0; i < count; i++ ) {
+            if ( !passes[i].culled && !scheduled[i] && dependencies[i] == 0 ) {
+                next = i;
+                break;
+            }
+        }
+
+        if ( next == UNUSED ) break;
+
+        scheduled[next] = true;
+        order.push_back(next);
+
+        for ( size_t dependent : dependents[next] ) {
+            dependencies[dependent]--;
+        }
+    }
+
+    for ( size_t i = 0; i < count; i++ ) {
+        if ( !passes[i].culled && !scheduled[i] ) {
+            std::cerr << "Frame graph cycle through pass: " << passes[i].name << '\n';
+            order.push_back(i);
+        }
+    }
+}
+
+bool FrameGraph::Writes(const Pass& _pass, FrameResource _resource) {
+    for ( FrameResource write : _pass.writes ) {
+        if ( write == _resource ) return true;
+    }
+
+    return false;
+}
+
+void FrameGraph::Execute() {
+    if ( !compiled ) Compile();
+
+    executedPasses = 0;
+
+    for ( size_t position = 0; position < order.size(); position++ ) {
+        for ( size_t i = 0; i < resourceCount; i++ ) {
+            Resource& resource = resources[i];
+            if ( !resource.imported && resource.firstUse == position ) resource.texture = pool.Acquire(resource.desc);
+        }
+
+        const Pass& pass = passes[order[position]];
+        pass.invoke(pass.function, *this);
+        executedPasses++;
+
+        for ( size_t i = 0; i < resourceCount; i++ ) {
+            Resource& resource = resources[i];
+            if ( !resource.imported && resource.lastUse == position ) pool.Release(resource.texture);
+        }
+    }
+
+    pool.EndFrame();
+
+    Reset();
+}
+
+void FrameGraph::Reset() {
+    for ( const Pass& pass : passes ) {
+        pass.destroy(pass.function);
+    }
+
+    arena.Reset();
+
+    resourceCount = 0;
+    passes.clear();
+    order.clear();
+    compiled = false;
+}
+
+GLuint FrameGraph::GetTexture(FrameResource _resource) const { return resources[_resource].texture; }
+
+size_t FrameGraph::GetExecutedPassCount() const { return executedPasses; }
+
+const TexturePool& FrameGraph::GetPool() const { return pool; }
\ No newline at end of file
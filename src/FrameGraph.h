@@ -0,0 +1,108 @@
+#ifndef FRAME_GRAPH_H
+#define FRAME_GRAPH_H
+
+#include <vector>
+#include <initializer_list>
+
+#include <GL/glew.h>
+
+#include "TexturePool.h"
+#include "FrameArena.h"
+
+using FrameResource = size_t;
+
+// The resources a pass reads or writes, a braced list or an array the caller fills. AddPass copies them.
+struct FrameResourceList {
+    const FrameResource* data;
+    size_t count;
+
+    FrameResourceList(std::initializer_list<FrameResource> _resources);
+    FrameResourceList(const FrameResource* _data, size_t _count);
+    const FrameResource* begin() const;
+    const FrameResource* end() const;
+    size_t size() const;
+};
+
+// Describes one frame as passes with declared reads and writes instead of a hand ordered sequence.
+// Compile() drops every pass whose results nobody consumes, orders the rest so each pass runs after the
+// writers of what it reads, and works out how long each transient texture lives. Execute() takes those
+// textures from the pool right before their first use and hands them back after their last, so a later
+// resource with the same description runs on the same memory.
+// Names are kept as pointers and have to outlive the frame, string literals. The pass functions and resource lists
+// live in the graph's frame arena and every table keeps its capacity, so building the same frame again allocates
+// nothing.
+class FrameGraph {
+    public:
+        FrameGraph();
+        ~FrameGraph();
+        FrameResource Create(const char* _name, const FrameTextureDesc& _desc);
+        FrameResource Import(const char* _name, bool _output, GLuint _texture = 0);
+        void Compile();
+        void Execute();
+        GLuint GetTexture(FrameResource _resource) const;
+        size_t GetExecutedPassCount() const;
+        const TexturePool& GetPool() const;
+
+        // _execute is called with the graph once the pass runs, any callable taking a FrameGraph&
+        template<typename Function>
+        void AddPass(const char* _name, FrameResourceList _reads, FrameResourceList _writes, Function _execute) {
+            Function* function = arena.New<Function>(std::move(_execute));
+            AddPass(_name, _reads, _writes, function, &Invoke<Function>, &Destroy<Function>);
+        }
+
+    private:
+        using PassInvoke = void (*)(void* _function, FrameGraph& _graph);
+        using PassDestroy = void (*)(void* _function);
+
+        struct Resource {
+            const char* name;
+            FrameTextureDesc desc;
+            bool imported, output;
+            GLuint texture;
+            std::vector<size_t> readers, writers;
+            size_t firstUse, lastUse;
+        };
+
+        struct Pass {
+            const char* name;
+            FrameResourceList reads, writes;
+            void* function;
+            PassInvoke invoke;
+            PassDestroy destroy;
+            bool culled;
+        };
+
+        // Slots past resourceCount are last frames', kept so their reader and writer lists keep their capacity
+        std::vector<Resource> resources;
+        size_t resourceCount;
+        std::vector<Pass> passes;
+        std::vector<size_t> order;
+        bool compiled;
+        size_t executedPasses;
+        TexturePool pool;
+        FrameArena arena;
+
+        // Scratch for Cull and Sort
+        std::vector<size_t> passReferences, resourceReferences;
+        std::vector<FrameResource> unreferenced;
+        std::vector<std::vector<size_t>> dependents;
+        std::vector<size_t> dependencies;
+        std::vector<bool> scheduled;
+
+        template<typename Function>
+        static void Invoke(void* _function, FrameGraph& _graph) { ( *static_cast<Function*>(_function) )(_graph); }
+
+        template<typename Function>
+        static void Destroy(void* _function) { static_cast<Function*>(_function)->~Function(); }
+
+        void AddPass(const char* _name, FrameResourceList _reads, FrameResourceList _writes, void* _function, PassInvoke _invoke,
+                PassDestroy _destroy);
+        FrameResourceList CopyList(FrameResourceList _list);
+        Resource& AddResource();
+        void Cull();
+        void Sort();
+        static bool Writes(const Pass& _pass, FrameResource _resource);
+        void Reset();
+};
+
+#endif
\ No newline at end of file
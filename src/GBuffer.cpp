@@ -0,0 +1,113 @@
+#include <iostream>
+
+#include "GBuffer.h"
+#include "GLState.h"
+#include "GpuMemory.h"
+
+GBuffer::GBuffer() : FBO(0), textures(), depthStencil(0), width(0), height(0) {  }
+
+GBuffer::~GBuffer() {
+    if ( FBO ) {
+        GLState::Get().DeleteFramebuffers(1, &FBO);
+    }
+
+    if ( textures[0] ) {
+        for ( GLuint texture : textures ) {
+            GpuMemory::Get().ReleaseTexture(texture);
+        }
+
+        GLState::Get().DeleteTextures(TARGET_COUNT, textures);
+    }
+
+    if ( depthStencil ) {
+        GpuMemory::Get().ReleaseTexture(depthStencil);
+        GLState::Get().DeleteTextures(1, &depthStencil);
+    }
+}
+
+bool GBuffer::Init(GLuint _width, GLuint _height) {
+    width = _width; height = _height;
+
+    // Normals are signed and shininess goes past 1, so those targets need float formats
+    const GLenum internalFormats[TARGET_COUNT] = { GL_RGBA8, GL_RGB16F, GL_RG16F, GL_RGBA8 };
+    const GLenum formats[TARGET_COUNT] = { GL_RGBA, GL_RGB, GL_RG, GL_RGBA };
+
+    glGenFramebuffers(1, &FBO);
+    GLState::Get().BindFramebuffer(GL_FRAMEBUFFER, FBO);
+
+    glGenTextures(TARGET_COUNT, textures);
+
+    for ( int i = 0; i < TARGET_COUNT; i++ ) {
+        GLState::Get().BindTexture(GL_TEXTURE_2D, textures[i]);
+        glTexImage2D(GL_TEXTURE_2D, 0, internalFormats[i], width, height, 0, formats[i], GL_FLOAT, nullptr);
+        GpuMemory::Get().TrackTexture(textures[i], GpuMemory::CalcTextureBytes(internalFormats[i], width, height, 1, 1),
+            GpuMemoryCategory::RenderTargets, "GBuffer");
+
+        // The lighting passes read one texel per pixel, filtering would only blend across edges
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+
+        glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0 + i, GL_TEXTURE_2D, textures[i], 0);
+    }
+
+    glGenTextures(1, &depthStencil);
+    GLState::Get().BindTexture(GL_TEXTURE_2D, depthStencil);
+    glTexImage2D(GL_TEXTURE_2D, 0, GL_DEPTH24_STENCIL8, width, height, 0, GL_DEPTH_STENCIL, GL_UNSIGNED_INT_24_8, nullptr);
+    GpuMemory::Get().TrackTexture(depthStencil, GpuMemory::CalcTextureBytes(GL_DEPTH24_STENCIL8, width, height, 1, 1),
+        GpuMemoryCategory::RenderTargets, "GBuffer");
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+
+    glFramebufferTexture2D(GL_FRAMEBUFFER, GL_DEPTH_STENCIL_ATTACHMENT, GL_TEXTURE_2D, depthStencil, 0);
+
+    GLenum status = glCheckFramebufferStatus(GL_FRAMEBUFFER);
+
+    GLState::Get().BindTexture(GL_TEXTURE_2D, 0);
+    GLState::Get().BindFramebuffer(GL_FRAMEBUFFER, 0);
+
+    if ( status != GL_FRAMEBUFFER_COMPLETE ) {
+        std::cerr << "GBuffer Framebuffer Error: " << status << '\n';
+        return false;
+    }
+
+    return true;
+}
+
+void GBuffer::WriteGeometry() {
+    GLState::Get().BindFramebuffer(GL_DRAW_FRAMEBUFFER, FBO);
+
+    // glDrawBuffers — Specifies a list of color buffers to be drawn into
+    const GLenum attachments[3] = { GL_COLOR_ATTACHMENT0 + ALBEDO, GL_COLOR_ATTACHMENT0 + NORMAL, GL_COLOR_ATTACHMENT0 + SPECULAR };
+    glDrawBuffers(3, attachments);
+}
+
+void GBuffer::WriteOutput() {
+    GLState::Get().BindFramebuffer(GL_DRAW_FRAMEBUFFER, FBO);
+    glDrawBuffer(GL_COLOR_ATTACHMENT0 + OUTPUT);
+}
+
+void GBuffer::Read(GLuint _firstTextureUnit) {
+    // Depth is sampled while it stays attached for the stencil test, the lighting passes never write it
+    const GLuint inputs[4] = { textures[ALBEDO], textures[NORMAL], textures[SPECULAR], depthStencil };
+
+    for ( GLuint i = 0; i < 4; i++ ) {
+        GLState::Get().BindTexture(_firstTextureUnit + i, GL_TEXTURE_2D, inputs[i]);
+    }
+}
+
+void GBuffer::BlitOutput(GLuint _width, GLuint _height) {
+    GLState::Get().BindFramebuffer(GL_READ_FRAMEBUFFER, FBO);
+    glReadBuffer(GL_COLOR_ATTACHMENT0 + OUTPUT);
+    GLState::Get().BindFramebuffer(GL_DRAW_FRAMEBUFFER, 0);
+
+    // glBlitFramebuffer — copy a block of pixels from the read framebuffer to the draw framebuffer
+    glBlitFramebuffer(0, 0, width, height, 0, 0, _width, _height, GL_COLOR_BUFFER_BIT, GL_LINEAR);
+
+    GLState::Get().BindFramebuffer(GL_FRAMEBUFFER, 0);
+}
+
+GLuint GBuffer::GetWidth() const { return width; }
+
+GLuint GBuffer::GetHeight() const { return height; }
\ No newline at end of file
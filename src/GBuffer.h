@@ -0,0 +1,30 @@
+#ifndef GBUFFER_H
+#define GBUFFER_H
+
+#include <GL/glew.h>
+
+// Render targets of the deferred path. The geometry pass fills albedo, normal and specular parameters,
+// the lighting passes read them back and accumulate into the output attachment, which shares the
+// depth-stencil buffer so light volumes can be stencil tested against the scene.
+class GBuffer {
+    public:
+        enum Target { ALBEDO, NORMAL, SPECULAR, OUTPUT, TARGET_COUNT };
+
+        GBuffer();
+        ~GBuffer();
+        bool Init(GLuint _width, GLuint _height);
+        void WriteGeometry();
+        void WriteOutput();
+        void Read(GLuint _firstTextureUnit);
+        void BlitOutput(GLuint _width, GLuint _height);
+        GLuint GetWidth() const;
+        GLuint GetHeight() const;
+
+    private:
+        GLuint FBO;
+        GLuint textures[TARGET_COUNT];
+        GLuint depthStencil;
+        GLuint width, height;
+};
+
+#endif
\ No newline at end of file
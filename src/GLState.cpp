@@ -0,0 +1,279 @@
+#include "GLState.h"
+
+GLState::GLState() : issued(0), skipped(0), frameIssued(0), frameSkipped(0) { Invalidate(); }
+
+GLState& GLState::Get() {
+    static GLState state;
+    return state;
+}
+
+bool GLState::Changes(GLuint& _cached, GLuint _value) {
+    if ( _cached == _value ) {
+        skipped++;
+        return false;
+    }
+
+    _cached = _value;
+    issued++;
+
+    return true;
+}
+
+void GLState::UseProgram(GLuint _program) {
+    if ( Changes(program, _program) ) glUseProgram(_program);
+}
+
+void GLState::BindVertexArray(GLuint _vertexArray) {
+    if ( !Changes(vertexArray, _vertexArray) ) return;
+
+    glBindVertexArray(_vertexArray);
+
+    // The element buffer binding belongs to the vertex array, whatever it recorded is current now
+    buffers[BufferSlot(GL_ELEMENT_ARRAY_BUFFER)] = UNKNOWN;
+}
+
+void GLState::BindBuffer(GLenum _target, GLuint _buffer) {
+    int slot = BufferSlot(_target);
+
+    if ( slot < 0 ) {
+        issued++;
+        glBindBuffer(_target, _buffer);
+    } else if ( Changes(buffers[slot], _buffer) ) {
+        glBindBuffer(_target, _buffer);
+    }
+}
+
+void GLState::BindBufferRange(GLenum _target, GLuint _index, GLuint _buffer, GLintptr _offset, GLsizeiptr _size) {
+    // Offsets differ from draw to draw, not worth caching, but the generic binding point moves along with it
+    issued++;
+    glBindBufferRange(_target, _index, _buffer, _offset, _size);
+
+    int slot = BufferSlot(_target);
+
+    if ( slot >= 0 ) buffers[slot] = _buffer;
+}
+
+void GLState::ActiveTexture(GLuint _unit) {
+    if ( Changes(activeUnit, _unit) ) glActiveTexture(GL_TEXTURE0 + _unit);
+}
+
+void GLState::BindTexture(GLenum _target, GLuint _texture) {
+    int slot = TextureSlot(_target);
+
+    // After an Invalidate the bind would land on whatever unit the driver has active and leave a stale entry behind
+    if ( activeUnit == UNKNOWN ) ActiveTexture(0);
+
+    if ( slot < 0 || activeUnit >= TEXTURE_UNITS ) {
+        issued++;
+        glBindTexture(_target, _texture);
+    } else if ( Changes(textures[activeUnit][slot], _texture) ) {
+        glBindTexture(_target, _texture);
+    }
+}
+
+void GLState::BindTexture(GLuint _unit, GLenum _target, GLuint _texture) {
+    int slot = TextureSlot(_target);
+
+    // Checked before selecting the unit, an unchanged binding doesn't need the glActiveTexture either
+    if ( slot >= 0 && _unit < TEXTURE_UNITS && textures[_unit][slot] == _texture ) {
+        skipped++;
+        return;
+    }
+
+    ActiveTexture(_unit);
+    BindTexture(_target, _texture);
+}
+
+void GLState::BindFramebuffer(GLenum _target, GLuint _framebuffer) {
+    bool draw = _target != GL_READ_FRAMEBUFFER && drawFramebuffer != _framebuffer;
+    bool read = _target != GL_DRAW_FRAMEBUFFER && readFramebuffer != _framebuffer;
+
+    if ( !draw && !read ) {
+        skipped++;
+        return;
+    }
+
+    issued++;
+
+    if ( _target == GL_FRAMEBUFFER && !( draw && read ) ) {
+        // Only one side changes, binding just that one leaves the other alone
+        glBindFramebuffer(draw ? GL_DRAW_FRAMEBUFFER : GL_READ_FRAMEBUFFER, _framebuffer);
+    } else {
+        glBindFramebuffer(_target, _framebuffer);
+    }
+
+    if ( _target != GL_READ_FRAMEBUFFER ) drawFramebuffer = _framebuffer;
+    if ( _target != GL_DRAW_FRAMEBUFFER ) readFramebuffer = _framebuffer;
+}
+
+void GLState::Viewport(GLint _x, GLint _y, GLsizei _width, GLsizei _height) {
+    if ( viewport[0] == _x && viewport[1] == _y && viewport[2] == _width && viewport[3] == _height ) {
+        skipped++;
+        return;
+    }
+
+    viewport[0] = _x; viewport[1] = _y; viewport[2] = _width; viewport[3] = _height;
+    issued++;
+
+    glViewport(_x, _y, _width, _height);
+}
+
+void GLState::Enable(GLenum _capability) {
+    int slot = CapabilitySlot(_capability);
+
+    if ( slot < 0 ) {
+        issued++;
+        glEnable(_capability);
+    } else if ( Changes(capabilities[slot], GL_TRUE) ) {
+        glEnable(_capability);
+    }
+}
+
+void GLState::Disable(GLenum _capability) {
+    int slot = CapabilitySlot(_capability);
+
+    if ( slot < 0 ) {
+        issued++;
+        glDisable(_capability);
+    } else if ( Changes(capabilities[slot], GL_FALSE) ) {
+        glDisable(_capability);
+    }
+}
+
+void GLState::DepthMask(GLboolean _mask) {
+    if ( Changes(depthMask, _mask) ) glDepthMask(_mask);
+}
+
+void GLState::DepthFunc(GLenum _function) {
+    if ( Changes(depthFunc, _function) ) glDepthFunc(_function);
+}
+
+void GLState::BlendFunc(GLenum _source, GLenum _destination) {
+    if ( blendSource == _source && blendDestination == _destination ) {
+        skipped++;
+        return;
+    }
+
+    blendSource = _source;
+    blendDestination = _destination;
+    issued++;
+
+    glBlendFunc(_source, _destination);
+}
+
+void GLState::BlendEquation(GLenum _mode) {
+    if ( Changes(blendEquation, _mode) ) glBlendEquation(_mode);
+}
+
+void GLState::CullFace(GLenum _mode) {
+    if ( Changes(cullFace, _mode) ) glCullFace(_mode);
+}
+
+void GLState::DeleteProgram(GLuint _program) {
+    // A deleted program stays in use until replaced, but its name can come back for a new one
+    if ( program == _program ) program = UNKNOWN;
+
+    glDeleteProgram(_program);
+}
+
+void GLState::DeleteVertexArrays(GLsizei _count, const GLuint* _vertexArrays) {
+    for ( GLsizei i = 0; i < _count; i++ ) {
+        if ( vertexArray == _vertexArrays[i] ) {
+            vertexArray = 0;
+            buffers[BufferSlot(GL_ELEMENT_ARRAY_BUFFER)] = UNKNOWN;
+        }
+    }
+
+    glDeleteVertexArrays(_count, _vertexArrays);
+}
+
+void GLState::DeleteBuffers(GLsizei _count, const GLuint* _buffers) {
+    for ( GLsizei i = 0; i < _count; i++ ) {
+        for ( GLuint& buffer : buffers ) {
+            if ( buffer == _buffers[i] ) buffer = 0;
+        }
+    }
+
+    glDeleteBuffers(_count, _buffers);
+}
+
+void GLState::DeleteTextures(GLsizei _count, const GLuint* _textures) {
+    for ( GLsizei i = 0; i < _count; i++ ) {
+        for ( auto& unit : textures ) {
+            for ( GLuint& texture : unit ) {
+                if ( texture == _textures[i] ) texture = 0;
+            }
+        }
+    }
+
+    glDeleteTextures(_count, _textures);
+}
+
+void GLState::DeleteFramebuffers(GLsizei _count, const GLuint* _framebuffers) {
+    for ( GLsizei i = 0; i < _count; i++ ) {
+        if ( drawFramebuffer == _framebuffers[i] ) drawFramebuffer = 0;
+        if ( readFramebuffer == _framebuffers[i] ) readFramebuffer = 0;
+    }
+
+    glDeleteFramebuffers(_count, _framebuffers);
+}
+
+void GLState::Invalidate() {
+    program = vertexArray = activeUnit = UNKNOWN;
+    drawFramebuffer = readFramebuffer = UNKNOWN;
+    depthMask = depthFunc = blendSource = blendDestination = blendEquation = cullFace = UNKNOWN;
+
+    for ( GLuint& buffer : buffers ) buffer = UNKNOWN;
+    for ( GLuint& capability : capabilities ) capability = UNKNOWN;
+
+    for ( auto& unit : textures ) {
+        for ( GLuint& texture : unit ) texture = UNKNOWN;
+    }
+
+    // A size no window has, so the first viewport is always set
+    viewport[0] = viewport[1] = viewport[2] = viewport[3] = -1;
+}
+
+void GLState::EndFrame() {
+    frameIssued = issued;
+    frameSkipped = skipped;
+    issued = skipped = 0;
+}
+
+size_t GLState::GetIssuedCount() const { return frameIssued; }
+
+size_t GLState::GetSkippedCount() const { return frameSkipped; }
+
+int GLState::BufferSlot(GLenum _target) {
+    switch ( _target ) {
+        case GL_ARRAY_BUFFER: return 0;
+        case GL_ELEMENT_ARRAY_BUFFER: return 1;
+        case GL_UNIFORM_BUFFER: return 2;
+        case GL_TEXTURE_BUFFER: return 3;
+        case GL_PIXEL_UNPACK_BUFFER: return 4;
+        case GL_COPY_READ_BUFFER: return 5;
+        case GL_COPY_WRITE_BUFFER: return 6;
+        default: return -1;
+    }
+}
+
+int GLState::TextureSlot(GLenum _target) {
+    switch ( _target ) {
+        case GL_TEXTURE_2D: return 0;
+        case GL_TEXTURE_2D_ARRAY: return 1;
+        case GL_TEXTURE_CUBE_MAP: return 2;
+        case GL_TEXTURE_BUFFER: return 3;
+        case GL_TEXTURE_CUBE_MAP_ARRAY: return 4;
+        default: return -1;
+    }
+}
+
+int GLState::CapabilitySlot(GLenum _capability) {
+    switch ( _capability ) {
+        case GL_DEPTH_TEST: return 0;
+        case GL_BLEND: return 1;
+        case GL_CULL_FACE: return 2;
+        case GL_STENCIL_TEST: return 3;
+        default: return -1;
+    }
+}
\ No newline at end of file
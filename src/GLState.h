@@ -0,0 +1,67 @@
+#ifndef GL_STATE_H
+#define GL_STATE_H
+
+#include <cstddef>
+
+#include <GL/glew.h>
+
+// Shadow copy of the GL state the renderer changes most, calls that would set what's already set are dropped.
+// Only correct while every change goes through here: binds, enables and deletes alike, since deleting a
+// bound object silently resets its binding. Anything unknown (startup, Invalidate, a VAO switch for the
+// element buffer) is reissued on the next call. GL thread only.
+class GLState {
+    public:
+        static GLState& Get();
+        void UseProgram(GLuint _program);
+        void BindVertexArray(GLuint _vertexArray);
+        void BindBuffer(GLenum _target, GLuint _buffer);
+        void BindBufferRange(GLenum _target, GLuint _index, GLuint _buffer, GLintptr _offset, GLsizeiptr _size);
+        void ActiveTexture(GLuint _unit);
+        void BindTexture(GLenum _target, GLuint _texture);
+        void BindTexture(GLuint _unit, GLenum _target, GLuint _texture);
+        void BindFramebuffer(GLenum _target, GLuint _framebuffer);
+        void Viewport(GLint _x, GLint _y, GLsizei _width, GLsizei _height);
+        void Enable(GLenum _capability);
+        void Disable(GLenum _capability);
+        void DepthMask(GLboolean _mask);
+        void DepthFunc(GLenum _function);
+        void BlendFunc(GLenum _source, GLenum _destination);
+        void BlendEquation(GLenum _mode);
+        void CullFace(GLenum _mode);
+        void DeleteProgram(GLuint _program);
+        void DeleteVertexArrays(GLsizei _count, const GLuint* _vertexArrays);
+        void DeleteBuffers(GLsizei _count, const GLuint* _buffers);
+        void DeleteTextures(GLsizei _count, const GLuint* _textures);
+        void DeleteFramebuffers(GLsizei _count, const GLuint* _framebuffers);
+        void Invalidate();
+        void EndFrame();
+        size_t GetIssuedCount() const;
+        size_t GetSkippedCount() const;
+
+    private:
+        static const GLuint UNKNOWN = ~0u;
+        static const int BUFFER_TARGETS = 7;
+        static const int TEXTURE_UNITS = 32;
+        static const int TEXTURE_TARGETS = 5;
+        static const int CAPABILITIES = 4;
+
+        GLuint program;
+        GLuint vertexArray;
+        GLuint buffers[BUFFER_TARGETS];
+        GLuint activeUnit;
+        GLuint textures[TEXTURE_UNITS][TEXTURE_TARGETS];
+        GLuint drawFramebuffer, readFramebuffer;
+        GLint viewport[4];
+        GLuint capabilities[CAPABILITIES];
+        GLuint depthMask, depthFunc, blendSource, blendDestination, blendEquation, cullFace;
+        size_t issued, skipped;
+        size_t frameIssued, frameSkipped;
+
+        GLState();
+        bool Changes(GLuint& _cached, GLuint _value);
+        static int BufferSlot(GLenum _target);
+        static int TextureSlot(GLenum _target);
+        static int CapabilitySlot(GLenum _capability);
+};
+
+#endif
\ No newline at end of file
@@ -0,0 +1,182 @@
+#include <map>
+#include <vector>
+#include <iomanip>
+#include <algorithm>
+
+#include "GpuMemory.h"
+
+namespace {
+    const double MEGABYTE = 1024.0 * 1024.0;
+
+    // What drivers actually store: three component formats are padded to four
+    size_t BytesPerTexel(GLenum _internalFormat) {
+        switch ( _internalFormat ) {
+            case GL_R8: return 1;
+            case GL_DEPTH_COMPONENT16: case GL_RG8: case GL_R16F: return 2;
+            case GL_RGB8: case GL_RGBA8: case GL_RGB: case GL_RGBA: case GL_DEPTH_COMPONENT24: case GL_DEPTH_COMPONENT32F:
+            case GL_DEPTH24_STENCIL8: case GL_RG16F: case GL_R32F: case GL_R32UI: return 4;
+            case GL_RGB16F: case GL_RGBA16F: case GL_RG32F: case GL_RG32UI: return 8;
+            case GL_RGBA32F: return 16;
+            default: return 4;
+        }
+    }
+}
+
+GpuMemory::GpuMemory() = default;
+
+GpuMemory& GpuMemory::Get() {
+    static GpuMemory memory;
+    return memory;
+}
+
+void GpuMemory::TrackBuffer(GLuint _buffer, size_t _bytes, GpuMemoryCategory _category, const std::string& _owner) {
+    Track(Kind::Buffer, _buffer, _bytes, _category, _owner);
+}
+
+void GpuMemory::TrackTexture(GLuint _texture, size_t _bytes, GpuMemoryCategory _category, const std::string& _owner) {
+    Track(Kind::Texture, _texture, _bytes, _category, _owner);
+}
+
+void GpuMemory::TrackRenderbuffer(GLuint _renderbuffer, size_t _bytes, GpuMemoryCategory _category, const std::string& _owner) {
+    Track(Kind::Renderbuffer, _renderbuffer, _bytes, _category, _owner);
+}
+
+void GpuMemory::ReleaseBuffer(GLuint _buffer) { Release(Kind::Buffer, _buffer); }
+
+void GpuMemory::ReleaseTexture(GLuint _texture) { Release(Kind::Texture, _texture); }
+
+void GpuMemory::ReleaseRenderbuffer(GLuint _renderbuffer) { Release(Kind::Renderbuffer, _renderbuffer); }
+
+void GpuMemory::Track(Kind _kind, GLuint _name, size_t _bytes, GpuMemoryCategory _category, const std::string& _owner) {
+    if ( _name == 0 ) return;
+
+    // Re-specifying a store (glBufferData orphaning) replaces the old size
+    Release(_kind, _name);
+
+    allocations[MakeKey(_kind, _name)] = { _kind, _bytes, _category, _owner };
+
+    categoryBytes[static_cast<int>(_category)] += _bytes;
+    totalBytes += _bytes;
+    peakBytes = std::max(peakBytes, totalBytes);
+}
+
+void GpuMemory::Release(Kind _kind, GLuint _name) {
+    auto found = allocations.find(MakeKey(_kind, _name));
+
+    if ( found == allocations.end() ) return;
+
+    categoryBytes[static_cast<int>(found->second.category)] -= found->second.bytes;
+    totalBytes -= found->second.bytes;
+
+    allocations.erase(found);
+}
+
+size_t GpuMemory::GetBytes(GpuMemoryCategory _category) const { return categoryBytes[static_cast<int>(_category)]; }
+
+size_t GpuMemory::GetTotalBytes() const { return totalBytes; }
+
+size_t GpuMemory::GetPeakBytes() const { return peakBytes; }
+
+size_t GpuMemory::GetAllocationCount() const { return allocations.size(); }
+
+void GpuMemory::Dump(std::ostream& _out) const {
+    // Owners sorted by size within each category, the big ones are what a scene gets sized by
+    std::map<std::pair<int, std::string>, std::pair<size_t, size_t>> owners;
+
+    for ( const auto& allocation : allocations ) {
+        auto& owner = owners[{ static_cast<int>(allocation.second.category), allocation.second.owner }];
+        owner.first += allocation.second.bytes;
+        owner.second++;
+    }
+
+    _out << std::fixed << std::setprecision(2);
+    _out << "GPU memory: " << totalBytes / MEGABYTE << " MB in " << allocations.size() << " allocations, peak "
+         << peakBytes / MEGABYTE << " MB\n";
+
+    for ( int category = 0; category < static_cast<int>(GpuMemoryCategory::Count); category++ ) {
+        _out << "  " << GetCategoryName(static_cast<GpuMemoryCategory>(category)) << ": " << categoryBytes[category] / MEGABYTE << " MB\n";
+
+        std::vector<std::pair<size_t, std::string>> sorted;
+
+        for ( const auto& owner : owners ) {
+            if ( owner.first.first != category ) continue;
+
+            sorted.emplace_back(owner.second.first, owner.first.second + " (" + std::to_string(owner.second.second) + ")");
+        }
+
+        std::sort(sorted.rbegin(), sorted.rend());
+
+        for ( const auto& owner : sorted ) {
+            _out << "    " << std::setw(10) << owner.first / MEGABYTE << " MB  " << owner.second << '\n';
+        }
+    }
+
+    _out << std::defaultfloat;
+}
+
+bool GpuMemory::EndFrame(std::ostream& _out) {
+    if ( totalBytes == lastFrameBytes ) return false;
+
+    _out << std::fixed << std::setprecision(2) << "GPU memory: " << totalBytes / MEGABYTE << " MB (";
+
+    for ( int category = 0; category < static_cast<int>(GpuMemoryCategory::Count); category++ ) {
+        _out << ( category ? ", " : "" ) << GetCategoryName(static_cast<GpuMemoryCategory>(category)) << ' ' << categoryBytes[category] / MEGABYTE;
+    }
+
+    _out << ")\n" << std::defaultfloat;
+
+    lastFrameBytes = totalBytes;
+
+    return true;
+}
+
+bool GpuMemory::ReportLeaks(std::ostream& _out) const {
+    for ( const auto& allocation : allocations ) {
+        _out << "GPU memory leak: " << GetKindName(allocation.second.kind) << ' ' << ( allocation.first & 0xFFFFFFFFu ) << " of "
+             << allocation.second.bytes << " bytes, " << GetCategoryName(allocation.second.category) << ", owned by "
+             << allocation.second.owner << '\n';
+    }
+
+    return !allocations.empty();
+}
+
+size_t GpuMemory::CalcTextureBytes(GLenum _internalFormat, GLuint _width, GLuint _height, GLuint _layers, GLuint _levels) {
+    size_t texels = 0;
+
+    for ( GLuint level = 0; level < _levels; level++ ) {
+        texels += static_cast<size_t>(std::max(1u, _width >> level)) * std::max(1u, _height >> level);
+    }
+
+    return texels * _layers * BytesPerTexel(_internalFormat);
+}
+
+GLuint GpuMemory::CalcLevelCount(GLuint _width, GLuint _height) {
+    GLuint levels = 1;
+
+    while ( ( std::max(_width, _height) >> levels ) > 0 ) levels++;
+
+    return levels;
+}
+
+const char* GpuMemory::GetCategoryName(GpuMemoryCategory _category) {
+    switch ( _category ) {
+        case GpuMemoryCategory::Geometry: return "Geometry";
+        case GpuMemoryCategory::Textures: return "Textures";
+        case GpuMemoryCategory::ShadowMaps: return "Shadow maps";
+        case GpuMemoryCategory::RenderTargets: return "Render targets";
+        case GpuMemoryCategory::LightData: return "Light data";
+        case GpuMemoryCategory::DrawData: return "Draw data";
+        case GpuMemoryCategory::Staging: return "Staging";
+        default: return "Unknown";
+    }
+}
+
+uint64_t GpuMemory::MakeKey(Kind _kind, GLuint _name) { return static_cast<uint64_t>(_kind) << 32 | _name; }
+
+const char* GpuMemory::GetKindName(Kind _kind) {
+    switch ( _kind ) {
+        case Kind::Buffer: return "buffer";
+        case Kind::Texture: return "texture";
+        default: return "renderbuffer";
+    }
+}
\ No newline at end of file
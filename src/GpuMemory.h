@@ -0,0 +1,67 @@
+#ifndef GPU_MEMORY_H
+#define GPU_MEMORY_H
+
+#include <string>
+#include <unordered_map>
+#include <ostream>
+#include <cstdint>
+
+#include <GL/glew.h>
+
+enum class GpuMemoryCategory {
+    Geometry,       // vertex and index buffers
+    Textures,       // material textures and the skybox
+    ShadowMaps,
+    RenderTargets,  // G-buffer and transient colour targets
+    LightData,      // buffers the clustered lights are read from
+    DrawData,       // per-draw matrices and material parameters
+    Staging,        // upload staging memory
+    Count
+};
+
+// Bookkeeping for every buffer, texture and renderbuffer the engine allocates: the size is recorded when the
+// storage is specified and dropped with the name, so the totals per category and owner are live. Whatever is
+// still recorded at shutdown was never deleted. GL thread only, like the allocations themselves.
+class GpuMemory {
+    public:
+        static GpuMemory& Get();
+        void TrackBuffer(GLuint _buffer, size_t _bytes, GpuMemoryCategory _category, const std::string& _owner);
+        void TrackTexture(GLuint _texture, size_t _bytes, GpuMemoryCategory _category, const std::string& _owner);
+        void TrackRenderbuffer(GLuint _renderbuffer, size_t _bytes, GpuMemoryCategory _category, const std::string& _owner);
+        void ReleaseBuffer(GLuint _buffer);
+        void ReleaseTexture(GLuint _texture);
+        void ReleaseRenderbuffer(GLuint _renderbuffer);
+        size_t GetBytes(GpuMemoryCategory _category) const;
+        size_t GetTotalBytes() const;
+        size_t GetPeakBytes() const;
+        size_t GetAllocationCount() const;
+        void Dump(std::ostream& _out) const;
+        bool EndFrame(std::ostream& _out);
+        bool ReportLeaks(std::ostream& _out) const;
+        static size_t CalcTextureBytes(GLenum _internalFormat, GLuint _width, GLuint _height, GLuint _layers, GLuint _levels);
+        static GLuint CalcLevelCount(GLuint _width, GLuint _height);
+        static const char* GetCategoryName(GpuMemoryCategory _category);
+
+    private:
+        enum class Kind { Buffer, Texture, Renderbuffer };
+
+        struct Allocation {
+            Kind kind;
+            size_t bytes;
+            GpuMemoryCategory category;
+            std::string owner;
+        };
+
+        // GL names are only unique per object type, the kind goes in the top bits of the key
+        std::unordered_map<uint64_t, Allocation> allocations;
+        size_t categoryBytes[static_cast<int>(GpuMemoryCategory::Count)]{};
+        size_t totalBytes{}, peakBytes{}, lastFrameBytes{};
+
+        GpuMemory();
+        void Track(Kind _kind, GLuint _name, size_t _bytes, GpuMemoryCategory _category, const std::string& _owner);
+        void Release(Kind _kind, GLuint _name);
+        static uint64_t MakeKey(Kind _kind, GLuint _name);
+        static const char* GetKindName(Kind _kind);
+};
+
+#endif
\ No newline at end of file
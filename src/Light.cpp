@@ -1,6 +1,14 @@
+#include <cmath>
+#include <algorithm>
+
 #include "Light.h"
 #include "ShadowMap.h"
 
+namespace {
+    // Stands in for lights without falloff, small enough that squaring it stays finite
+    const float UNBOUNDED_RANGE = 1e6f;
+}
+
 Light::Light(GLuint _width, GLuint _height, const glm::vec3& _colour, GLfloat _aIntensity, GLfloat _dIntensity)
         : colour(_colour), ambientIntensity(_aIntensity), diffuseIntensity(_dIntensity) {
     shadowMap = std::make_shared<ShadowMap>();
@@ -9,4 +17,18 @@ Light::Light(GLuint _width, GLuint _height, const glm::vec3& _colour, GLfloat _a
 
 Light::~Light() = default;
 
-std::shared_ptr<ShadowMap> Light::GetShadowMap() const { return shadowMap; }
\ No newline at end of file
+std::shared_ptr<ShadowMap> Light::GetShadowMap() const { return shadowMap; }
+
+GLfloat Light::CalcAttenuationRange(const glm::vec3& _colour, GLfloat _intensity, GLfloat _constant, GLfloat _linear, GLfloat _exponent,
+        GLfloat _cutoff) {
+    float brightest = std::max(_colour.x, std::max(_colour.y, _colour.z)) * _intensity;
+    float target = brightest / _cutoff - _constant;
+
+    if ( target <= 0.0f ) return 0.0f;
+
+    if ( _exponent > 0.0f ) return ( -_linear + std::sqrt(_linear * _linear + 4.0f * _exponent * target) ) / ( 2.0f * _exponent );
+
+    if ( _linear > 0.0f ) return target / _linear;
+
+    return UNBOUNDED_RANGE;
+}
\ No newline at end of file
@@ -13,6 +13,9 @@ class Light {
         explicit Light(GLuint _width, GLuint _height, const glm::vec3& _colour, GLfloat _aIntensity, GLfloat _dIntensity);
         ~Light();
         std::shared_ptr<ShadowMap> GetShadowMap() const;
+        // Distance at which the light's brightest channel falls to _cutoff, one step of an 8 bit channel by default
+        static GLfloat CalcAttenuationRange(const glm::vec3& _colour, GLfloat _intensity, GLfloat _constant, GLfloat _linear,
+                GLfloat _exponent, GLfloat _cutoff = 1.0f / 256.0f);
 
     protected:
         glm::vec3 colour;
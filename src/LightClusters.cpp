@@ -0,0 +1,346 @@
+#include <cmath>
+#include <cfloat>
+#include <algorithm>
+
+#if defined(__SSE2__) || defined(_M_X64) || defined(_M_AMD64)
+#define LIGHT_CLUSTERS_SSE 1
+#include <emmintrin.h>
+#endif
+
+#include "glm/gtc/matrix_transform.hpp"
+
+#include "LightClusters.h"
+#include "GLState.h"
+#include "Light.h"
+#include "Constans.h"
+#include "Shader.h"
+#include "ThreadPool.h"
+#include "GpuMemory.h"
+
+namespace {
+    // Every slice tests all of its 144 clusters against each light, so a few slices per job are enough to pay for the wake up
+    const size_t MIN_SLICES_PER_RANGE = 4;
+
+    const size_t TEXELS_PER_LIGHT = 4;
+
+    enum ClusterBuffer { GRID, INDICES, LIGHTS };
+
+    glm::vec3 UnprojectAtDepth(const glm::mat4& _inverseProjection, float _x, float _y, float _depth) {
+        glm::vec4 nearPoint = _inverseProjection * glm::vec4(_x, _y, -1.0f, 1.0f);
+        glm::vec3 point = glm::vec3(nearPoint) / nearPoint.w;
+
+        // The view looks down -Z, scale the near plane point along its eye ray onto the slice plane
+        return point * ( _depth / -point.z );
+    }
+}
+
+GLfloat ClusterLight::CalcRange() const {
+    return Light::CalcAttenuationRange(colour, diffuseIntensity, constant, linear, exponent);
+}
+
+LightClusters::LightClusters() : zNear(0.1f), zFar(100.0f) {
+    slices.resize(GRID_Z);
+    grid.resize(CLUSTER_COUNT * 2);
+}
+
+LightClusters::~LightClusters() {
+    if ( textures[0] != 0 ) GLState::Get().DeleteTextures(3, textures);
+    if ( buffers[0] != 0 ) {
+        for ( GLuint buffer : buffers ) {
+            GpuMemory::Get().ReleaseBuffer(buffer);
+        }
+
+        GLState::Get().DeleteBuffers(3, buffers);
+    }
+}
+
+void LightClusters::SetProjection(const glm::mat4& _projection, GLfloat _near, GLfloat _far) {
+    zNear = _near;
+    zFar = _far;
+
+    glm::mat4 inverseProjection = glm::inverse(_projection);
+
+    for ( GLuint z = 0; z < GRID_Z; z++ ) {
+        Slice& slice = slices[z];
+
+        // Exponential slices keep the clusters roughly cubic, the same split shader.frag inverts with a log
+        slice.nearDepth = zNear * std::pow(zFar / zNear, static_cast<float>(z) / GRID_Z);
+        slice.farDepth = zNear * std::pow(zFar / zNear, static_cast<float>(z + 1) / GRID_Z);
+
+        slice.minX.resize(CLUSTERS_PER_SLICE);
+        slice.minY.resize(CLUSTERS_PER_SLICE);
+        slice.minZ.resize(CLUSTERS_PER_SLICE);
+        slice.maxX.resize(CLUSTERS_PER_SLICE);
+        slice.maxY.resize(CLUSTERS_PER_SLICE);
+        slice.maxZ.resize(CLUSTERS_PER_SLICE);
+        slice.spheres.resize(CLUSTERS_PER_SLICE);
+
+        for ( GLuint y = 0; y < GRID_Y; y++ ) {
+            for ( GLuint x = 0; x < GRID_X; x++ ) {
+                float ndcX[2] = { -1.0f + 2.0f * x / GRID_X, -1.0f + 2.0f * ( x + 1 ) / GRID_X };
+                float ndcY[2] = { -1.0f + 2.0f * y / GRID_Y, -1.0f + 2.0f * ( y + 1 ) / GRID_Y };
+                float depths[2] = { slice.nearDepth, slice.farDepth };
+
+                glm::vec3 minCorner(FLT_MAX), maxCorner(-FLT_MAX);
+
+                for ( float depth : depths ) {
+                    for ( float cornerX : ndcX ) {
+                        for ( float cornerY : ndcY ) {
+                            glm::vec3 corner = UnprojectAtDepth(inverseProjection, cornerX, cornerY, depth);
+                            minCorner = glm::min(minCorner, corner);
+                            maxCorner = glm::max(maxCorner, corner);
+                        }
+                    }
+                }
+
+                size_t cluster = x + GRID_X * y;
+
+                slice.minX[cluster] = minCorner.x;
+                slice.minY[cluster] = minCorner.y;
+                slice.minZ[cluster] = minCorner.z;
+                slice.maxX[cluster] = maxCorner.x;
+                slice.maxY[cluster] = maxCorner.y;
+                slice.maxZ[cluster] = maxCorner.z;
+                slice.spheres[cluster] = glm::vec4(( minCorner + maxCorner ) * 0.5f, glm::length(maxCorner - minCorner) * 0.5f);
+            }
+        }
+    }
+}
+
+void LightClusters::Assign(const glm::mat4& _viewMatrix, const std::vector<ClusterLight>& _lights) {
+    size_t lightCount = std::min(_lights.size(), static_cast<size_t>(MAX_CLUSTERED_LIGHTS));
+
+    viewLights.resize(lightCount);
+    lightData.resize(std::max(lightCount, static_cast<size_t>(1)) * TEXELS_PER_LIGHT * 4);
+
+    glm::mat3 viewRotation(_viewMatrix);
+
+    for ( size_t i = 0; i < lightCount; i++ ) {
+        const ClusterLight& light = _lights[i];
+        ViewLight& viewLight = viewLights[i];
+
+        viewLight.range = light.CalcRange();
+        viewLight.apex = glm::vec3(_viewMatrix * glm::vec4(light.position, 1.0f));
+        viewLight.isSpot = light.edge > 0.0f && light.edge < 90.0f;
+
+        float cosEdge = -2.0f;
+
+        if ( viewLight.isSpot ) {
+            float angle = glm::radians(light.edge);
+            cosEdge = std::cos(angle);
+
+            viewLight.direction = glm::normalize(viewRotation * light.direction);
+            viewLight.cosEdge = cosEdge;
+            viewLight.sinEdge = std::sin(angle);
+
+            // Tightest sphere around the cone: wide cones are bounded by their cap, narrow ones by apex and rim
+            if ( angle > glm::radians(45.0f) ) {
+                viewLight.center = viewLight.apex + viewLight.direction * ( viewLight.range * cosEdge );
+                viewLight.radius = viewLight.range * viewLight.sinEdge;
+            } else {
+                float radius = viewLight.range / ( 2.0f * cosEdge * cosEdge );
+                viewLight.center = viewLight.apex + viewLight.direction * radius;
+                viewLight.radius = radius;
+            }
+        } else {
+            viewLight.center = viewLight.apex;
+            viewLight.radius = viewLight.range;
+        }
+
+        // Shading happens in world space, so the texture buffer keeps the untransformed light
+        float* texels = &lightData[i * TEXELS_PER_LIGHT * 4];
+        glm::vec3 direction = viewLight.isSpot ? glm::normalize(light.direction) : glm::vec3(0.0f);
+
+        texels[0] = light.position.x; texels[1] = light.position.y; texels[2] = light.position.z; texels[3] = viewLight.range;
+        texels[4] = light.colour.x; texels[5] = light.colour.y; texels[6] = light.colour.z; texels[7] = light.diffuseIntensity;
+        texels[8] = light.constant; texels[9] = light.linear; texels[10] = light.exponent; texels[11] = cosEdge;
+        texels[12] = direction.x; texels[13] = direction.y; texels[14] = direction.z; texels[15] = 0.0f;
+    }
+
+    ThreadPool& pool = ThreadPool::Get();
+
+    // Each slice range builds its own index list, stitched together afterwards in slice order
+    rangeOutputs.resize(pool.RangeCount(GRID_Z, MIN_SLICES_PER_RANGE));
+
+    pool.ParallelFor(GRID_Z, MIN_SLICES_PER_RANGE, [&](size_t _range, size_t _begin, size_t _end) {
+        RangeOutput& output = rangeOutputs[_range];
+        output.indices.clear();
+        output.firstCluster = _begin * CLUSTERS_PER_SLICE;
+        output.endCluster = _end * CLUSTERS_PER_SLICE;
+
+        for ( size_t z = _begin; z < _end; z++ ) {
+            AssignSlice(z, output);
+        }
+    });
+
+    indices.clear();
+
+    for ( const RangeOutput& output : rangeOutputs ) {
+        uint32_t base = static_cast<uint32_t>(indices.size());
+
+        for ( size_t cluster = output.firstCluster; cluster < output.endCluster; cluster++ ) {
+            grid[cluster * 2] += base;
+        }
+
+        indices.insert(indices.end(), output.indices.begin(), output.indices.end());
+    }
+
+    // An empty texture buffer can't be created, keep one dummy entry that no cluster points at
+    if ( indices.empty() ) indices.push_back(0);
+}
+
+void LightClusters::AssignSlice(size_t _slice, RangeOutput& _output) {
+    const Slice& slice = slices[_slice];
+    uint32_t counts[CLUSTERS_PER_SLICE] = {};
+
+    _output.pairs.clear();
+
+    for ( size_t i = 0; i < viewLights.size(); i++ ) {
+        const ViewLight& light = viewLights[i];
+
+        if ( light.radius <= 0.0f ) continue;
+
+        // Cheap reject on the view depth before testing the clusters of the slice
+        float depth = -light.center.z;
+
+        if ( depth + light.radius < slice.nearDepth || depth - light.radius > slice.farDepth ) continue;
+
+        float radiusSquared = light.radius * light.radius;
+
+        for ( size_t first = 0; first < CLUSTERS_PER_SLICE; first += 4 ) {
+            int mask = 0;
+
+#ifdef LIGHT_CLUSTERS_SSE
+            // Squared distance from the sphere centre to four cluster boxes at once
+            __m128 zero = _mm_setzero_ps();
+            __m128 centerX = _mm_set1_ps(light.center.x);
+            __m128 centerY = _mm_set1_ps(light.center.y);
+            __m128 centerZ = _mm_set1_ps(light.center.z);
+
+            __m128 dx = _mm_max_ps(zero, _mm_max_ps(_mm_sub_ps(_mm_loadu_ps(&slice.minX[first]), centerX),
+                                                    _mm_sub_ps(centerX, _mm_loadu_ps(&slice.maxX[first]))));
+            __m128 dy = _mm_max_ps(zero, _mm_max_ps(_mm_sub_ps(_mm_loadu_ps(&slice.minY[first]), centerY),
+                                                    _mm_sub_ps(centerY, _mm_loadu_ps(&slice.maxY[first]))));
+            __m128 dz = _mm_max_ps(zero, _mm_max_ps(_mm_sub_ps(_mm_loadu_ps(&slice.minZ[first]), centerZ),
+                                                    _mm_sub_ps(centerZ, _mm_loadu_ps(&slice.maxZ[first]))));
+
+            __m128 distance = _mm_add_ps(_mm_add_ps(_mm_mul_ps(dx, dx), _mm_mul_ps(dy, dy)), _mm_mul_ps(dz, dz));
+            mask = _mm_movemask_ps(_mm_cmple_ps(distance, _mm_set1_ps(radiusSquared)));
+#else
+            for ( size_t lane = 0; lane < 4; lane++ ) {
+                size_t cluster = first + lane;
+                float dx = std::max(0.0f, std::max(slice.minX[cluster] - light.center.x, light.center.x - slice.maxX[cluster]));
+                float dy = std::max(0.0f, std::max(slice.minY[cluster] - light.center.y, light.center.y - slice.maxY[cluster]));
+                float dz = std::max(0.0f, std::max(slice.minZ[cluster] - light.center.z, light.center.z - slice.maxZ[cluster]));
+
+                if ( dx * dx + dy * dy + dz * dz <= radiusSquared ) mask |= 1 << lane;
+            }
+#endif
+
+            while ( mask != 0 ) {
+                int lane = 0;
+                while ( ( mask & ( 1 << lane ) ) == 0 ) lane++;
+                mask &= ~( 1 << lane );
+
+                size_t cluster = first + lane;
+
+                if ( light.isSpot && !ConeIntersectsSphere(light, slice.spheres[cluster]) ) continue;
+
+                if ( counts[cluster] >= static_cast<uint32_t>(MAX_LIGHTS_PER_CLUSTER) ) continue;
+
+                counts[cluster]++;
+                _output.pairs.push_back(static_cast<uint32_t>(cluster << 16 | i));
+            }
+        }
+    }
+
+    // Counting sort of the pairs by cluster, the lights inside a cluster stay in their original order
+    uint32_t cursors[CLUSTERS_PER_SLICE];
+    uint32_t offset = static_cast<uint32_t>(_output.indices.size());
+    size_t firstCluster = _slice * CLUSTERS_PER_SLICE;
+
+    for ( size_t cluster = 0; cluster < CLUSTERS_PER_SLICE; cluster++ ) {
+        cursors[cluster] = offset;
+        grid[( firstCluster + cluster ) * 2] = offset;
+        grid[( firstCluster + cluster ) * 2 + 1] = counts[cluster];
+        offset += counts[cluster];
+    }
+
+    _output.indices.resize(offset);
+
+    for ( uint32_t pair : _output.pairs ) {
+        _output.indices[cursors[pair >> 16]++] = pair & 0xFFFF;
+    }
+}
+
+bool LightClusters::ConeIntersectsSphere(const ViewLight& _light, const glm::vec4& _sphere) {
+    glm::vec3 toCenter = glm::vec3(_sphere) - _light.apex;
+    float lengthSquared = glm::dot(toCenter, toCenter);
+    float alongAxis = glm::dot(toCenter, _light.direction);
+    float closest = _light.cosEdge * std::sqrt(std::max(lengthSquared - alongAxis * alongAxis, 0.0f)) - alongAxis * _light.sinEdge;
+
+    bool outsideAngle = closest > _sphere.w;
+    bool beyondRange = alongAxis > _sphere.w + _light.range;
+    bool behindApex = alongAxis < -_sphere.w;
+
+    return !( outsideAngle || beyondRange || behindApex );
+}
+
+void LightClusters::Upload() {
+    if ( buffers[0] == 0 ) {
+        glGenBuffers(3, buffers);
+        glGenTextures(3, textures);
+
+        // glTexBuffer attaches the buffer object's data store to a buffer texture, orphaning the store keeps the attachment
+        GLenum formats[3] = { GL_RG32UI, GL_R32UI, GL_RGBA32F };
+
+        for ( int i = 0; i < 3; i++ ) {
+            GLState::Get().BindBuffer(GL_TEXTURE_BUFFER, buffers[i]);
+            glBufferData(GL_TEXTURE_BUFFER, 16, nullptr, GL_STREAM_DRAW);
+
+            GLState::Get().BindTexture(GL_TEXTURE_BUFFER, textures[i]);
+            glTexBuffer(GL_TEXTURE_BUFFER, formats[i], buffers[i]);
+        }
+
+        GLState::Get().BindTexture(GL_TEXTURE_BUFFER, 0);
+    }
+
+    UploadBuffer(buffers[GRID], grid.data(), grid.size() * sizeof(uint32_t));
+    UploadBuffer(buffers[INDICES], indices.data(), indices.size() * sizeof(uint32_t));
+    UploadBuffer(buffers[LIGHTS], lightData.data(), lightData.size() * sizeof(float));
+
+    GLState::Get().BindBuffer(GL_TEXTURE_BUFFER, 0);
+}
+
+void LightClusters::UploadBuffer(GLuint _buffer, const void* _data, size_t _size) {
+    GLState::Get().BindBuffer(GL_TEXTURE_BUFFER, _buffer);
+
+    // Orphan last frame's store so the driver doesn't stall on draws still reading it
+    glBufferData(GL_TEXTURE_BUFFER, _size, nullptr, GL_STREAM_DRAW);
+    GpuMemory::Get().TrackBuffer(_buffer, _size, GpuMemoryCategory::LightData, "LightClusters");
+
+    glBufferSubData(GL_TEXTURE_BUFFER, 0, _size, _data);
+}
+
+void LightClusters::Bind(GLuint _firstTextureUnit, GLfloat _screenWidth, GLfloat _screenHeight, Shader* _shader) const {
+    const char* samplers[3] = { "clusterGrid", "clusterLightIndices", "clusterLights" };
+
+    for ( GLuint i = 0; i < 3; i++ ) {
+        GLState::Get().BindTexture(_firstTextureUnit + i, GL_TEXTURE_BUFFER, textures[i]);
+        glUniform1i(_shader->GetUniformLocation(samplers[i]), _firstTextureUnit + i);
+    }
+
+    float logRatio = std::log(zFar / zNear);
+
+    glUniform3ui(_shader->GetUniformLocation("clusterDims"), GRID_X, GRID_Y, GRID_Z);
+    glUniform2f(_shader->GetUniformLocation("clusterScreenSize"), _screenWidth, _screenHeight);
+    glUniform1f(_shader->GetUniformLocation("clusterZScale"), GRID_Z / logRatio);
+    glUniform1f(_shader->GetUniformLocation("clusterZBias"), GRID_Z * std::log(zNear) / logRatio);
+}
+
+size_t LightClusters::GetIndexCount() const { return indices.size(); }
+
+void LightClusters::GetCluster(size_t _cluster, uint32_t& _offset, uint32_t& _count) const {
+    _offset = grid[_cluster * 2];
+    _count = grid[_cluster * 2 + 1];
+}
\ No newline at end of file
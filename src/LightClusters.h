@@ -0,0 +1,83 @@
+#ifndef LIGHT_CLUSTERS_H
+#define LIGHT_CLUSTERS_H
+
+#include <vector>
+#include <cstdint>
+
+#include <GL/glew.h>
+
+#include "glm/glm.hpp"
+
+class Shader;
+
+// A shadowless point or spot light that only reaches the fragments of the clusters it overlaps
+struct ClusterLight {
+    glm::vec3 position;
+    glm::vec3 colour;
+    GLfloat diffuseIntensity;
+    GLfloat constant, linear, exponent;
+    glm::vec3 direction;
+    GLfloat edge;       // spot cone half angle in degrees, 0 or less for a point light
+
+    GLfloat CalcRange() const;
+};
+
+// Splits the view frustum into a froxel grid, assigns lights to froxels on the CPU every frame
+// and hands the compact per-cluster light lists to shader.frag through texture buffers
+class LightClusters {
+    public:
+        static const GLuint GRID_X = 16, GRID_Y = 9, GRID_Z = 24;
+        static const GLuint CLUSTERS_PER_SLICE = GRID_X * GRID_Y;
+        static const GLuint CLUSTER_COUNT = CLUSTERS_PER_SLICE * GRID_Z;
+
+        LightClusters();
+        ~LightClusters();
+        void SetProjection(const glm::mat4& _projection, GLfloat _near, GLfloat _far);
+        void Assign(const glm::mat4& _viewMatrix, const std::vector<ClusterLight>& _lights);
+        void Upload();
+        void Bind(GLuint _firstTextureUnit, GLfloat _screenWidth, GLfloat _screenHeight, Shader* _shader) const;
+        size_t GetIndexCount() const;
+        void GetCluster(size_t _cluster, uint32_t& _offset, uint32_t& _count) const;
+
+    private:
+        struct Slice {
+            // Cluster AABBs in view space, SoA so four clusters are tested at once
+            std::vector<float> minX, minY, minZ, maxX, maxY, maxZ;
+            // Bounding spheres of the same clusters, used by the spot cone test
+            std::vector<glm::vec4> spheres;
+            float nearDepth, farDepth;
+        };
+
+        struct ViewLight {
+            glm::vec3 center;   // view space centre of the bounding sphere
+            float radius;
+            glm::vec3 apex, direction;
+            float range, cosEdge, sinEdge;
+            bool isSpot;
+        };
+
+        struct RangeOutput {
+            std::vector<uint32_t> indices;
+            std::vector<uint32_t> pairs;   // cluster in the high half, light in the low half
+            size_t firstCluster, endCluster;
+        };
+
+        std::vector<Slice> slices;
+        GLfloat zNear, zFar;
+
+        std::vector<ViewLight> viewLights;
+        std::vector<RangeOutput> rangeOutputs;
+        std::vector<uint32_t> grid;             // offset and count per cluster
+        std::vector<uint32_t> indices;
+        std::vector<float> lightData;
+
+        // Created on the first upload, so assignment alone runs without a GL context
+        GLuint buffers[3]{};
+        GLuint textures[3]{};
+
+        void AssignSlice(size_t _slice, RangeOutput& _output);
+        static bool ConeIntersectsSphere(const ViewLight& _light, const glm::vec4& _sphere);
+        static void UploadBuffer(GLuint _buffer, const void* _data, size_t _size);
+};
+
+#endif
\ No newline at end of file
@@ -0,0 +1,166 @@
+#include <cstring>
+#include <cstdint>
+#include <vector>
+
+#include "Lz4.h"
+
+namespace {
+    const size_t MIN_MATCH = 4;
+
+    // Set by the format: the last five bytes are always literals and the last match starts twelve bytes before the end
+    const size_t LAST_LITERALS = 5;
+    const size_t MATCH_FIND_LIMIT = 12;
+
+    const size_t MAX_OFFSET = 65535;
+    const int HASH_BITS = 12;
+
+    uint32_t Read32(const unsigned char* _data) {
+        uint32_t value;
+        std::memcpy(&value, _data, sizeof(value));
+        return value;
+    }
+
+    uint32_t Hash(uint32_t _sequence) { return ( _sequence * 2654435761u ) >> ( 32 - HASH_BITS ); }
+}
+
+size_t Lz4::CompressBound(size_t _size) { return _size + _size / 255 + 16; }
+
+// Every input byte expands to at most 255 output bytes, a length byte of 255 being the best case, a block claiming more
+// is corrupt
+size_t Lz4::DecompressBound(size_t _compressedSize) { return _compressedSize * 255 + 16; }
+
+// Lengths of 15 and more continue in bytes of 255 after the token, ended by one smaller than that
+bool Lz4::WriteLength(size_t _length, unsigned char* _destination, size_t _capacity, size_t& _written) {
+    for ( ; _length >= 255; _length -= 255 ) {
+        if ( _written >= _capacity ) return false;
+        _destination[_written++] = 255;
+    }
+
+    if ( _written >= _capacity ) return false;
+    _destination[_written++] = static_cast<unsigned char>(_length);
+
+    return true;
+}
+
+// Token, literals, then the match as an offset back from here and its length. The block's last sequence has no match.
+bool Lz4::WriteSequence(const unsigned char* _literals, size_t _literalLength, size_t _offset, size_t _matchLength,
+        unsigned char* _destination, size_t _capacity, size_t& _written) {
+    if ( _written >= _capacity ) return false;
+
+    size_t matchCode = _offset ? _matchLength - MIN_MATCH : 0;
+    unsigned char& token = _destination[_written++];
+    token = static_cast<unsigned char>(( _literalLength < 15 ? _literalLength : 15 ) << 4 | ( matchCode < 15 ? matchCode : 15 ));
+
+    if ( _literalLength >= 15 && !WriteLength(_literalLength - 15, _destination, _capacity, _written) ) return false;
+
+    if ( _written + _literalLength > _capacity ) return false;
+    std::memcpy(_destination + _written, _literals, _literalLength);
+    _written += _literalLength;
+
+    if ( !_offset ) return true;
+
+    if ( _written + 2 > _capacity ) return false;
+    _destination[_written++] = static_cast<unsigned char>(_offset & 0xff);
+    _destination[_written++] = static_cast<unsigned char>(_offset >> 8);
+
+    return matchCode < 15 || WriteLength(matchCode - 15, _destination, _capacity, _written);
+}
+
+size_t Lz4::Compress(const unsigned char* _source, size_t _sourceSize, unsigned char* _destination, size_t _capacity) {
+    // Positions plus one, zero is an empty slot
+    std::vector<uint32_t> table(static_cast<size_t>(1) << HASH_BITS, 0);
+
+    size_t written = 0, anchor = 0, position = 0;
+
+    if ( _sourceSize > MATCH_FIND_LIMIT ) {
+        size_t matchEnd = _sourceSize - LAST_LITERALS;
+        size_t searchEnd = _sourceSize - MATCH_FIND_LIMIT;
+
+        while ( position <= searchEnd ) {
+            uint32_t sequence = Read32(_source + position);
+            uint32_t& slot = table[Hash(sequence)];
+            size_t candidate = slot;
+            slot = static_cast<uint32_t>(position + 1);
+
+            if ( !candidate || position + 1 - candidate > MAX_OFFSET || Read32(_source + candidate - 1) != sequence ) {
+                position++;
+                continue;
+            }
+
+            candidate--;
+
+            size_t length = MIN_MATCH;
+
+            while ( position + length < matchEnd && _source[candidate + length] == _source[position + length] ) length++;
+
+            if ( !WriteSequence(_source + anchor, position - anchor, position - candidate, length, _destination, _capacity, written) ) {
+                return 0;
+            }
+
+            position += length;
+            anchor = position;
+        }
+    }
+
+    if ( !WriteSequence(_source + anchor, _sourceSize - anchor, 0, 0, _destination, _capacity, written) ) return 0;
+
+    return written;
+}
+
+bool Lz4::Decompress(const unsigned char* _source, size_t _sourceSize, unsigned char* _destination, size_t _size) {
+    size_t in = 0, out = 0;
+
+    auto readLength = [&](size_t& _length) {
+        unsigned char next;
+
+        do {
+            if ( in >= _sourceSize ) return false;
+
+            next = _source[in++];
+            _length += next;
+        } while ( next == 255 );
+
+        return true;
+    };
+
+    while ( in < _sourceSize ) {
+        unsigned char token = _source[in++];
+        size_t literalLength = token >> 4;
+
+        if ( literalLength == 15 && !readLength(literalLength) ) return false;
+
+        if ( literalLength > _sourceSize - in || literalLength > _size - out ) return false;
+
+        std::memcpy(_destination + out, _source + in, literalLength);
+        in += literalLength;
+        out += literalLength;
+
+        if ( in == _sourceSize ) break;
+
+        if ( _sourceSize - in < 2 ) return false;
+
+        size_t offset = _source[in] | static_cast<size_t>(_source[in + 1]) << 8;
+        in += 2;
+
+        if ( offset == 0 || offset > out ) return false;
+
+        size_t matchLength = token & 15;
+
+        if ( matchLength == 15 && !readLength(matchLength) ) return false;
+
+        matchLength += MIN_MATCH;
+
+        if ( matchLength > _size - out ) return false;
+
+        // Byte by byte, a match may overlap what it's copying (an offset of one repeats a single byte)
+        const unsigned char* match = _destination + out - offset;
+
+        for ( size_t i = 0; i < matchLength; i++ ) {
+            _destination[out + i] = match[i];
+        }
+
+        out += matchLength;
+    }
+
+    return out == _size;
+}
\ No newline at end of file
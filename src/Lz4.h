@@ -0,0 +1,22 @@
+#ifndef LZ4_H
+#define LZ4_H
+
+#include <cstddef>
+
+// The LZ4 block format, without the frame around it. Compress is the plain greedy single-hash search, about as fast as
+// reading the file and good for the shaders, models and uncompressed images in the asset pack. Decompress checks every
+// length against both buffers, a corrupt block fails instead of reading or writing out of bounds.
+class Lz4 {
+    public:
+        static size_t CompressBound(size_t _size);
+        static size_t DecompressBound(size_t _compressedSize);
+        static size_t Compress(const unsigned char* _source, size_t _sourceSize, unsigned char* _destination, size_t _capacity);
+        static bool Decompress(const unsigned char* _source, size_t _sourceSize, unsigned char* _destination, size_t _size);
+
+    private:
+        static bool WriteLength(size_t _length, unsigned char* _destination, size_t _capacity, size_t& _written);
+        static bool WriteSequence(const unsigned char* _literals, size_t _literalLength, size_t _offset, size_t _matchLength,
+                unsigned char* _destination, size_t _capacity, size_t& _written);
+};
+
+#endif
\ No newline at end of file
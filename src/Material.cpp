@@ -4,7 +4,6 @@ Material::Material(GLfloat _sIntensity, GLfloat _shine) : specularIntesity(_sInt
 
 Material::~Material() = default;
 
-void Material::UseMateril(GLfloat _specularIntensityLocation, GLfloat _shininessLocation) const {
-    glUniform1f(_specularIntensityLocation, specularIntesity);
-    glUniform1f(_shininessLocation, shininess);
-}
\ No newline at end of file
+GLfloat Material::GetSpecularIntensity() const { return specularIntesity; }
+
+GLfloat Material::GetShininess() const { return shininess; }
\ No newline at end of file
@@ -7,7 +7,8 @@ class Material {
     public:
         Material(GLfloat _sIntensity, GLfloat _shine);
         ~Material();
-        void UseMateril(GLfloat _specularIntensityLocation, GLfloat _shininessLocation) const;
+        GLfloat GetSpecularIntensity() const;
+        GLfloat GetShininess() const;
 
     private:
         GLfloat specularIntesity;
@@ -1,19 +1,33 @@
+#include <algorithm>
+#include <cstring>
+
 #include "Mesh.h"
+#include "GLState.h"
+#include "GpuMemory.h"
+#include "UploadManager.h"
 
 Mesh::Mesh() = default;
 
 Mesh::~Mesh() { ClearMesh(); };
 
-void Mesh::CreateMesh(const std::vector<Shape>& _vertices, const std::vector<GLuint> & _indices) {
+void Mesh::CreateMesh(const std::vector<Shape>& _vertices, const std::vector<GLuint> & _indices, const StagingRegion* _staged) {
     indexCount = _indices.size();
 
+    boundsMin = _vertices.empty() ? glm::vec3(0.0f) : _vertices[0].position;
+    boundsMax = boundsMin;
+
+    for ( const auto& vertex : _vertices ) {
+        boundsMin = glm::min(boundsMin, vertex.position);
+        boundsMax = glm::max(boundsMax, vertex.position);
+    }
+
     // glGenVertexArrays returns n vertex array object names in arrays. There is no guarantee that the names form a contiguous set of integers; however,
     // it is guaranteed that none of the returned names was in use immediately before the call to glGenVertexArrays.
     glGenVertexArrays(1, &VAO);
 
     // glBindVertexArray binds the vertex array object with name array. array is the name of a vertex array object previously returned from a call to glGenVertexArrays,
     // or zero to break the existing vertex array object binding.
-    glBindVertexArray(VAO);
+    GLState::Get().BindVertexArray(VAO);
 
     // glGenBuffers returns n buffer object names in buffers. There is no guarantee that the names form a contiguous set of integers; however,
     // it is guaranteed that none of the returned names was in use immediately before the call to glGenBuffers.
@@ -22,19 +36,21 @@ void Mesh::CreateMesh(const std::vector<Shape>& _vertices, const std::vector<GLu
     // glBindBuffer binds a buffer object to the specified buffer binding point. Calling glBindBuffer with target set to one of
     // the accepted symbolic constants and buffer set to the name of a buffer object binds that buffer object name to the target.
     // GL_ELEMENT_ARRAY_BUFFER - Vertex array indices
-    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, IBO);
+    GLState::Get().BindBuffer(GL_ELEMENT_ARRAY_BUFFER, IBO);
 
     // glBufferData and glNamedBufferData create a new data store for a buffer object. In case of glBufferData, the buffer object currently bound to target is used.
     // For glNamedBufferData, a buffer object associated with ID specified by the caller in buffer will be used instead.
     // GL_STATIC_DRAW - The data store contents will be modified once and used many times as the source for GL drawing commands.
-    glBufferData(GL_ELEMENT_ARRAY_BUFFER, sizeof(_indices[0]) * _indices.size(), &_indices[0], GL_STATIC_DRAW);
+    FillBuffer(GL_ELEMENT_ARRAY_BUFFER, IBO, _indices.data(), sizeof(_indices[0]) * _indices.size(), _staged, sizeof(_vertices[0]) * _vertices.size());
+    GpuMemory::Get().TrackBuffer(IBO, sizeof(_indices[0]) * _indices.size(), GpuMemoryCategory::Geometry, "Mesh");
 
     glGenBuffers(1, &VBO);
 
     // GL_ARRAY_BUFFER - Vertex attributes
-    glBindBuffer(GL_ARRAY_BUFFER, VBO);
+    GLState::Get().BindBuffer(GL_ARRAY_BUFFER, VBO);
 
-    glBufferData(GL_ARRAY_BUFFER, sizeof(_vertices[0]) * _vertices.size(), &_vertices[0], GL_STATIC_DRAW);
+    FillBuffer(GL_ARRAY_BUFFER, VBO, _vertices.data(), sizeof(_vertices[0]) * _vertices.size(), _staged, 0);
+    GpuMemory::Get().TrackBuffer(VBO, sizeof(_vertices[0]) * _vertices.size(), GpuMemoryCategory::Geometry, "Mesh");
 
     // glVertexAttribPointer — define an array of generic vertex attribute data
     glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, sizeof(_vertices[0]), nullptr);
@@ -47,42 +63,110 @@ void Mesh::CreateMesh(const std::vector<Shape>& _vertices, const std::vector<GLu
     glVertexAttribPointer(2, 3, GL_FLOAT, GL_FALSE, sizeof(_vertices[0]), (void*)( (sizeof(_vertices[0].position)) + (sizeof(_vertices[0].texCoord)) ));
     glEnableVertexAttribArray(2);
 
+    // The element buffer stays bound, it's part of the VAO and unbinding it here would detach it
+    GLState::Get().BindBuffer(GL_ARRAY_BUFFER, 0);
+
+    GLState::Get().BindVertexArray(0);
+}
+
+void Mesh::CreateMesh(const std::vector<Shape>& _vertices, const std::vector<GLuint>& _indices, const std::vector<GLfloat>& _layers,
+        const StagingRegion* _staged) {
+    CreateMesh(_vertices, _indices, _staged);
 
-    glBindBuffer(GL_ARRAY_BUFFER, 0);
-    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, 0);
+    GLState::Get().BindVertexArray(VAO);
 
-    glBindVertexArray(0);
+    glGenBuffers(1, &LBO);
+    GLState::Get().BindBuffer(GL_ARRAY_BUFFER, LBO);
+    // The layers are only final on the GL thread, so they never come pre-staged
+    FillBuffer(GL_ARRAY_BUFFER, LBO, _layers.data(), sizeof(_layers[0]) * _layers.size(), nullptr, 0);
+    GpuMemory::Get().TrackBuffer(LBO, sizeof(_layers[0]) * _layers.size(), GpuMemoryCategory::Geometry, "Mesh");
+
+    glVertexAttribPointer(3, 1, GL_FLOAT, GL_FALSE, sizeof(_layers[0]), nullptr);
+    glEnableVertexAttribArray(3);
+
+    GLState::Get().BindBuffer(GL_ARRAY_BUFFER, 0);
+    GLState::Get().BindVertexArray(0);
 }
 
 void Mesh::RenderMesh() const {
-    glBindVertexArray(VAO);
-    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, IBO);
+    // Still waiting in the upload queue, drawing now would read uninitialised buffers
+    if ( !UploadManager::Get().IsDone(uploadTicket) ) return;
+
+    // The VAO brings its index buffer along and stays bound afterwards, consecutive draws of one mesh bind nothing
+    GLState::Get().BindVertexArray(VAO);
 
     // glDrawElements specifies multiple geometric primitives with very few subroutine calls. Instead of calling a GL function to pass each individual vertex,
     // normal, texture coordinate, edge flag, or color, you can prespecify separate arrays of vertices, normals, and so on, and use them to construct a sequence
     // of primitives with a single call to glDrawElements.
     // GL_TRIANGLES - Treats each triplet of vertices as an independent triangle. Vertices 3n - 2 , 3n - 1 , and 3n define triangle n. N / 3 triangles are drawn.
     glDrawElements(GL_TRIANGLES, indexCount, GL_UNSIGNED_INT, nullptr);
-
-    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, 0);
-    glBindVertexArray(0);
 }
 
 void Mesh::ClearMesh() {
+    // A queued copy must not land in a deleted buffer, or in a new one that got the same name
+    UploadManager::Get().Flush(uploadTicket);
+    uploadTicket = 0;
+
     if ( IBO != 0 ) {
-        glDeleteBuffers(1, &IBO);
+        GpuMemory::Get().ReleaseBuffer(IBO);
+        GLState::Get().DeleteBuffers(1, &IBO);
         IBO = 0;
     }
 
     if ( VBO != 0 ) {
-        glDeleteBuffers(1, &VBO);
+        GpuMemory::Get().ReleaseBuffer(VBO);
+        GLState::Get().DeleteBuffers(1, &VBO);
         VBO = 0;
     }
 
+    if ( LBO != 0 ) {
+        GpuMemory::Get().ReleaseBuffer(LBO);
+        GLState::Get().DeleteBuffers(1, &LBO);
+        LBO = 0;
+    }
+
     if ( VAO != 0 ) {
-        glDeleteBuffers(1, &VAO);
+        // glDeleteVertexArrays — a VAO is not a buffer, glDeleteBuffers silently ignored it and leaked the name
+        GLState::Get().DeleteVertexArrays(1, &VAO);
         VAO = 0;
     }
 
     indexCount = 0;
+}
+
+const glm::vec3& Mesh::GetBoundsMin() const { return boundsMin; }
+
+const glm::vec3& Mesh::GetBoundsMax() const { return boundsMax; }
+
+StagingRegion Mesh::Stage(const std::vector<Shape>& _vertices, const std::vector<GLuint>& _indices) {
+    // The layout CreateMesh expects from a staged mesh: the vertices, followed by the indices
+    size_t vertexBytes = sizeof(_vertices[0]) * _vertices.size();
+    size_t indexBytes = sizeof(_indices[0]) * _indices.size();
+
+    StagingRegion region = UploadManager::Get().Allocate(vertexBytes + indexBytes);
+
+    if ( region.IsValid() ) {
+        std::memcpy(region.GetData(), _vertices.data(), vertexBytes);
+        std::memcpy(region.GetData() + vertexBytes, _indices.data(), indexBytes);
+    }
+
+    return region;
+}
+
+void Mesh::FillBuffer(GLenum _target, GLuint _buffer, const void* _data, size_t _bytes, const StagingRegion* _staged, size_t _stagedOffset) {
+    StagingRegion region;
+
+    if ( !_staged || !_staged->IsValid() ) {
+        region = UploadManager::Get().Stage(_data, _bytes);
+        _staged = &region;
+        _stagedOffset = 0;
+    }
+
+    if ( _staged->IsValid() ) {
+        // Storage only, the contents follow with the upload queue
+        glBufferData(_target, _bytes, nullptr, GL_STATIC_DRAW);
+        uploadTicket = std::max(uploadTicket, UploadManager::Get().CopyToBuffer(*_staged, _stagedOffset, _bytes, _buffer, 0));
+    } else {
+        glBufferData(_target, _bytes, _data, GL_STATIC_DRAW);
+    }
 }
\ No newline at end of file
@@ -2,11 +2,14 @@
 #define MESH_H
 
 #include <vector>
+#include <cstdint>
 
 #include <GL/glew.h>
 
 #include "glm/glm.hpp"
 
+class StagingRegion;
+
 struct Shape {
     glm::vec3 position;
     glm::vec2 texCoord;
@@ -20,13 +23,23 @@ class Mesh {
     public:
         Mesh();
         ~Mesh();
-        void CreateMesh(const std::vector<Shape>& _vertices, const std::vector<GLuint> & _indices);
+        void CreateMesh(const std::vector<Shape>& _vertices, const std::vector<GLuint> & _indices, const StagingRegion* _staged = nullptr);
+        void CreateMesh(const std::vector<Shape>& _vertices, const std::vector<GLuint>& _indices, const std::vector<GLfloat>& _layers,
+                const StagingRegion* _staged = nullptr);
         void RenderMesh() const;
         void ClearMesh();
+        const glm::vec3& GetBoundsMin() const;
+        const glm::vec3& GetBoundsMax() const;
+        static StagingRegion Stage(const std::vector<Shape>& _vertices, const std::vector<GLuint>& _indices);
 
     private:
         GLuint VAO{}, VBO{}, IBO{};
+        GLuint LBO{};       // per-vertex texture array layer, only for meshes merged from several materials
         GLsizei indexCount{};
+        glm::vec3 boundsMin{}, boundsMax{};     // object space, for culling
+        uint64_t uploadTicket{};                // last copy into the buffers, the mesh draws once it's issued
+
+        void FillBuffer(GLenum _target, GLuint _buffer, const void* _data, size_t _bytes, const StagingRegion* _staged, size_t _stagedOffset);
 };
 
 #endif
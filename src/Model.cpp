@@ -1,29 +1,127 @@
 #include <iostream>
+#include <algorithm>
+#include <cstring>
+
+#include <assimp/IOStream.hpp>
+#include <assimp/IOSystem.hpp>
 
 #include "Model.h"
 #include "Mesh.h"
 #include "Texture.h"
+#include "TextureStreamer.h"
+#include "TextureArrays.h"
+#include "ModelLoader.h"
+#include "NormalGenerator.h"
+#include "ThreadPool.h"
+#include "FileSystem.h"
+
+namespace {
+    const char* const PLAIN_TEXTURE = "Textures/plain.png";
+
+    // A whole file read through the file system, the importer only ever reads its input
+    class FileStream : public Assimp::IOStream {
+        public:
+            explicit FileStream(FileData&& _file) : file(std::move(_file)), position(0) {  }
+
+            size_t Read(void* _buffer, size_t _size, size_t _count) override {
+                if ( !_size ) return 0;
+
+                size_t count = std::min(_count, ( file.size - position ) / _size);
+                std::memcpy(_buffer, file.data + position, count * _size);
+                position += count * _size;
+
+                return count;
+            }
+
+            size_t Write(const void*, size_t, size_t) override { return 0; }
+
+            aiReturn Seek(size_t _offset, aiOrigin _origin) override {
+                size_t base = _origin == aiOrigin_SET ? 0 : _origin == aiOrigin_CUR ? position : file.size;
+
+                if ( base + _offset > file.size ) return aiReturn_FAILURE;
+
+                position = base + _offset;
+
+                return aiReturn_SUCCESS;
+            }
+
+            size_t Tell() const override { return position; }
+
+            size_t FileSize() const override { return file.size; }
+
+            void Flush() override {  }
+
+        private:
+            FileData file;
+            size_t position;
+    };
+
+    // Lets the importer find the model and what it references, an OBJ's material library, in a mounted pack
+    class FileSystemIO : public Assimp::IOSystem {
+        public:
+            bool Exists(const char* _path) const override { return FileSystem::Get().Exists(_path); }
+
+            char getOsSeparator() const override { return '/'; }
+
+            Assimp::IOStream* Open(const char* _path, const char* _mode) override {
+                FileData file;
+
+                if ( std::strchr(_mode, 'w') || std::strchr(_mode, 'a') || !FileSystem::Get().ReadFile(_path, file) ) return nullptr;
+
+                return new FileStream(std::move(file));
+            }
+
+            void Close(Assimp::IOStream* _stream) override { delete _stream; }
+    };
+}
 
 Model::Model() = default;
 
 Model::~Model() { ClearModel(); }
 
-void Model::LoadModel(const std::string &_fileName) {
-    Assimp::Importer importer;
-    const aiScene* scene = importer.ReadFile(_fileName, aiProcess_Triangulate | aiProcess_FlipUVs | aiProcess_GenSmoothNormals
-        | aiProcess_JoinIdenticalVertices );
+void Model::LoadModel(const std::string &_fileName, TextureStreamer* _streamer) {
+    ClearModel();
+
+    ModelData data;
+    std::string error;
+
+    if ( !Import(_fileName, false, keepTriangles, data, error) ) {
+        std::cerr << "Model \"" << _fileName << "\" failed to load: " << error << '\n';
+        return;
+    }
+
+    LoadTextures(data.texturePaths, _streamer);
+    triangles = std::move(data.triangles);
+
+    for ( const auto& mesh : data.meshes ) {
+        LoadMesh(mesh);
+    }
+}
+
+void Model::LoadModel(const std::string& _fileName, TextureArrays& _arrays) {
+    ClearModel();
 
-    if( !scene ) {
-        std::cerr << "Model \"" << _fileName << "\" failed to load: " << importer.GetErrorString() << '\n';
+    ModelData data;
+    std::string error;
+
+    if ( !Import(_fileName, true, keepTriangles, data, error) ) {
+        std::cerr << "Model \"" << _fileName << "\" failed to load: " << error << '\n';
+        return;
     }
 
-    LoadNode(scene->mRootNode, scene);
-    LoadMaterials(scene);
+    LoadTextures(data, _arrays);
+    triangles = std::move(data.triangles);
+
+    for ( const auto& mesh : data.meshes ) {
+        LoadMesh(mesh);
+    }
 }
 
 void Model::RenderModel() {
     for ( size_t i = 0; i < meshList.size(); i++ ) {
-        if ( meshToTex[i] < textureList.size() && textureList[meshToTex[i]] ) {
+        if ( textureArrays ) {
+            textureArrays->Bind(meshToTex[i]);
+        } else if ( meshToTex[i] < textureList.size() && textureList[meshToTex[i]] ) {
             textureList[meshToTex[i]]->UseTexture();
         }
 
@@ -31,7 +129,17 @@ void Model::RenderModel() {
     }
 }
 
+bool Model::UsesTextureArrays() const { return textureArrays != nullptr; }
+
+void Model::RequestTextures(TextureStreamer& _streamer, GLfloat _screenSize) const {
+    for ( auto texture : textureList ) {
+        if ( texture ) _streamer.Request(texture, _screenSize);
+    }
+}
+
 void Model::ClearModel() {
+    if ( loader ) loader->Cancel(*this);
+
     for (auto & mesh : meshList) {
         if (mesh) {
             delete mesh;
@@ -45,76 +153,291 @@ void Model::ClearModel() {
             texture = nullptr;
         }
     }
+
+    meshList.clear();
+    textureList.clear();
+    meshToTex.clear();
+    textureArrays = nullptr;
+    triangles.Clear();
+    boundsMin = boundsMax = glm::vec3(0.0f);
+}
+
+const glm::vec3& Model::GetBoundsMin() const { return boundsMin; }
+
+const glm::vec3& Model::GetBoundsMax() const { return boundsMax; }
+
+size_t Model::GetMeshCount() const { return meshList.size(); }
+
+// Takes effect with the next load, the GPU copy of the vertices can't be read back
+void Model::SetKeepTriangles(bool _keep) { keepTriangles = _keep; }
+
+// Object space, the hit's triangle counts through the imported sub-meshes in order
+bool Model::Raycast(const glm::vec3& _origin, const glm::vec3& _direction, GLfloat _maxDistance, RayHit& _hit) const {
+    return triangles.Raycast(_origin, _direction, _maxDistance, _hit);
+}
+
+bool Model::IsOccluded(const glm::vec3& _origin, const glm::vec3& _direction, GLfloat _maxDistance) const {
+    return triangles.Occluded(_origin, _direction, _maxDistance);
 }
 
-void Model::LoadNode(aiNode *_node, const aiScene *_scene) {
+const TriangleBVH& Model::GetTriangles() const { return triangles; }
+
+void Model::LoadNode(const aiNode *_node, const aiScene *_scene, std::vector<const aiMesh*>& _meshes) {
     for( size_t i = 0; i < _node->mNumMeshes; i++ ) {
-        LoadMesh(_scene->mMeshes[_node->mMeshes[i]], _scene);
+        _meshes.push_back(_scene->mMeshes[_node->mMeshes[i]]);
     }
 
     for( size_t i = 0; i < _node->mNumChildren; i++ ) {
-        LoadNode(_node->mChildren[i], _scene);
+        LoadNode(_node->mChildren[i], _scene, _meshes);
+    }
+}
+
+void Model::LoadMesh(const ModelData::SubMesh& _mesh) {
+    Mesh* mesh = new Mesh();
+
+    if ( _mesh.layers.empty() ) {
+        mesh->CreateMesh(_mesh.vertices, _mesh.indices, &_mesh.staging);
+    } else {
+        mesh->CreateMesh(_mesh.vertices, _mesh.indices, _mesh.layers, &_mesh.staging);
+    }
+
+    AddMesh(mesh, _mesh.material);
+}
+
+void Model::AddMesh(Mesh* _mesh, unsigned int _texture) {
+    meshList.push_back(_mesh);
+    meshToTex.push_back(_texture);
+
+    if ( meshList.size() == 1 ) {
+        boundsMin = _mesh->GetBoundsMin();
+        boundsMax = _mesh->GetBoundsMax();
+    } else {
+        boundsMin = glm::min(boundsMin, _mesh->GetBoundsMin());
+        boundsMax = glm::max(boundsMax, _mesh->GetBoundsMax());
+    }
+}
+
+bool Model::Import(const std::string& _fileName, bool _textureArrays, bool _keepTriangles, ModelData& _data, std::string& _error) {
+    Assimp::Importer importer;
+
+    // The importer owns the handler and deletes it with itself
+    importer.SetIOHandler(new FileSystemIO());
+    const aiScene* scene = importer.ReadFile(_fileName, aiProcess_Triangulate | aiProcess_FlipUVs | aiProcess_JoinIdenticalVertices );
+
+    if ( !scene || !scene->mRootNode ) {
+        _error = importer.GetErrorString();
+        return false;
     }
+
+    std::vector<const aiMesh*> meshes;
+    LoadNode(scene->mRootNode, scene, meshes);
+
+    _data.texturePaths.resize(scene->mNumMaterials);
+
+    for ( size_t i = 0; i < scene->mNumMaterials; i++ ) {
+        std::string& path = _data.texturePaths[i];
+        path = GetTexturePath(scene->mMaterials[i]);
+
+        // The arrays substitute white for a file that doesn't decode, per-mesh textures fall back to the plain one later
+        if ( _textureArrays && path.empty() ) {
+            path = PLAIN_TEXTURE;
+        } else if ( !_textureArrays && !path.empty() && !FileSystem::Get().Exists(path) ) {
+            std::cerr << "Failed to load texture at: " << path << '\n';
+            path.clear();
+        }
+    }
+
+    // Materials sharing a file point at its first occurrence, only that one is decoded
+    std::vector<size_t> firstOf(scene->mNumMaterials);
+    std::vector<size_t> unique;
+
+    for ( size_t i = 0; i < scene->mNumMaterials; i++ ) {
+        firstOf[i] = i;
+
+        for ( size_t j = 0; j < i; j++ ) {
+            if ( _data.texturePaths[j] == _data.texturePaths[i] ) {
+                firstOf[i] = j;
+                break;
+            }
+        }
+
+        if ( firstOf[i] == i ) unique.push_back(i);
+    }
+
+    if ( _textureArrays ) {
+        _data.textures.resize(scene->mNumMaterials);
+
+        ThreadPool::Get().ParallelFor(unique.size(), 1, [&](size_t, size_t _begin, size_t _end) {
+            for ( size_t i = _begin; i < _end; i++ ) {
+                TextureArrays::Decode(_data.texturePaths[unique[i]], _data.textures[unique[i]]);
+            }
+        });
+    }
+
+    std::vector<ModelData::SubMesh> converted(meshes.size());
+
+    ThreadPool::Get().ParallelFor(meshes.size(), 1, [&](size_t, size_t _begin, size_t _end) {
+        for ( size_t i = _begin; i < _end; i++ ) {
+            ConvertMesh(meshes[i], converted[i].vertices, converted[i].indices);
+            converted[i].material = meshes[i]->mMaterialIndex;
+        }
+    });
+
+    // Point clouds and lines triangulate to nothing
+    converted.erase(std::remove_if(converted.begin(), converted.end(), [](const ModelData::SubMesh& _mesh) { return _mesh.indices.empty(); }),
+            converted.end());
+
+    if ( _keepTriangles ) BuildTriangles(converted, _data.triangles);
+
+    if ( !_textureArrays ) {
+        _data.meshes = std::move(converted);
+        StageMeshes(_data);
+        return true;
+    }
+
+    // Sub-meshes whose textures share a size tier share an array and merge into one mesh, each vertex carries its
+    // material until the array slots are known
+    std::vector<GLuint> tiers;
+
+    for ( const auto& mesh : converted ) {
+        GLuint tier = _data.textures[firstOf[mesh.material]].width;
+        size_t batch = std::find(tiers.begin(), tiers.end(), tier) - tiers.begin();
+
+        if ( batch == tiers.size() ) {
+            tiers.push_back(tier);
+            _data.meshes.push_back({ {}, {}, {}, mesh.material, {} });
+        }
+
+        ModelData::SubMesh& target = _data.meshes[batch];
+        GLuint base = target.vertices.size();
+
+        for ( GLuint index : mesh.indices ) {
+            target.indices.push_back(base + index);
+        }
+
+        target.vertices.insert(target.vertices.end(), mesh.vertices.begin(), mesh.vertices.end());
+        target.layers.resize(target.vertices.size(), static_cast<GLfloat>(mesh.material));
+    }
+
+    StageMeshes(_data);
+
+    return true;
 }
 
-void Model::LoadMesh(aiMesh *_mesh, const aiScene *_scene) {
-    std::vector<Shape> vertices;
-    std::vector<unsigned int> indices;
+void Model::BuildTriangles(const std::vector<ModelData::SubMesh>& _meshes, TriangleBVH& _triangles) {
+    std::vector<glm::vec3> positions;
+    std::vector<GLuint> indices;
+
+    for ( const auto& mesh : _meshes ) {
+        GLuint base = positions.size();
+
+        for ( const Shape& vertex : mesh.vertices ) {
+            positions.push_back(vertex.position);
+        }
+
+        for ( GLuint index : mesh.indices ) {
+            indices.push_back(base + index);
+        }
+    }
+
+    _triangles.Build(positions, indices);
+}
 
+void Model::StageMeshes(ModelData& _data) {
+    // Still on the importing thread, the GL thread only queues the copies
+    for ( auto& mesh : _data.meshes ) {
+        mesh.staging = Mesh::Stage(mesh.vertices, mesh.indices);
+    }
+}
+
+void Model::ConvertMesh(const aiMesh *_mesh, std::vector<Shape> &_vertices, std::vector<unsigned int> &_indices) {
     for ( size_t i = 0; i < _mesh->mNumVertices; i++ ) {
-        vertices.insert(vertices.end(), {
+        _vertices.insert(_vertices.end(), {
                 _mesh->mVertices[i].x, _mesh->mVertices[i].y, _mesh->mVertices[i].z,
                 ( _mesh->mTextureCoords[0] ? _mesh->mTextureCoords[0][i].x : 0.0f ),
                 ( _mesh->mTextureCoords[0] ? _mesh->mTextureCoords[0][i].y : 0.0f ),
-                -_mesh->mNormals[i].x, -_mesh->mNormals[i].y, -_mesh->mNormals[i].z
+                ( _mesh->mNormals ? -_mesh->mNormals[i].x : 0.0f ),
+                ( _mesh->mNormals ? -_mesh->mNormals[i].y : 0.0f ),
+                ( _mesh->mNormals ? -_mesh->mNormals[i].z : 0.0f )
         } );
     }
 
     for ( size_t i = 0; i < _mesh->mNumFaces; i++ ) {
         for ( size_t j = 0; j < _mesh->mFaces[i].mNumIndices; j++ ) {
-            indices.push_back(_mesh->mFaces[i].mIndices[j]);
+            _indices.push_back(_mesh->mFaces[i].mIndices[j]);
         }
     }
 
-    Mesh* mesh = new Mesh();
-    mesh->CreateMesh(vertices, indices);
-    meshList.push_back(mesh);
-    meshToTex.push_back(_mesh->mMaterialIndex);
+    if ( !_mesh->mNormals ) {
+        NormalGenerator::Generate(_indices, _vertices, NormalWeighting::Angle);
+
+        // Imported normals are flipped above, keep generated ones consistent with them
+        for ( auto& vertex : _vertices ) vertex.normal = -vertex.normal;
+    }
 }
 
-void Model::LoadMaterials(const aiScene *_scene) {
-    textureList.resize(_scene->mNumMaterials);
+void Model::LoadTextures(const std::vector<std::string>& _texturePaths, TextureStreamer* _streamer) {
+    textureList.resize(_texturePaths.size());
 
-    for ( size_t i = 0; i < _scene->mNumMaterials; i++ ) {
+    for ( size_t i = 0; i < _texturePaths.size(); i++ ) {
         textureList[i] = nullptr;
 
-        if ( _scene->mMaterials[i]->GetTextureCount(aiTextureType_DIFFUSE) ) {
-            aiString path;
-
-            if ( _scene->mMaterials[i]->GetTexture(aiTextureType_DIFFUSE, 0, &path) == AI_SUCCESS ) {
-                int idx = std::string(path.data).rfind('\\');
-                std::string filename = std::string(path.data).substr(idx + 1);
-
-                // Solve problem for case sensitive in extension
-                std::string extension = filename.substr(filename.rfind('.') + 1);
-                transform(extension.begin(), extension.end(), extension.begin(), ::tolower);
-                filename.replace(filename.rfind('.') + 1, 3, extension);
+        if ( !_texturePaths[i].empty() ) {
+            textureList[i] = new Texture(_texturePaths[i]);
 
-                std::string texPath = std::string("Textures/") + filename;
+            // Streamed textures decode in the background, the import already dropped missing files
+            if ( _streamer ) {
+                textureList[i]->StreamTexture(*_streamer);
+            } else if ( !textureList[i]->LoadTexture() ) {
+                std::cerr << "Failed to load texture at: " << _texturePaths[i] << '\n';
+                delete textureList[i];
+                textureList[i] = nullptr;
+            }
+        }
 
-                textureList[i] = new Texture(texPath);
+        if ( !textureList[i] ) {
+            textureList[i] = new Texture(PLAIN_TEXTURE);
 
-                if ( !textureList[i]->LoadTexture() ) {
-                    std::cerr << "Failed to load texture at: " << texPath << '\n';
-                    delete textureList[i];
-                    textureList[i] = nullptr;
-                }
+            if ( _streamer ) {
+                textureList[i]->StreamTexture(*_streamer);
+            } else {
+                textureList[i]->LoadTextureA();
             }
         }
+    }
+}
 
-        if ( !textureList[i] ) {
-            textureList[i] = new Texture("Textures/plain.png");
-            textureList[i]->LoadTextureA();
+void Model::LoadTextures(ModelData& _data, TextureArrays& _arrays) {
+    std::vector<TextureSlot> slots = _arrays.Insert(_data.texturePaths, _data.textures);
+
+    // The images are on the GPU now
+    std::vector<MipChain>().swap(_data.textures);
+
+    for ( auto& mesh : _data.meshes ) {
+        for ( auto& layer : mesh.layers ) {
+            layer = static_cast<GLfloat>(slots[static_cast<size_t>(layer)].layer);
         }
+
+        mesh.material = slots[mesh.material].array;
     }
+
+    textureArrays = &_arrays;
+}
+
+std::string Model::GetTexturePath(const aiMaterial* _material) {
+    aiString path;
+
+    if ( !_material->GetTextureCount(aiTextureType_DIFFUSE) || _material->GetTexture(aiTextureType_DIFFUSE, 0, &path) != AI_SUCCESS ) {
+        return "";
+    }
+
+    int idx = std::string(path.data).rfind('\\');
+    std::string filename = std::string(path.data).substr(idx + 1);
+
+    // Solve problem for case sensitive in extension
+    std::string extension = filename.substr(filename.rfind('.') + 1);
+    transform(extension.begin(), extension.end(), extension.begin(), ::tolower);
+    filename.replace(filename.rfind('.') + 1, 3, extension);
+
+    return FileSystem::JoinPath("Textures", filename);
 }
\ No newline at end of file
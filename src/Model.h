@@ -8,25 +8,70 @@
 #include <assimp/scene.h>
 #include <assimp/postprocess.h>
 
-class Mesh;
+#include "Mesh.h"
+#include "TextureStreamer.h"
+#include "TriangleBVH.h"
+
 class Texture;
+class TextureArrays;
+class ModelLoader;
+
+// Everything an import produces before anything touches GL, so it can be built on any thread
+struct ModelData {
+    struct SubMesh {
+        std::vector<Shape> vertices;
+        std::vector<GLuint> indices;
+        std::vector<GLfloat> layers;    // texture arrays only, the material of each vertex until the slots are known
+        unsigned int material;
+        StagingRegion staging;          // vertices and indices, written by the import when the arena has room
+    };
+
+    std::vector<SubMesh> meshes;
+    std::vector<std::string> texturePaths;  // per material, empty without a usable diffuse texture
+    std::vector<MipChain> textures;         // per material, decoded for texture arrays only
+    TriangleBVH triangles;                  // every sub-mesh in import order, only when the model keeps its triangles
+};
 
 class Model {
     public:
         Model();
         ~Model();
-        void LoadModel(const std::string& _fileName);
+        void LoadModel(const std::string& _fileName, TextureStreamer* _streamer = nullptr);
+        void LoadModel(const std::string& _fileName, TextureArrays& _arrays);
         void RenderModel();
+        bool UsesTextureArrays() const;
+        void RequestTextures(TextureStreamer& _streamer, GLfloat _screenSize) const;
         void ClearModel();
+        const glm::vec3& GetBoundsMin() const;
+        const glm::vec3& GetBoundsMax() const;
+        size_t GetMeshCount() const;
+        void SetKeepTriangles(bool _keep);
+        bool Raycast(const glm::vec3& _origin, const glm::vec3& _direction, GLfloat _maxDistance, RayHit& _hit) const;
+        bool IsOccluded(const glm::vec3& _origin, const glm::vec3& _direction, GLfloat _maxDistance) const;
+        const TriangleBVH& GetTriangles() const;
+        static bool Import(const std::string& _fileName, bool _textureArrays, bool _keepTriangles, ModelData& _data, std::string& _error);
+        static void ConvertMesh(const aiMesh* _mesh, std::vector<Shape>& _vertices, std::vector<unsigned int>& _indices);
 
     private:
+        friend class ModelLoader;
+
         std::vector<Mesh*> meshList;
         std::vector<Texture*> textureList;
-        std::vector<unsigned int> meshToTex;
+        std::vector<unsigned int> meshToTex;        // texture list index, or the array index with texture arrays
+        TextureArrays* textureArrays{};
+        glm::vec3 boundsMin{}, boundsMax{};     // union of the mesh bounds, object space
+        ModelLoader* loader{};                  // while a load into this model is in flight
+        TriangleBVH triangles;                  // object space, for ray queries once the GPU has the vertices
+        bool keepTriangles{};
 
-        void LoadNode(aiNode* _node, const aiScene* _scene);
-        void LoadMesh(aiMesh* _mesh, const aiScene* _scene);
-        void LoadMaterials(const aiScene* _scene);
+        void LoadTextures(const std::vector<std::string>& _texturePaths, TextureStreamer* _streamer);
+        void LoadTextures(ModelData& _data, TextureArrays& _arrays);
+        void LoadMesh(const ModelData::SubMesh& _mesh);
+        void AddMesh(Mesh* _mesh, unsigned int _texture);
+        static void StageMeshes(ModelData& _data);
+        static void BuildTriangles(const std::vector<ModelData::SubMesh>& _meshes, TriangleBVH& _triangles);
+        static void LoadNode(const aiNode* _node, const aiScene* _scene, std::vector<const aiMesh*>& _meshes);
+        static std::string GetTexturePath(const aiMaterial* _material);
 };
 
 #endif
\ No newline at end of file
@@ -0,0 +1,145 @@
+#include <iostream>
+#include <atomic>
+#include <chrono>
+
+#include "ModelLoader.h"
+#include "Model.h"
+#include "ThreadPool.h"
+
+// Shared with the worker importing it, so cancelling a load mid-import only drops the result
+struct ModelLoader::Import {
+    std::string fileName;
+    bool textureArrays;
+    bool keepTriangles;
+    ModelData data;
+    std::string error;
+    bool ok;
+    std::atomic<bool> done;
+
+    Import(std::string _fileName, bool _textureArrays, bool _keepTriangles) : fileName(std::move(_fileName)), textureArrays(_textureArrays),
+            keepTriangles(_keepTriangles), data(), error(), ok(false), done(false) {  }
+};
+
+ModelLoader::ModelLoader(double _budgetMilliseconds) : budget(_budgetMilliseconds) {  }
+
+ModelLoader::~ModelLoader() {
+    // Models outliving the loader keep the sub-meshes they already have
+    for ( auto& job : jobs ) {
+        job.model->loader = nullptr;
+    }
+}
+
+ModelLoadHandle ModelLoader::Load(Model& _model, const std::string& _fileName, TextureArrays& _arrays) {
+    return Submit(_model, _fileName, &_arrays, nullptr);
+}
+
+ModelLoadHandle ModelLoader::Load(Model& _model, const std::string& _fileName, TextureStreamer& _streamer) {
+    return Submit(_model, _fileName, nullptr, &_streamer);
+}
+
+ModelLoadHandle ModelLoader::Submit(Model& _model, const std::string& _fileName, TextureArrays* _arrays, TextureStreamer* _streamer) {
+    // Loading into a model replaces what it had, a load still in flight included
+    _model.ClearModel();
+    _model.loader = this;
+
+    auto status = std::make_shared<ModelLoad>(ModelLoad{ _fileName, ModelLoadState::Loading, "", 0, 0 });
+    auto import = std::make_shared<Import>(_fileName, _arrays != nullptr, _model.keepTriangles);
+
+    jobs.push_back({ &_model, _arrays, _streamer, status, import, false });
+
+    ThreadPool::Get().Submit([import]() {
+        import->ok = Model::Import(import->fileName, import->textureArrays, import->keepTriangles, import->data, import->error);
+        import->done.store(true, std::memory_order_release);
+    });
+
+    return status;
+}
+
+void ModelLoader::Update() {
+    using Clock = std::chrono::steady_clock;
+
+    Clock::time_point start = Clock::now();
+    bool stepped = false;
+
+    // Oldest load first. Each step is a single upload, so only the last one of a frame can run over the budget, and
+    // at least one is taken every frame however small the budget.
+    for ( size_t i = 0; i < jobs.size(); ) {
+        Job& job = jobs[i];
+
+        if ( !job.import->done.load(std::memory_order_acquire) ) {
+            i++;
+            continue;
+        }
+
+        if ( !job.import->ok ) {
+            std::cerr << "Model \"" << job.status->fileName << "\" failed to load: " << job.import->error << '\n';
+            Finish(i, ModelLoadState::Failed, job.import->error);
+            continue;
+        }
+
+        job.status->meshCount = job.import->data.meshes.size();
+
+        bool remaining = true;
+
+        while ( remaining ) {
+            if ( stepped && std::chrono::duration<double, std::milli>(Clock::now() - start).count() >= budget ) return;
+
+            remaining = Step(job);
+            stepped = true;
+        }
+
+        Finish(i, ModelLoadState::Ready, "");
+    }
+}
+
+void ModelLoader::Cancel(Model& _model) {
+    for ( size_t i = 0; i < jobs.size(); i++ ) {
+        if ( jobs[i].model == &_model ) {
+            Finish(i, ModelLoadState::Failed, "Cancelled");
+            return;
+        }
+    }
+}
+
+void ModelLoader::SetBudget(double _budgetMilliseconds) { budget = _budgetMilliseconds; }
+
+double ModelLoader::GetBudget() const { return budget; }
+
+size_t ModelLoader::GetPendingCount() const { return jobs.size(); }
+
+bool ModelLoader::Step(Job& _job) {
+    ModelData& data = _job.import->data;
+
+    // The textures go first so every sub-mesh has its texture from its first frame on
+    if ( !_job.texturesLoaded ) {
+        if ( _job.arrays ) {
+            _job.model->LoadTextures(data, *_job.arrays);
+        } else {
+            _job.model->LoadTextures(data.texturePaths, _job.streamer);
+        }
+
+        _job.model->triangles = std::move(data.triangles);
+
+        _job.texturesLoaded = true;
+    } else {
+        ModelData::SubMesh& mesh = data.meshes[_job.status->uploadedMeshes];
+
+        _job.model->LoadMesh(mesh);
+        _job.status->uploadedMeshes++;
+
+        // The vertices live on the GPU now
+        mesh = ModelData::SubMesh();
+    }
+
+    return _job.status->uploadedMeshes < data.meshes.size();
+}
+
+void ModelLoader::Finish(size_t _job, ModelLoadState _state, const std::string& _error) {
+    Job& job = jobs[_job];
+
+    job.status->state = _state;
+    job.status->error = _error;
+    job.model->loader = nullptr;
+
+    jobs.erase(jobs.begin() + _job);
+}
\ No newline at end of file
@@ -0,0 +1,65 @@
+#ifndef MODEL_LOADER_H
+#define MODEL_LOADER_H
+
+#include <vector>
+#include <string>
+#include <memory>
+
+class Model;
+class TextureArrays;
+class TextureStreamer;
+
+enum class ModelLoadState {
+    Loading,
+    Ready,
+    Failed
+};
+
+// What the caller gets back from ModelLoader::Load, updated by ModelLoader::Update on the GL thread
+struct ModelLoad {
+    std::string fileName;
+    ModelLoadState state;
+    std::string error;
+    size_t meshCount;       // known once the import is done
+    size_t uploadedMeshes;
+};
+
+using ModelLoadHandle = std::shared_ptr<const ModelLoad>;
+
+// Loads models without blocking the frame. The import, the mesh conversion and the texture decodes run on the thread
+// pool, Update then creates the GL objects a step at a time until the frame's budget is spent. Sub-meshes are
+// drawn by RenderModel from the frame they're uploaded in, so a model fills in over a few frames. Clearing or
+// destroying a model cancels its load.
+class ModelLoader {
+    public:
+        explicit ModelLoader(double _budgetMilliseconds);
+        ~ModelLoader();
+        ModelLoadHandle Load(Model& _model, const std::string& _fileName, TextureArrays& _arrays);
+        ModelLoadHandle Load(Model& _model, const std::string& _fileName, TextureStreamer& _streamer);
+        void Update();
+        void Cancel(Model& _model);
+        void SetBudget(double _budgetMilliseconds);
+        double GetBudget() const;
+        size_t GetPendingCount() const;
+
+    private:
+        struct Import;
+
+        struct Job {
+            Model* model;
+            TextureArrays* arrays;
+            TextureStreamer* streamer;
+            std::shared_ptr<ModelLoad> status;
+            std::shared_ptr<Import> import;
+            bool texturesLoaded;
+        };
+
+        std::vector<Job> jobs;
+        double budget;
+
+        ModelLoadHandle Submit(Model& _model, const std::string& _fileName, TextureArrays* _arrays, TextureStreamer* _streamer);
+        bool Step(Job& _job);
+        void Finish(size_t _job, ModelLoadState _state, const std::string& _error);
+};
+
+#endif
\ No newline at end of file
@@ -0,0 +1,185 @@
+#include <cmath>
+#include <algorithm>
+
+#if defined(__SSE2__) || defined(_M_X64) || defined(_M_AMD64)
+#define NORMAL_GENERATOR_SSE 1
+#include <emmintrin.h>
+#endif
+
+#include "NormalGenerator.h"
+#include "ThreadPool.h"
+
+namespace {
+    // Below these sizes the cost of waking workers is bigger than the work itself
+    const size_t MIN_TRIANGLES_PER_RANGE = 16384;
+    const size_t MIN_VERTICES_PER_RANGE = 32768;
+
+    const float MIN_LENGTH = 1e-20f;
+
+    float CornerAngle(float _cos) { return std::acos(std::min(std::max(_cos, -1.0f), 1.0f)); }
+
+#ifdef NORMAL_GENERATOR_SSE
+    inline __m128 Dot(__m128 _ax, __m128 _ay, __m128 _az, __m128 _bx, __m128 _by, __m128 _bz) {
+        return _mm_add_ps(_mm_add_ps(_mm_mul_ps(_ax, _bx), _mm_mul_ps(_ay, _by)), _mm_mul_ps(_az, _bz));
+    }
+
+    inline __m128 Length(__m128 _x, __m128 _y, __m128 _z) {
+        return _mm_max_ps(_mm_sqrt_ps(Dot(_x, _y, _z, _x, _y, _z)), _mm_set1_ps(MIN_LENGTH));
+    }
+
+    inline __m128 Gather(const std::vector<float>& _values, const GLuint* _indices, size_t _corner) {
+        return _mm_setr_ps(_values[_indices[_corner]], _values[_indices[3 + _corner]],
+                           _values[_indices[6 + _corner]], _values[_indices[9 + _corner]]);
+    }
+#endif
+}
+
+void NormalGenerator::Generate(const std::vector<GLuint>& _indices, std::vector<Shape>& _vertices, NormalWeighting _weighting) {
+    ThreadPool& pool = ThreadPool::Get();
+
+    size_t vertexCount = _vertices.size();
+    size_t triangleCount = _indices.size() / 3;
+
+    // Gather positions into SoA so four triangles can be crossed at once
+    Positions positions;
+    positions.x.resize(vertexCount);
+    positions.y.resize(vertexCount);
+    positions.z.resize(vertexCount);
+
+    pool.ParallelFor(vertexCount, MIN_VERTICES_PER_RANGE, [&](size_t, size_t _begin, size_t _end) {
+        for ( size_t i = _begin; i < _end; i++ ) {
+            positions.x[i] = _vertices[i].position.x;
+            positions.y[i] = _vertices[i].position.y;
+            positions.z[i] = _vertices[i].position.z;
+        }
+    });
+
+    // Each triangle range scatters into its own buffer, so ranges never contend over shared vertices
+    std::vector<Accumulator> accumulators(pool.RangeCount(triangleCount, MIN_TRIANGLES_PER_RANGE));
+
+    pool.ParallelFor(triangleCount, MIN_TRIANGLES_PER_RANGE, [&](size_t _range, size_t _begin, size_t _end) {
+        Accumulator& accumulator = accumulators[_range];
+        accumulator.x.assign(vertexCount, 0.0f);
+        accumulator.y.assign(vertexCount, 0.0f);
+        accumulator.z.assign(vertexCount, 0.0f);
+
+        AccumulateFaces(_indices.data(), _begin, _end, positions, _weighting, accumulator);
+    });
+
+    // Reduce the per-range buffers and normalize
+    pool.ParallelFor(vertexCount, MIN_VERTICES_PER_RANGE, [&](size_t, size_t _begin, size_t _end) {
+        for ( size_t i = _begin; i < _end; i++ ) {
+            glm::vec3 normal(0.0f, 0.0f, 0.0f);
+
+            for ( const auto& accumulator : accumulators ) {
+                normal.x += accumulator.x[i];
+                normal.y += accumulator.y[i];
+                normal.z += accumulator.z[i];
+            }
+
+            float length = glm::length(normal);
+            _vertices[i].normal = length > MIN_LENGTH ? normal / length : glm::vec3(0.0f, 0.0f, 0.0f);
+        }
+    });
+}
+
+void NormalGenerator::AccumulateFaces(const GLuint* _indices, size_t _begin, size_t _end, const Positions& _positions,
+        NormalWeighting _weighting, Accumulator& _accumulator) {
+    size_t triangle = _begin;
+
+#ifdef NORMAL_GENERATOR_SSE
+    for ( ; triangle + 4 <= _end; triangle += 4 ) {
+        const GLuint* indices = _indices + triangle * 3;
+
+        __m128 p0x = Gather(_positions.x, indices, 0), p0y = Gather(_positions.y, indices, 0), p0z = Gather(_positions.z, indices, 0);
+        __m128 p1x = Gather(_positions.x, indices, 1), p1y = Gather(_positions.y, indices, 1), p1z = Gather(_positions.z, indices, 1);
+        __m128 p2x = Gather(_positions.x, indices, 2), p2y = Gather(_positions.y, indices, 2), p2z = Gather(_positions.z, indices, 2);
+
+        __m128 e1x = _mm_sub_ps(p1x, p0x), e1y = _mm_sub_ps(p1y, p0y), e1z = _mm_sub_ps(p1z, p0z);
+        __m128 e2x = _mm_sub_ps(p2x, p0x), e2y = _mm_sub_ps(p2y, p0y), e2z = _mm_sub_ps(p2z, p0z);
+
+        // The length of the cross product is twice the triangle area, which is exactly the area weight
+        __m128 nx = _mm_sub_ps(_mm_mul_ps(e1y, e2z), _mm_mul_ps(e1z, e2y));
+        __m128 ny = _mm_sub_ps(_mm_mul_ps(e1z, e2x), _mm_mul_ps(e1x, e2z));
+        __m128 nz = _mm_sub_ps(_mm_mul_ps(e1x, e2y), _mm_mul_ps(e1y, e2x));
+
+        if ( _weighting != NormalWeighting::Area ) {
+            __m128 inverseLength = _mm_div_ps(_mm_set1_ps(1.0f), Length(nx, ny, nz));
+            nx = _mm_mul_ps(nx, inverseLength);
+            ny = _mm_mul_ps(ny, inverseLength);
+            nz = _mm_mul_ps(nz, inverseLength);
+        }
+
+        alignas(16) float normalX[4], normalY[4], normalZ[4];
+        alignas(16) float weights[3][4] = {
+                { 1.0f, 1.0f, 1.0f, 1.0f }, { 1.0f, 1.0f, 1.0f, 1.0f }, { 1.0f, 1.0f, 1.0f, 1.0f }
+        };
+
+        _mm_store_ps(normalX, nx);
+        _mm_store_ps(normalY, ny);
+        _mm_store_ps(normalZ, nz);
+
+        if ( _weighting == NormalWeighting::Angle ) {
+            // Corner edges: v0 sees e1 and e2, v1 sees (e2 - e1) and -e1, v2 sees -e2 and (e1 - e2)
+            __m128 e3x = _mm_sub_ps(e2x, e1x), e3y = _mm_sub_ps(e2y, e1y), e3z = _mm_sub_ps(e2z, e1z);
+            __m128 length1 = Length(e1x, e1y, e1z), length2 = Length(e2x, e2y, e2z), length3 = Length(e3x, e3y, e3z);
+
+            __m128 cos0 = _mm_div_ps(Dot(e1x, e1y, e1z, e2x, e2y, e2z), _mm_mul_ps(length1, length2));
+            __m128 cos1 = _mm_div_ps(Dot(e3x, e3y, e3z, e1x, e1y, e1z), _mm_mul_ps(length3, length1));
+            __m128 cos2 = _mm_div_ps(Dot(e2x, e2y, e2z, e3x, e3y, e3z), _mm_mul_ps(length2, length3));
+
+            _mm_store_ps(weights[0], cos0);
+            _mm_store_ps(weights[1], _mm_sub_ps(_mm_setzero_ps(), cos1));
+            _mm_store_ps(weights[2], cos2);
+
+            for ( auto& corner : weights ) {
+                for ( float& weight : corner ) weight = CornerAngle(weight);
+            }
+        }
+
+        for ( size_t lane = 0; lane < 4; lane++ ) {
+            for ( size_t corner = 0; corner < 3; corner++ ) {
+                GLuint index = indices[lane * 3 + corner];
+                _accumulator.x[index] += normalX[lane] * weights[corner][lane];
+                _accumulator.y[index] += normalY[lane] * weights[corner][lane];
+                _accumulator.z[index] += normalZ[lane] * weights[corner][lane];
+            }
+        }
+    }
+#endif
+
+    for ( ; triangle < _end; triangle++ ) {
+        AccumulateFace(_indices + triangle * 3, _positions, _weighting, _accumulator);
+    }
+}
+
+void NormalGenerator::AccumulateFace(const GLuint* _triangle, const Positions& _positions, NormalWeighting _weighting,
+        Accumulator& _accumulator) {
+    glm::vec3 p[3];
+
+    for ( size_t corner = 0; corner < 3; corner++ ) {
+        p[corner] = glm::vec3(_positions.x[_triangle[corner]], _positions.y[_triangle[corner]], _positions.z[_triangle[corner]]);
+    }
+
+    glm::vec3 e1 = p[1] - p[0], e2 = p[2] - p[0];
+    glm::vec3 normal = glm::cross(e1, e2);
+
+    if ( _weighting != NormalWeighting::Area ) {
+        normal /= std::max(glm::length(normal), MIN_LENGTH);
+    }
+
+    float weights[3] = { 1.0f, 1.0f, 1.0f };
+
+    if ( _weighting == NormalWeighting::Angle ) {
+        for ( size_t corner = 0; corner < 3; corner++ ) {
+            glm::vec3 a = p[( corner + 1 ) % 3] - p[corner], b = p[( corner + 2 ) % 3] - p[corner];
+            weights[corner] = CornerAngle(glm::dot(a, b) / std::max(glm::length(a) * glm::length(b), MIN_LENGTH));
+        }
+    }
+
+    for ( size_t corner = 0; corner < 3; corner++ ) {
+        _accumulator.x[_triangle[corner]] += normal.x * weights[corner];
+        _accumulator.y[_triangle[corner]] += normal.y * weights[corner];
+        _accumulator.z[_triangle[corner]] += normal.z * weights[corner];
+    }
+}
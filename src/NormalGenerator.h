@@ -0,0 +1,38 @@
+#ifndef NORMAL_GENERATOR_H
+#define NORMAL_GENERATOR_H
+
+#include <vector>
+
+#include <GL/glew.h>
+
+#include "Mesh.h"
+
+enum class NormalWeighting {
+    Uniform,    // every adjacent face counts the same, what calcAverageNormals used to do
+    Area,       // faces contribute proportionally to their area
+    Angle       // faces contribute by the angle they make at the vertex, independent of tessellation
+};
+
+class NormalGenerator {
+    public:
+        // Overwrites the normal of every vertex with the weighted average of its adjacent face normals.
+        // Faces are wound like createObjects(), the normal is cross(v1 - v0, v2 - v0).
+        static void Generate(const std::vector<GLuint>& _indices, std::vector<Shape>& _vertices,
+                NormalWeighting _weighting = NormalWeighting::Area);
+
+    private:
+        struct Positions {
+            std::vector<float> x, y, z;
+        };
+
+        struct Accumulator {
+            std::vector<float> x, y, z;
+        };
+
+        static void AccumulateFaces(const GLuint* _indices, size_t _begin, size_t _end, const Positions& _positions,
+                NormalWeighting _weighting, Accumulator& _accumulator);
+        static void AccumulateFace(const GLuint* _triangle, const Positions& _positions, NormalWeighting _weighting,
+                Accumulator& _accumulator);
+};
+
+#endif
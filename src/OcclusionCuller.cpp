@@ -0,0 +1,248 @@
+#include <algorithm>
+#include <cmath>
+
+#if defined(__SSE2__) || defined(_M_X64) || defined(_M_AMD64)
+#define OCCLUSION_CULLER_SSE 1
+#include <emmintrin.h>
+#endif
+
+#include "OcclusionCuller.h"
+#include "ThreadPool.h"
+
+namespace {
+    // A band of tile rows per job, few enough jobs that each one has real work
+    const size_t MIN_TILE_ROWS_PER_RANGE = 3;
+
+    const float FAR_DEPTH = 1.0f;
+}
+
+OcclusionCuller::OcclusionCuller() : viewProjection(1.0f), depth(WIDTH * HEIGHT, FAR_DEPTH), tileDepth(TILES_X * TILES_Y, FAR_DEPTH) {  }
+
+OcclusionCuller::~OcclusionCuller() = default;
+
+void OcclusionCuller::Begin(const glm::mat4& _viewProjection) {
+    viewProjection = _viewProjection;
+    triangles.clear();
+}
+
+void OcclusionCuller::AddOccluder(const std::vector<glm::vec3>& _positions, const std::vector<GLuint>& _indices, const glm::mat4& _model) {
+    glm::mat4 transform = viewProjection * _model;
+
+    for ( size_t i = 0; i + 2 < _indices.size(); i += 3 ) {
+        AddTriangle(transform * glm::vec4(_positions[_indices[i]], 1.0f), transform * glm::vec4(_positions[_indices[i + 1]], 1.0f),
+                transform * glm::vec4(_positions[_indices[i + 2]], 1.0f));
+    }
+}
+
+void OcclusionCuller::AddTriangle(const glm::vec4& _a, const glm::vec4& _b, const glm::vec4& _c) {
+    // Clipped against the near plane (z = -w) only, the bounding boxes take care of the screen edges
+    const glm::vec4* input[3] = { &_a, &_b, &_c };
+    glm::vec4 clipped[4];
+    int count = 0;
+
+    for ( int i = 0; i < 3; i++ ) {
+        const glm::vec4& current = *input[i];
+        const glm::vec4& next = *input[( i + 1 ) % 3];
+        float currentDistance = current.z + current.w, nextDistance = next.z + next.w;
+
+        if ( currentDistance >= 0.0f ) clipped[count++] = current;
+
+        if ( ( currentDistance >= 0.0f ) != ( nextDistance >= 0.0f ) ) {
+            clipped[count++] = glm::mix(current, next, currentDistance / ( currentDistance - nextDistance ));
+        }
+    }
+
+    for ( int i = 2; i < count; i++ ) {
+        SetupTriangle(clipped[0], clipped[i - 1], clipped[i]);
+    }
+}
+
+void OcclusionCuller::SetupTriangle(const glm::vec4& _a, const glm::vec4& _b, const glm::vec4& _c) {
+    glm::vec3 screen[3];
+    const glm::vec4* clip[3] = { &_a, &_b, &_c };
+
+    for ( int i = 0; i < 3; i++ ) {
+        glm::vec3 ndc = glm::vec3(*clip[i]) / clip[i]->w;
+        screen[i] = glm::vec3(( ndc.x * 0.5f + 0.5f ) * WIDTH, ( ndc.y * 0.5f + 0.5f ) * HEIGHT, ndc.z * 0.5f + 0.5f);
+    }
+
+    float area = ( screen[1].x - screen[0].x ) * ( screen[2].y - screen[0].y ) - ( screen[1].y - screen[0].y ) * ( screen[2].x - screen[0].x );
+
+    if ( area == 0.0f ) return;
+
+    // Occluders are two sided, a clockwise triangle is turned around so the inside is positive on every edge
+    if ( area < 0.0f ) {
+        std::swap(screen[1], screen[2]);
+        area = -area;
+    }
+
+    Triangle triangle;
+
+    glm::vec2 boundsMin = glm::min(glm::vec2(screen[0]), glm::min(glm::vec2(screen[1]), glm::vec2(screen[2])));
+    glm::vec2 boundsMax = glm::max(glm::vec2(screen[0]), glm::max(glm::vec2(screen[1]), glm::vec2(screen[2])));
+
+    // Pixels whose centres lie within the bounds
+    triangle.minX = std::max(0, static_cast<int>(std::ceil(boundsMin.x - 0.5f)));
+    triangle.minY = std::max(0, static_cast<int>(std::ceil(boundsMin.y - 0.5f)));
+    triangle.maxX = std::min(WIDTH - 1, static_cast<int>(std::floor(boundsMax.x - 0.5f)));
+    triangle.maxY = std::min(HEIGHT - 1, static_cast<int>(std::floor(boundsMax.y - 0.5f)));
+
+    if ( triangle.minX > triangle.maxX || triangle.minY > triangle.maxY ) return;
+
+    float depthA = 0.0f, depthB = 0.0f, depthC = 0.0f;
+
+    for ( int i = 0; i < 3; i++ ) {
+        const glm::vec3& from = screen[i];
+        const glm::vec3& to = screen[( i + 1 ) % 3];
+        const glm::vec3& opposite = screen[( i + 2 ) % 3];
+
+        float a = from.y - to.y;
+        float b = to.x - from.x;
+        float c = from.x * to.y - from.y * to.x;
+
+        // The edge weighs the opposite vertex, together they interpolate the depth
+        depthA += a * opposite.z;
+        depthB += b * opposite.z;
+        depthC += c * opposite.z;
+
+        // Sampled at pixel centres, a centre right on an edge shared by two triangles is inside both so meshes are
+        // watertight
+        triangle.edgeA[i] = a;
+        triangle.edgeB[i] = b;
+        triangle.edgeC[i] = c + 0.5f * a + 0.5f * b;
+    }
+
+    triangle.depthA = depthA / area;
+    triangle.depthB = depthB / area;
+
+    // The farthest depth over the pixel rather than the one at its centre
+    triangle.depthC = depthC / area + 0.5f * triangle.depthA + 0.5f * triangle.depthB
+                    + 0.5f * ( std::abs(triangle.depthA) + std::abs(triangle.depthB) );
+
+    triangles.push_back(triangle);
+}
+
+void OcclusionCuller::Rasterize() {
+    std::fill(depth.begin(), depth.end(), FAR_DEPTH);
+
+    // Bands of whole tile rows, no two jobs ever write the same pixel or tile
+    ThreadPool::Get().ParallelFor(TILES_Y, MIN_TILE_ROWS_PER_RANGE, [this](size_t, size_t _begin, size_t _end) {
+        RasterizeRows(static_cast<int>(_begin), static_cast<int>(_end));
+    });
+}
+
+void OcclusionCuller::RasterizeRows(int _firstTileRow, int _lastTileRow) {
+    int rowBegin = _firstTileRow * TILE_SIZE, rowEnd = _lastTileRow * TILE_SIZE - 1;
+
+    for ( const Triangle& triangle : triangles ) {
+        int firstRow = std::max(triangle.minY, rowBegin), lastRow = std::min(triangle.maxY, rowEnd);
+
+        // Four pixel steps start on a multiple of four, WIDTH is one as well so a step never leaves the row
+        int firstColumn = triangle.minX & ~3;
+
+        for ( int y = firstRow; y <= lastRow; y++ ) {
+            float* row = &depth[y * WIDTH];
+            float edge0 = triangle.edgeB[0] * y + triangle.edgeC[0];
+            float edge1 = triangle.edgeB[1] * y + triangle.edgeC[1];
+            float edge2 = triangle.edgeB[2] * y + triangle.edgeC[2];
+            float rowDepth = triangle.depthB * y + triangle.depthC;
+
+#ifdef OCCLUSION_CULLER_SSE
+            __m128 lanes = _mm_set_ps(3.0f, 2.0f, 1.0f, 0.0f);
+            __m128 zero = _mm_setzero_ps();
+
+            for ( int x = firstColumn; x <= triangle.maxX; x += 4 ) {
+                __m128 columns = _mm_add_ps(_mm_set1_ps(static_cast<float>(x)), lanes);
+
+                __m128 inside = _mm_cmpge_ps(_mm_add_ps(_mm_mul_ps(_mm_set1_ps(triangle.edgeA[0]), columns), _mm_set1_ps(edge0)), zero);
+                inside = _mm_and_ps(inside, _mm_cmpge_ps(_mm_add_ps(_mm_mul_ps(_mm_set1_ps(triangle.edgeA[1]), columns), _mm_set1_ps(edge1)), zero));
+                inside = _mm_and_ps(inside, _mm_cmpge_ps(_mm_add_ps(_mm_mul_ps(_mm_set1_ps(triangle.edgeA[2]), columns), _mm_set1_ps(edge2)), zero));
+
+                // The coverage is the write mask, pixels outside the triangle keep what they had
+                __m128 current = _mm_loadu_ps(row + x);
+                __m128 nearer = _mm_min_ps(current, _mm_add_ps(_mm_mul_ps(_mm_set1_ps(triangle.depthA), columns), _mm_set1_ps(rowDepth)));
+
+                _mm_storeu_ps(row + x, _mm_or_ps(_mm_and_ps(inside, nearer), _mm_andnot_ps(inside, current)));
+            }
+#else
+            for ( int x = triangle.minX; x <= triangle.maxX; x++ ) {
+                if ( triangle.edgeA[0] * x + edge0 < 0.0f || triangle.edgeA[1] * x + edge1 < 0.0f || triangle.edgeA[2] * x + edge2 < 0.0f ) {
+                    continue;
+                }
+
+                row[x] = std::min(row[x], triangle.depthA * x + rowDepth);
+            }
+#endif
+        }
+    }
+
+    for ( int tileY = _firstTileRow; tileY < _lastTileRow; tileY++ ) {
+        for ( int tileX = 0; tileX < TILES_X; tileX++ ) {
+            float farthest = 0.0f;
+
+            for ( int y = tileY * TILE_SIZE; y < ( tileY + 1 ) * TILE_SIZE; y++ ) {
+                const float* row = &depth[y * WIDTH + tileX * TILE_SIZE];
+
+                for ( int x = 0; x < TILE_SIZE; x++ ) {
+                    farthest = std::max(farthest, row[x]);
+                }
+            }
+
+            tileDepth[tileY * TILES_X + tileX] = farthest;
+        }
+    }
+}
+
+bool OcclusionCuller::IsVisible(const glm::vec3& _boundsMin, const glm::vec3& _boundsMax) const {
+    if ( triangles.empty() ) return true;
+
+    glm::vec2 screenMin(WIDTH, HEIGHT), screenMax(0.0f);
+    float nearest = FAR_DEPTH;
+
+    for ( int i = 0; i < 8; i++ ) {
+        glm::vec3 corner(i & 1 ? _boundsMax.x : _boundsMin.x, i & 2 ? _boundsMax.y : _boundsMin.y, i & 4 ? _boundsMax.z : _boundsMin.z);
+        glm::vec4 clip = viewProjection * glm::vec4(corner, 1.0f);
+
+        // Reaching through the near plane, the camera may well be inside it
+        if ( clip.z < -clip.w ) return true;
+
+        glm::vec3 ndc = glm::vec3(clip) / clip.w;
+        glm::vec2 screen(( ndc.x * 0.5f + 0.5f ) * WIDTH, ( ndc.y * 0.5f + 0.5f ) * HEIGHT);
+
+        screenMin = glm::min(screenMin, screen);
+        screenMax = glm::max(screenMax, screen);
+        nearest = std::min(nearest, ndc.z * 0.5f + 0.5f);
+    }
+
+    // Off screen, that's for the frustum to decide
+    if ( screenMax.x < 0.0f || screenMax.y < 0.0f || screenMin.x >= WIDTH || screenMin.y >= HEIGHT ) return true;
+
+    // Every pixel the box touches and one more around them, an occluder's silhouette claims pixels it only covers
+    // the centre of, the box has to show through next to them
+    int minX = std::max(0, static_cast<int>(std::floor(screenMin.x)) - 1);
+    int minY = std::max(0, static_cast<int>(std::floor(screenMin.y)) - 1);
+    int maxX = std::min(WIDTH - 1, static_cast<int>(std::floor(screenMax.x)) + 1);
+    int maxY = std::min(HEIGHT - 1, static_cast<int>(std::floor(screenMax.y)) + 1);
+
+    for ( int tileY = minY / TILE_SIZE; tileY <= maxY / TILE_SIZE; tileY++ ) {
+        for ( int tileX = minX / TILE_SIZE; tileX <= maxX / TILE_SIZE; tileX++ ) {
+            // Nothing in the tile is farther than the box, the tile hides its part of it
+            if ( nearest > tileDepth[tileY * TILES_X + tileX] ) continue;
+
+            int firstY = std::max(minY, tileY * TILE_SIZE), lastY = std::min(maxY, ( tileY + 1 ) * TILE_SIZE - 1);
+            int firstX = std::max(minX, tileX * TILE_SIZE), lastX = std::min(maxX, ( tileX + 1 ) * TILE_SIZE - 1);
+
+            for ( int y = firstY; y <= lastY; y++ ) {
+                for ( int x = firstX; x <= lastX; x++ ) {
+                    if ( nearest <= depth[y * WIDTH + x] ) return true;
+                }
+            }
+        }
+    }
+
+    return false;
+}
+
+size_t OcclusionCuller::GetOccluderTriangleCount() const { return triangles.size(); }
+
+GLfloat OcclusionCuller::GetDepth(int _x, int _y) const { return depth[_y * WIDTH + _x]; }
\ No newline at end of file
@@ -0,0 +1,49 @@
+#ifndef OCCLUSION_CULLER_H
+#define OCCLUSION_CULLER_H
+
+#include <vector>
+
+#include <GL/glew.h>
+
+#include "glm/glm.hpp"
+
+// Software occlusion culling for the camera. A few selected occluder meshes are rasterized on the CPU into a small
+// depth buffer, four pixels per SIMD step with the triangle's coverage as the write mask, one band of tiles per
+// worker. Every 8x8 tile also keeps its farthest depth, so most boxes are settled on the tiles without reading pixels.
+// Coverage is sampled at pixel centres but depth is the farthest over the whole pixel, and boxes are tested with a
+// pixel of margin, so an object isn't hidden by the edge of an occluder that only partly covers it. Only gaps between
+// occluders narrower than a pixel can be missed.
+class OcclusionCuller {
+    public:
+        static const int WIDTH = 256, HEIGHT = 144;
+        static const int TILE_SIZE = 8;
+        static const int TILES_X = WIDTH / TILE_SIZE, TILES_Y = HEIGHT / TILE_SIZE;
+
+        OcclusionCuller();
+        ~OcclusionCuller();
+        void Begin(const glm::mat4& _viewProjection);
+        void AddOccluder(const std::vector<glm::vec3>& _positions, const std::vector<GLuint>& _indices, const glm::mat4& _model);
+        void Rasterize();
+        bool IsVisible(const glm::vec3& _boundsMin, const glm::vec3& _boundsMax) const;
+        size_t GetOccluderTriangleCount() const;
+        GLfloat GetDepth(int _x, int _y) const;
+
+    private:
+        // Edge functions and depth plane of a screen space triangle, evaluated at whole pixel coordinates
+        struct Triangle {
+            float edgeA[3], edgeB[3], edgeC[3];
+            float depthA, depthB, depthC;
+            int minX, minY, maxX, maxY;
+        };
+
+        glm::mat4 viewProjection;
+        std::vector<Triangle> triangles;
+        std::vector<float> depth;
+        std::vector<float> tileDepth;       // farthest depth of each tile
+
+        void AddTriangle(const glm::vec4& _a, const glm::vec4& _b, const glm::vec4& _c);
+        void SetupTriangle(const glm::vec4& _a, const glm::vec4& _b, const glm::vec4& _c);
+        void RasterizeRows(int _firstTileRow, int _lastTileRow);
+};
+
+#endif
\ No newline at end of file
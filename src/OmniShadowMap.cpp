@@ -3,24 +3,53 @@
 #include "glm/gtc/type_ptr.hpp"
 
 #include "OmniShadowMap.h"
+#include "GLState.h"
 #include "Shader.h"
 
-OmniShadowMap::OmniShadowMap() : ShadowMap() {  }
+namespace {
+    const GLuint ALL_FACES = 0x3f;
 
-OmniShadowMap::~OmniShadowMap() = default;
+    // Smallest tier, below it the PCF taps smear the shadow over more than the light reaches on screen
+    const GLuint MIN_OMNI_SHADOW_SIZE = 128;
 
-bool OmniShadowMap::Init(GLuint _width, GLuint _height) {
-    shadowWidth = _width; shadowHeight = _height;
+    // A light only drops a tier once it needs less than this much of the smaller one, one hovering on the boundary
+    // would otherwise redraw its whole cube map every few frames
+    const GLfloat SHRINK_MARGIN = 0.75f;
 
-    glGenFramebuffers(1, &FBO);
+    GLuint CalcTier(GLfloat _texels, GLuint _maxSize) {
+        GLuint size = MIN_OMNI_SHADOW_SIZE;
 
-    glGenTextures(1, &shadowMap);
-    glBindTexture(GL_TEXTURE_CUBE_MAP, shadowMap);
+        while ( size < _texels && size < _maxSize ) size *= 2;
 
-    for ( size_t i = 0; i < 6; ++i ) {
-        glTexImage2D(GL_TEXTURE_CUBE_MAP_POSITIVE_X + i, 0, GL_DEPTH_COMPONENT, shadowWidth, shadowHeight,
-                0, GL_DEPTH_COMPONENT, GL_FLOAT, nullptr);
+        return size;
     }
+}
+
+OmniShadowMap::OmniShadowMap() : ShadowMap(), depthFormat(GL_DEPTH_COMPONENT24) {  }
+
+OmniShadowMap::~OmniShadowMap() = default;
+
+FrameTextureDesc OmniShadowMap::GetDescription() const {
+    return { GL_TEXTURE_CUBE_MAP, depthFormat, shadowWidth, shadowHeight, 1 };
+}
+
+// Takes effect on the next GetDescription, the scheduler then swaps the light's cube map for one of the new size
+void OmniShadowMap::SetResolution(GLuint _size, GLenum _depthFormat) {
+    shadowWidth = _size; shadowHeight = _size;
+    depthFormat = _depthFormat;
+}
+
+GLuint OmniShadowMap::CalcResolution(GLfloat _screenSize, GLuint _current, const OmniShadowQuality& _quality) {
+    GLfloat texels = _screenSize * _quality.texelsPerPixel;
+    GLuint size = CalcTier(texels, _quality.maxSize);
+
+    if ( _current >= size && _current <= CalcTier(texels / SHRINK_MARGIN, _quality.maxSize) ) return _current;
+
+    return size;
+}
+
+void OmniShadowMap::SetTextureParameters() {
+    GLState::Get().BindTexture(GL_TEXTURE_CUBE_MAP, shadowMap);
 
     glTexParameterf(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
     glTexParameterf(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
@@ -29,38 +58,39 @@ bool OmniShadowMap::Init(GLuint _width, GLuint _height) {
     glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
     glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_WRAP_R, GL_CLAMP_TO_EDGE);
 
-    glBindFramebuffer(GL_FRAMEBUFFER, FBO);
-    glFramebufferTexture(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, shadowMap, 0);
+    glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_COMPARE_MODE, GL_COMPARE_REF_TO_TEXTURE);
+    glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_COMPARE_FUNC, GL_LEQUAL);
 
-    glDrawBuffer(GL_NONE);
-    glReadBuffer(GL_NONE);
+    GLState::Get().BindTexture(GL_TEXTURE_CUBE_MAP, 0);
+}
 
-    GLenum status = glCheckFramebufferStatus(GL_FRAMEBUFFER);
+void OmniShadowMap::Write() {
+    GLState::Get().BindFramebuffer(GL_FRAMEBUFFER, FBO);
+}
 
-    if ( status != GL_FRAMEBUFFER_COMPLETE ) {
-        std::cerr << "Framebuffer Error: " << status << '\n';
-        return false;
+void OmniShadowMap::ClearFaces(GLuint _faces) {
+    if ( _faces == ALL_FACES ) {
+        glClear(GL_DEPTH_BUFFER_BIT);
+        return;
     }
 
-    glBindFramebuffer(GL_FRAMEBUFFER, 0);
+    // glClear takes every layer of a layered attachment, the faces that aren't redrawn have to keep their depth
+    GLfloat farDepth = 1.0f;
 
-    return true;
-}
-
-void OmniShadowMap::Write() {
-    glBindFramebuffer(GL_FRAMEBUFFER, FBO);
+    for ( GLint face = 0; face < 6; face++ ) {
+        if ( _faces & ( 1u << face ) ) {
+            glClearTexSubImage(shadowMap, 0, 0, 0, face, shadowWidth, shadowHeight, 1, GL_DEPTH_COMPONENT, GL_FLOAT, &farDepth);
+        }
+    }
 }
 
 void OmniShadowMap::Read(GLenum _textureUnit) {
-    glActiveTexture(_textureUnit);
-    glBindTexture(GL_TEXTURE_CUBE_MAP, shadowMap);
+    GLState::Get().BindTexture(_textureUnit - GL_TEXTURE0, GL_TEXTURE_CUBE_MAP, shadowMap);
 }
 
-void OmniShadowMap::SetLightMatrices(Shader *_shader, const std::vector<glm::mat4>& _matrices) {
-    for ( size_t i = 0; i < 6; ++i ) {
-        std::string lightMatrixLocation = "lightMatrices[" + std::to_string(i) + "]";
-        glUniformMatrix4fv( _shader->GetUniformLocation(lightMatrixLocation), 1, GL_FALSE, glm::value_ptr(_matrices[i]) );
-    }
+void OmniShadowMap::SetLightMatrices(Shader *_shader, const std::array<glm::mat4, 6>& _matrices) {
+    // The array's name locates its first element, the other five follow it
+    glUniformMatrix4fv(_shader->GetUniformLocation("lightMatrices"), 6, GL_FALSE, glm::value_ptr(_matrices[0]));
 }
 
 void OmniShadowMap::GetUniformsOmniShadowMap(std::vector<UniformOmniShadowMap> &_uOmniShadowMap, Shader *_shader) {
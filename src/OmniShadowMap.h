@@ -2,6 +2,7 @@
 #define OMNI_SHADOW_MAP_H
 
 #include <vector>
+#include <array>
 
 #include "ShadowMap.h"
 
@@ -12,18 +13,40 @@ struct UniformOmniShadowMap {
     float farPlane;
 };
 
+// How many cube face texels a light gets per screen pixel its range spans, and the largest tier it may reach. The
+// faces are sized in powers of two so lights of the same tier share textures in the shadow scheduler's pool.
+struct OmniShadowQuality {
+    GLfloat texelsPerPixel;
+    GLuint maxSize;
+};
+
+constexpr OmniShadowQuality OMNI_SHADOW_QUALITIES[] = {
+        { 0.25f, 256 },     // Low
+        { 0.5f, 512 },      // Medium
+        { 1.0f, 1024 },     // High, a light filling the screen gets the size every light used to have
+        { 2.0f, 2048 }      // Ultra
+};
+
+constexpr int OMNI_SHADOW_QUALITY_COUNT = sizeof(OMNI_SHADOW_QUALITIES) / sizeof(OMNI_SHADOW_QUALITIES[0]);
+constexpr int DEFAULT_OMNI_SHADOW_QUALITY = 2;
+
 class OmniShadowMap : public ShadowMap {
     public:
         OmniShadowMap();
         ~OmniShadowMap();
-        bool Init(GLuint _width, GLuint _height) override;
+        FrameTextureDesc GetDescription() const override;
+        void SetResolution(GLuint _size, GLenum _depthFormat);
+        static GLuint CalcResolution(GLfloat _screenSize, GLuint _current, const OmniShadowQuality& _quality);
         void Write() override;
+        void ClearFaces(GLuint _faces);
         void Read(GLenum _textureUnit) override;
-        static void SetLightMatrices(Shader* _shader, const std::vector<glm::mat4>& _matrices);
+        static void SetLightMatrices(Shader* _shader, const std::array<glm::mat4, 6>& _matrices);
         static void GetUniformsOmniShadowMap(std::vector<UniformOmniShadowMap>& _uOmniShadowMap, Shader* _shader);
 
-    private:
+    protected:
+        GLenum depthFormat;
 
+        void SetTextureParameters() override;
 };
 
 #endif
\ No newline at end of file
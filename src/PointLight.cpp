@@ -76,17 +76,25 @@ void PointLight::SetPointLights(std::vector<PointLight> &_pLight, const std::vec
     }
 }
 
-std::vector<glm::mat4> PointLight::CalcLightTransform() {
-    return std::vector<glm::mat4> {
-            lightProj * glm::lookAt(position, position + glm::vec3(1.0f, 0.0f, 0.0f), glm::vec3(0.0f, -1.0f, 0.0f)), // X
-            lightProj * glm::lookAt(position, position + glm::vec3(-1.0f, 0.0f, 0.0f), glm::vec3(0.0f, -1.0f, 0.0f)), // -X
-            lightProj * glm::lookAt(position, position + glm::vec3(0.0f, 1.0f, 0.0f), glm::vec3(0.0f, 0.0f, 1.0f)), // Y
-            lightProj * glm::lookAt(position, position + glm::vec3(0.0f, -1.0f, 0.0f), glm::vec3(0.0f, 0.0f, -1.0f)), // -Y
-            lightProj * glm::lookAt(position, position + glm::vec3(0.0f, 0.0f, 1.0f), glm::vec3(0.0f, -1.0f, 0.0f)), // Z
-            lightProj * glm::lookAt(position, position + glm::vec3(0.0f, 0.0f, -1.0f), glm::vec3(0.0f, -1.0f, 0.0f)), // -Z
+std::array<glm::mat4, 6> PointLight::CalcLightTransform() {
+    return CalcLightTransform(lightProj, position);
+}
+
+std::array<glm::mat4, 6> PointLight::CalcLightTransform(const glm::mat4& _lightProj, const glm::vec3& _position) {
+    return std::array<glm::mat4, 6> {
+            _lightProj * glm::lookAt(_position, _position + glm::vec3(1.0f, 0.0f, 0.0f), glm::vec3(0.0f, -1.0f, 0.0f)), // X
+            _lightProj * glm::lookAt(_position, _position + glm::vec3(-1.0f, 0.0f, 0.0f), glm::vec3(0.0f, -1.0f, 0.0f)), // -X
+            _lightProj * glm::lookAt(_position, _position + glm::vec3(0.0f, 1.0f, 0.0f), glm::vec3(0.0f, 0.0f, 1.0f)), // Y
+            _lightProj * glm::lookAt(_position, _position + glm::vec3(0.0f, -1.0f, 0.0f), glm::vec3(0.0f, 0.0f, -1.0f)), // -Y
+            _lightProj * glm::lookAt(_position, _position + glm::vec3(0.0f, 0.0f, 1.0f), glm::vec3(0.0f, -1.0f, 0.0f)), // Z
+            _lightProj * glm::lookAt(_position, _position + glm::vec3(0.0f, 0.0f, -1.0f), glm::vec3(0.0f, -1.0f, 0.0f)), // -Z
     };
 }
 
+GLfloat PointLight::CalcRange(GLfloat _cutoff) const {
+    return CalcAttenuationRange(colour, diffuseIntensity, constant, linear, exponent, _cutoff);
+}
+
 GLfloat PointLight::GetFarPlane() const { return farPlane; }
 
 glm::vec3 PointLight::GetPosition() const { return position; }
@@ -2,6 +2,7 @@
 #define POINT_LIGHT_H
 
 #include <vector>
+#include <array>
 
 #include "Light.h"
 
@@ -35,7 +36,11 @@ class PointLight : public Light  {
         static void SetPointLights(std::vector<PointLight>& _pLight, const std::vector<UniformPointLight>& _uPointLight,
                 GLuint _uPointLightCount, unsigned int _texUnit, unsigned int _offSet, const std::vector<UniformOmniShadowMap>& _uOmniShadowMap);
 
-        std::vector<glm::mat4> CalcLightTransform();
+        std::array<glm::mat4, 6> CalcLightTransform();
+
+        static std::array<glm::mat4, 6> CalcLightTransform(const glm::mat4& _lightProj, const glm::vec3& _position);
+
+        GLfloat CalcRange(GLfloat _cutoff = 1.0f / 256.0f) const;
 
         GLfloat GetFarPlane() const;
 
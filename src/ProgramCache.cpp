@@ -0,0 +1,165 @@
+#include <cstdio>
+#include <iostream>
+
+#ifdef _WIN32
+#include <direct.h>
+#else
+#include <sys/stat.h>
+#endif
+
+#include "ProgramCache.h"
+#include "Shader.h"
+
+namespace {
+    const uint32_t CACHE_MAGIC = 0x42505347; // "GSPB"
+    const uint32_t CACHE_VERSION = 1;
+
+    struct CacheHeader {
+        uint32_t magic;
+        uint32_t version;
+        uint32_t format;
+        uint32_t length;
+    };
+
+    // FNV-1a, stable across runs and platforms unlike std::hash
+    uint64_t Hash(uint64_t _hash, const void* _data, size_t _size) {
+        const auto* bytes = static_cast<const unsigned char*>(_data);
+
+        for ( size_t i = 0; i < _size; i++ ) {
+            _hash ^= bytes[i];
+            _hash *= 0x100000001B3ull;
+        }
+
+        return _hash;
+    }
+
+    uint64_t Hash(uint64_t _hash, const std::string& _text) { return Hash(_hash, _text.data(), _text.size() + 1); }
+
+    std::string GetString(GLenum _name) {
+        const GLubyte* value = glGetString(_name);
+        return value ? reinterpret_cast<const char*>(value) : "";
+    }
+
+    void MakeDirectory(const std::string& _directory) {
+#ifdef _WIN32
+        _mkdir(_directory.c_str());
+#else
+        mkdir(_directory.c_str(), 0755);
+#endif
+    }
+}
+
+std::string ProgramCache::directory = "ShaderCache";
+
+void ProgramCache::SetDirectory(const std::string& _directory) { directory = _directory; }
+
+bool ProgramCache::IsSupported() {
+    if ( directory.empty() || !( GLEW_ARB_get_program_binary ) ) return false;
+
+    // Some drivers expose the extension with zero formats, meaning they can't actually hand binaries back
+    GLint formats = 0;
+    glGetIntegerv(GL_NUM_PROGRAM_BINARY_FORMATS, &formats);
+
+    return formats > 0;
+}
+
+uint64_t ProgramCache::Key(const std::vector<ShaderStage>& _stages) {
+    uint64_t hash = 0xCBF29CE484222325ull;
+
+    // A driver update invalidates every binary, so the driver identity is part of the key
+    hash = Hash(hash, GetString(GL_VENDOR));
+    hash = Hash(hash, GetString(GL_RENDERER));
+    hash = Hash(hash, GetString(GL_VERSION));
+
+    for ( const auto& stage : _stages ) {
+        hash = Hash(hash, &stage.type, sizeof(stage.type));
+        hash = Hash(hash, stage.code);
+    }
+
+    return hash;
+}
+
+void ProgramCache::PrepareForStore(GLuint _program) {
+    // GL_PROGRAM_BINARY_RETRIEVABLE_HINT tells the driver we'll ask for the binary, it must be set before linking
+    glProgramParameteri(_program, GL_PROGRAM_BINARY_RETRIEVABLE_HINT, GL_TRUE);
+}
+
+bool ProgramCache::Load(GLuint _program, uint64_t _key) {
+    std::FILE* file = std::fopen(FilePath(_key).c_str(), "rb");
+
+    if ( !file ) return false;
+
+    CacheHeader header{};
+    std::vector<char> binary;
+
+    bool valid = std::fread(&header, sizeof(header), 1, file) == 1 && header.magic == CACHE_MAGIC
+            && header.version == CACHE_VERSION && header.length > 0;
+
+    if ( valid ) {
+        binary.resize(header.length);
+        valid = std::fread(binary.data(), 1, binary.size(), file) == binary.size();
+    }
+
+    std::fclose(file);
+
+    if ( !valid ) {
+        Remove(_key);
+        return false;
+    }
+
+    // glProgramBinary loads a program object with a program binary previously returned from glGetProgramBinary.
+    // Whether the driver accepted it shows up in GL_LINK_STATUS, which the caller checks when it needs the program.
+    glProgramBinary(_program, header.format, binary.data(), header.length);
+
+    return true;
+}
+
+void ProgramCache::Store(GLuint _program, uint64_t _key) {
+    GLint length = 0;
+    glGetProgramiv(_program, GL_PROGRAM_BINARY_LENGTH, &length);
+
+    if ( length <= 0 ) return;
+
+    std::vector<char> binary(length);
+    GLenum format = 0;
+
+    // glGetProgramBinary returns a binary representation of the compiled and linked executable for program.
+    glGetProgramBinary(_program, length, &length, &format, binary.data());
+
+    MakeDirectory(directory);
+
+    // Written to a temporary name first so a crash mid-write never leaves a truncated binary behind
+    std::string filePath = FilePath(_key);
+    std::string tempPath = filePath + ".tmp";
+    std::FILE* file = std::fopen(tempPath.c_str(), "wb");
+
+    if ( !file ) return;
+
+    CacheHeader header { CACHE_MAGIC, CACHE_VERSION, format, static_cast<uint32_t>(length) };
+
+    bool written = std::fwrite(&header, sizeof(header), 1, file) == 1
+            && std::fwrite(binary.data(), 1, length, file) == static_cast<size_t>(length);
+
+    std::fclose(file);
+
+    if ( !written ) {
+        std::remove(tempPath.c_str());
+        return;
+    }
+
+    std::remove(filePath.c_str());
+
+    if ( std::rename(tempPath.c_str(), filePath.c_str()) != 0 ) {
+        std::cerr << "Fail to store program binary " << filePath << '\n';
+        std::remove(tempPath.c_str());
+    }
+}
+
+void ProgramCache::Remove(uint64_t _key) { std::remove(FilePath(_key).c_str()); }
+
+std::string ProgramCache::FilePath(uint64_t _key) {
+    char name[32] = { '\0' };
+    snprintf(name, sizeof(name), "%016llx.bin", static_cast<unsigned long long>(_key));
+
+    return directory + "/" + name;
+}
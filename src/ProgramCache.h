@@ -0,0 +1,30 @@
+#ifndef PROGRAM_CACHE_H
+#define PROGRAM_CACHE_H
+
+#include <string>
+#include <vector>
+#include <cstdint>
+
+#include <GL/glew.h>
+
+struct ShaderStage;
+
+// Stores linked programs with glGetProgramBinary so warm starts skip compiling and linking.
+// Load only hands the binary to the driver, a rejected binary shows up as a failed GL_LINK_STATUS.
+class ProgramCache {
+    public:
+        static void SetDirectory(const std::string& _directory);
+        static bool IsSupported();
+        static uint64_t Key(const std::vector<ShaderStage>& _stages);
+        static void PrepareForStore(GLuint _program);
+        static bool Load(GLuint _program, uint64_t _key);
+        static void Store(GLuint _program, uint64_t _key);
+        static void Remove(uint64_t _key);
+
+    private:
+        static std::string directory;
+
+        static std::string FilePath(uint64_t _key);
+};
+
+#endif
@@ -0,0 +1,464 @@
+#include <algorithm>
+#include <cfloat>
+
+#include "SceneBVH.h"
+
+namespace {
+    // What visiting an interior node costs next to testing one proxy, the SAH weighs splits by it
+    const GLfloat TRAVERSAL_COST = 1.0f;
+
+    // Refits only ever grow the nodes of a tree whose objects drift apart, past this it's cheaper to build it again
+    const GLfloat REBUILD_COST_RATIO = 1.5f;
+
+    Containment ClassifySphere(const glm::vec3& _center, GLfloat _radius, const glm::vec3& _boundsMin, const glm::vec3& _boundsMax) {
+        glm::vec3 nearest = glm::clamp(_center, _boundsMin, _boundsMax);
+        glm::vec3 toNear = nearest - _center;
+
+        if ( glm::dot(toNear, toNear) > _radius * _radius ) return Containment::Outside;
+
+        glm::vec3 toFar = glm::max(glm::abs(_boundsMin - _center), glm::abs(_boundsMax - _center));
+
+        return glm::dot(toFar, toFar) <= _radius * _radius ? Containment::Inside : Containment::Intersects;
+    }
+
+    // Slab test, _entry is where the ray goes into the box or 0 when it starts inside
+    bool RayHitsBox(const glm::vec3& _origin, const glm::vec3& _inverseDirection, const glm::vec3& _boundsMin, const glm::vec3& _boundsMax,
+            GLfloat _maxDistance, GLfloat& _entry) {
+        glm::vec3 t0 = ( _boundsMin - _origin ) * _inverseDirection;
+        glm::vec3 t1 = ( _boundsMax - _origin ) * _inverseDirection;
+        glm::vec3 tNear = glm::min(t0, t1);
+        glm::vec3 tFar = glm::max(t0, t1);
+
+        _entry = std::max(std::max(tNear.x, tNear.y), std::max(tNear.z, 0.0f));
+        GLfloat exit = std::min(std::min(tFar.x, tFar.y), std::min(tFar.z, _maxDistance));
+
+        return _entry <= exit;
+    }
+}
+
+Frustum::Frustum(const glm::mat4& _viewProjection) {
+    // Gribb & Hartmann, each plane is the last row of the matrix plus or minus one of the others
+    glm::vec4 rows[4];
+
+    for ( int i = 0; i < 4; i++ ) {
+        rows[i] = glm::vec4(_viewProjection[0][i], _viewProjection[1][i], _viewProjection[2][i], _viewProjection[3][i]);
+    }
+
+    for ( int i = 0; i < 3; i++ ) {
+        planes[i * 2] = rows[3] + rows[i];
+        planes[i * 2 + 1] = rows[3] - rows[i];
+    }
+
+    for ( glm::vec4& plane : planes ) {
+        plane /= glm::length(glm::vec3(plane));
+    }
+}
+
+Containment Frustum::Classify(const glm::vec3& _boundsMin, const glm::vec3& _boundsMax) const {
+    Containment result = Containment::Inside;
+
+    for ( const glm::vec4& plane : planes ) {
+        glm::vec3 normal(plane);
+
+        // The corner furthest along the normal decides whether the box is outside, the nearest one whether it's all inside
+        glm::vec3 furthest(normal.x >= 0.0f ? _boundsMax.x : _boundsMin.x,
+                           normal.y >= 0.0f ? _boundsMax.y : _boundsMin.y,
+                           normal.z >= 0.0f ? _boundsMax.z : _boundsMin.z);
+        glm::vec3 nearest(normal.x >= 0.0f ? _boundsMin.x : _boundsMax.x,
+                          normal.y >= 0.0f ? _boundsMin.y : _boundsMax.y,
+                          normal.z >= 0.0f ? _boundsMin.z : _boundsMax.z);
+
+        if ( glm::dot(normal, furthest) + plane.w < 0.0f ) return Containment::Outside;
+        if ( glm::dot(normal, nearest) + plane.w < 0.0f ) result = Containment::Intersects;
+    }
+
+    return result;
+}
+
+bool Frustum::Intersects(const glm::vec3& _boundsMin, const glm::vec3& _boundsMax) const {
+    return Classify(_boundsMin, _boundsMax) != Containment::Outside;
+}
+
+SceneBVH::SceneBVH() : liveProxies(0), visited(0), areaSum(0.0f), builtCost(0.0f), dirty(true) {  }
+
+SceneBVH::~SceneBVH() = default;
+
+int SceneBVH::Insert(const glm::vec3& _boundsMin, const glm::vec3& _boundsMax, uint32_t _object) {
+    int proxy;
+
+    if ( !freeProxies.empty() ) {
+        proxy = freeProxies.back();
+        freeProxies.pop_back();
+    } else {
+        proxy = static_cast<int>(proxies.size());
+        proxies.emplace_back();
+    }
+
+    proxies[proxy] = { _boundsMin, _boundsMax, _object, 0, true };
+    liveProxies++;
+    dirty = true;
+
+    return proxy;
+}
+
+void SceneBVH::Update(int _proxy, const glm::vec3& _boundsMin, const glm::vec3& _boundsMax) {
+    if ( _proxy == NO_PROXY ) return;
+
+    Proxy& proxy = proxies[_proxy];
+
+    if ( proxy.boundsMin == _boundsMin && proxy.boundsMax == _boundsMax ) return;
+
+    proxy.boundsMin = _boundsMin;
+    proxy.boundsMax = _boundsMax;
+
+    // A pending rebuild picks the new box up anyway
+    if ( !dirty ) Refit(proxy.leaf);
+}
+
+void SceneBVH::Remove(int _proxy) {
+    if ( _proxy == NO_PROXY ) return;
+
+    proxies[_proxy].alive = false;
+    freeProxies.push_back(_proxy);
+    liveProxies--;
+    dirty = true;
+}
+
+void SceneBVH::GetBounds(int _proxy, glm::vec3& _boundsMin, glm::vec3& _boundsMax) const {
+    _boundsMin = proxies[_proxy].boundsMin;
+    _boundsMax = proxies[_proxy].boundsMax;
+}
+
+void SceneBVH::Rebuild() {
+    nodes.clear();
+    leafProxies.clear();
+    areaSum = 0.0f;
+
+    for ( size_t i = 0; i < proxies.size(); i++ ) {
+        if ( proxies[i].alive ) leafProxies.push_back(static_cast<int>(i));
+    }
+
+    nodes.push_back({ glm::vec3(0.0f), glm::vec3(0.0f), -1, 0, 0, 0 });
+
+    if ( !leafProxies.empty() ) Build(0, 0, static_cast<int>(leafProxies.size()));
+
+    builtCost = GetCost();
+    dirty = false;
+}
+
+void SceneBVH::Build(int _node, int _begin, int _end) {
+    glm::vec3 boundsMin = proxies[leafProxies[_begin]].boundsMin, boundsMax = proxies[leafProxies[_begin]].boundsMax;
+    glm::vec3 centroidMin = ( boundsMin + boundsMax ) * 0.5f, centroidMax = centroidMin;
+
+    for ( int i = _begin + 1; i < _end; i++ ) {
+        const Proxy& proxy = proxies[leafProxies[i]];
+        glm::vec3 centroid = ( proxy.boundsMin + proxy.boundsMax ) * 0.5f;
+
+        boundsMin = glm::min(boundsMin, proxy.boundsMin);
+        boundsMax = glm::max(boundsMax, proxy.boundsMax);
+        centroidMin = glm::min(centroidMin, centroid);
+        centroidMax = glm::max(centroidMax, centroid);
+    }
+
+    int count = _end - _begin;
+
+    // The vector grows below, so the node is only touched through its index
+    nodes[_node].boundsMin = boundsMin;
+    nodes[_node].boundsMax = boundsMax;
+    nodes[_node].first = _begin;
+    nodes[_node].count = count;
+
+    GLfloat area = CalcArea(boundsMin, boundsMax);
+    GLfloat inverseArea = area > 0.0f ? 1.0f / area : 0.0f;
+
+    // A small node only splits when that beats testing all of its proxies, a big one always does
+    int bestAxis = -1, bestSplit = 0;
+    GLfloat bestCost = count > MAX_LEAF_PROXIES ? FLT_MAX : static_cast<GLfloat>(count);
+
+    // Proxies are binned by centroid along each axis, the split between two bins with the lowest SAH cost wins
+    for ( int axis = 0; axis < 3 && count > 1; axis++ ) {
+        GLfloat extent = centroidMax[axis] - centroidMin[axis];
+
+        if ( extent <= 0.0f ) continue;
+
+        struct Bin {
+            glm::vec3 boundsMin, boundsMax;
+            int count;
+        } bins[BINS];
+
+        for ( Bin& bin : bins ) bin = { glm::vec3(FLT_MAX), glm::vec3(-FLT_MAX), 0 };
+
+        GLfloat scale = BINS / extent;
+
+        for ( int i = _begin; i < _end; i++ ) {
+            const Proxy& proxy = proxies[leafProxies[i]];
+            GLfloat centroid = ( proxy.boundsMin[axis] + proxy.boundsMax[axis] ) * 0.5f;
+            Bin& bin = bins[std::min(static_cast<int>(( centroid - centroidMin[axis] ) * scale), BINS - 1)];
+
+            bin.boundsMin = glm::min(bin.boundsMin, proxy.boundsMin);
+            bin.boundsMax = glm::max(bin.boundsMax, proxy.boundsMax);
+            bin.count++;
+        }
+
+        // Right to left sweep first, the left to right one then has both sides of every split
+        GLfloat rightCosts[BINS];
+        glm::vec3 sweepMin(FLT_MAX), sweepMax(-FLT_MAX);
+        int sweepCount = 0;
+
+        for ( int i = BINS - 1; i > 0; i-- ) {
+            sweepMin = glm::min(sweepMin, bins[i].boundsMin);
+            sweepMax = glm::max(sweepMax, bins[i].boundsMax);
+            sweepCount += bins[i].count;
+            rightCosts[i] = sweepCount ? CalcArea(sweepMin, sweepMax) * sweepCount : -1.0f;
+        }
+
+        sweepMin = glm::vec3(FLT_MAX);
+        sweepMax = glm::vec3(-FLT_MAX);
+        sweepCount = 0;
+
+        for ( int i = 1; i < BINS; i++ ) {
+            sweepMin = glm::min(sweepMin, bins[i - 1].boundsMin);
+            sweepMax = glm::max(sweepMax, bins[i - 1].boundsMax);
+            sweepCount += bins[i - 1].count;
+
+            if ( sweepCount == 0 || rightCosts[i] < 0.0f ) continue;
+
+            GLfloat cost = TRAVERSAL_COST + ( CalcArea(sweepMin, sweepMax) * sweepCount + rightCosts[i] ) * inverseArea;
+
+            if ( cost < bestCost ) {
+                bestCost = cost;
+                bestAxis = axis;
+                bestSplit = i;
+            }
+        }
+    }
+
+    int middle;
+
+    if ( bestAxis >= 0 ) {
+        GLfloat scale = BINS / ( centroidMax[bestAxis] - centroidMin[bestAxis] );
+        GLfloat minimum = centroidMin[bestAxis];
+
+        middle = static_cast<int>(std::partition(leafProxies.begin() + _begin, leafProxies.begin() + _end, [&](int _proxy) {
+            GLfloat centroid = ( proxies[_proxy].boundsMin[bestAxis] + proxies[_proxy].boundsMax[bestAxis] ) * 0.5f;
+            return std::min(static_cast<int>(( centroid - minimum ) * scale), BINS - 1) < bestSplit;
+        }) - leafProxies.begin());
+    } else if ( count > MAX_LEAF_PROXIES ) {
+        // Stacked centroids can't be told apart, halving them still keeps the leaves small
+        middle = _begin + count / 2;
+    } else {
+        nodes[_node].left = 0;
+        areaSum += area * CalcWeight(nodes[_node]);
+
+        for ( int i = _begin; i < _end; i++ ) {
+            proxies[leafProxies[i]].leaf = _node;
+        }
+
+        return;
+    }
+
+    int left = static_cast<int>(nodes.size());
+
+    nodes[_node].left = left;
+    nodes.push_back({ glm::vec3(0.0f), glm::vec3(0.0f), _node, 0, 0, 0 });
+    nodes.push_back({ glm::vec3(0.0f), glm::vec3(0.0f), _node, 0, 0, 0 });
+    areaSum += area * TRAVERSAL_COST;
+
+    Build(left, _begin, middle);
+    Build(left + 1, middle, _end);
+}
+
+void SceneBVH::FitLeaf(Node& _node) {
+    _node.boundsMin = proxies[leafProxies[_node.first]].boundsMin;
+    _node.boundsMax = proxies[leafProxies[_node.first]].boundsMax;
+
+    for ( int i = _node.first + 1; i < _node.first + _node.count; i++ ) {
+        _node.boundsMin = glm::min(_node.boundsMin, proxies[leafProxies[i]].boundsMin);
+        _node.boundsMax = glm::max(_node.boundsMax, proxies[leafProxies[i]].boundsMax);
+    }
+}
+
+void SceneBVH::Refit(int _node) {
+    // Walks up from the leaf and stops at the first ancestor whose box is still right
+    while ( _node >= 0 ) {
+        Node& node = nodes[_node];
+        GLfloat oldArea = CalcArea(node.boundsMin, node.boundsMax);
+        glm::vec3 oldMin = node.boundsMin, oldMax = node.boundsMax;
+
+        if ( node.left == 0 ) {
+            FitLeaf(node);
+        } else {
+            node.boundsMin = glm::min(nodes[node.left].boundsMin, nodes[node.left + 1].boundsMin);
+            node.boundsMax = glm::max(nodes[node.left].boundsMax, nodes[node.left + 1].boundsMax);
+        }
+
+        if ( node.boundsMin == oldMin && node.boundsMax == oldMax ) break;
+
+        areaSum += ( CalcArea(node.boundsMin, node.boundsMax) - oldArea ) * CalcWeight(node);
+        _node = node.parent;
+    }
+
+    if ( GetCost() > builtCost * REBUILD_COST_RATIO ) dirty = true;
+}
+
+void SceneBVH::AddSubtree(const Node& _node, std::vector<uint32_t>& _objects) const {
+    for ( int i = _node.first; i < _node.first + _node.count; i++ ) {
+        _objects.push_back(proxies[leafProxies[i]].object);
+    }
+}
+
+void SceneBVH::Query(const Frustum& _frustum, std::vector<uint32_t>& _objects) {
+    if ( dirty ) Rebuild();
+
+    _objects.clear();
+    visited = 0;
+
+    if ( liveProxies == 0 ) return;
+
+    stack.clear();
+    stack.push_back(0);
+
+    while ( !stack.empty() ) {
+        const Node& node = nodes[stack.back()];
+        stack.pop_back();
+        visited++;
+
+        Containment containment = _frustum.Classify(node.boundsMin, node.boundsMax);
+
+        if ( containment == Containment::Outside ) continue;
+
+        // Everything below a node that's all inside is visible, no need to look at it
+        if ( containment == Containment::Inside ) {
+            AddSubtree(node, _objects);
+        } else if ( node.left != 0 ) {
+            stack.push_back(node.left + 1);
+            stack.push_back(node.left);
+        } else {
+            for ( int i = node.first; i < node.first + node.count; i++ ) {
+                const Proxy& proxy = proxies[leafProxies[i]];
+
+                if ( _frustum.Intersects(proxy.boundsMin, proxy.boundsMax) ) _objects.push_back(proxy.object);
+            }
+        }
+    }
+}
+
+void SceneBVH::Query(const glm::vec3& _center, GLfloat _radius, std::vector<uint32_t>& _objects) {
+    if ( dirty ) Rebuild();
+
+    _objects.clear();
+    visited = 0;
+
+    if ( liveProxies == 0 ) return;
+
+    stack.clear();
+    stack.push_back(0);
+
+    while ( !stack.empty() ) {
+        const Node& node = nodes[stack.back()];
+        stack.pop_back();
+        visited++;
+
+        Containment containment = ClassifySphere(_center, _radius, node.boundsMin, node.boundsMax);
+
+        if ( containment == Containment::Outside ) continue;
+
+        if ( containment == Containment::Inside ) {
+            AddSubtree(node, _objects);
+        } else if ( node.left != 0 ) {
+            stack.push_back(node.left + 1);
+            stack.push_back(node.left);
+        } else {
+            for ( int i = node.first; i < node.first + node.count; i++ ) {
+                const Proxy& proxy = proxies[leafProxies[i]];
+
+                if ( ClassifySphere(_center, _radius, proxy.boundsMin, proxy.boundsMax) != Containment::Outside ) {
+                    _objects.push_back(proxy.object);
+                }
+            }
+        }
+    }
+}
+
+bool SceneBVH::Raycast(const glm::vec3& _origin, const glm::vec3& _direction, GLfloat _maxDistance, uint32_t& _object,
+        GLfloat& _distance) {
+    if ( dirty ) Rebuild();
+
+    visited = 0;
+
+    if ( liveProxies == 0 ) return false;
+
+    glm::vec3 inverseDirection = 1.0f / _direction;
+    GLfloat closest = _maxDistance;
+    GLfloat entry;
+    bool hit = false;
+
+    stack.clear();
+    stack.push_back(0);
+
+    // Front to back, a node further away than the closest hit so far is skipped when it comes off the stack
+    while ( !stack.empty() ) {
+        const Node& node = nodes[stack.back()];
+        stack.pop_back();
+
+        if ( !RayHitsBox(_origin, inverseDirection, node.boundsMin, node.boundsMax, closest, entry) ) continue;
+
+        visited++;
+
+        if ( node.left != 0 ) {
+            GLfloat leftEntry, rightEntry;
+            bool hitsLeft = RayHitsBox(_origin, inverseDirection, nodes[node.left].boundsMin, nodes[node.left].boundsMax, closest, leftEntry);
+            bool hitsRight = RayHitsBox(_origin, inverseDirection, nodes[node.left + 1].boundsMin, nodes[node.left + 1].boundsMax, closest,
+                    rightEntry);
+            bool leftFirst = !hitsRight || ( hitsLeft && leftEntry <= rightEntry );
+
+            if ( leftFirst ) {
+                if ( hitsRight ) stack.push_back(node.left + 1);
+                if ( hitsLeft ) stack.push_back(node.left);
+            } else {
+                if ( hitsLeft ) stack.push_back(node.left);
+                stack.push_back(node.left + 1);
+            }
+
+            continue;
+        }
+
+        for ( int i = node.first; i < node.first + node.count; i++ ) {
+            const Proxy& proxy = proxies[leafProxies[i]];
+
+            if ( RayHitsBox(_origin, inverseDirection, proxy.boundsMin, proxy.boundsMax, closest, entry) && ( !hit || entry < closest ) ) {
+                closest = entry;
+                _object = proxy.object;
+                hit = true;
+            }
+        }
+    }
+
+    if ( hit ) _distance = closest;
+
+    return hit;
+}
+
+GLfloat SceneBVH::CalcArea(const glm::vec3& _boundsMin, const glm::vec3& _boundsMax) {
+    glm::vec3 extent = glm::max(_boundsMax - _boundsMin, glm::vec3(0.0f));
+
+    return 2.0f * ( extent.x * extent.y + extent.y * extent.z + extent.z * extent.x );
+}
+
+GLfloat SceneBVH::CalcWeight(const Node& _node) const {
+    return _node.left != 0 ? TRAVERSAL_COST : static_cast<GLfloat>(_node.count);
+}
+
+size_t SceneBVH::GetProxyCount() const { return liveProxies; }
+
+size_t SceneBVH::GetNodeCount() const { return nodes.size(); }
+
+// Nodes the last query looked at, against GetNodeCount() it shows how much of the tree a pass actually walked
+size_t SceneBVH::GetVisitedCount() const { return visited; }
+
+// SAH cost of the tree as it is now, relative to the root's surface
+GLfloat SceneBVH::GetCost() const {
+    GLfloat rootArea = nodes.empty() ? 0.0f : CalcArea(nodes[0].boundsMin, nodes[0].boundsMax);
+
+    return rootArea > 0.0f ? areaSum / rootArea : 0.0f;
+}
\ No newline at end of file
@@ -0,0 +1,82 @@
+#ifndef SCENE_BVH_H
+#define SCENE_BVH_H
+
+#include <vector>
+#include <cstdint>
+
+#include <GL/glew.h>
+
+#include "glm/glm.hpp"
+
+enum class Containment { Outside, Intersects, Inside };
+
+// The six clip planes of a view-projection matrix, normalised and facing inwards
+struct Frustum {
+    glm::vec4 planes[6];
+
+    explicit Frustum(const glm::mat4& _viewProjection);
+    Containment Classify(const glm::vec3& _boundsMin, const glm::vec3& _boundsMax) const;
+    bool Intersects(const glm::vec3& _boundsMin, const glm::vec3& _boundsMax) const;
+};
+
+// Bounding volume hierarchy over the world space boxes of scene objects. Built top down with binned SAH, an object
+// that moves only refits its leaf and the ancestors whose box actually changes. Inserts and removes, or refits that
+// left the tree much worse than a fresh build would be, rebuild it before the next query. Proxies stay valid across
+// rebuilds, the caller keeps them next to its objects.
+class SceneBVH {
+    public:
+        static const int NO_PROXY = -1;
+
+        SceneBVH();
+        ~SceneBVH();
+        int Insert(const glm::vec3& _boundsMin, const glm::vec3& _boundsMax, uint32_t _object);
+        void Update(int _proxy, const glm::vec3& _boundsMin, const glm::vec3& _boundsMax);
+        void Remove(int _proxy);
+        void GetBounds(int _proxy, glm::vec3& _boundsMin, glm::vec3& _boundsMax) const;
+        void Rebuild();
+        void Query(const Frustum& _frustum, std::vector<uint32_t>& _objects);
+        void Query(const glm::vec3& _center, GLfloat _radius, std::vector<uint32_t>& _objects);
+        bool Raycast(const glm::vec3& _origin, const glm::vec3& _direction, GLfloat _maxDistance, uint32_t& _object, GLfloat& _distance);
+        size_t GetProxyCount() const;
+        size_t GetNodeCount() const;
+        size_t GetVisitedCount() const;
+        GLfloat GetCost() const;
+
+    private:
+        static const int MAX_LEAF_PROXIES = 4;
+        static const int BINS = 12;
+
+        struct Node {
+            glm::vec3 boundsMin, boundsMax;
+            int parent;
+            int left;               // first child, the second one follows it, 0 for a leaf
+            int first, count;       // the subtree's proxies in leafProxies, contiguous for every node
+        };
+
+        struct Proxy {
+            glm::vec3 boundsMin, boundsMax;
+            uint32_t object;
+            int leaf;
+            bool alive;
+        };
+
+        std::vector<Node> nodes;
+        std::vector<Proxy> proxies;
+        std::vector<int> freeProxies;
+        std::vector<int> leafProxies;
+        std::vector<int> stack;
+        size_t liveProxies;
+        size_t visited;
+        GLfloat areaSum;            // node surface areas weighted by what a visit costs, the unnormalised SAH cost
+        GLfloat builtCost;
+        bool dirty;
+
+        void Build(int _node, int _begin, int _end);
+        void FitLeaf(Node& _node);
+        void Refit(int _node);
+        void AddSubtree(const Node& _node, std::vector<uint32_t>& _objects) const;
+        static GLfloat CalcArea(const glm::vec3& _boundsMin, const glm::vec3& _boundsMax);
+        GLfloat CalcWeight(const Node& _node) const;
+};
+
+#endif
\ No newline at end of file
@@ -1,49 +1,63 @@
-#include <fstream>
-
 #include "Shader.h"
+#include "GLState.h"
+#include "ProgramCache.h"
+#include "Constans.h"
+
+#ifndef GL_COMPLETION_STATUS_KHR
+#define GL_COMPLETION_STATUS_KHR 0x91B1 // same value as GL_COMPLETION_STATUS_ARB
+#endif
+
+bool Shader::parallelCompile = false;
 
 Shader::Shader() = default;
 
 Shader::~Shader() { ClearShader(); }
 
+void Shader::AddDefine(const std::string& _name, const std::string& _value) {
+    for ( auto& define : defines ) {
+        if ( define.name == _name ) {
+            define.value = _value;
+            return;
+        }
+    }
+
+    defines.push_back({ _name, _value });
+}
+
+void Shader::AddDefine(const std::string& _name, int _value) { AddDefine(_name, std::to_string(_value)); }
+
 void Shader::CreateFormFiles(const std::string &_vertexFilePath, const std::string &_fragmentFilePath) {
-    std::string vertexString = ReadFile(_vertexFilePath);
-    std::string fragmentString = ReadFile(_fragmentFilePath);
+    std::vector<ShaderStage> stages(2);
+    stages[0].type = GL_VERTEX_SHADER; stages[0].filePath = _vertexFilePath;
+    stages[1].type = GL_FRAGMENT_SHADER; stages[1].filePath = _fragmentFilePath;
 
-    CompileShader(vertexString, fragmentString);
+    CompileShader(stages);
 }
 
 void Shader::CreateFormFiles(const std::string &_vertexFilePath,  const std::string &_geometryFilePath, const std::string &_fragmentFilePath) {
-    std::string vertexString = ReadFile(_vertexFilePath);
-    std::string geometryString = ReadFile(_geometryFilePath);
-    std::string fragmentString = ReadFile(_fragmentFilePath);
+    std::vector<ShaderStage> stages(3);
+    stages[0].type = GL_VERTEX_SHADER; stages[0].filePath = _vertexFilePath;
+    stages[1].type = GL_GEOMETRY_SHADER; stages[1].filePath = _geometryFilePath;
+    stages[2].type = GL_FRAGMENT_SHADER; stages[2].filePath = _fragmentFilePath;
 
-    CompileShader(vertexString, geometryString, fragmentString);
+    CompileShader(stages);
 }
 
 std::string Shader::ReadFile(const std::string &_filePath) {
     std::string content;
-    std::fstream fileStream(_filePath, std::ios::in);
 
-    if ( !fileStream.is_open() ) {
-        std::cerr << "Fail to read " << _filePath << " file" << std::endl;
-        return "";
-    }
-
-    std::string line;
-
-    while ( !fileStream.eof() ) {
-        std::getline(fileStream, line);
-        content.append(line + "\n");
-    }
-
-    fileStream.close();
+    if ( !ShaderPreprocessor::ReadFile(_filePath, content) ) return "";
 
     return content;
 }
 
+// Literals go straight to the driver, a std::string for a name longer than its inline buffer would allocate every call
+GLuint Shader::GetUniformLocation(const char* _name) const {
+    return glGetUniformLocation(shaderID, _name);
+}
+
 GLuint Shader::GetUniformLocation(const std::string &_name) const {
-    return glGetUniformLocation(shaderID, _name.c_str());
+    return GetUniformLocation(_name.c_str());
 }
 
 GLuint Shader::GetProjectionLocation() const { return uniformProjection; }
@@ -52,22 +66,71 @@ GLuint Shader::GetModelLocation() const { return uniformModel; }
 
 GLuint Shader::GetViewLocation() const { return uniformView; }
 
-void Shader::UseShader() const {
-    // glGetUniformLocation returns an integer that represents the location of a specific uniform variable within a program object.
-    glUseProgram(shaderID);
+bool Shader::UseShader() {
+    if ( GetStatus() != ShaderStatus::Ready ) return false;
+
+    // glUseProgram installs the program object specified by program as part of current rendering state.
+    GLState::Get().UseProgram(shaderID);
+
+    return true;
+}
+
+ShaderStatus Shader::GetStatus() {
+    if ( status != ShaderStatus::NotReady ) return status;
+
+    if ( parallelCompile ) {
+        GLint completed = GL_FALSE;
+
+        // GL_COMPLETION_STATUS_KHR never blocks, it reports whether the driver threads are done with the program
+        glGetProgramiv(shaderID, GL_COMPLETION_STATUS_KHR, &completed);
+
+        if ( !completed ) return status;
+    }
+
+    Finish();
+
+    return status;
+}
+
+void Shader::Wait() {
+    while ( status == ShaderStatus::NotReady ) {
+        Finish();
+    }
+}
+
+void Shader::EnableParallelCompile() {
+    // Let the driver use as many compiler threads as it likes
+#ifdef GL_KHR_parallel_shader_compile
+    if ( GLEW_KHR_parallel_shader_compile ) {
+        glMaxShaderCompilerThreadsKHR(0xFFFFFFFF);
+        parallelCompile = true;
+        return ;
+    }
+#endif
+
+    if ( GLEW_ARB_parallel_shader_compile ) {
+        glMaxShaderCompilerThreadsARB(0xFFFFFFFF);
+        parallelCompile = true;
+    }
 }
 
 void Shader::ClearShader() {
+    ReleaseStages();
+
     if ( shaderID != 0 ) {
         // glDeleteProgram frees the memory and invalidates the name associated with the program object specified by program.
-        glDeleteProgram(shaderID);
+        GLState::Get().DeleteProgram(shaderID);
+        shaderID = 0;
     }
 
+    status = ShaderStatus::Failed;
     uniformModel = 0;
     uniformProjection = 0;
 }
 
 void Shader::Validate() const {
+    // Validation stalls on the driver every draw, release builds skip it
+#ifdef ENGINE_GL_DEBUG
     GLint result{};
     GLchar eLog[1024]{};
 
@@ -82,58 +145,73 @@ void Shader::Validate() const {
         std::cerr << "Error validating program: " << eLog << std::endl;
         return ;
     }
+#endif
 }
 
-void Shader::CompileShader(std::string &_vertexCode, std::string &_fragmentCode) {
+void Shader::CompileShader(std::vector<ShaderStage>& _stages) {
+    for ( auto& stage : _stages ) {
+        stage.preprocessor.AddDefines(defines);
+
+        // Resolves #include, injects the defines and tags every chunk with #line so errors point at the right file
+        if ( !stage.preprocessor.Process(stage.filePath, stage.code) ) {
+            std::cerr << "Error preprocessing " << stage.filePath << std::endl;
+            status = ShaderStatus::Failed;
+            return ;
+        }
+    }
+
     // glCreateProgram creates an empty program object and returns a non-zero value by which it can be referenced.
     // A program object is an object to which shader objects can be attached. This provides a mechanism to specify the shader objects that will be linked to create a program.
     shaderID = glCreateProgram();
 
     if ( !shaderID ) {
         std::cerr << "Error creating shader program" << std::endl;
+        status = ShaderStatus::Failed;
         return ;
     }
 
-    // GL_VERTEX_SHADER - A shader of type GL_VERTEX_SHADER is a shader that is intended to run on the programmable vertex processor
-    AddShader(shaderID, _vertexCode, GL_VERTEX_SHADER);
+    pendingStages = std::move(_stages);
+    status = ShaderStatus::NotReady;
 
-    // GL_FRAGMENT_SHADER - A shader of type GL_FRAGMENT_SHADER is a shader that is intended to run on the programmable fragment processor.
-    AddShader(shaderID, _fragmentCode, GL_FRAGMENT_SHADER);
+    // The key covers the preprocessed sources, so a changed include or define never picks up a stale binary
+    cacheable = ProgramCache::IsSupported();
+    cacheKey = cacheable ? ProgramCache::Key(pendingStages) : 0;
 
-    // glLinkProgram links the program object specified by program. If any shader objects of type GL_VERTEX_SHADER are attached to program,
-    // they will be used to create an executable that will run on the programmable vertex processor.
-    glLinkProgram(shaderID);
+    // Nothing below asks the driver for a status, the result is only looked at in GetStatus()
+    if ( cacheable && ProgramCache::Load(shaderID, cacheKey) ) {
+        loadedFromCache = true;
+        return ;
+    }
 
-    CompileProgram();
+    LinkFromSource();
 }
 
-void Shader::CompileShader(std::string& _vertexCode, std::string& _geometryCode, std::string& _fragmentCode) {
-    shaderID = glCreateProgram();
+void Shader::LinkFromSource() {
+    loadedFromCache = false;
 
-    if ( !shaderID ) {
-        std::cerr << "Error creating shader program" << std::endl;
-        return ;
+    // GL_VERTEX_SHADER - A shader of type GL_VERTEX_SHADER is a shader that is intended to run on the programmable vertex processor
+    // GL_FRAGMENT_SHADER - A shader of type GL_FRAGMENT_SHADER is a shader that is intended to run on the programmable fragment processor.
+    for ( const auto& stage : pendingStages ) {
+        pendingShaders.push_back(AddShader(shaderID, stage));
     }
 
-    AddShader(shaderID, _vertexCode, GL_VERTEX_SHADER);
-    AddShader(shaderID, _geometryCode, GL_GEOMETRY_SHADER);
-    AddShader(shaderID, _fragmentCode, GL_FRAGMENT_SHADER);
+    if ( cacheable ) ProgramCache::PrepareForStore(shaderID);
 
+    // glLinkProgram links the program object specified by program. If any shader objects of type GL_VERTEX_SHADER are attached to program,
+    // they will be used to create an executable that will run on the programmable vertex processor.
     glLinkProgram(shaderID);
-
-    CompileProgram();
 }
 
-void Shader::AddShader(GLuint _program, std::string& _shaderCode, GLenum _shaderType) {
+GLuint Shader::AddShader(GLuint _program, const ShaderStage& _stage) {
     // glCreateShader creates an empty shader object and returns a non-zero value by which it can be referenced.
     // A shader object is used to maintain the source code strings that define a shader. shaderType indicates the type of shader to be created.
-    GLuint shader = glCreateShader(_shaderType);
+    GLuint shader = glCreateShader(_stage.type);
 
     const GLchar* shaderCode[1];
-    shaderCode[0] = _shaderCode.c_str();
+    shaderCode[0] = _stage.code.c_str();
 
     GLint codeLenght[1];
-    codeLenght[0] = _shaderCode.length();
+    codeLenght[0] = _stage.code.length();
 
     // glShaderSource sets the source code in shader to the source code in the array of strings specified by string.
     glShaderSource(shader, 1, shaderCode, codeLenght);
@@ -141,24 +219,58 @@ void Shader::AddShader(GLuint _program, std::string& _shaderCode, GLenum _shader
     // glCompileShader compiles the source code strings that have been stored in the shader object specified by shader.
     glCompileShader(shader);
 
-    GLint result{};
-    GLchar eLog[1024]{};
+    // glAttachShader — Attaches a shader object to a program object
+    glAttachShader(_program, shader);
 
-    // glGetShaderiv — return a parameter from a shader object
-    glGetShaderiv(shader, GL_COMPILE_STATUS, &result);
+    return shader;
+}
 
-    if ( !result ) {
-        // glGetShaderInfoLog — Returns the information log for a shader object
-        glGetShaderInfoLog(shader, sizeof(eLog), nullptr, eLog);
-        std::cerr << "Error compiling " << _shaderType << " shader: " <<  eLog << std::endl;
+void Shader::Finish() {
+    if ( loadedFromCache ) {
+        if ( CompileProgram(false) ) {
+            ReleaseStages();
+            return ;
+        }
+
+        // The driver rejected the stored binary, drop it and build from source instead
+        ProgramCache::Remove(cacheKey);
+        status = ShaderStatus::NotReady;
+        LinkFromSource();
         return ;
     }
 
-    // glAttachShader — Attaches a shader object to a program object
-    glAttachShader(_program, shader);
+    for ( size_t i = 0; i < pendingShaders.size(); i++ ) {
+        GLint result{};
+        GLchar eLog[1024]{};
+
+        // glGetShaderiv — return a parameter from a shader object
+        glGetShaderiv(pendingShaders[i], GL_COMPILE_STATUS, &result);
+
+        if ( !result ) {
+            // glGetShaderInfoLog — Returns the information log for a shader object
+            glGetShaderInfoLog(pendingShaders[i], sizeof(eLog), nullptr, eLog);
+            std::cerr << "Error compiling " << pendingStages[i].filePath << ": "
+                      << pendingStages[i].preprocessor.TranslateLog(eLog) << std::endl;
+        }
+    }
+
+    if ( CompileProgram(true) && cacheable ) ProgramCache::Store(shaderID, cacheKey);
+
+    ReleaseStages();
+}
+
+void Shader::ReleaseStages() {
+    for ( GLuint shader : pendingShaders ) {
+        // Once linked the program keeps its own copy, the shader objects are only dead weight
+        glDetachShader(shaderID, shader);
+        glDeleteShader(shader);
+    }
+
+    pendingShaders.clear();
+    pendingStages.clear();
 }
 
-void Shader::CompileProgram() {
+bool Shader::CompileProgram(bool _reportErrors) {
     GLint result{};
     GLchar eLog[1024]{};
 
@@ -167,14 +279,31 @@ void Shader::CompileProgram() {
     glGetProgramiv(shaderID, GL_LINK_STATUS, &result);
 
     if ( !result ) {
-        // glGetProgramInfoLog — return the information log for a program object
-        glGetProgramInfoLog(shaderID, sizeof(eLog), nullptr, eLog);
-        std::cerr << "Error linking program: " << eLog << std::endl;
-        return ;
+        status = ShaderStatus::Failed;
+
+        if ( _reportErrors ) {
+            // glGetProgramInfoLog — return the information log for a program object
+            glGetProgramInfoLog(shaderID, sizeof(eLog), nullptr, eLog);
+            std::cerr << "Error linking program: " << eLog << std::endl;
+        }
+
+        return false;
     }
 
+    status = ShaderStatus::Ready;
+    LoadUniforms();
+
+    return true;
+}
+
+void Shader::LoadUniforms() {
     // glGetUniformLocation returns an integer that represents the location of a specific uniform variable within a program object.
     uniformModel = glGetUniformLocation(shaderID, "model");
     uniformProjection = glGetUniformLocation(shaderID, "projection");
     uniformView = glGetUniformLocation(shaderID, "view");
+
+    // glUniformBlockBinding — not part of the program binary, so it's set again after every link or cache load
+    GLuint drawDataBlock = glGetUniformBlockIndex(shaderID, "DrawData");
+
+    if ( drawDataBlock != GL_INVALID_INDEX ) glUniformBlockBinding(shaderID, drawDataBlock, DRAW_DATA_BINDING);
 }
\ No newline at end of file
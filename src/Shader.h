@@ -4,21 +4,43 @@
 #include <string>
 #include <iostream>
 #include <vector>
+#include <cstdint>
 
 #include <GL/glew.h>
 
+#include "ShaderPreprocessor.h"
+
+enum class ShaderStatus {
+    NotReady,   // submitted, the driver is still compiling or linking
+    Ready,
+    Failed
+};
+
+struct ShaderStage {
+    GLenum type;
+    std::string filePath;
+    std::string code;
+    ShaderPreprocessor preprocessor;
+};
+
 class Shader {
     public:
         Shader();
         ~Shader();
+        void AddDefine(const std::string& _name, const std::string& _value);
+        void AddDefine(const std::string& _name, int _value);
         void CreateFormFiles(const std::string& _vertexFilePath, const std::string& _fragmentFilePath);
         void CreateFormFiles(const std::string &_vertexFilePath,  const std::string &_geometryFilePath, const std::string &_fragmentFilePath);
         static std::string ReadFile(const std::string& _filePath);
+        GLuint GetUniformLocation(const char* _name) const;
         GLuint GetUniformLocation(const std::string& _name) const;
         GLuint GetProjectionLocation() const;
         GLuint GetModelLocation() const;
         GLuint GetViewLocation() const;
-        void UseShader() const;
+        bool UseShader();
+        ShaderStatus GetStatus();
+        void Wait();
+        static void EnableParallelCompile();
         void ClearShader();
         void Validate() const;
 
@@ -27,11 +49,22 @@ class Shader {
         GLuint uniformProjection{};
         GLuint uniformModel{};
         GLuint uniformView{};
+        std::vector<ShaderDefine> defines;
+        ShaderStatus status{ ShaderStatus::Failed };
+        std::vector<ShaderStage> pendingStages;
+        std::vector<GLuint> pendingShaders;
+        bool cacheable{};
+        bool loadedFromCache{};
+        uint64_t cacheKey{};
+        static bool parallelCompile;
 
-        void CompileShader(std::string& _vertexCode, std::string& _fragmentCode);
-        void CompileShader(std::string& _vertexCode, std::string& _geometryCode, std::string& _fragmentCode);
-        static void AddShader(GLuint _program, std::string& _shaderCode, GLenum _shaderType);
-        void CompileProgram();
+        void CompileShader(std::vector<ShaderStage>& _stages);
+        void LinkFromSource();
+        static GLuint AddShader(GLuint _program, const ShaderStage& _stage);
+        void Finish();
+        void ReleaseStages();
+        bool CompileProgram(bool _reportErrors);
+        void LoadUniforms();
 };
 
 #endif
@@ -0,0 +1,33 @@
+#include "ShaderBatch.h"
+#include "Shader.h"
+
+ShaderBatch::ShaderBatch() { Shader::EnableParallelCompile(); }
+
+ShaderBatch::~ShaderBatch() = default;
+
+void ShaderBatch::Add(Shader* _shader, const std::string& _vertexFilePath, const std::string& _fragmentFilePath) {
+    _shader->CreateFormFiles(_vertexFilePath, _fragmentFilePath);
+    shaders.push_back(_shader);
+}
+
+void ShaderBatch::Add(Shader* _shader, const std::string& _vertexFilePath, const std::string& _geometryFilePath,
+        const std::string& _fragmentFilePath) {
+    _shader->CreateFormFiles(_vertexFilePath, _geometryFilePath, _fragmentFilePath);
+    shaders.push_back(_shader);
+}
+
+bool ShaderBatch::IsReady() const {
+    bool ready = true;
+
+    for ( auto shader : shaders ) {
+        ready = shader->GetStatus() != ShaderStatus::NotReady && ready;
+    }
+
+    return ready;
+}
+
+void ShaderBatch::Wait() const {
+    for ( auto shader : shaders ) {
+        shader->Wait();
+    }
+}
@@ -0,0 +1,25 @@
+#ifndef SHADER_BATCH_H
+#define SHADER_BATCH_H
+
+#include <string>
+#include <vector>
+
+class Shader;
+
+// Submits every program before anything asks for a status, so the driver compiles them side by side
+// while the caller goes on loading assets. Nothing here blocks except Wait().
+class ShaderBatch {
+    public:
+        ShaderBatch();
+        ~ShaderBatch();
+        void Add(Shader* _shader, const std::string& _vertexFilePath, const std::string& _fragmentFilePath);
+        void Add(Shader* _shader, const std::string& _vertexFilePath, const std::string& _geometryFilePath,
+                const std::string& _fragmentFilePath);
+        bool IsReady() const;
+        void Wait() const;
+
+    private:
+        std::vector<Shader*> shaders;
+};
+
+#endif
@@ -0,0 +1,61 @@
+#include <algorithm>
+
+#include "ShaderPermutations.h"
+#include "Shader.h"
+
+ShaderPermutations::ShaderPermutations(std::string _vertexFilePath, std::string _fragmentFilePath)
+        : vertexFilePath(std::move(_vertexFilePath)), fragmentFilePath(std::move(_fragmentFilePath)), lastReady{ nullptr, nullptr } {  }
+
+ShaderPermutations::~ShaderPermutations() = default;
+
+Shader* ShaderPermutations::Get(const ShaderPermutationKey& _key) {
+    ShaderPermutationKey key = Clamp(_key);
+    Shader* shader = Find(key);
+    bool prefiltered = PCF_QUALITIES[key.pcfQuality].prefiltered;
+
+    if ( shader->GetStatus() == ShaderStatus::Ready ) {
+        lastReady[prefiltered] = shader;
+        return shader;
+    }
+
+    // Prefer a stand-in that samples the directional shadow the same way, the other kind only beats drawing nothing
+    if ( lastReady[prefiltered] ) return lastReady[prefiltered];
+    if ( lastReady[!prefiltered] ) return lastReady[!prefiltered];
+
+    return shader;
+}
+
+void ShaderPermutations::Precompile(const ShaderPermutationKey& _key) {
+    Find(Clamp(_key));
+}
+
+Shader* ShaderPermutations::Find(const ShaderPermutationKey& _key) {
+    uint32_t packed = PackPermutation(_key);
+
+    auto variant = variants.find(packed);
+
+    if ( variant != variants.end() ) return variant->second.get();
+
+    // Submitted without waiting, Get keeps returning the last ready variant until this one links
+    auto shader = std::make_unique<Shader>();
+    shader->AddDefine("POINT_LIGHT_COUNT", _key.pointLights);
+    shader->AddDefine("SPOT_LIGHT_COUNT", _key.spotLights);
+    shader->AddDefine("SHADOWS", _key.shadows ? 1 : 0);
+    shader->AddDefine("DIRECTIONAL_PCF_SAMPLES", PCF_QUALITIES[_key.pcfQuality].directionalSamples);
+    shader->AddDefine("OMNI_PCF_SAMPLES", PCF_QUALITIES[_key.pcfQuality].omniSamples);
+    shader->AddDefine("SHADOW_PREFILTERED", PCF_QUALITIES[_key.pcfQuality].prefiltered ? 1 : 0);
+    shader->CreateFormFiles(vertexFilePath, fragmentFilePath);
+
+    Shader* result = shader.get();
+    variants.emplace(packed, std::move(shader));
+
+    return result;
+}
+
+ShaderPermutationKey ShaderPermutations::Clamp(ShaderPermutationKey _key) {
+    _key.pointLights = std::min(std::max(_key.pointLights, 0), MAX_POINT_LIGHTS);
+    _key.spotLights = std::min(std::max(_key.spotLights, 0), MAX_SPOT_LIGHTS);
+    _key.pcfQuality = std::min(std::max(_key.pcfQuality, 0), PCF_QUALITY_COUNT - 1);
+
+    return _key;
+}
@@ -0,0 +1,77 @@
+#ifndef SHADER_PERMUTATIONS_H
+#define SHADER_PERMUTATIONS_H
+
+#include <string>
+#include <memory>
+#include <unordered_map>
+#include <cstdint>
+
+#include "Constans.h"
+
+class Shader;
+
+// How much shadow filtering a variant bakes in: rotated Poisson taps for the directional and omni maps, every
+// tap is a hardware compare that already filters 2x2 texels. Prefiltered variants read the directional light
+// from a blurred exponential shadow map instead, one tap whatever the softness.
+struct PcfQuality {
+    int directionalSamples;
+    int omniSamples;
+    bool prefiltered;
+};
+
+constexpr PcfQuality PCF_QUALITIES[] = {
+        { 1, 1, false },    // Low, a single compare each
+        { 4, 6, false },    // Medium
+        { 8, 12, false },   // High, what the generic shader does
+        { 1, 12, true }     // Prefiltered directional, omni as High
+};
+
+constexpr int PCF_QUALITY_COUNT = sizeof(PCF_QUALITIES) / sizeof(PCF_QUALITIES[0]);
+constexpr int DEFAULT_PCF_QUALITY = 2;
+
+struct ShaderPermutationKey {
+    int pointLights;
+    int spotLights;
+    bool shadows;
+    int pcfQuality;
+};
+
+// Bit layout of the packed key, wide enough for the light limits in Constans.h
+constexpr int PERMUTATION_LIGHT_BITS = 4;
+constexpr int PERMUTATION_QUALITY_BITS = 2;
+
+static_assert(MAX_POINT_LIGHTS < ( 1 << PERMUTATION_LIGHT_BITS ), "MAX_POINT_LIGHTS doesn't fit the permutation key");
+static_assert(MAX_SPOT_LIGHTS < ( 1 << PERMUTATION_LIGHT_BITS ), "MAX_SPOT_LIGHTS doesn't fit the permutation key");
+static_assert(PCF_QUALITY_COUNT <= ( 1 << PERMUTATION_QUALITY_BITS ), "PCF_QUALITIES doesn't fit the permutation key");
+
+constexpr uint32_t PackPermutation(const ShaderPermutationKey& _key) {
+    return static_cast<uint32_t>(_key.pointLights)
+         | static_cast<uint32_t>(_key.spotLights) << PERMUTATION_LIGHT_BITS
+         | static_cast<uint32_t>(_key.shadows) << ( PERMUTATION_LIGHT_BITS * 2 )
+         | static_cast<uint32_t>(_key.pcfQuality) << ( PERMUTATION_LIGHT_BITS * 2 + 1 );
+}
+
+constexpr uint32_t PERMUTATION_COUNT = ( MAX_POINT_LIGHTS + 1 ) * ( MAX_SPOT_LIGHTS + 1 ) * 2 * PCF_QUALITY_COUNT;
+
+// Compiles one program per key with the light counts, shadows and PCF kernel baked in as constants,
+// so the loops unroll and the disabled features are compiled out instead of branched over. While a newly
+// requested variant is still compiling Get hands back the last one that was ready, so a toggle never blanks the frame.
+class ShaderPermutations {
+    public:
+        ShaderPermutations(std::string _vertexFilePath, std::string _fragmentFilePath);
+        ~ShaderPermutations();
+        Shader* Get(const ShaderPermutationKey& _key);
+        void Precompile(const ShaderPermutationKey& _key);
+        static ShaderPermutationKey Clamp(ShaderPermutationKey _key);
+
+    private:
+        std::string vertexFilePath;
+        std::string fragmentFilePath;
+        std::unordered_map<uint32_t, std::unique_ptr<Shader>> variants;
+        // Indexed by PcfQuality::prefiltered, the two kinds bind different samplers to the directional shadow unit
+        Shader* lastReady[2];
+
+        Shader* Find(const ShaderPermutationKey& _key);
+};
+
+#endif
@@ -0,0 +1,252 @@
+#include <iostream>
+#include <mutex>
+#include <regex>
+#include <unordered_map>
+
+#include "ShaderPreprocessor.h"
+#include "Constans.h"
+#include "FileSystem.h"
+
+namespace {
+    // Deeper than any sane include chain, stops include cycles that the guard can't see
+    const int MAX_INCLUDE_DEPTH = 16;
+
+    std::mutex cacheMutex;
+    std::unordered_map<std::string, std::string> fileCache;
+
+    std::string DirectoryOf(const std::string& _filePath) {
+        size_t slash = _filePath.find_last_of("/\\");
+        return slash == std::string::npos ? "" : _filePath.substr(0, slash + 1);
+    }
+
+    // Collapses "a/b/../c" so the same file included through different paths is only pasted once
+    std::string NormalizePath(const std::string& _filePath) {
+        std::vector<std::string> parts;
+        size_t start = 0;
+
+        while ( start <= _filePath.size() ) {
+            size_t end = _filePath.find_first_of("/\\", start);
+            if ( end == std::string::npos ) end = _filePath.size();
+
+            std::string part = _filePath.substr(start, end - start);
+
+            if ( part == ".." && !parts.empty() && parts.back() != ".." ) {
+                parts.pop_back();
+            } else if ( !part.empty() && part != "." ) {
+                parts.push_back(part);
+            }
+
+            start = end + 1;
+        }
+
+        std::string normalized = !_filePath.empty() && _filePath[0] == '/' ? "/" : "";
+
+        for ( size_t i = 0; i < parts.size(); i++ ) {
+            normalized += ( i ? "/" : "" ) + parts[i];
+        }
+
+        return normalized;
+    }
+
+    bool StartsWithDirective(const std::string& _line, const char* _directive, size_t& _rest) {
+        size_t pos = _line.find_first_not_of(" \t");
+
+        if ( pos == std::string::npos || _line[pos] != '#' ) return false;
+
+        pos = _line.find_first_not_of(" \t", pos + 1);
+        std::string directive(_directive);
+
+        if ( pos == std::string::npos || _line.compare(pos, directive.size(), directive) != 0 ) return false;
+
+        _rest = pos + directive.size();
+
+        return true;
+    }
+}
+
+ShaderPreprocessor::ShaderPreprocessor() {
+    // Limits shared with the C++ side, so they only live in Constans.h
+    AddDefine("MAX_POINT_LIGHTS", MAX_POINT_LIGHTS);
+    AddDefine("MAX_SPOT_LIGHTS", MAX_SPOT_LIGHTS);
+    AddDefine("SHADOW_CASCADES", SHADOW_CASCADES);
+    AddDefine("ESM_EXPONENT", ESM_EXPONENT);
+}
+
+ShaderPreprocessor::~ShaderPreprocessor() = default;
+
+void ShaderPreprocessor::AddDefine(const std::string& _name, const std::string& _value) {
+    for ( auto& define : defines ) {
+        if ( define.name == _name ) {
+            define.value = _value;
+            return;
+        }
+    }
+
+    defines.push_back({ _name, _value });
+}
+
+void ShaderPreprocessor::AddDefine(const std::string& _name, int _value) { AddDefine(_name, std::to_string(_value)); }
+
+void ShaderPreprocessor::AddDefines(const std::vector<ShaderDefine>& _defines) {
+    for ( const auto& define : _defines ) {
+        AddDefine(define.name, define.value);
+    }
+}
+
+bool ShaderPreprocessor::Process(const std::string& _filePath, std::string& _output) {
+    _output.clear();
+    sourceFiles.clear();
+    includedFiles.clear();
+
+    return ProcessFile(NormalizePath(_filePath), _output, 0);
+}
+
+bool ShaderPreprocessor::ProcessFile(const std::string& _filePath, std::string& _output, int _depth) {
+    if ( _depth > MAX_INCLUDE_DEPTH ) {
+        std::cerr << "Shader include depth exceeded at " << _filePath << '\n';
+        return false;
+    }
+
+    // Every file is pasted once per program, like an implicit include guard
+    if ( !includedFiles.insert(_filePath).second ) return true;
+
+    std::string content;
+
+    if ( !ReadCachedFile(_filePath, content) ) return false;
+
+    int sourceIndex = sourceFiles.size();
+    sourceFiles.push_back(_filePath);
+
+    std::string directory = DirectoryOf(_filePath);
+    bool hasVersion = false;
+    int lineNumber = 0;
+    size_t start = 0;
+
+    if ( _depth == 0 && content.find("#version") == std::string::npos ) {
+        // Without a #version line the defines just go first
+        for ( const auto& define : defines ) {
+            _output += "#define " + define.name + " " + define.value + "\n";
+        }
+
+        _output += "#line 1 " + std::to_string(sourceIndex) + "\n";
+        hasVersion = true;
+    }
+
+    while ( start < content.size() ) {
+        size_t end = content.find('\n', start);
+        if ( end == std::string::npos ) end = content.size();
+
+        std::string line = content.substr(start, end - start);
+        start = end + 1;
+        lineNumber++;
+
+        size_t rest = 0;
+
+        if ( StartsWithDirective(line, "version", rest) ) {
+            if ( _depth != 0 ) {
+                // Only the top level file may set the version, includes keep theirs just for editor tooling
+                _output += "\n";
+                continue;
+            }
+
+            _output += line + "\n";
+
+            if ( !hasVersion ) {
+                for ( const auto& define : defines ) {
+                    _output += "#define " + define.name + " " + define.value + "\n";
+                }
+
+                _output += "#line " + std::to_string(lineNumber + 1) + " " + std::to_string(sourceIndex) + "\n";
+                hasVersion = true;
+            }
+
+            continue;
+        }
+
+        if ( StartsWithDirective(line, "include", rest) ) {
+            size_t open = line.find('"', rest);
+            size_t close = open == std::string::npos ? open : line.find('"', open + 1);
+
+            if ( close == std::string::npos ) {
+                std::cerr << _filePath << "(" << lineNumber << "): malformed #include\n";
+                return false;
+            }
+
+            std::string includePath = NormalizePath(directory + line.substr(open + 1, close - open - 1));
+
+            _output += "#line 1 " + std::to_string(sourceFiles.size()) + "\n";
+
+            if ( !ProcessFile(includePath, _output, _depth + 1) ) {
+                std::cerr << "  included from " << _filePath << "(" << lineNumber << ")\n";
+                return false;
+            }
+
+            _output += "#line " + std::to_string(lineNumber + 1) + " " + std::to_string(sourceIndex) + "\n";
+            continue;
+        }
+
+        _output += line + "\n";
+    }
+
+    return true;
+}
+
+std::string ShaderPreprocessor::TranslateLog(const std::string& _log) const {
+    // Drivers prefix messages with the source string number: "0(12) :" (NVIDIA), "0:12(5):" (Mesa), "ERROR: 0:12:" (AMD)
+    static const std::regex location(R"((^|\n)((?:ERROR|WARNING): )?(\d+)([:(])(\d+))");
+
+    std::string translated;
+    auto last = _log.cbegin();
+
+    for ( std::sregex_iterator it(_log.begin(), _log.end(), location), end; it != end; ++it ) {
+        const std::smatch& match = *it;
+        size_t index = std::stoul(match[3].str());
+
+        translated.append(last, match[0].first);
+        translated += match[1].str() + match[2].str();
+        translated += index < sourceFiles.size() ? sourceFiles[index] : match[3].str();
+        translated += match[4].str() + match[5].str();
+
+        last = match[0].second;
+    }
+
+    translated.append(last, _log.cend());
+
+    return translated;
+}
+
+const std::vector<std::string>& ShaderPreprocessor::GetSourceFiles() const { return sourceFiles; }
+
+// Through the file system, a mounted pack serves the shaders and #include alike
+bool ShaderPreprocessor::ReadFile(const std::string& _filePath, std::string& _content) {
+    if ( !FileSystem::Get().ReadText(_filePath, _content) ) {
+        std::cerr << "Fail to read " << _filePath << " file" << std::endl;
+        return false;
+    }
+
+    return true;
+}
+
+void ShaderPreprocessor::ClearCache() {
+    std::lock_guard<std::mutex> lock(cacheMutex);
+    fileCache.clear();
+}
+
+bool ShaderPreprocessor::ReadCachedFile(const std::string& _filePath, std::string& _content) {
+    {
+        std::lock_guard<std::mutex> lock(cacheMutex);
+        auto cached = fileCache.find(_filePath);
+
+        if ( cached != fileCache.end() ) {
+            _content = cached->second;
+            return true;
+        }
+    }
+
+    if ( !ReadFile(_filePath, _content) ) return false;
+
+    std::lock_guard<std::mutex> lock(cacheMutex);
+    fileCache.emplace(_filePath, _content);
+
+    return true;
+}
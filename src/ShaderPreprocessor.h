@@ -0,0 +1,35 @@
+#ifndef SHADER_PREPROCESSOR_H
+#define SHADER_PREPROCESSOR_H
+
+#include <string>
+#include <vector>
+#include <set>
+
+struct ShaderDefine {
+    std::string name;
+    std::string value;
+};
+
+class ShaderPreprocessor {
+    public:
+        ShaderPreprocessor();
+        ~ShaderPreprocessor();
+        void AddDefine(const std::string& _name, const std::string& _value);
+        void AddDefine(const std::string& _name, int _value);
+        void AddDefines(const std::vector<ShaderDefine>& _defines);
+        bool Process(const std::string& _filePath, std::string& _output);
+        std::string TranslateLog(const std::string& _log) const;
+        const std::vector<std::string>& GetSourceFiles() const;
+        static bool ReadFile(const std::string& _filePath, std::string& _content);
+        static void ClearCache();
+
+    private:
+        std::vector<ShaderDefine> defines;
+        std::vector<std::string> sourceFiles;
+        std::set<std::string> includedFiles;
+
+        bool ProcessFile(const std::string& _filePath, std::string& _output, int _depth);
+        static bool ReadCachedFile(const std::string& _filePath, std::string& _content);
+};
+
+#endif
@@ -0,0 +1,78 @@
+#include <iostream>
+
+#include "ShadowBlur.h"
+#include "GLState.h"
+#include "Shader.h"
+#include "ShaderBatch.h"
+
+ShadowBlur::ShadowBlur() : FBO(0), VAO(0) {
+    glGenFramebuffers(1, &FBO);
+
+    // The full-screen triangle comes from gl_VertexID, core profile still wants a vertex array bound
+    glGenVertexArrays(1, &VAO);
+}
+
+ShadowBlur::~ShadowBlur() {
+    if ( FBO ) {
+        GLState::Get().DeleteFramebuffers(1, &FBO);
+    }
+
+    if ( VAO ) {
+        GLState::Get().DeleteVertexArrays(1, &VAO);
+    }
+}
+
+void ShadowBlur::CreateShaders(ShaderBatch& _batch) {
+    shader = std::make_unique<Shader>();
+    _batch.Add(shader.get(), "Shaders/shadowBlur.vert", "Shaders/shadowBlur.frag");
+}
+
+FrameTextureDesc ShadowBlur::GetScratchDescription(const FrameTextureDesc& _moments) {
+    return { GL_TEXTURE_2D_ARRAY, _moments.internalFormat, _moments.width, _moments.height, 1 };
+}
+
+void ShadowBlur::Blur(GLuint _moments, GLuint _scratch, const FrameTextureDesc& _desc, GLuint _layers) {
+    if ( !_layers || !shader || !shader->UseShader() ) return;
+
+    // Pool textures come without sampling state, the blur reads between texels
+    GLState::Get().BindTexture(GL_TEXTURE_2D_ARRAY, _scratch);
+    glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+    glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+    glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+    glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+
+    GLState::Get().Viewport(0, 0, _desc.width, _desc.height);
+    GLState::Get().Disable(GL_DEPTH_TEST);
+    GLState::Get().DepthMask(GL_FALSE);
+
+    glUniform1i(shader->GetUniformLocation("source"), 0);
+
+    GLState::Get().BindFramebuffer(GL_FRAMEBUFFER, FBO);
+    GLState::Get().BindVertexArray(VAO);
+
+    // Layers that weren't redrawn are blurred already, a second pass would only soften them further
+    for ( GLuint layer = 0; layer < _desc.layers; layer++ ) {
+        if ( !( _layers & ( 1u << layer ) ) ) continue;
+
+        BlurLayer(_moments, layer, _scratch, 0, 1.0f / _desc.width, 0.0f);
+        BlurLayer(_scratch, 0, _moments, layer, 0.0f, 1.0f / _desc.height);
+    }
+
+    GLState::Get().BindVertexArray(0);
+    GLState::Get().BindFramebuffer(GL_FRAMEBUFFER, 0);
+
+    GLState::Get().DepthMask(GL_TRUE);
+    GLState::Get().Enable(GL_DEPTH_TEST);
+}
+
+void ShadowBlur::BlurLayer(GLuint _source, GLuint _sourceLayer, GLuint _target, GLuint _targetLayer, GLfloat _dx, GLfloat _dy) {
+    glFramebufferTextureLayer(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, _target, 0, _targetLayer);
+    glDrawBuffer(GL_COLOR_ATTACHMENT0);
+
+    GLState::Get().BindTexture(0, GL_TEXTURE_2D_ARRAY, _source);
+
+    glUniform1i(shader->GetUniformLocation("layer"), _sourceLayer);
+    glUniform2f(shader->GetUniformLocation("direction"), _dx, _dy);
+
+    glDrawArrays(GL_TRIANGLES, 0, 3);
+}
\ No newline at end of file
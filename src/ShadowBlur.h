@@ -0,0 +1,30 @@
+#ifndef SHADOW_BLUR_H
+#define SHADOW_BLUR_H
+
+#include <memory>
+
+#include <GL/glew.h>
+
+#include "TexturePool.h"
+
+class Shader;
+class ShaderBatch;
+
+// Separable Gaussian blur over the chosen layers of a moments array, horizontally into a one layer scratch texture
+// and vertically back. Blurring the exponential maps is what lets one shadow tap stand in for a PCF kernel.
+class ShadowBlur {
+    public:
+        ShadowBlur();
+        ~ShadowBlur();
+        void CreateShaders(ShaderBatch& _batch);
+        static FrameTextureDesc GetScratchDescription(const FrameTextureDesc& _moments);
+        void Blur(GLuint _moments, GLuint _scratch, const FrameTextureDesc& _desc, GLuint _layers);
+
+    private:
+        std::unique_ptr<Shader> shader;
+        GLuint FBO, VAO;
+
+        void BlurLayer(GLuint _source, GLuint _sourceLayer, GLuint _target, GLuint _targetLayer, GLfloat _dx, GLfloat _dy);
+};
+
+#endif
\ No newline at end of file
@@ -3,17 +3,14 @@
 #include "glm/gtc/type_ptr.hpp"
 
 #include "ShadowMap.h"
+#include "GLState.h"
 #include "Shader.h"
 
 ShadowMap::ShadowMap() : FBO(0), shadowMap(0), shadowWidth(0), shadowHeight(0) {  }
 
 ShadowMap::~ShadowMap() {
     if ( FBO ) {
-        glDeleteFramebuffers(1, &FBO);
-    }
-
-    if ( shadowMap ) {
-        glDeleteTextures(1, &shadowMap);
+        GLState::Get().DeleteFramebuffers(1, &FBO);
     }
 }
 
@@ -22,44 +19,70 @@ bool ShadowMap::Init(GLuint _width, GLuint _height) {
 
     glGenFramebuffers(1, &FBO);
 
-    glGenTextures(1, &shadowMap);
-    glBindTexture(GL_TEXTURE_2D, shadowMap);
-    glTexImage2D(GL_TEXTURE_2D, 0, GL_DEPTH_COMPONENT, shadowWidth, shadowHeight, 0, GL_DEPTH_COMPONENT, GL_FLOAT,nullptr);
+    return true;
+}
 
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_BORDER);
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_BORDER);
+FrameTextureDesc ShadowMap::GetDescription() const {
+    return { GL_TEXTURE_2D, GL_DEPTH_COMPONENT24, shadowWidth, shadowHeight, 1 };
+}
 
-    float borderColor[] = { 1.0f, 1.0f, 1.0f, 1.0f };
-    glTextureParameterfv(GL_TEXTURE_2D, GL_TEXTURE_BORDER_COLOR, borderColor);
+bool ShadowMap::Attach(GLuint _texture, bool _newStorage) {
+    // The sampling state stays with the texture and the attachment with the framebuffer, both still hold from last frame
+    if ( _texture == shadowMap && !_newStorage ) return true;
 
-    glTexParameterf(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
-    glTexParameterf(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+    shadowMap = _texture;
+    SetTextureParameters();
 
-    glBindFramebuffer(GL_FRAMEBUFFER, FBO);
-    glFramebufferTexture2D(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, GL_TEXTURE_2D, shadowMap, 0);
+    GLState::Get().BindFramebuffer(GL_FRAMEBUFFER, FBO);
+
+    // glFramebufferTexture attaches every face of a cube map as a layered attachment, a 2D texture as its only image
+    glFramebufferTexture(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, shadowMap, 0);
 
     glDrawBuffer(GL_NONE);
     glReadBuffer(GL_NONE);
 
+    bool complete = true;
+
+#ifdef ENGINE_GL_DEBUG
+    // Round trips to the driver, only checked in debug builds and only when the attachment changed
     GLenum status = glCheckFramebufferStatus(GL_FRAMEBUFFER);
 
     if ( status != GL_FRAMEBUFFER_COMPLETE ) {
         std::cerr << "Framebuffer Error: " << status << '\n';
-        return false;
+        complete = false;
     }
+#endif
 
-    glBindFramebuffer(GL_FRAMEBUFFER, 0);
+    GLState::Get().BindFramebuffer(GL_FRAMEBUFFER, 0);
 
-    return true;
+    return complete;
+}
+
+void ShadowMap::SetTextureParameters() {
+    GLState::Get().BindTexture(GL_TEXTURE_2D, shadowMap);
+
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_BORDER);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_BORDER);
+
+    float borderColor[] = { 1.0f, 1.0f, 1.0f, 1.0f };
+    glTexParameterfv(GL_TEXTURE_2D, GL_TEXTURE_BORDER_COLOR, borderColor);
+
+    glTexParameterf(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+    glTexParameterf(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+
+    // Sampled through shadow samplers: every fetch compares against the reference and filters the 2x2 results
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_COMPARE_MODE, GL_COMPARE_REF_TO_TEXTURE);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_COMPARE_FUNC, GL_LEQUAL);
+
+    GLState::Get().BindTexture(GL_TEXTURE_2D, 0);
 }
 
 void ShadowMap::Write() {
-    glBindFramebuffer(GL_FRAMEBUFFER, FBO);
+    GLState::Get().BindFramebuffer(GL_FRAMEBUFFER, FBO);
 }
 
 void ShadowMap::Read(GLenum _textureUnit) {
-    glActiveTexture(_textureUnit);
-    glBindTexture(GL_TEXTURE_2D, shadowMap);
+    GLState::Get().BindTexture(_textureUnit - GL_TEXTURE0, GL_TEXTURE_2D, shadowMap);
 }
 
 GLuint ShadowMap::GetShadowWidth() const { return shadowWidth; }
@@ -4,13 +4,20 @@
 #include "glm/glm.hpp"
 #include <GL/glew.h>
 
+#include "TexturePool.h"
+
 class Shader;
 
+// Owns only the framebuffer, the depth texture is kept by the shadow scheduler and handed over through the frame graph
+// every frame. It's only set up and attached again when the scheduler gave out new storage. Read binds the name from
+// the last Attach, so a target is only released on a frame its pass runs, or the shadow map drops it right away.
 class ShadowMap {
     public:
         ShadowMap();
-        ~ShadowMap();
+        virtual ~ShadowMap();
         virtual bool Init(GLuint _width, GLuint _height);
+        virtual FrameTextureDesc GetDescription() const;
+        bool Attach(GLuint _texture, bool _newStorage);
         virtual void Write();
         virtual void Read(GLenum _textureUnit);
         GLuint GetShadowWidth() const;
@@ -22,6 +29,8 @@ class ShadowMap {
     protected:
         GLuint FBO, shadowMap;
         GLuint shadowWidth, shadowHeight;
+
+        virtual void SetTextureParameters();
 };
 
 #endif
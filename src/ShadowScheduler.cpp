@@ -0,0 +1,331 @@
+#include <algorithm>
+#include <cfloat>
+
+#include "ShadowScheduler.h"
+#include "SceneBVH.h"
+
+namespace {
+    // What drawing a slice is assumed to cost until its first timer query comes back
+    const double DEFAULT_SLICE_COST_MS = 0.25;
+
+    // Weight of a new measurement in the running cost, the GPU time of one draw jitters a lot
+    const double COST_SMOOTHING = 0.2;
+
+    // A light ten units away from the camera scores half of one right next to it
+    const float DISTANCE_FALLOFF = 0.1f;
+
+    // A light that moved changes everything it lights, a caster that moved only its own shadow
+    const float MOVED_LIGHT_BOOST = 2.0f;
+
+    // Never drawn into, the slice's contents are garbage and it goes ahead of everything else
+    const float FORCED_SCORE = FLT_MAX;
+}
+
+ShadowScheduler::ShadowScheduler(double _budgetMilliseconds) : budget(_budgetMilliseconds), scheduledSlices(0), staleSlices(0) {  }
+
+ShadowScheduler::~ShadowScheduler() {
+    for ( const Timing& timing : timings ) {
+        freeQueries.push_back(timing.query);
+    }
+
+    if ( !freeQueries.empty() ) {
+        glDeleteQueries(static_cast<GLsizei>(freeQueries.size()), freeQueries.data());
+    }
+}
+
+int ShadowScheduler::AddShadow(GLuint _slices) {
+    Shadow shadow {};
+    shadow.sliceCount = std::min<GLuint>(_slices, MAX_SLICES);
+    shadow.omni = false;
+    shadow.sliceCost = DEFAULT_SLICE_COST_MS;
+
+    shadows.push_back(shadow);
+
+    return static_cast<int>(shadows.size()) - 1;
+}
+
+GLuint ShadowScheduler::GetTarget(int _shadow, int _target, const FrameTextureDesc& _desc) {
+    Shadow& shadow = shadows[_shadow];
+    Target& target = shadow.targets[_target];
+
+    if ( target.texture && target.desc == _desc ) return target.texture;
+
+    if ( target.texture ) {
+        pool.Release(target.texture);
+
+        // Drawing costs about as much as the texels filled, the estimate follows a resize until it's measured again
+        if ( _target == DEPTH_TARGET && target.desc.width && target.desc.height ) {
+            double texels = static_cast<double>(_desc.width) * _desc.height;
+            shadow.sliceCost *= texels / ( static_cast<double>(target.desc.width) * target.desc.height );
+        }
+    }
+
+    // New storage holds nothing, every slice has to be drawn before it's read
+    target.texture = pool.Acquire(_desc);
+    target.desc = _desc;
+    target.fresh = true;
+    shadow.valid = 0;
+
+    return target.texture;
+}
+
+void ShadowScheduler::ReleaseTarget(int _shadow, int _target) {
+    Target& target = shadows[_shadow].targets[_target];
+
+    if ( target.texture ) pool.Release(target.texture);
+
+    target.texture = 0;
+}
+
+// True once per new storage, kept until the shadow's pass runs so a light culled on the frame it got its texture still
+// sets it up later. The texture's name can't tell, the pool may hand out a recycled one.
+bool ShadowScheduler::ConsumeNewTarget(int _shadow, int _target) {
+    Target& target = shadows[_shadow].targets[_target];
+    bool fresh = target.fresh;
+
+    target.fresh = false;
+
+    return fresh;
+}
+
+void ShadowScheduler::SetCascade(int _shadow, GLuint _cascade, const glm::mat4& _transform, GLfloat _distance) {
+    Shadow& shadow = shadows[_shadow];
+    Slice& slice = shadow.slices[_cascade];
+
+    slice.transform = _transform;
+    slice.distance = _distance;
+
+    // The window snaps to whole texels, it only moves once the camera has gone a texel's width
+    if ( _transform != slice.rendered ) {
+        shadow.dirty |= 1u << _cascade;
+        shadow.moved = true;
+    }
+}
+
+void ShadowScheduler::SetOmni(int _shadow, const glm::vec3& _position, GLfloat _range) {
+    Shadow& shadow = shadows[_shadow];
+
+    if ( shadow.omni && _position == shadow.position && _range == shadow.range ) return;
+
+    shadow.omni = true;
+    shadow.position = _position;
+    shadow.range = _range;
+    shadow.dirty = ( 1u << shadow.sliceCount ) - 1;
+    shadow.moved = true;
+
+    // Faces in GL order (+x, -x, +y, -y, +z, -z), each sees the half of the range's box on its side of the light
+    for ( GLuint face = 0; face < shadow.sliceCount; face++ ) {
+        Slice& slice = shadow.slices[face];
+        int axis = face / 2;
+
+        slice.boundsMin = _position - glm::vec3(_range);
+        slice.boundsMax = _position + glm::vec3(_range);
+
+        if ( face % 2 == 0 ) {
+            slice.boundsMin[axis] = _position[axis];
+        } else {
+            slice.boundsMax[axis] = _position[axis];
+        }
+    }
+}
+
+void ShadowScheduler::Invalidate(const glm::vec3& _boundsMin, const glm::vec3& _boundsMax) {
+    for ( Shadow& shadow : shadows ) {
+        for ( GLuint i = 0; i < shadow.sliceCount; i++ ) {
+            GLuint bit = 1u << i;
+            const Slice& slice = shadow.slices[i];
+
+            if ( !( shadow.valid & bit ) || ( shadow.dirty & bit ) ) continue;
+
+            bool touched = true;
+
+            if ( shadow.omni ) {
+                for ( int axis = 0; axis < 3; axis++ ) {
+                    touched = touched && _boundsMin[axis] <= slice.boundsMax[axis] && slice.boundsMin[axis] <= _boundsMax[axis];
+                }
+            } else {
+                touched = Frustum(slice.rendered).Intersects(_boundsMin, _boundsMax);
+            }
+
+            if ( touched ) shadow.dirty |= bit;
+        }
+    }
+}
+
+void ShadowScheduler::Request(int _shadow) { shadows[_shadow].requested = true; }
+
+void ShadowScheduler::Schedule(const glm::mat4& _projection, const glm::mat4& _view) {
+    CollectTimings();
+    pool.EndFrame();
+
+    Frustum frustum(_projection * _view);
+    glm::vec3 eye(glm::inverse(_view)[3]);
+
+    candidates.clear();
+
+    for ( size_t i = 0; i < shadows.size(); i++ ) {
+        Shadow& shadow = shadows[i];
+        shadow.scheduled = 0;
+
+        if ( !shadow.requested ) continue;
+
+        GLuint stale = ( shadow.dirty | ~shadow.valid ) & ( ( 1u << shadow.sliceCount ) - 1 );
+
+        for ( GLuint slice = 0; slice < shadow.sliceCount; slice++ ) {
+            if ( !( stale & ( 1u << slice ) ) ) continue;
+
+            if ( !( shadow.valid & ( 1u << slice ) ) ) {
+                candidates.push_back({ static_cast<int>(i), slice, FORCED_SCORE });
+                continue;
+            }
+
+            // Out of sight it keeps waiting, it's picked soon after it comes into view since it kept ageing
+            GLfloat weight = CalcWeight(shadow, slice, frustum, eye, _projection[1][1]);
+
+            if ( weight > 0.0f ) candidates.push_back({ static_cast<int>(i), slice, weight * ( 1.0f + shadow.slices[slice].age ) });
+        }
+    }
+
+    std::sort(candidates.begin(), candidates.end(), [](const Candidate& _a, const Candidate& _b) { return _a.score > _b.score; });
+
+    double spent = 0.0;
+    scheduledSlices = 0;
+
+    // Best first, a slice that doesn't fit leaves room for cheaper ones further down. The first one is always taken so
+    // a budget smaller than any slice still makes progress.
+    for ( const Candidate& candidate : candidates ) {
+        Shadow& shadow = shadows[candidate.shadow];
+
+        if ( candidate.score < FORCED_SCORE && scheduledSlices > 0 && spent + shadow.sliceCost > budget ) continue;
+
+        shadow.scheduled |= 1u << candidate.slice;
+        spent += shadow.sliceCost;
+        scheduledSlices++;
+    }
+
+    staleSlices = 0;
+
+    for ( Shadow& shadow : shadows ) {
+        GLuint waiting = shadow.dirty & shadow.valid & ~shadow.scheduled;
+
+        for ( GLuint slice = 0; slice < shadow.sliceCount; slice++ ) {
+            if ( !( waiting & ( 1u << slice ) ) ) continue;
+
+            shadow.slices[slice].age++;
+            staleSlices++;
+        }
+
+        shadow.requested = false;
+    }
+}
+
+GLfloat ShadowScheduler::CalcWeight(const Shadow& _shadow, GLuint _slice, const Frustum& _frustum, const glm::vec3& _eye,
+        GLfloat _focalLength) {
+    const Slice& slice = _shadow.slices[_slice];
+    GLfloat moved = _shadow.moved ? MOVED_LIGHT_BOOST : 1.0f;
+
+    // A cascade covers the whole screen beyond its split
+    if ( !_shadow.omni ) return moved / ( 1.0f + slice.distance * DISTANCE_FALLOFF );
+
+    // Nothing the face sees is on screen, no visible pixel looks this face up
+    if ( !_frustum.Intersects(slice.boundsMin, slice.boundsMax) ) return 0.0f;
+
+    GLfloat distance = glm::length(_shadow.position - _eye);
+    GLfloat coverage = 1.0f;
+
+    // Share of the screen height the light's range spans, squared for the area
+    if ( distance > _shadow.range ) {
+        GLfloat extent = _shadow.range / distance * _focalLength;
+        coverage = std::min(1.0f, extent * extent);
+    }
+
+    return moved * coverage / ( 1.0f + distance * DISTANCE_FALLOFF );
+}
+
+GLuint ShadowScheduler::GetUpdateMask(int _shadow) const { return shadows[_shadow].scheduled; }
+
+void ShadowScheduler::BeginUpdate(int _shadow) {
+    GLuint query;
+
+    if ( freeQueries.empty() ) {
+        glGenQueries(1, &query);
+    } else {
+        query = freeQueries.back();
+        freeQueries.pop_back();
+    }
+
+    // Read back a few frames later in CollectTimings, waiting for it here would stall on the GPU
+    glBeginQuery(GL_TIME_ELAPSED, query);
+
+    timings.push_back({ query, _shadow, CountSlices(shadows[_shadow].scheduled) });
+}
+
+void ShadowScheduler::EndUpdate(int _shadow, bool _rendered) {
+    glEndQuery(GL_TIME_ELAPSED);
+
+    Shadow& shadow = shadows[_shadow];
+
+    // The pass gave up (a shader still compiling), nothing was drawn and the slices stay stale
+    if ( !_rendered ) {
+        timings.back().slices = 0;
+        shadow.scheduled = 0;
+        return;
+    }
+
+    for ( GLuint slice = 0; slice < shadow.sliceCount; slice++ ) {
+        if ( !( shadow.scheduled & ( 1u << slice ) ) ) continue;
+
+        shadow.slices[slice].age = 0;
+        shadow.slices[slice].rendered = shadow.slices[slice].transform;
+    }
+
+    shadow.dirty &= ~shadow.scheduled;
+    shadow.valid |= shadow.scheduled;
+
+    if ( !shadow.dirty ) shadow.moved = false;
+}
+
+void ShadowScheduler::CollectTimings() {
+    size_t collected = 0;
+
+    for ( ; collected < timings.size(); collected++ ) {
+        const Timing& timing = timings[collected];
+        GLint available = 0;
+
+        glGetQueryObjectiv(timing.query, GL_QUERY_RESULT_AVAILABLE, &available);
+
+        // Queries finish in the order they were issued
+        if ( !available ) break;
+
+        GLuint64 elapsed = 0;
+        glGetQueryObjectui64v(timing.query, GL_QUERY_RESULT, &elapsed);
+
+        if ( timing.slices ) {
+            Shadow& shadow = shadows[timing.shadow];
+            double cost = elapsed / 1.0e6 / timing.slices;
+
+            shadow.sliceCost = shadow.measured ? shadow.sliceCost + ( cost - shadow.sliceCost ) * COST_SMOOTHING : cost;
+            shadow.measured = true;
+        }
+
+        freeQueries.push_back(timing.query);
+    }
+
+    timings.erase(timings.begin(), timings.begin() + collected);
+}
+
+GLuint ShadowScheduler::CountSlices(GLuint _mask) {
+    GLuint count = 0;
+
+    for ( ; _mask; _mask &= _mask - 1 ) count++;
+
+    return count;
+}
+
+void ShadowScheduler::SetBudget(double _budgetMilliseconds) { budget = _budgetMilliseconds; }
+
+double ShadowScheduler::GetBudget() const { return budget; }
+
+size_t ShadowScheduler::GetScheduledSliceCount() const { return scheduledSlices; }
+
+size_t ShadowScheduler::GetStaleSliceCount() const { return staleSlices; }
\ No newline at end of file
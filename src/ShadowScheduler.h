@@ -0,0 +1,96 @@
+#ifndef SHADOW_SCHEDULER_H
+#define SHADOW_SCHEDULER_H
+
+#include <vector>
+
+#include <GL/glew.h>
+
+#include "glm/glm.hpp"
+
+#include "TexturePool.h"
+
+struct Frustum;
+
+// Keeps the shadow maps from one frame to the next and decides which parts of them get redrawn. Every shadow is split
+// into slices, the cascades of a directional light or the faces of a cube map, and a slice goes stale when its light
+// moves or a caster moves through it. Each frame the stale slices of the shadows the frame reads are scored by how
+// much of the screen their light covers, how close it is, whether the light itself moved and how long they have
+// waited, then drawn best first until their measured GPU time fills the budget. The rest wait for a later frame, so
+// shadow cost stays flat however many lights there are.
+class ShadowScheduler {
+    public:
+        static const int MAX_SLICES = 6;
+        static const int DEPTH_TARGET = 0, MOMENTS_TARGET = 1;
+
+        explicit ShadowScheduler(double _budgetMilliseconds);
+        ~ShadowScheduler();
+        int AddShadow(GLuint _slices);
+        GLuint GetTarget(int _shadow, int _target, const FrameTextureDesc& _desc);
+        void ReleaseTarget(int _shadow, int _target);
+        bool ConsumeNewTarget(int _shadow, int _target);
+        void SetCascade(int _shadow, GLuint _cascade, const glm::mat4& _transform, GLfloat _distance);
+        void SetOmni(int _shadow, const glm::vec3& _position, GLfloat _range);
+        void Invalidate(const glm::vec3& _boundsMin, const glm::vec3& _boundsMax);
+        void Request(int _shadow);
+        void Schedule(const glm::mat4& _projection, const glm::mat4& _view);
+        GLuint GetUpdateMask(int _shadow) const;
+        void BeginUpdate(int _shadow);
+        void EndUpdate(int _shadow, bool _rendered);
+        void SetBudget(double _budgetMilliseconds);
+        double GetBudget() const;
+        size_t GetScheduledSliceCount() const;
+        size_t GetStaleSliceCount() const;
+
+    private:
+        struct Slice {
+            glm::mat4 transform, rendered;      // cascades, this frame's window and the one the layer holds
+            glm::vec3 boundsMin, boundsMax;     // cube faces, the part of the light's range the face sees
+            GLfloat distance;                   // cascades, the view depth the cascade starts at
+            unsigned int age;                   // frames spent stale without being picked
+        };
+
+        struct Target {
+            FrameTextureDesc desc;
+            GLuint texture;
+            bool fresh;             // handed out since the owner last attached it
+        };
+
+        struct Shadow {
+            GLuint sliceCount;
+            bool omni;
+            glm::vec3 position;
+            GLfloat range;
+            Slice slices[MAX_SLICES];
+            GLuint dirty, valid, scheduled;     // one bit per slice
+            bool moved, requested, measured;
+            double sliceCost;                   // GPU milliseconds to draw one slice
+            Target targets[2];
+        };
+
+        struct Timing {
+            GLuint query;
+            int shadow;
+            GLuint slices;
+        };
+
+        struct Candidate {
+            int shadow;
+            GLuint slice;
+            GLfloat score;
+        };
+
+        std::vector<Shadow> shadows;
+        std::vector<Candidate> candidates;
+        std::vector<GLuint> freeQueries;
+        std::vector<Timing> timings;        // oldest first, a deque would allocate as it moves along
+        TexturePool pool;
+        double budget;
+        size_t scheduledSlices, staleSlices;
+
+        void CollectTimings();
+        static GLfloat CalcWeight(const Shadow& _shadow, GLuint _slice, const Frustum& _frustum, const glm::vec3& _eye,
+                GLfloat _focalLength);
+        static GLuint CountSlices(GLuint _mask);
+};
+
+#endif
\ No newline at end of file
@@ -3,35 +3,75 @@
 #include "stb_image.h"
 
 #include "SkyBox.h"
+#include "GLState.h"
 #include "Shader.h"
 #include "Mesh.h"
+#include "GpuMemory.h"
+#include "UploadManager.h"
+#include "ThreadPool.h"
+#include "FileSystem.h"
 
-SkyBox::SkyBox(const std::vector<std::string>& _faceLocations) : textureID() {
+SkyBox::SkyBox(const std::vector<std::string>& _faceLocations) : textureID(), uploadTicket() {
     skyShader = std::make_unique<Shader>();
     skyShader->CreateFormFiles("Shaders/SkyBox.vert", "Shaders/SkyBox.frag");
 
-    uniformProjection = skyShader->GetProjectionLocation();
-    uniformView = skyShader->GetViewLocation();
+    struct Face {
+        unsigned char* data;
+        int width, height, bitDepth;
+        StagingRegion staging;
+    };
 
-    glGenTextures(1, &textureID);
-    glBindTexture(GL_TEXTURE_CUBE_MAP, textureID);
+    std::vector<Face> faces(_faceLocations.size());
+
+    // Decoded in parallel, each face goes straight into the staging arena when there's room for it
+    ThreadPool::Get().ParallelFor(faces.size(), 1, [&](size_t, size_t _begin, size_t _end) {
+        for ( size_t i = _begin; i < _end; i++ ) {
+            Face& face = faces[i];
+            FileData file;
+            face.data = nullptr;
 
-    int width, height, bitDepth;
+            if ( FileSystem::Get().ReadFile(_faceLocations[i], file) ) {
+                face.data = stbi_load_from_memory(file.data, static_cast<int>(file.size), &face.width, &face.height, &face.bitDepth, 0);
+            }
 
-    for ( size_t i = 0; i < _faceLocations.size(); i++ ) {
-        unsigned char* textureData = stbi_load(_faceLocations[i].c_str(), &width, &height, &bitDepth, 0);
+            if ( face.data ) face.staging = UploadManager::Get().Stage(face.data, static_cast<size_t>(face.width) * face.height * 3);
+        }
+    });
 
-        if ( !textureData ) {
+    for ( size_t i = 0; i < faces.size(); i++ ) {
+        if ( !faces[i].data ) {
             std::cerr << "Failed to load texture: " << _faceLocations[i] << '\n';
 
+            for ( auto& face : faces ) {
+                if ( face.data ) stbi_image_free(face.data);
+            }
+
             return ;
         }
+    }
+
+    glGenTextures(1, &textureID);
+    GLState::Get().BindTexture(GL_TEXTURE_CUBE_MAP, textureID);
+
+    // glTexStorage2D — all six faces at once, they share the first face's size
+    glTexStorage2D(GL_TEXTURE_CUBE_MAP, 1, GL_RGB8, faces[0].width, faces[0].height);
 
-        glTexImage2D(GL_TEXTURE_CUBE_MAP_POSITIVE_X + i, 0, GL_RGB, width, height, 0, GL_RGB, GL_UNSIGNED_BYTE, textureData);
+    for ( size_t i = 0; i < faces.size(); i++ ) {
+        Face& face = faces[i];
 
-        stbi_image_free(textureData);
+        if ( face.staging.IsValid() ) {
+            uploadTicket = UploadManager::Get().CopyToTexture(face.staging, 0, textureID, GL_TEXTURE_CUBE_MAP_POSITIVE_X + i, 0, 0,
+                    face.width, face.height, GL_RGB);
+        } else {
+            glTexSubImage2D(GL_TEXTURE_CUBE_MAP_POSITIVE_X + i, 0, 0, 0, face.width, face.height, GL_RGB, GL_UNSIGNED_BYTE, face.data);
+        }
+
+        stbi_image_free(face.data);
     }
 
+    GpuMemory::Get().TrackTexture(textureID, GpuMemory::CalcTextureBytes(GL_RGB, faces[0].width, faces[0].height, faces.size(), 1),
+        GpuMemoryCategory::Textures, "SkyBox");
+
     glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
     glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
     glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_WRAP_R, GL_CLAMP_TO_EDGE);
@@ -72,24 +112,28 @@ SkyBox::SkyBox(const std::vector<std::string>& _faceLocations) : textureID() {
     } );
 }
 
-SkyBox::~SkyBox() = default;
+SkyBox::~SkyBox() {
+    UploadManager::Get().Flush(uploadTicket);
+
+    GpuMemory::Get().ReleaseTexture(textureID);
+    GLState::Get().DeleteTextures(1, &textureID);
+}
 
 void SkyBox::DrawSkyBox(glm::mat4 _viewMatrix, glm::mat4 _projectionMatrix) {
-    _viewMatrix = glm::mat4(glm::mat3(_viewMatrix));
+    if ( !UploadManager::Get().IsDone(uploadTicket) || !skyShader->UseShader() ) return;
 
-    glDepthMask(GL_FALSE);
+    _viewMatrix = glm::mat4(glm::mat3(_viewMatrix));
 
-    skyShader->UseShader();
+    GLState::Get().DepthMask(GL_FALSE);
 
-    glUniformMatrix4fv(uniformProjection, 1, GL_FALSE, glm::value_ptr(_projectionMatrix));
-    glUniformMatrix4fv(uniformView, 1, GL_FALSE, glm::value_ptr(_viewMatrix));
+    glUniformMatrix4fv(skyShader->GetProjectionLocation(), 1, GL_FALSE, glm::value_ptr(_projectionMatrix));
+    glUniformMatrix4fv(skyShader->GetViewLocation(), 1, GL_FALSE, glm::value_ptr(_viewMatrix));
 
-    glActiveTexture(GL_TEXTURE0);
-    glBindTexture(GL_TEXTURE_CUBE_MAP, textureID);
+    GLState::Get().BindTexture(0, GL_TEXTURE_CUBE_MAP, textureID);
 
     skyShader->Validate();
 
     skyMesh->RenderMesh();
 
-    glDepthMask(GL_TRUE);
+    GLState::Get().DepthMask(GL_TRUE);
 }
@@ -4,6 +4,7 @@
 #include <vector>
 #include <string>
 #include <memory>
+#include <cstdint>
 
 #include "GL/glew.h"
 #include "glm/glm.hpp"
@@ -21,7 +22,7 @@ class SkyBox {
         std::unique_ptr<Mesh> skyMesh;
         std::unique_ptr<Shader> skyShader;
         GLuint textureID;
-        GLuint uniformProjection, uniformView;
+        uint64_t uploadTicket;      // last face copy, the sky draws once it's issued
 };
 
 #endif
\ No newline at end of file
@@ -86,4 +86,6 @@ void SpotLight::SetFlash(glm::vec3 _pos, glm::vec3 _dir) {
     direction = _dir;
 }
 
-void SpotLight::Toggle() { isOn = !isOn; }
\ No newline at end of file
+void SpotLight::Toggle() { isOn = !isOn; }
+
+bool SpotLight::IsOn() const { return isOn; }
\ No newline at end of file
@@ -40,6 +40,8 @@ class SpotLight : public PointLight {
 
         void Toggle();
 
+        bool IsOn() const;
+
     private:
         glm::vec3 direction;
         GLfloat edge{}, procEdge{};
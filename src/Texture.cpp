@@ -4,24 +4,27 @@
 #include <stb_image.h>
 
 #include "Texture.h"
+#include "GLState.h"
+#include "TextureStreamer.h"
+#include "GpuMemory.h"
+#include "UploadManager.h"
+#include "FileSystem.h"
 
-Texture::Texture(std::string _filePath) : filePath(std::move(_filePath)), textureID(0), width(0), height(0), bitDepth(0) {  }
+Texture::Texture(std::string _filePath) : filePath(std::move(_filePath)), textureID(0), width(0), height(0), bitDepth(0), uploadTicket(0),
+        streamer(nullptr), streamSlot(0) {  }
 
 Texture::~Texture() { ClearTexture(); };
 
 bool Texture::LoadTexture() {
-    unsigned char* textureData = stbi_load(filePath.c_str(), &width, &height, &bitDepth, 0);
+    unsigned char* textureData = ReadImage(filePath, width, height, bitDepth);
 
-    if ( !textureData ) {
-        std::cerr << "Failed to load texture: " << filePath << '\n';
-        return false;
-    }
+    if ( !textureData ) return false;
 
     // glGenTextures returns n texture names in textures.
     glGenTextures(1, &textureID);
 
     // glBindTexture lets you create or use a named texture.
-    glBindTexture(GL_TEXTURE_2D, textureID);
+    GLState::Get().BindTexture(GL_TEXTURE_2D, textureID);
 
     // glTexParameter, glTextureParameter — set texture parameters
     // GL_TEXTURE_WRAP_S - Sets the wrap parameter for texture coordinate s to either GL_CLAMP_TO_EDGE, GL_MIRRORED_REPEAT, or GL_REPEAT. GL_CLAMP_TO_EDGE
@@ -38,32 +41,27 @@ bool Texture::LoadTexture() {
     // GL_TEXTURE_MAG_FILTER - The texture magnification function is used when the pixel being textured maps to an area less than or equal to one texture element.
     glTextureParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
 
-    // glTexImage2D — specify a two-dimensional texture image
-    // GL_RGBA, GL_BGRA - Each element contains all four components. Each component is clamped to the range [0,1].
-    glTexImage2D(GL_TEXTURE_2D, 0, GL_RGB, width, height, 0, GL_RGB, GL_UNSIGNED_BYTE, textureData);
+    UploadImage(textureData, GL_RGB, GL_RGB8);
 
-    // glGenerateMipmap and glGenerateTextureMipmap generates mipmaps for the specified texture object.
-    glGenerateMipmap(GL_TEXTURE_2D);
+    GpuMemory::Get().TrackTexture(textureID, GpuMemory::CalcTextureBytes(GL_RGB, width, height, 1, GpuMemory::CalcLevelCount(width, height)),
+        GpuMemoryCategory::Textures, filePath);
 
     // glBindTexture — bind a named texture to a texturing target
-    glBindTexture(GL_TEXTURE_2D, 0);
+    GLState::Get().BindTexture(GL_TEXTURE_2D, 0);
 
-    stbi_image_free(textureData);
+    FreeImage(textureData);
 
     return true;
 }
 
 bool Texture::LoadTextureA() {
-    unsigned char* textureData = stbi_load(filePath.c_str(), &width, &height, &bitDepth, 0);
+    unsigned char* textureData = ReadImage(filePath, width, height, bitDepth);
 
-    if ( !textureData ) {
-        std::cerr << "Failed to load texture: " << filePath << '\n';
-        return false;
-    }
+    if ( !textureData ) return false;
 
     glGenTextures(1, &textureID);
 
-    glBindTexture(GL_TEXTURE_2D, textureID);
+    GLState::Get().BindTexture(GL_TEXTURE_2D, textureID);
 
     glTextureParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_REPEAT);
     glTextureParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_REPEAT);
@@ -71,22 +69,75 @@ bool Texture::LoadTextureA() {
     glTextureParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
     glTextureParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
 
-    glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA, width, height, 0, GL_RGBA, GL_UNSIGNED_BYTE, textureData);
-    glGenerateMipmap(GL_TEXTURE_2D);
+    UploadImage(textureData, GL_RGBA, GL_RGBA8);
+
+    GpuMemory::Get().TrackTexture(textureID, GpuMemory::CalcTextureBytes(GL_RGBA, width, height, 1, GpuMemory::CalcLevelCount(width, height)),
+        GpuMemoryCategory::Textures, filePath);
 
-    glBindTexture(GL_TEXTURE_2D, 0);
+    GLState::Get().BindTexture(GL_TEXTURE_2D, 0);
 
-    stbi_image_free(textureData);
+    FreeImage(textureData);
 
     return true;
 }
 
+void Texture::StreamTexture(TextureStreamer& _streamer) { _streamer.Add(this); }
 
 void Texture::UseTexture() const {
-    // glActiveTexture selects which texture unit subsequent texture state calls will affect.
-    glActiveTexture(GL_TEXTURE1);
-    glBindTexture(GL_TEXTURE_2D, textureID);
+    // Unit 1 holds the diffuse texture, rebinding the one already there is skipped. Until its pixels are out of the
+    // upload queue nothing is bound, rather than storage with undefined contents.
+    GLState::Get().BindTexture(1, GL_TEXTURE_2D, UploadManager::Get().IsDone(uploadTicket) ? textureID : 0);
 }
 
 // glDeleteTextures deletes n textures named by the elements of the array textures.
-void Texture::ClearTexture() { glDeleteTextures(1, &textureID); }
\ No newline at end of file
+void Texture::ClearTexture() {
+    if ( streamer ) {
+        streamer->Remove(this);
+        return;
+    }
+
+    // A queued copy must not land in a deleted texture, or in a new one that got the same name
+    UploadManager::Get().Flush(uploadTicket);
+    uploadTicket = 0;
+
+    GpuMemory::Get().ReleaseTexture(textureID);
+    GLState::Get().DeleteTextures(1, &textureID);
+    textureID = 0;
+}
+
+void Texture::UploadImage(const unsigned char* _data, GLenum _format, GLenum _internalFormat) {
+    // glTexStorage2D — immutable storage for the whole mip chain, filled below
+    glTexStorage2D(GL_TEXTURE_2D, GpuMemory::CalcLevelCount(width, height), _internalFormat, width, height);
+
+    size_t bytes = static_cast<size_t>(width) * height * ( _format == GL_RGB ? 3 : 4 );
+    StagingRegion region = UploadManager::Get().Stage(_data, bytes);
+
+    if ( region.IsValid() ) {
+        UploadManager::Get().CopyToTexture(region, 0, textureID, GL_TEXTURE_2D, 0, 0, width, height, _format);
+        uploadTicket = UploadManager::Get().GenerateMipmap(textureID, GL_TEXTURE_2D);
+    } else {
+        // glTexSubImage2D — the arena is full, straight from client memory
+        glTexSubImage2D(GL_TEXTURE_2D, 0, 0, 0, width, height, _format, GL_UNSIGNED_BYTE, _data);
+
+        // glGenerateMipmap and glGenerateTextureMipmap generates mipmaps for the specified texture object.
+        glGenerateMipmap(GL_TEXTURE_2D);
+    }
+}
+
+unsigned char* Texture::ReadImage(const std::string& _filePath, int& _width, int& _height, int& _bitDepth) {
+    FileData file;
+    unsigned char* textureData = nullptr;
+
+    // Decoded straight from the pack's mapping when the entry is stored as is
+    if ( FileSystem::Get().ReadFile(_filePath, file) ) {
+        textureData = stbi_load_from_memory(file.data, static_cast<int>(file.size), &_width, &_height, &_bitDepth, 0);
+    }
+
+    if ( !textureData ) {
+        std::cerr << "Failed to load texture: " << _filePath << '\n';
+    }
+
+    return textureData;
+}
+
+void Texture::FreeImage(unsigned char* _data) { stbi_image_free(_data); }
\ No newline at end of file
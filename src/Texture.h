@@ -2,22 +2,37 @@
 #define TEXTURE_H
 
 #include <string>
+#include <cstdint>
 
 #include <GL/glew.h>
 
+class TextureStreamer;
+
 class Texture {
     public:
         explicit Texture(std::string  _filePath);
         ~Texture();
         bool LoadTexture();
         bool LoadTextureA();
+        void StreamTexture(TextureStreamer& _streamer);
         void UseTexture() const;
         void ClearTexture();
+        static unsigned char* ReadImage(const std::string& _filePath, int& _width, int& _height, int& _bitDepth);
+        static void FreeImage(unsigned char* _data);
 
     private:
         GLuint textureID;
         int width, height, bitDepth;
         std::string filePath;
+        uint64_t uploadTicket;
+
+        // Set while registered, the streamer swaps textureID as mips come and go
+        TextureStreamer* streamer;
+        size_t streamSlot;
+
+        void UploadImage(const unsigned char* _data, GLenum _format, GLenum _internalFormat);
+
+        friend class TextureStreamer;
 };
 
 #endif
\ No newline at end of file
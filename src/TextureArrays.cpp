@@ -0,0 +1,236 @@
+#include <iostream>
+#include <algorithm>
+#include <cmath>
+
+#include "TextureArrays.h"
+#include "GLState.h"
+#include "TextureStreamer.h"
+#include "Texture.h"
+#include "ThreadPool.h"
+#include "GpuMemory.h"
+#include "UploadManager.h"
+
+namespace {
+    // Smaller images are upsampled, larger ones are downsampled, the biggest tier bounds each layer to 5.3 MB
+    const GLuint MIN_TIER_SIZE = 64;
+    const GLuint MAX_TIER_SIZE = 1024;
+
+    // Stands in for an image that failed to decode so the slot stays valid, white keeps the material colour
+    const unsigned char WHITE[4] = { 255, 255, 255, 255 };
+}
+
+TextureArrays::TextureArrays(GLuint _textureUnit, TextureStreamer& _streamer) : textureUnit(_textureUnit), streamer(&_streamer) {  }
+
+TextureArrays::~TextureArrays() {
+    for ( auto& array : arrays ) {
+        streamer->Refund(GpuMemory::CalcTextureBytes(GL_RGBA8, array.size, array.size, array.capacity, array.levels));
+        GpuMemory::Get().ReleaseTexture(array.texture);
+        GLState::Get().DeleteTextures(1, &array.texture);
+    }
+}
+
+std::vector<TextureSlot> TextureArrays::Load(const std::vector<std::string>& _filePaths) {
+    std::vector<size_t> pending = FindPending(_filePaths);
+    std::vector<MipChain> chains(_filePaths.size());
+
+    // Decoding, resampling and the mip chains run on the pool, only the uploads need the GL thread
+    ThreadPool::Get().ParallelFor(pending.size(), 1, [&](size_t, size_t _begin, size_t _end) {
+        for ( size_t i = _begin; i < _end; i++ ) {
+            Decode(_filePaths[pending[i]], chains[pending[i]]);
+        }
+    });
+
+    return Insert(_filePaths, chains);
+}
+
+std::vector<TextureSlot> TextureArrays::Insert(const std::vector<std::string>& _filePaths, const std::vector<MipChain>& _chains) {
+    // Only the first occurrence of a file not loaded yet needs its chain, the others may be left empty
+    std::vector<size_t> pending = FindPending(_filePaths);
+
+    // Sized for the whole batch up front, so loading a model reallocates each array at most once
+    std::vector<GLuint> added;
+
+    for ( size_t p : pending ) {
+        GLuint index = FindArray(_chains[p].width);
+
+        added.resize(arrays.size());
+        added[index]++;
+    }
+
+    for ( size_t i = 0; i < added.size(); i++ ) {
+        Reserve(arrays[i], arrays[i].layers + added[i]);
+    }
+
+    uint64_t ticket = 0;
+
+    for ( size_t p : pending ) {
+        const MipChain& chain = _chains[p];
+        GLuint index = FindArray(chain.width);
+        Array& array = arrays[index];
+
+        GLState::Get().BindTexture(GL_TEXTURE_2D_ARRAY, array.texture);
+
+        // One layer of every level, the array's storage already covers it
+        ticket = std::max(ticket, TextureStreamer::CopyMipChain(chain, array.texture, GL_TEXTURE_2D_ARRAY, array.layers));
+
+        GLState::Get().BindTexture(GL_TEXTURE_2D_ARRAY, 0);
+
+        loaded[_filePaths[p]] = { index, array.layers };
+        array.layers++;
+    }
+
+    // Out before returning, the next Reserve may copy these layers into a bigger array and draws sample them right away
+    UploadManager::Get().Flush(ticket);
+
+    std::vector<TextureSlot> slots(_filePaths.size());
+
+    for ( size_t i = 0; i < _filePaths.size(); i++ ) {
+        slots[i] = loaded[_filePaths[i]];
+    }
+
+    return slots;
+}
+
+void TextureArrays::Bind(GLuint _array) const {
+    GLState::Get().BindTexture(textureUnit, GL_TEXTURE_2D_ARRAY, arrays[_array].texture);
+}
+
+GLuint TextureArrays::GetTextureUnit() const { return textureUnit; }
+
+size_t TextureArrays::GetArrayCount() const { return arrays.size(); }
+
+GLuint TextureArrays::GetLayerCount(GLuint _array) const { return arrays[_array].layers; }
+
+void TextureArrays::Decode(const std::string& _filePath, MipChain& _chain) {
+    int width = 0, height = 0, channels = 0;
+    unsigned char* data = Texture::ReadImage(_filePath, width, height, channels);
+
+    std::vector<unsigned char> rgba;
+    GLuint size = data ? CalcTierSize(width, height) : MIN_TIER_SIZE;
+
+    if ( data ) {
+        Resample(data, width, height, channels, size, rgba);
+        Texture::FreeImage(data);
+    } else {
+        Resample(WHITE, 1, 1, 4, size, rgba);
+    }
+
+    TextureStreamer::BuildMipChain(rgba.data(), size, size, 4, 0, _chain);
+    TextureStreamer::StageMipChain(_chain);
+}
+
+GLuint TextureArrays::CalcTierSize(int _width, int _height) {
+    // Nearest power of two to the larger side in log terms, so 1250x836 lands on 1024 and 510x510 on 512
+    int largest = std::max(std::max(_width, _height), 1);
+    GLuint size = 1u << static_cast<GLuint>(std::lround(std::log2(static_cast<double>(largest))));
+
+    return std::min(std::max(size, MIN_TIER_SIZE), MAX_TIER_SIZE);
+}
+
+void TextureArrays::Resample(const unsigned char* _data, int _width, int _height, int _channels, GLuint _size,
+        std::vector<unsigned char>& _rgba) {
+    _rgba.resize(static_cast<size_t>(_size) * _size * 4);
+
+    // Bilinear at the target texel centres, wrapping like the GL_REPEAT the materials are sampled with. Shrinking by
+    // more than two skips source texels, the tiers keep that to the odd few oversized images.
+    for ( GLuint y = 0; y < _size; y++ ) {
+        float sourceY = ( y + 0.5f ) * _height / _size - 0.5f;
+        int y0 = static_cast<int>(std::floor(sourceY));
+        float fy = sourceY - y0;
+
+        for ( GLuint x = 0; x < _size; x++ ) {
+            float sourceX = ( x + 0.5f ) * _width / _size - 0.5f;
+            int x0 = static_cast<int>(std::floor(sourceX));
+            float fx = sourceX - x0;
+
+            const unsigned char* texels[4];
+
+            for ( int corner = 0; corner < 4; corner++ ) {
+                int sx = ( ( x0 + ( corner & 1 ) ) % _width + _width ) % _width;
+                int sy = ( ( y0 + ( corner >> 1 ) ) % _height + _height ) % _height;
+                texels[corner] = _data + ( static_cast<size_t>(sy) * _width + sx ) * _channels;
+            }
+
+            unsigned char* target = &_rgba[( static_cast<size_t>(y) * _size + x ) * 4];
+
+            for ( int c = 0; c < 4; c++ ) {
+                // Grey fills all three colour channels, missing alpha is opaque
+                int source = _channels < 3 ? ( c < 3 ? 0 : 1 ) : c;
+
+                if ( source >= _channels ) {
+                    target[c] = 255;
+                    continue;
+                }
+
+                float top = texels[0][source] + ( texels[1][source] - texels[0][source] ) * fx;
+                float bottom = texels[2][source] + ( texels[3][source] - texels[2][source] ) * fx;
+
+                target[c] = static_cast<unsigned char>(top + ( bottom - top ) * fy + 0.5f);
+            }
+        }
+    }
+}
+
+std::vector<size_t> TextureArrays::FindPending(const std::vector<std::string>& _filePaths) const {
+    std::vector<size_t> pending;
+
+    for ( size_t i = 0; i < _filePaths.size(); i++ ) {
+        if ( loaded.count(_filePaths[i]) ) continue;
+
+        if ( std::find_if(pending.begin(), pending.end(), [&](size_t _p) { return _filePaths[_p] == _filePaths[i]; }) == pending.end() ) {
+            pending.push_back(i);
+        }
+    }
+
+    return pending;
+}
+
+GLuint TextureArrays::FindArray(GLuint _size) {
+    for ( GLuint i = 0; i < arrays.size(); i++ ) {
+        if ( arrays[i].size == _size ) return i;
+    }
+
+    arrays.push_back({ 0, _size, GpuMemory::CalcLevelCount(_size, _size), 0, 0 });
+
+    return arrays.size() - 1;
+}
+
+void TextureArrays::Reserve(Array& _array, GLuint _layers) {
+    if ( _layers <= _array.capacity ) return;
+
+    // Exact on the first load, doubling after that so arrays shared by many models don't reallocate every time
+    GLuint capacity = _array.capacity ? std::max(_array.capacity * 2, _layers) : _layers;
+
+    GLuint texture = 0;
+
+    glGenTextures(1, &texture);
+    GLState::Get().BindTexture(GL_TEXTURE_2D_ARRAY, texture);
+    glTexStorage3D(GL_TEXTURE_2D_ARRAY, _array.levels, GL_RGBA8, _array.size, _array.size, capacity);
+
+    glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_WRAP_S, GL_REPEAT);
+    glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_WRAP_T, GL_REPEAT);
+    glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
+    glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+
+    GLState::Get().BindTexture(GL_TEXTURE_2D_ARRAY, 0);
+
+    size_t bytes = GpuMemory::CalcTextureBytes(GL_RGBA8, _array.size, _array.size, capacity, _array.levels);
+    GpuMemory::Get().TrackTexture(texture, bytes, GpuMemoryCategory::Textures, "TextureArrays");
+    streamer->Charge(bytes);
+
+    if ( _array.texture ) {
+        // glCopyImageSubData — the layers already uploaded move over on the GPU, every level at once
+        for ( GLuint level = 0; level < _array.levels; level++ ) {
+            GLuint size = std::max(1u, _array.size >> level);
+            glCopyImageSubData(_array.texture, GL_TEXTURE_2D_ARRAY, level, 0, 0, 0, texture, GL_TEXTURE_2D_ARRAY, level, 0, 0, 0,
+                    size, size, _array.layers);
+        }
+
+        streamer->Refund(GpuMemory::CalcTextureBytes(GL_RGBA8, _array.size, _array.size, _array.capacity, _array.levels));
+        GpuMemory::Get().ReleaseTexture(_array.texture);
+        GLState::Get().DeleteTextures(1, &_array.texture);
+    }
+
+    _array.texture = texture;
+    _array.capacity = capacity;
+}
\ No newline at end of file
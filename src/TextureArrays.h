@@ -0,0 +1,54 @@
+#ifndef TEXTURE_ARRAYS_H
+#define TEXTURE_ARRAYS_H
+
+#include <vector>
+#include <string>
+#include <unordered_map>
+
+#include <GL/glew.h>
+
+#include "TextureStreamer.h"
+
+struct TextureSlot {
+    GLuint array;   // which of the manager's arrays, one per size tier
+    GLuint layer;
+};
+
+// Material textures packed into GL_TEXTURE_2D_ARRAYs, one per power-of-two size tier, so a model binds one array
+// per tier instead of one texture per sub-mesh and draws its sub-meshes together. Images of other sizes are
+// resampled to the nearest tier and everything is stored as mipmapped RGBA8. A full array grows by reallocating
+// and copying the old layers over on the GPU. Arrays are always fully resident, their storage is charged to the
+// streamer's budget so the streamed textures give way instead of the total running over it.
+class TextureArrays {
+    public:
+        TextureArrays(GLuint _textureUnit, TextureStreamer& _streamer);
+        ~TextureArrays();
+        std::vector<TextureSlot> Load(const std::vector<std::string>& _filePaths);
+        std::vector<TextureSlot> Insert(const std::vector<std::string>& _filePaths, const std::vector<MipChain>& _chains);
+        void Bind(GLuint _array) const;
+        GLuint GetTextureUnit() const;
+        size_t GetArrayCount() const;
+        GLuint GetLayerCount(GLuint _array) const;
+        static void Decode(const std::string& _filePath, MipChain& _chain);
+        static GLuint CalcTierSize(int _width, int _height);
+        static void Resample(const unsigned char* _data, int _width, int _height, int _channels, GLuint _size,
+                std::vector<unsigned char>& _rgba);
+
+    private:
+        struct Array {
+            GLuint texture;
+            GLuint size, levels;
+            GLuint layers, capacity;
+        };
+
+        std::vector<Array> arrays;
+        std::unordered_map<std::string, TextureSlot> loaded;
+        GLuint textureUnit;
+        TextureStreamer* streamer;
+
+        std::vector<size_t> FindPending(const std::vector<std::string>& _filePaths) const;
+        GLuint FindArray(GLuint _size);
+        void Reserve(Array& _array, GLuint _layers);
+};
+
+#endif
\ No newline at end of file
@@ -0,0 +1,99 @@
+#include <algorithm>
+
+#include "TexturePool.h"
+#include "GLState.h"
+#include "GpuMemory.h"
+
+namespace {
+    // About half a second at 60 Hz, long enough that toggling a light doesn't reallocate its shadow map
+    const unsigned int FRAMES_BEFORE_RELEASE = 30;
+}
+
+bool FrameTextureDesc::operator==(const FrameTextureDesc& _other) const {
+    return target == _other.target && internalFormat == _other.internalFormat && width == _other.width && height == _other.height
+        && layers == _other.layers;
+}
+
+TexturePool::TexturePool() = default;
+
+TexturePool::~TexturePool() {
+    for ( auto& entry : entries ) {
+        GpuMemory::Get().ReleaseTexture(entry.texture);
+        GLState::Get().DeleteTextures(1, &entry.texture);
+    }
+}
+
+GLuint TexturePool::Acquire(const FrameTextureDesc& _desc) {
+    for ( auto& entry : entries ) {
+        if ( !entry.inUse && entry.desc == _desc ) {
+            entry.inUse = true;
+            entry.idleFrames = 0;
+            return entry.texture;
+        }
+    }
+
+    entries.push_back({ _desc, CreateTexture(_desc), true, 0 });
+
+    return entries.back().texture;
+}
+
+void TexturePool::Release(GLuint _texture) {
+    for ( auto& entry : entries ) {
+        if ( entry.texture == _texture ) {
+            entry.inUse = false;
+            return;
+        }
+    }
+}
+
+void TexturePool::EndFrame() {
+    for ( auto& entry : entries ) {
+        if ( !entry.inUse && ++entry.idleFrames > FRAMES_BEFORE_RELEASE ) {
+            GpuMemory::Get().ReleaseTexture(entry.texture);
+            GLState::Get().DeleteTextures(1, &entry.texture);
+            entry.texture = 0;
+        }
+    }
+
+    entries.erase(std::remove_if(entries.begin(), entries.end(), [](const Entry& _entry) { return _entry.texture == 0; }), entries.end());
+}
+
+size_t TexturePool::GetAllocatedBytes() const {
+    size_t bytes = 0;
+
+    for ( const auto& entry : entries ) {
+        bytes += CalcSize(entry.desc);
+    }
+
+    return bytes;
+}
+
+size_t TexturePool::CalcSize(const FrameTextureDesc& _desc) {
+    size_t faces = _desc.target == GL_TEXTURE_CUBE_MAP ? 6 : _desc.layers;
+
+    return GpuMemory::CalcTextureBytes(_desc.internalFormat, _desc.width, _desc.height, faces, 1);
+}
+
+GLuint TexturePool::CreateTexture(const FrameTextureDesc& _desc) {
+    GLuint texture = 0;
+
+    glGenTextures(1, &texture);
+    GLState::Get().BindTexture(_desc.target, texture);
+
+    // glTexStorage2D/3D — simultaneously specify storage for all levels of a texture, immutable afterwards
+    if ( _desc.target == GL_TEXTURE_2D_ARRAY ) {
+        glTexStorage3D(_desc.target, 1, _desc.internalFormat, _desc.width, _desc.height, _desc.layers);
+    } else {
+        glTexStorage2D(_desc.target, 1, _desc.internalFormat, _desc.width, _desc.height);
+    }
+
+    GLState::Get().BindTexture(_desc.target, 0);
+
+    bool depth = _desc.internalFormat == GL_DEPTH_COMPONENT16 || _desc.internalFormat == GL_DEPTH_COMPONENT24
+        || _desc.internalFormat == GL_DEPTH_COMPONENT32F;
+
+    GpuMemory::Get().TrackTexture(texture, CalcSize(_desc), depth ? GpuMemoryCategory::ShadowMaps : GpuMemoryCategory::RenderTargets,
+        "Frame graph");
+
+    return texture;
+}
\ No newline at end of file
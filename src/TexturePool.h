@@ -0,0 +1,43 @@
+#ifndef TEXTURE_POOL_H
+#define TEXTURE_POOL_H
+
+#include <vector>
+
+#include <GL/glew.h>
+
+struct FrameTextureDesc {
+    GLenum target;          // GL_TEXTURE_2D, GL_TEXTURE_2D_ARRAY or GL_TEXTURE_CUBE_MAP
+    GLenum internalFormat;  // sized format, storage is immutable
+    GLuint width, height;
+    GLuint layers;          // array layers, 1 for everything else
+
+    bool operator==(const FrameTextureDesc& _other) const;
+};
+
+// Render targets handed out per frame. A released texture goes back on the free list and is given to the next
+// request with the same description, textures nobody asked for in a while are deleted so the pool shrinks back
+// to what the frame actually needs.
+class TexturePool {
+    public:
+        TexturePool();
+        ~TexturePool();
+        GLuint Acquire(const FrameTextureDesc& _desc);
+        void Release(GLuint _texture);
+        void EndFrame();
+        size_t GetAllocatedBytes() const;
+        static size_t CalcSize(const FrameTextureDesc& _desc);
+
+    private:
+        struct Entry {
+            FrameTextureDesc desc;
+            GLuint texture;
+            bool inUse;
+            unsigned int idleFrames;
+        };
+
+        std::vector<Entry> entries;
+
+        static GLuint CreateTexture(const FrameTextureDesc& _desc);
+};
+
+#endif
\ No newline at end of file
@@ -0,0 +1,454 @@
+#include <cmath>
+#include <cstring>
+#include <atomic>
+#include <algorithm>
+#include <limits>
+
+#include "TextureStreamer.h"
+#include "GLState.h"
+#include "Texture.h"
+#include "ThreadPool.h"
+#include "GpuMemory.h"
+
+namespace {
+    // Levels this small go up with the first decode and are never evicted
+    const GLuint TAIL_SIZE = 64;
+
+    // Spread uploads over frames so a burst of finished decodes doesn't hitch one of them
+    const size_t MAX_UPLOADS_PER_FRAME = 2;
+    const size_t MAX_DECODES_IN_FLIGHT = 4;
+
+    const GLuint NOT_RESIDENT = std::numeric_limits<GLuint>::max();
+
+    GLuint LevelSize(GLuint _size, GLuint _level) { return std::max(1u, _size >> _level); }
+}
+
+// Shared with the worker decoding it, so removing a texture mid-decode only drops the result
+struct TextureStreamer::Decode {
+    std::string filePath;
+    GLuint firstLevel;
+    MipChain chain;
+    bool ok;
+    std::atomic<bool> done;
+
+    Decode(std::string _filePath, GLuint _firstLevel) : filePath(std::move(_filePath)), firstLevel(_firstLevel), chain(), ok(false),
+            done(false) {  }
+};
+
+TextureStreamer::TextureStreamer(size_t _budgetBytes) : placeholder(0), budget(_budgetBytes), residentBytes(0), chargedBytes(0), frame(0), inFlight(0) {
+    // Bound until a texture's tail arrives, plain white so untextured surfaces keep their material colour
+    const unsigned char white[4] = { 255, 255, 255, 255 };
+
+    glGenTextures(1, &placeholder);
+    GLState::Get().BindTexture(GL_TEXTURE_2D, placeholder);
+    glTexStorage2D(GL_TEXTURE_2D, 1, GL_RGBA8, 1, 1);
+    glTexSubImage2D(GL_TEXTURE_2D, 0, 0, 0, 1, 1, GL_RGBA, GL_UNSIGNED_BYTE, white);
+    GLState::Get().BindTexture(GL_TEXTURE_2D, 0);
+
+    GpuMemory::Get().TrackTexture(placeholder, 4, GpuMemoryCategory::Textures, "TextureStreamer");
+}
+
+TextureStreamer::~TextureStreamer() {
+    // Textures outliving the streamer keep whatever they have resident and delete it themselves
+    for ( auto& entry : entries ) {
+        if ( entry.texture->textureID == placeholder ) entry.texture->textureID = 0;
+
+        entry.texture->streamer = nullptr;
+    }
+
+    if ( placeholder ) {
+        GpuMemory::Get().ReleaseTexture(placeholder);
+        GLState::Get().DeleteTextures(1, &placeholder);
+    }
+}
+
+void TextureStreamer::Add(Texture* _texture) {
+    _texture->streamer = this;
+    _texture->streamSlot = entries.size();
+    _texture->textureID = placeholder;
+
+    entries.push_back({ _texture, 0, 0, 0, NOT_RESIDENT, 0.0f, frame, nullptr, false });
+
+    // The size isn't known before the decode, asking for nothing finer than the tail gets just the tail
+    Submit(entries.back(), NOT_RESIDENT);
+}
+
+void TextureStreamer::Remove(Texture* _texture) {
+    size_t slot = _texture->streamSlot;
+    Entry& entry = entries[slot];
+
+    if ( entry.pending ) inFlight--;
+
+    residentBytes -= CalcBytes(entry.width, entry.height, entry.residentLevel, entry.levels);
+
+    if ( _texture->textureID != placeholder ) {
+        GpuMemory::Get().ReleaseTexture(_texture->textureID);
+        GLState::Get().DeleteTextures(1, &_texture->textureID);
+    }
+
+    _texture->textureID = 0;
+    _texture->streamer = nullptr;
+
+    if ( slot + 1 != entries.size() ) {
+        entries[slot] = std::move(entries.back());
+        entries[slot].texture->streamSlot = slot;
+    }
+
+    entries.pop_back();
+}
+
+void TextureStreamer::Request(const Texture* _texture, GLfloat _screenSize) {
+    if ( _texture->streamer != this ) return;
+
+    Entry& entry = entries[_texture->streamSlot];
+    entry.screenSize = std::max(entry.screenSize, _screenSize);
+}
+
+void TextureStreamer::Update() {
+    frame++;
+
+    size_t uploads = 0;
+
+    for ( auto& entry : entries ) {
+        if ( !entry.pending || uploads == MAX_UPLOADS_PER_FRAME || !entry.pending->done.load(std::memory_order_acquire) ) continue;
+
+        std::shared_ptr<Decode> decode = std::move(entry.pending);
+        inFlight--;
+
+        if ( !decode->ok ) {
+            entry.failed = true;
+            continue;
+        }
+
+        entry.width = decode->chain.width;
+        entry.height = decode->chain.height;
+        entry.levels = decode->chain.levels;
+
+        // Evicted or already finer while the decode ran
+        if ( decode->chain.firstLevel >= entry.residentLevel ) continue;
+
+        Upload(entry, decode->chain);
+        uploads++;
+    }
+
+    // Largest on-screen textures first, each only as fine as the budget allows once stale textures are evicted
+    size_t available = budget > chargedBytes ? budget - chargedBytes : 0;
+
+    candidates.clear();
+
+    for ( size_t i = 0; i < entries.size(); i++ ) {
+        Entry& entry = entries[i];
+
+        if ( entry.screenSize > 0.0f ) entry.lastUsed = frame;
+
+        if ( !entry.failed && !entry.pending && entry.levels && CalcWantedLevel(entry) < entry.residentLevel ) candidates.push_back(i);
+    }
+
+    std::sort(candidates.begin(), candidates.end(), [this](size_t _a, size_t _b) {
+        return entries[_a].screenSize > entries[_b].screenSize;
+    });
+
+    size_t reserved = 0;
+
+    for ( size_t index : candidates ) {
+        if ( inFlight >= MAX_DECODES_IN_FLIGHT ) break;
+
+        Entry& entry = entries[index];
+        GLuint wanted = CalcWantedLevel(entry);
+        size_t current = CalcBytes(entry.width, entry.height, entry.residentLevel, entry.levels);
+        size_t extra = 0;
+
+        for ( ; wanted < entry.residentLevel; wanted++ ) {
+            extra = CalcBytes(entry.width, entry.height, wanted, entry.levels) - current;
+
+            if ( residentBytes + reserved + extra <= available ) break;
+
+            if ( available >= reserved + extra && EvictUntil(available - reserved - extra, frame) ) break;
+        }
+
+        if ( wanted >= entry.residentLevel ) continue;
+
+        Submit(entry, wanted);
+        reserved += extra;
+    }
+
+    // A lowered budget or a new charge takes from visible textures too once the stale ones are down to their tails
+    if ( residentBytes > available && !EvictUntil(available, frame) ) EvictUntil(available, frame + 1);
+
+    for ( auto& entry : entries ) {
+        entry.screenSize = 0.0f;
+    }
+}
+
+void TextureStreamer::SetBudget(size_t _budgetBytes) { budget = _budgetBytes; }
+
+size_t TextureStreamer::GetBudget() const { return budget; }
+
+size_t TextureStreamer::GetResidentBytes() const { return residentBytes; }
+
+void TextureStreamer::Charge(size_t _bytes) { chargedBytes += _bytes; }
+
+void TextureStreamer::Refund(size_t _bytes) { chargedBytes -= std::min(_bytes, chargedBytes); }
+
+size_t TextureStreamer::GetChargedBytes() const { return chargedBytes; }
+
+size_t TextureStreamer::GetPendingCount() const { return inFlight; }
+
+void TextureStreamer::Submit(Entry& _entry, GLuint _firstLevel) {
+    auto decode = std::make_shared<Decode>(_entry.texture->filePath, _firstLevel);
+
+    _entry.pending = decode;
+    inFlight++;
+
+    auto job = [decode]() {
+        int width = 0, height = 0, channels = 0;
+        unsigned char* data = Texture::ReadImage(decode->filePath, width, height, channels);
+
+        if ( data ) {
+            decode->ok = BuildMipChain(data, width, height, channels, decode->firstLevel, decode->chain);
+            Texture::FreeImage(data);
+        }
+
+        if ( decode->ok ) StageMipChain(decode->chain);
+
+        decode->done.store(true, std::memory_order_release);
+    };
+
+    // Without workers nobody would ever pick the job up
+    if ( ThreadPool::Get().GetThreadCount() > 1 ) {
+        ThreadPool::Get().Submit(job);
+    } else {
+        job();
+    }
+}
+
+void TextureStreamer::Upload(Entry& _entry, const MipChain& _chain) {
+    GLuint first = _chain.firstLevel;
+    GLuint texture = 0;
+
+    glGenTextures(1, &texture);
+    GLState::Get().BindTexture(GL_TEXTURE_2D, texture);
+
+    // Immutable storage for just the resident levels, the texture's level 0 is the chain's first level
+    glTexStorage2D(GL_TEXTURE_2D, _chain.levels - first, GL_RGBA8, LevelSize(_chain.width, first), LevelSize(_chain.height, first));
+
+    // Out right away, the texture is swapped in below and the streamer already spreads uploads over frames
+    UploadManager::Get().Flush(CopyMipChain(_chain, texture, GL_TEXTURE_2D, 0));
+
+    GLState::Get().BindTexture(GL_TEXTURE_2D, texture);
+    SetSamplerState();
+
+    GLState::Get().BindTexture(GL_TEXTURE_2D, 0);
+
+    if ( _entry.texture->textureID != placeholder ) {
+        GpuMemory::Get().ReleaseTexture(_entry.texture->textureID);
+        GLState::Get().DeleteTextures(1, &_entry.texture->textureID);
+    }
+
+    GpuMemory::Get().TrackTexture(texture, CalcBytes(_chain.width, _chain.height, first, _chain.levels), GpuMemoryCategory::Textures,
+        _entry.texture->filePath);
+
+    residentBytes -= CalcBytes(_entry.width, _entry.height, _entry.residentLevel, _entry.levels);
+    residentBytes += CalcBytes(_entry.width, _entry.height, first, _entry.levels);
+
+    _entry.texture->textureID = texture;
+    _entry.residentLevel = first;
+}
+
+void TextureStreamer::Downgrade(Entry& _entry, GLuint _level) {
+    GLuint texture = 0;
+
+    glGenTextures(1, &texture);
+    GLState::Get().BindTexture(GL_TEXTURE_2D, texture);
+    glTexStorage2D(GL_TEXTURE_2D, _entry.levels - _level, GL_RGBA8, LevelSize(_entry.width, _level), LevelSize(_entry.height, _level));
+    SetSamplerState();
+    GLState::Get().BindTexture(GL_TEXTURE_2D, 0);
+
+    // glCopyImageSubData — copy between images on the GPU, the coarser levels survive without going back to the file
+    for ( GLuint level = _level; level < _entry.levels; level++ ) {
+        glCopyImageSubData(_entry.texture->textureID, GL_TEXTURE_2D, level - _entry.residentLevel, 0, 0, 0,
+                texture, GL_TEXTURE_2D, level - _level, 0, 0, 0,
+                LevelSize(_entry.width, level), LevelSize(_entry.height, level), 1);
+    }
+
+    GpuMemory::Get().ReleaseTexture(_entry.texture->textureID);
+    GLState::Get().DeleteTextures(1, &_entry.texture->textureID);
+
+    GpuMemory::Get().TrackTexture(texture, CalcBytes(_entry.width, _entry.height, _level, _entry.levels), GpuMemoryCategory::Textures,
+        _entry.texture->filePath);
+
+    residentBytes -= CalcBytes(_entry.width, _entry.height, _entry.residentLevel, _entry.levels);
+    residentBytes += CalcBytes(_entry.width, _entry.height, _level, _entry.levels);
+
+    _entry.texture->textureID = texture;
+    _entry.residentLevel = _level;
+}
+
+bool TextureStreamer::EvictUntil(size_t _target, uint64_t _protectedFrom) {
+    while ( residentBytes > _target ) {
+        Entry* oldest = nullptr;
+
+        for ( auto& entry : entries ) {
+            if ( entry.lastUsed >= _protectedFrom || entry.residentLevel >= CalcTailLevel(entry.width, entry.height, entry.levels) ) continue;
+
+            if ( !oldest || entry.lastUsed < oldest->lastUsed ) oldest = &entry;
+        }
+
+        if ( !oldest ) return false;
+
+        // One level at a time, the least recently used texture goes down to its tail before anything else is touched
+        Downgrade(*oldest, oldest->residentLevel + 1);
+    }
+
+    return true;
+}
+
+GLuint TextureStreamer::CalcWantedLevel(const Entry& _entry) const {
+    GLuint tail = CalcTailLevel(_entry.width, _entry.height, _entry.levels);
+
+    if ( _entry.screenSize <= 0.0f ) return tail;
+
+    // One texel per pixel across the mesh's on-screen size
+    float ratio = std::max(_entry.width, _entry.height) / _entry.screenSize;
+    GLuint level = ratio <= 1.0f ? 0 : static_cast<GLuint>(std::log2(ratio));
+
+    return std::min(level, tail);
+}
+
+GLuint TextureStreamer::CalcTailLevel(GLuint _width, GLuint _height, GLuint _levels) {
+    GLuint level = 0;
+
+    while ( level + 1 < _levels && std::max(LevelSize(_width, level), LevelSize(_height, level)) > TAIL_SIZE ) level++;
+
+    return level;
+}
+
+size_t TextureStreamer::CalcBytes(GLuint _width, GLuint _height, GLuint _firstLevel, GLuint _levels) {
+    size_t bytes = 0;
+
+    for ( GLuint level = _firstLevel; level < _levels; level++ ) {
+        bytes += static_cast<size_t>(LevelSize(_width, level)) * LevelSize(_height, level) * 4;
+    }
+
+    return bytes;
+}
+
+void TextureStreamer::StageMipChain(MipChain& _chain) {
+    size_t bytes = 0;
+
+    for ( const auto& image : _chain.images ) {
+        bytes += image.size();
+    }
+
+    _chain.staging = UploadManager::Get().Allocate(bytes);
+
+    // No room in the arena, the levels stay in client memory
+    if ( !_chain.staging.IsValid() ) return;
+
+    size_t offset = 0;
+
+    for ( const auto& image : _chain.images ) {
+        std::memcpy(_chain.staging.GetData() + offset, image.data(), image.size());
+        offset += image.size();
+    }
+
+    _chain.images.clear();
+    _chain.images.shrink_to_fit();
+}
+
+uint64_t TextureStreamer::CopyMipChain(const MipChain& _chain, GLuint _texture, GLenum _target, GLint _layer) {
+    uint64_t ticket = 0;
+    size_t offset = 0;
+
+    // The chain's first level goes to the texture's level 0. Unstaged levels go straight from client memory, the
+    // texture has to be bound to _target for those.
+    for ( GLuint level = _chain.firstLevel; level < _chain.levels; level++ ) {
+        GLuint index = level - _chain.firstLevel;
+        GLsizei width = LevelSize(_chain.width, level);
+        GLsizei height = LevelSize(_chain.height, level);
+
+        if ( _chain.staging.IsValid() ) {
+            ticket = UploadManager::Get().CopyToTexture(_chain.staging, offset, _texture, _target, index, _layer, width, height, GL_RGBA);
+            offset += static_cast<size_t>(width) * height * 4;
+        } else if ( _target == GL_TEXTURE_2D_ARRAY ) {
+            glTexSubImage3D(GL_TEXTURE_2D_ARRAY, index, 0, 0, _layer, width, height, 1, GL_RGBA, GL_UNSIGNED_BYTE, _chain.images[index].data());
+        } else {
+            glTexSubImage2D(_target, index, 0, 0, width, height, GL_RGBA, GL_UNSIGNED_BYTE, _chain.images[index].data());
+        }
+    }
+
+    return ticket;
+}
+
+bool TextureStreamer::BuildMipChain(const unsigned char* _data, int _width, int _height, int _channels, GLuint _firstLevel,
+        MipChain& _chain) {
+    if ( !_data || _width <= 0 || _height <= 0 || _channels < 1 || _channels > 4 ) return false;
+
+    GLuint width = _width, height = _height;
+    GLuint levels = 1;
+
+    while ( ( std::max(width, height) >> levels ) > 0 ) levels++;
+
+    _chain.width = width;
+    _chain.height = height;
+    _chain.levels = levels;
+    _chain.firstLevel = std::min(_firstLevel, CalcTailLevel(width, height, levels));
+    _chain.images.clear();
+
+    // Level 0 expanded to RGBA: grey fills all three colour channels, missing alpha is opaque
+    std::vector<unsigned char> current(static_cast<size_t>(width) * height * 4);
+
+    for ( size_t i = 0, count = static_cast<size_t>(width) * height; i < count; i++ ) {
+        const unsigned char* source = _data + i * _channels;
+        unsigned char* target = &current[i * 4];
+
+        if ( _channels < 3 ) {
+            target[0] = target[1] = target[2] = source[0];
+            target[3] = _channels == 2 ? source[1] : 255;
+        } else {
+            target[0] = source[0]; target[1] = source[1]; target[2] = source[2];
+            target[3] = _channels == 4 ? source[3] : 255;
+        }
+    }
+
+    for ( GLuint level = 0; level < levels; level++ ) {
+        GLuint w = LevelSize(width, level), h = LevelSize(height, level);
+        GLuint nextW = LevelSize(width, level + 1), nextH = LevelSize(height, level + 1);
+
+        std::vector<unsigned char> next;
+
+        // 2x2 box filter, an odd last row or column is folded into its neighbour
+        if ( level + 1 < levels ) {
+            next.resize(static_cast<size_t>(nextW) * nextH * 4);
+
+            for ( GLuint y = 0; y < nextH; y++ ) {
+                const unsigned char* row0 = &current[static_cast<size_t>(std::min(y * 2, h - 1)) * w * 4];
+                const unsigned char* row1 = &current[static_cast<size_t>(std::min(y * 2 + 1, h - 1)) * w * 4];
+
+                for ( GLuint x = 0; x < nextW; x++ ) {
+                    GLuint x0 = std::min(x * 2, w - 1) * 4, x1 = std::min(x * 2 + 1, w - 1) * 4;
+                    unsigned char* target = &next[( static_cast<size_t>(y) * nextW + x ) * 4];
+
+                    for ( int c = 0; c < 4; c++ ) {
+                        target[c] = static_cast<unsigned char>(( row0[x0 + c] + row0[x1 + c] + row1[x0 + c] + row1[x1 + c] + 2 ) >> 2);
+                    }
+                }
+            }
+        }
+
+        if ( level >= _chain.firstLevel ) _chain.images.push_back(std::move(current));
+
+        current = std::move(next);
+    }
+
+    return true;
+}
+
+void TextureStreamer::SetSamplerState() {
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_REPEAT);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_REPEAT);
+
+    // Trilinear, the levels are there to be used
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+}
\ No newline at end of file
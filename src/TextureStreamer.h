@@ -0,0 +1,80 @@
+#ifndef TEXTURE_STREAMER_H
+#define TEXTURE_STREAMER_H
+
+#include <vector>
+#include <string>
+#include <memory>
+#include <cstdint>
+
+#include <GL/glew.h>
+
+#include "UploadManager.h"
+
+class Texture;
+
+// Mip levels of one image from some first level down to 1x1, always RGBA8
+struct MipChain {
+    GLuint width, height;       // of level 0
+    GLuint levels;              // of the full chain
+    GLuint firstLevel;
+    std::vector<std::vector<unsigned char>> images;
+    StagingRegion staging;      // once staged, all levels back to back and images is empty
+};
+
+// Keeps registered textures resident only down to the mip their on-screen size needs. Images are decoded and
+// mipmapped on the thread pool, the small tail goes up as soon as it's ready and finer levels follow as meshes
+// using the texture get bigger on screen, largest first. Past the budget the least recently used textures
+// drop their finest levels again. A texture's GL name changes whenever its residency does, so it's bound
+// through Texture::UseTexture every time. Memory that can't stream, like the material arrays, is charged
+// against the same budget and leaves the streamed textures only what remains.
+class TextureStreamer {
+    public:
+        explicit TextureStreamer(size_t _budgetBytes);
+        ~TextureStreamer();
+        void Add(Texture* _texture);
+        void Remove(Texture* _texture);
+        void Request(const Texture* _texture, GLfloat _screenSize);
+        void Update();
+        void SetBudget(size_t _budgetBytes);
+        size_t GetBudget() const;
+        size_t GetResidentBytes() const;
+        void Charge(size_t _bytes);
+        void Refund(size_t _bytes);
+        size_t GetChargedBytes() const;
+        size_t GetPendingCount() const;
+        static bool BuildMipChain(const unsigned char* _data, int _width, int _height, int _channels, GLuint _firstLevel,
+                MipChain& _chain);
+        static size_t CalcBytes(GLuint _width, GLuint _height, GLuint _firstLevel, GLuint _levels);
+        static void StageMipChain(MipChain& _chain);
+        static uint64_t CopyMipChain(const MipChain& _chain, GLuint _texture, GLenum _target, GLint _layer);
+
+    private:
+        struct Decode;
+
+        struct Entry {
+            Texture* texture;
+            GLuint width, height, levels;   // zero until the first decode lands
+            GLuint residentLevel;           // finest level on the GPU, NOT_RESIDENT (all bits set) while only the placeholder is bound
+            GLfloat screenSize;             // largest request since the last Update
+            uint64_t lastUsed;
+            std::shared_ptr<Decode> pending;
+            bool failed;
+        };
+
+        std::vector<Entry> entries;
+        std::vector<size_t> candidates;
+        GLuint placeholder;
+        size_t budget, residentBytes, chargedBytes;
+        uint64_t frame;
+        size_t inFlight;
+
+        void Submit(Entry& _entry, GLuint _firstLevel);
+        void Upload(Entry& _entry, const MipChain& _chain);
+        void Downgrade(Entry& _entry, GLuint _level);
+        bool EvictUntil(size_t _target, uint64_t _protectedFrom);
+        GLuint CalcWantedLevel(const Entry& _entry) const;
+        static GLuint CalcTailLevel(GLuint _width, GLuint _height, GLuint _levels);
+        static void SetSamplerState();
+};
+
+#endif
\ No newline at end of file
@@ -0,0 +1,198 @@
+#include <atomic>
+#include <algorithm>
+
+#include "ThreadPool.h"
+
+namespace {
+    const size_t INITIAL_JOB_CAPACITY = 64;
+}
+
+ThreadPool::ThreadPool(size_t _workers) : jobs(INITIAL_JOB_CAPACITY), firstJob(0), jobCount(0), stopping(false) {
+    for ( size_t i = 0; i < _workers; i++ ) {
+        workers.emplace_back(&ThreadPool::WorkerLoop, this);
+    }
+}
+
+ThreadPool::~ThreadPool() {
+    {
+        std::lock_guard<std::mutex> lock(jobsMutex);
+        stopping = true;
+    }
+
+    jobsCondition.notify_all();
+
+    for ( auto& worker : workers ) {
+        worker.join();
+    }
+}
+
+ThreadPool& ThreadPool::Get() {
+    // One worker per hardware thread, the thread calling ParallelFor takes a share of the work too. Never none, jobs
+    // handed to Submit for the background would wait forever on a single core.
+    static ThreadPool pool(std::max(2u, std::thread::hardware_concurrency()) - 1);
+    return pool;
+}
+
+size_t ThreadPool::GetThreadCount() const { return workers.size() + 1; }
+
+void ThreadPool::Submit(std::function<void()> _job) {
+    {
+        std::lock_guard<std::mutex> lock(jobsMutex);
+        PushJob(std::move(_job), nullptr);
+    }
+
+    jobsCondition.notify_one();
+}
+
+size_t ThreadPool::RangeCount(size_t _count, size_t _minRange) const {
+    if ( _count == 0 ) return 0;
+
+    size_t ranges = ( _count + _minRange - 1 ) / std::max<size_t>(_minRange, 1);
+
+    return std::min(ranges, GetThreadCount());
+}
+
+void ThreadPool::ParallelFor(size_t _count, size_t _minRange, const std::function<void(size_t, size_t, size_t)>& _function) {
+    size_t ranges = RangeCount(_count, _minRange);
+
+    if ( ranges == 0 ) return;
+
+    if ( ranges == 1 ) {
+        _function(0, 0, _count);
+        return;
+    }
+
+    struct Batch {
+        const std::function<void(size_t, size_t, size_t)>* function;
+        size_t count, ranges;
+        std::atomic<size_t> next;
+        size_t finished;            // helpers done, counted under doneMutex
+        std::mutex doneMutex;
+        std::condition_variable doneCondition;
+
+        size_t Begin(size_t _range) const { return count * _range / ranges; }
+
+        // Ranges are claimed one at a time by whoever gets there first, the caller or a worker that picked up a helper
+        void Run() {
+            for ( size_t range = next++; range < ranges; range = next++ ) {
+                ( *function )(range, Begin(range), Begin(range + 1));
+            }
+        }
+    };
+
+    Batch batch;
+    batch.function = &_function;
+    batch.count = _count;
+    batch.ranges = ranges;
+    batch.next = 0;
+    batch.finished = 0;
+
+    // Each helper only holds a pointer, small enough for std::function to keep inline
+    Batch* shared = &batch;
+    size_t helpers = ranges - 1;
+
+    {
+        std::lock_guard<std::mutex> lock(jobsMutex);
+
+        for ( size_t i = 0; i < helpers; i++ ) {
+            PushJob([shared]() {
+                shared->Run();
+
+                // Counted under the lock so the caller can't return and destroy the condition before we notify it
+                std::lock_guard<std::mutex> lock(shared->doneMutex);
+                shared->finished++;
+                shared->doneCondition.notify_one();
+            }, shared);
+        }
+    }
+
+    jobsCondition.notify_all();
+
+    // The caller works through the ranges too and finishes them alone if every worker is busy with something long.
+    // Helpers still queued then have nothing left to do and are taken back out, only the ones a worker already
+    // started are waited for, and those are running this batch's ranges.
+    batch.Run();
+
+    size_t started = helpers;
+
+    {
+        std::lock_guard<std::mutex> lock(jobsMutex);
+        started -= CancelJobs(shared);
+    }
+
+    std::unique_lock<std::mutex> lock(batch.doneMutex);
+    batch.doneCondition.wait(lock, [&]() { return batch.finished == started; });
+}
+
+void ThreadPool::PushJob(std::function<void()>&& _job, const void* _batch) {
+    if ( jobCount == jobs.size() ) {
+        std::vector<Job> grown(jobs.size() * 2);
+
+        for ( size_t i = 0; i < jobCount; i++ ) {
+            grown[i] = std::move(jobs[( firstJob + i ) % jobs.size()]);
+        }
+
+        jobs.swap(grown);
+        firstJob = 0;
+    }
+
+    Job& job = jobs[( firstJob + jobCount ) % jobs.size()];
+    job.function = std::move(_job);
+    job.batch = _batch;
+    jobCount++;
+}
+
+std::function<void()> ThreadPool::PopJob() {
+    std::function<void()> job = std::move(jobs[firstJob].function);
+    jobs[firstJob].function = nullptr;
+
+    firstJob = ( firstJob + 1 ) % jobs.size();
+    jobCount--;
+
+    return job;
+}
+
+// Drops the batch's queued helpers, the other jobs keep their order
+size_t ThreadPool::CancelJobs(const void* _batch) {
+    size_t kept = 0;
+
+    for ( size_t i = 0; i < jobCount; i++ ) {
+        Job& job = jobs[( firstJob + i ) % jobs.size()];
+
+        if ( job.batch == _batch ) continue;
+
+        if ( kept != i ) {
+            Job& target = jobs[( firstJob + kept ) % jobs.size()];
+            target.function = std::move(job.function);
+            target.batch = job.batch;
+        }
+
+        kept++;
+    }
+
+    for ( size_t i = kept; i < jobCount; i++ ) {
+        jobs[( firstJob + i ) % jobs.size()].function = nullptr;
+    }
+
+    size_t cancelled = jobCount - kept;
+    jobCount = kept;
+
+    return cancelled;
+}
+
+void ThreadPool::WorkerLoop() {
+    while ( true ) {
+        std::function<void()> job;
+
+        {
+            std::unique_lock<std::mutex> lock(jobsMutex);
+            jobsCondition.wait(lock, [this]() { return stopping || jobCount > 0; });
+
+            if ( stopping && jobCount == 0 ) return;
+
+            job = PopJob();
+        }
+
+        job();
+    }
+}
@@ -0,0 +1,42 @@
+#ifndef THREAD_POOL_H
+#define THREAD_POOL_H
+
+#include <vector>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <functional>
+
+// Workers for background jobs handed to Submit and for ParallelFor. The thread calling ParallelFor only ever works on
+// its own call's ranges, never on a queued background job, so a frame that splits work over the pool can't end up
+// running a model import inline.
+class ThreadPool {
+    public:
+        explicit ThreadPool(size_t _workers);
+        ~ThreadPool();
+        static ThreadPool& Get();
+        size_t GetThreadCount() const;
+        void Submit(std::function<void()> _job);
+        size_t RangeCount(size_t _count, size_t _minRange) const;
+        void ParallelFor(size_t _count, size_t _minRange, const std::function<void(size_t _range, size_t _begin, size_t _end)>& _function);
+
+    private:
+        std::vector<std::thread> workers;
+        struct Job {
+            std::function<void()> function;
+            const void* batch;      // the ParallelFor call the job helps with, null for a background job
+        };
+
+        std::vector<Job> jobs;      // ring buffer, doubled when full, so queueing doesn't allocate
+        size_t firstJob, jobCount;
+        std::mutex jobsMutex;
+        std::condition_variable jobsCondition;
+        bool stopping;
+
+        void PushJob(std::function<void()>&& _job, const void* _batch);
+        std::function<void()> PopJob();
+        size_t CancelJobs(const void* _batch);
+        void WorkerLoop();
+};
+
+#endif
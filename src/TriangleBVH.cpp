@@ -0,0 +1,534 @@
+#include <algorithm>
+#include <atomic>
+#include <cfloat>
+
+#if defined(__SSE2__) || defined(_M_X64) || defined(_M_AMD64)
+#define TRIANGLE_BVH_SSE 1
+#include <emmintrin.h>
+#endif
+
+#include "TriangleBVH.h"
+#include "ThreadPool.h"
+
+namespace {
+    const int32_t LEAF_TRIANGLES = 4;
+    const int BINS = 16;
+
+    // Below this many triangles a subtree isn't worth handing to another thread
+    const int32_t PARALLEL_TRIANGLES = 4096;
+    const size_t MIN_TRIANGLES_PER_RANGE = 8192;
+
+    // Past this depth the SAH gives way to median splits, which keeps the traversal stack bounded on any input
+    const int MAX_SAH_DEPTH = 40;
+    const int STACK_SIZE = 256;
+
+    struct Ray {
+        glm::vec3 origin, direction, inverseDirection;
+#ifdef TRIANGLE_BVH_SSE
+        __m128 originX, originY, originZ;
+        __m128 directionX, directionY, directionZ;
+        __m128 inverseX, inverseY, inverseZ;
+#endif
+
+        Ray(const glm::vec3& _origin, const glm::vec3& _direction) : origin(_origin), direction(_direction),
+                inverseDirection(1.0f / _direction) {
+#ifdef TRIANGLE_BVH_SSE
+            originX = _mm_set1_ps(origin.x);
+            originY = _mm_set1_ps(origin.y);
+            originZ = _mm_set1_ps(origin.z);
+            directionX = _mm_set1_ps(direction.x);
+            directionY = _mm_set1_ps(direction.y);
+            directionZ = _mm_set1_ps(direction.z);
+            inverseX = _mm_set1_ps(inverseDirection.x);
+            inverseY = _mm_set1_ps(inverseDirection.y);
+            inverseZ = _mm_set1_ps(inverseDirection.z);
+#endif
+        }
+    };
+
+    GLfloat CalcArea(const glm::vec3& _boundsMin, const glm::vec3& _boundsMax) {
+        glm::vec3 extent = glm::max(_boundsMax - _boundsMin, glm::vec3(0.0f));
+
+        return 2.0f * ( extent.x * extent.y + extent.y * extent.z + extent.z * extent.x );
+    }
+}
+
+struct TriangleBVH::Builder {
+    struct BinaryNode {
+        glm::vec3 boundsMin, boundsMax;
+        int32_t left;           // first child, the second one follows it, 0 for a leaf
+        int32_t first, count;   // triangles in references
+    };
+
+    const std::vector<glm::vec3>& positions;
+    const std::vector<GLuint>& indices;
+    std::vector<glm::vec3> triangleMin, triangleMax, centroids;
+    std::vector<uint32_t> references;
+    std::vector<BinaryNode> binaryNodes;
+    std::atomic<int32_t> binaryCount;
+
+    Builder(const std::vector<glm::vec3>& _positions, const std::vector<GLuint>& _indices) : positions(_positions), indices(_indices),
+            binaryCount(1) {  }
+
+    void Split(int32_t _node, int32_t _begin, int32_t _end, int _depth);
+    int32_t Collapse(int32_t _node, TriangleBVH& _bvh);
+};
+
+void TriangleBVH::Builder::Split(int32_t _node, int32_t _begin, int32_t _end, int _depth) {
+    glm::vec3 boundsMin(FLT_MAX), boundsMax(-FLT_MAX);
+    glm::vec3 centroidMin(FLT_MAX), centroidMax(-FLT_MAX);
+
+    for ( int32_t i = _begin; i < _end; i++ ) {
+        uint32_t triangle = references[i];
+
+        boundsMin = glm::min(boundsMin, triangleMin[triangle]);
+        boundsMax = glm::max(boundsMax, triangleMax[triangle]);
+        centroidMin = glm::min(centroidMin, centroids[triangle]);
+        centroidMax = glm::max(centroidMax, centroids[triangle]);
+    }
+
+    // Other threads write other nodes of the array, never this one
+    BinaryNode& node = binaryNodes[_node];
+    node = { boundsMin, boundsMax, 0, _begin, _end - _begin };
+
+    int32_t count = _end - _begin;
+
+    if ( count <= LEAF_TRIANGLES ) return;
+
+    glm::vec3 extent = centroidMax - centroidMin;
+    int axis = extent.x >= extent.y && extent.x >= extent.z ? 0 : ( extent.y >= extent.z ? 1 : 2 );
+    int32_t middle = _begin + count / 2;
+
+    if ( extent[axis] <= 0.0f ) {
+        // Every centroid is the same point, any halving is as good as another
+    } else if ( _depth >= MAX_SAH_DEPTH ) {
+        std::nth_element(references.begin() + _begin, references.begin() + middle, references.begin() + _end, [&](uint32_t _a, uint32_t _b) {
+            return centroids[_a][axis] < centroids[_b][axis];
+        });
+    } else {
+        // All three axes are binned in one pass over the triangles, then swept from both ends for the cheapest split
+        struct Bin {
+            glm::vec3 boundsMin, boundsMax;
+            int32_t count;
+        } bins[3][BINS];
+
+        for ( auto& axisBins : bins ) {
+            for ( Bin& bin : axisBins ) bin = { glm::vec3(FLT_MAX), glm::vec3(-FLT_MAX), 0 };
+        }
+
+        glm::vec3 scale;
+
+        for ( int a = 0; a < 3; a++ ) {
+            scale[a] = extent[a] > 0.0f ? BINS / extent[a] : 0.0f;
+        }
+
+        for ( int32_t i = _begin; i < _end; i++ ) {
+            uint32_t triangle = references[i];
+
+            for ( int a = 0; a < 3; a++ ) {
+                Bin& bin = bins[a][std::min(static_cast<int>(( centroids[triangle][a] - centroidMin[a] ) * scale[a]), BINS - 1)];
+
+                bin.boundsMin = glm::min(bin.boundsMin, triangleMin[triangle]);
+                bin.boundsMax = glm::max(bin.boundsMax, triangleMax[triangle]);
+                bin.count++;
+            }
+        }
+
+        GLfloat bestCost = FLT_MAX;
+        int bestAxis = -1, bestSplit = 0;
+
+        for ( int a = 0; a < 3; a++ ) {
+            if ( extent[a] <= 0.0f ) continue;
+
+            GLfloat rightCosts[BINS];
+            glm::vec3 sweepMin(FLT_MAX), sweepMax(-FLT_MAX);
+            int32_t sweepCount = 0;
+
+            for ( int i = BINS - 1; i > 0; i-- ) {
+                sweepMin = glm::min(sweepMin, bins[a][i].boundsMin);
+                sweepMax = glm::max(sweepMax, bins[a][i].boundsMax);
+                sweepCount += bins[a][i].count;
+                rightCosts[i] = sweepCount ? CalcArea(sweepMin, sweepMax) * sweepCount : -1.0f;
+            }
+
+            sweepMin = glm::vec3(FLT_MAX);
+            sweepMax = glm::vec3(-FLT_MAX);
+            sweepCount = 0;
+
+            for ( int i = 1; i < BINS; i++ ) {
+                sweepMin = glm::min(sweepMin, bins[a][i - 1].boundsMin);
+                sweepMax = glm::max(sweepMax, bins[a][i - 1].boundsMax);
+                sweepCount += bins[a][i - 1].count;
+
+                if ( sweepCount == 0 || rightCosts[i] < 0.0f ) continue;
+
+                GLfloat cost = CalcArea(sweepMin, sweepMax) * sweepCount + rightCosts[i];
+
+                if ( cost < bestCost ) {
+                    bestCost = cost;
+                    bestAxis = a;
+                    bestSplit = i;
+                }
+            }
+        }
+
+        if ( bestAxis >= 0 ) {
+            GLfloat minimum = centroidMin[bestAxis], binScale = scale[bestAxis];
+
+            middle = static_cast<int32_t>(std::partition(references.begin() + _begin, references.begin() + _end, [&](uint32_t _triangle) {
+                return std::min(static_cast<int>(( centroids[_triangle][bestAxis] - minimum ) * binScale), BINS - 1) < bestSplit;
+            }) - references.begin());
+        }
+    }
+
+    int32_t left = binaryCount.fetch_add(2);
+    node.left = left;
+
+    if ( count >= PARALLEL_TRIANGLES ) {
+        ThreadPool::Get().ParallelFor(2, 1, [&](size_t, size_t _first, size_t _last) {
+            for ( size_t child = _first; child < _last; child++ ) {
+                if ( child == 0 ) Split(left, _begin, middle, _depth + 1);
+                else Split(left + 1, middle, _end, _depth + 1);
+            }
+        });
+    } else {
+        Split(left, _begin, middle, _depth + 1);
+        Split(left + 1, middle, _end, _depth + 1);
+    }
+}
+
+int32_t TriangleBVH::Builder::Collapse(int32_t _node, TriangleBVH& _bvh) {
+    const BinaryNode& binary = binaryNodes[_node];
+
+    if ( binary.left == 0 ) {
+        Packet packet{};
+
+        for ( int32_t lane = 0; lane < LEAF_TRIANGLES; lane++ ) {
+            packet.triangles[lane] = ~0u;
+
+            if ( lane >= binary.count ) continue;
+
+            uint32_t triangle = references[binary.first + lane];
+            const glm::vec3& v0 = positions[indices[triangle * 3]];
+            glm::vec3 e1 = positions[indices[triangle * 3 + 1]] - v0;
+            glm::vec3 e2 = positions[indices[triangle * 3 + 2]] - v0;
+
+            packet.v0X[lane] = v0.x; packet.v0Y[lane] = v0.y; packet.v0Z[lane] = v0.z;
+            packet.e1X[lane] = e1.x; packet.e1Y[lane] = e1.y; packet.e1Z[lane] = e1.z;
+            packet.e2X[lane] = e2.x; packet.e2Y[lane] = e2.y; packet.e2Z[lane] = e2.z;
+            packet.triangles[lane] = triangle;
+        }
+
+        _bvh.packets.push_back(packet);
+
+        return ~static_cast<int32_t>(_bvh.packets.size() - 1);
+    }
+
+    // Pulls grandchildren up into the slots, always opening the biggest inner child, until all four are used
+    int32_t children[4] = { binary.left, binary.left + 1 };
+    int childCount = 2;
+
+    while ( childCount < 4 ) {
+        int widest = -1;
+        GLfloat widestArea = -1.0f;
+
+        for ( int i = 0; i < childCount; i++ ) {
+            const BinaryNode& child = binaryNodes[children[i]];
+            GLfloat area = CalcArea(child.boundsMin, child.boundsMax);
+
+            if ( child.left != 0 && area > widestArea ) {
+                widest = i;
+                widestArea = area;
+            }
+        }
+
+        if ( widest < 0 ) break;
+
+        int32_t opened = children[widest];
+        children[widest] = binaryNodes[opened].left;
+        children[childCount++] = binaryNodes[opened].left + 1;
+    }
+
+    // The vector grows while the children collapse, the node is filled in through its index
+    int32_t index = static_cast<int32_t>(_bvh.nodes.size());
+    _bvh.nodes.emplace_back();
+
+    for ( int i = 0; i < 4; i++ ) {
+        Node& node = _bvh.nodes[index];
+
+        if ( i >= childCount ) {
+            node.minX[i] = node.minY[i] = node.minZ[i] = 0.0f;
+            node.maxX[i] = node.maxY[i] = node.maxZ[i] = 0.0f;
+            node.children[i] = EMPTY_CHILD;
+            continue;
+        }
+
+        const BinaryNode& child = binaryNodes[children[i]];
+
+        node.minX[i] = child.boundsMin.x; node.minY[i] = child.boundsMin.y; node.minZ[i] = child.boundsMin.z;
+        node.maxX[i] = child.boundsMax.x; node.maxY[i] = child.boundsMax.y; node.maxZ[i] = child.boundsMax.z;
+
+        int32_t collapsed = Collapse(children[i], _bvh);
+        _bvh.nodes[index].children[i] = collapsed;
+    }
+
+    return index;
+}
+
+TriangleBVH::TriangleBVH() : triangleCount(0), boundsMin(0.0f), boundsMax(0.0f) {  }
+
+TriangleBVH::~TriangleBVH() = default;
+
+TriangleBVH::TriangleBVH(TriangleBVH&& _other) noexcept = default;
+
+TriangleBVH& TriangleBVH::operator=(TriangleBVH&& _other) noexcept = default;
+
+void TriangleBVH::Build(const std::vector<glm::vec3>& _positions, const std::vector<GLuint>& _indices) {
+    Clear();
+
+    size_t count = _indices.size() / 3;
+
+    if ( count == 0 ) return;
+
+    Builder builder(_positions, _indices);
+
+    builder.triangleMin.resize(count);
+    builder.triangleMax.resize(count);
+    builder.centroids.resize(count);
+    builder.references.resize(count);
+
+    ThreadPool::Get().ParallelFor(count, MIN_TRIANGLES_PER_RANGE, [&](size_t, size_t _begin, size_t _end) {
+        for ( size_t i = _begin; i < _end; i++ ) {
+            const glm::vec3& a = _positions[_indices[i * 3]];
+            const glm::vec3& b = _positions[_indices[i * 3 + 1]];
+            const glm::vec3& c = _positions[_indices[i * 3 + 2]];
+
+            builder.triangleMin[i] = glm::min(a, glm::min(b, c));
+            builder.triangleMax[i] = glm::max(a, glm::max(b, c));
+            builder.centroids[i] = ( builder.triangleMin[i] + builder.triangleMax[i] ) * 0.5f;
+            builder.references[i] = static_cast<uint32_t>(i);
+        }
+    });
+
+    // A binary tree over n triangles never has more than 2n - 1 nodes, so threads can take theirs without locking
+    builder.binaryNodes.resize(count * 2);
+    builder.Split(0, 0, static_cast<int32_t>(count), 0);
+
+    const auto& root = builder.binaryNodes[0];
+
+    nodes.reserve(builder.binaryCount / 3 + 1);
+    packets.reserve(( count + LEAF_TRIANGLES - 1 ) / LEAF_TRIANGLES * 2);
+
+    if ( root.left == 0 ) {
+        // Too few triangles for a split, the root still has to be a node
+        nodes.emplace_back();
+        Node& node = nodes[0];
+
+        for ( int i = 0; i < 4; i++ ) {
+            node.minX[i] = node.minY[i] = node.minZ[i] = node.maxX[i] = node.maxY[i] = node.maxZ[i] = 0.0f;
+            node.children[i] = EMPTY_CHILD;
+        }
+
+        node.minX[0] = root.boundsMin.x; node.minY[0] = root.boundsMin.y; node.minZ[0] = root.boundsMin.z;
+        node.maxX[0] = root.boundsMax.x; node.maxY[0] = root.boundsMax.y; node.maxZ[0] = root.boundsMax.z;
+
+        int32_t leaf = builder.Collapse(0, *this);
+        nodes[0].children[0] = leaf;
+    } else {
+        builder.Collapse(0, *this);
+    }
+
+    nodes.shrink_to_fit();
+    packets.shrink_to_fit();
+
+    triangleCount = count;
+    boundsMin = root.boundsMin;
+    boundsMax = root.boundsMax;
+}
+
+void TriangleBVH::Clear() {
+    std::vector<Node>().swap(nodes);
+    std::vector<Packet>().swap(packets);
+    triangleCount = 0;
+    boundsMin = boundsMax = glm::vec3(0.0f);
+}
+
+bool TriangleBVH::Raycast(const glm::vec3& _origin, const glm::vec3& _direction, GLfloat _maxDistance, RayHit& _hit) const {
+    return Traverse<false>(_origin, _direction, _maxDistance, _hit);
+}
+
+bool TriangleBVH::Occluded(const glm::vec3& _origin, const glm::vec3& _direction, GLfloat _maxDistance) const {
+    RayHit hit;
+
+    return Traverse<true>(_origin, _direction, _maxDistance, hit);
+}
+
+template<bool ANY_HIT>
+bool TriangleBVH::Traverse(const glm::vec3& _origin, const glm::vec3& _direction, GLfloat _maxDistance, RayHit& _hit) const {
+    if ( nodes.empty() ) return false;
+
+    Ray ray(_origin, _direction);
+    GLfloat closest = _maxDistance;
+    bool found = false;
+
+    struct Entry {
+        int32_t child;
+        GLfloat distance;
+    } stack[STACK_SIZE];
+
+    int size = 0;
+    stack[size++] = { 0, 0.0f };
+
+    while ( size > 0 ) {
+        Entry entry = stack[--size];
+
+        // Pushed before a closer hit was found
+        if ( entry.distance > closest ) continue;
+
+        if ( entry.child < 0 ) {
+            const Packet& packet = packets[~entry.child];
+            float t[4], u[4], v[4];
+            int mask = 0;
+
+#ifdef TRIANGLE_BVH_SSE
+            // Möller-Trumbore on four triangles at once
+            __m128 e1X = _mm_loadu_ps(packet.e1X), e1Y = _mm_loadu_ps(packet.e1Y), e1Z = _mm_loadu_ps(packet.e1Z);
+            __m128 e2X = _mm_loadu_ps(packet.e2X), e2Y = _mm_loadu_ps(packet.e2Y), e2Z = _mm_loadu_ps(packet.e2Z);
+
+            __m128 pX = _mm_sub_ps(_mm_mul_ps(ray.directionY, e2Z), _mm_mul_ps(ray.directionZ, e2Y));
+            __m128 pY = _mm_sub_ps(_mm_mul_ps(ray.directionZ, e2X), _mm_mul_ps(ray.directionX, e2Z));
+            __m128 pZ = _mm_sub_ps(_mm_mul_ps(ray.directionX, e2Y), _mm_mul_ps(ray.directionY, e2X));
+
+            __m128 determinant = _mm_add_ps(_mm_add_ps(_mm_mul_ps(e1X, pX), _mm_mul_ps(e1Y, pY)), _mm_mul_ps(e1Z, pZ));
+            __m128 inverse = _mm_div_ps(_mm_set1_ps(1.0f), determinant);
+
+            __m128 sX = _mm_sub_ps(ray.originX, _mm_loadu_ps(packet.v0X));
+            __m128 sY = _mm_sub_ps(ray.originY, _mm_loadu_ps(packet.v0Y));
+            __m128 sZ = _mm_sub_ps(ray.originZ, _mm_loadu_ps(packet.v0Z));
+
+            __m128 uLanes = _mm_mul_ps(_mm_add_ps(_mm_add_ps(_mm_mul_ps(sX, pX), _mm_mul_ps(sY, pY)), _mm_mul_ps(sZ, pZ)), inverse);
+
+            __m128 qX = _mm_sub_ps(_mm_mul_ps(sY, e1Z), _mm_mul_ps(sZ, e1Y));
+            __m128 qY = _mm_sub_ps(_mm_mul_ps(sZ, e1X), _mm_mul_ps(sX, e1Z));
+            __m128 qZ = _mm_sub_ps(_mm_mul_ps(sX, e1Y), _mm_mul_ps(sY, e1X));
+
+            __m128 vLanes = _mm_mul_ps(_mm_add_ps(_mm_add_ps(_mm_mul_ps(ray.directionX, qX), _mm_mul_ps(ray.directionY, qY)),
+                    _mm_mul_ps(ray.directionZ, qZ)), inverse);
+            __m128 tLanes = _mm_mul_ps(_mm_add_ps(_mm_add_ps(_mm_mul_ps(e2X, qX), _mm_mul_ps(e2Y, qY)), _mm_mul_ps(e2Z, qZ)), inverse);
+
+            __m128 zero = _mm_setzero_ps();
+            __m128 hits = _mm_and_ps(_mm_cmpneq_ps(determinant, zero), _mm_cmpge_ps(uLanes, zero));
+            hits = _mm_and_ps(hits, _mm_cmpge_ps(vLanes, zero));
+            hits = _mm_and_ps(hits, _mm_cmple_ps(_mm_add_ps(uLanes, vLanes), _mm_set1_ps(1.0f)));
+            hits = _mm_and_ps(hits, _mm_cmpge_ps(tLanes, zero));
+            hits = _mm_and_ps(hits, _mm_cmple_ps(tLanes, _mm_set1_ps(closest)));
+
+            _mm_storeu_ps(t, tLanes);
+            _mm_storeu_ps(u, uLanes);
+            _mm_storeu_ps(v, vLanes);
+            mask = _mm_movemask_ps(hits);
+#else
+            for ( int lane = 0; lane < 4; lane++ ) {
+                glm::vec3 e1(packet.e1X[lane], packet.e1Y[lane], packet.e1Z[lane]);
+                glm::vec3 e2(packet.e2X[lane], packet.e2Y[lane], packet.e2Z[lane]);
+                glm::vec3 p = glm::cross(ray.direction, e2);
+                float determinant = glm::dot(e1, p);
+
+                if ( determinant == 0.0f ) continue;
+
+                float inverse = 1.0f / determinant;
+                glm::vec3 s = ray.origin - glm::vec3(packet.v0X[lane], packet.v0Y[lane], packet.v0Z[lane]);
+                glm::vec3 q = glm::cross(s, e1);
+
+                u[lane] = glm::dot(s, p) * inverse;
+                v[lane] = glm::dot(ray.direction, q) * inverse;
+                t[lane] = glm::dot(e2, q) * inverse;
+
+                if ( u[lane] >= 0.0f && v[lane] >= 0.0f && u[lane] + v[lane] <= 1.0f && t[lane] >= 0.0f && t[lane] <= closest ) {
+                    mask |= 1 << lane;
+                }
+            }
+#endif
+
+            if ( mask != 0 && ANY_HIT ) return true;
+
+            for ( int lane = 0; lane < 4; lane++ ) {
+                if ( ( mask & ( 1 << lane ) ) == 0 || t[lane] > closest ) continue;
+
+                closest = t[lane];
+                _hit = { t[lane], packet.triangles[lane], u[lane], v[lane] };
+                found = true;
+            }
+
+            continue;
+        }
+
+        const Node& node = nodes[entry.child];
+        float entries[4];
+        int mask = 0;
+
+#ifdef TRIANGLE_BVH_SSE
+        // Slab test against the four child boxes at once
+        __m128 t0X = _mm_mul_ps(_mm_sub_ps(_mm_loadu_ps(node.minX), ray.originX), ray.inverseX);
+        __m128 t1X = _mm_mul_ps(_mm_sub_ps(_mm_loadu_ps(node.maxX), ray.originX), ray.inverseX);
+        __m128 t0Y = _mm_mul_ps(_mm_sub_ps(_mm_loadu_ps(node.minY), ray.originY), ray.inverseY);
+        __m128 t1Y = _mm_mul_ps(_mm_sub_ps(_mm_loadu_ps(node.maxY), ray.originY), ray.inverseY);
+        __m128 t0Z = _mm_mul_ps(_mm_sub_ps(_mm_loadu_ps(node.minZ), ray.originZ), ray.inverseZ);
+        __m128 t1Z = _mm_mul_ps(_mm_sub_ps(_mm_loadu_ps(node.maxZ), ray.originZ), ray.inverseZ);
+
+        __m128 nearest = _mm_max_ps(_mm_max_ps(_mm_min_ps(t0X, t1X), _mm_min_ps(t0Y, t1Y)),
+                                    _mm_max_ps(_mm_min_ps(t0Z, t1Z), _mm_setzero_ps()));
+        __m128 furthest = _mm_min_ps(_mm_min_ps(_mm_max_ps(t0X, t1X), _mm_max_ps(t0Y, t1Y)),
+                                     _mm_min_ps(_mm_max_ps(t0Z, t1Z), _mm_set1_ps(closest)));
+
+        _mm_storeu_ps(entries, nearest);
+        mask = _mm_movemask_ps(_mm_cmple_ps(nearest, furthest));
+#else
+        for ( int lane = 0; lane < 4; lane++ ) {
+            glm::vec3 t0 = ( glm::vec3(node.minX[lane], node.minY[lane], node.minZ[lane]) - ray.origin ) * ray.inverseDirection;
+            glm::vec3 t1 = ( glm::vec3(node.maxX[lane], node.maxY[lane], node.maxZ[lane]) - ray.origin ) * ray.inverseDirection;
+            glm::vec3 tNear = glm::min(t0, t1), tFar = glm::max(t0, t1);
+
+            entries[lane] = std::max(std::max(tNear.x, tNear.y), std::max(tNear.z, 0.0f));
+
+            if ( entries[lane] <= std::min(std::min(tFar.x, tFar.y), std::min(tFar.z, closest)) ) mask |= 1 << lane;
+        }
+#endif
+
+        // Nearest child on top of the stack, so closer hits come first and cut the rest short
+        Entry hits[4];
+        int hitCount = 0;
+
+        for ( int lane = 0; lane < 4; lane++ ) {
+            if ( ( mask & ( 1 << lane ) ) == 0 || node.children[lane] == EMPTY_CHILD ) continue;
+
+            Entry hit = { node.children[lane], entries[lane] };
+            int slot = hitCount++;
+
+            while ( slot > 0 && hits[slot - 1].distance < hit.distance ) {
+                hits[slot] = hits[slot - 1];
+                slot--;
+            }
+
+            hits[slot] = hit;
+        }
+
+        for ( int i = 0; i < hitCount; i++ ) {
+            stack[size++] = hits[i];
+        }
+    }
+
+    return found;
+}
+
+bool TriangleBVH::IsEmpty() const { return nodes.empty(); }
+
+size_t TriangleBVH::GetTriangleCount() const { return triangleCount; }
+
+size_t TriangleBVH::GetNodeCount() const { return nodes.size(); }
+
+size_t TriangleBVH::GetMemoryBytes() const { return nodes.size() * sizeof(Node) + packets.size() * sizeof(Packet); }
+
+const glm::vec3& TriangleBVH::GetBoundsMin() const { return boundsMin; }
+
+const glm::vec3& TriangleBVH::GetBoundsMax() const { return boundsMax; }
\ No newline at end of file
@@ -0,0 +1,67 @@
+#ifndef TRIANGLE_BVH_H
+#define TRIANGLE_BVH_H
+
+#include <vector>
+#include <cstdint>
+
+#include <GL/glew.h>
+
+#include "glm/glm.hpp"
+
+struct RayHit {
+    GLfloat distance;       // along the ray, in multiples of the direction's length
+    GLuint triangle;        // the triangle's position in the index list the BVH was built from
+    GLfloat u, v;           // barycentric coordinates of the hit on that triangle
+};
+
+// Four-wide triangle BVH for ray queries against static geometry on the CPU. Built with binned SAH as a binary tree,
+// big subtrees in parallel on the thread pool, then collapsed so every node tests four child boxes at once and every
+// leaf four triangles at once. The leaves keep their own copy of the triangles, the source vertices can go after Build.
+class TriangleBVH {
+    public:
+        TriangleBVH();
+        ~TriangleBVH();
+        TriangleBVH(TriangleBVH&& _other) noexcept;
+        TriangleBVH& operator=(TriangleBVH&& _other) noexcept;
+        void Build(const std::vector<glm::vec3>& _positions, const std::vector<GLuint>& _indices);
+        void Clear();
+        bool Raycast(const glm::vec3& _origin, const glm::vec3& _direction, GLfloat _maxDistance, RayHit& _hit) const;
+        bool Occluded(const glm::vec3& _origin, const glm::vec3& _direction, GLfloat _maxDistance) const;
+        bool IsEmpty() const;
+        size_t GetTriangleCount() const;
+        size_t GetNodeCount() const;
+        size_t GetMemoryBytes() const;
+        const glm::vec3& GetBoundsMin() const;
+        const glm::vec3& GetBoundsMax() const;
+
+    private:
+        struct Builder;
+
+        // Children's boxes side by side so the four slab tests are one SIMD pass each
+        struct Node {
+            float minX[4], minY[4], minZ[4];
+            float maxX[4], maxY[4], maxZ[4];
+            int32_t children[4];        // node index, ~packet index for a leaf, EMPTY_CHILD for an unused slot
+        };
+
+        // Up to four triangles as a vertex and two edges each, unused lanes have zero edges and never hit
+        struct Packet {
+            float v0X[4], v0Y[4], v0Z[4];
+            float e1X[4], e1Y[4], e1Z[4];
+            float e2X[4], e2Y[4], e2Z[4];
+            GLuint triangles[4];
+        };
+
+        // The root is nobody's child
+        static const int32_t EMPTY_CHILD = 0;
+
+        std::vector<Node> nodes;
+        std::vector<Packet> packets;
+        size_t triangleCount;
+        glm::vec3 boundsMin, boundsMax;
+
+        template<bool ANY_HIT>
+        bool Traverse(const glm::vec3& _origin, const glm::vec3& _direction, GLfloat _maxDistance, RayHit& _hit) const;
+};
+
+#endif
\ No newline at end of file
@@ -0,0 +1,347 @@
+#include <iostream>
+#include <cstring>
+
+#include "UploadManager.h"
+#include "GLState.h"
+#include "GpuMemory.h"
+
+namespace {
+    // Enough for the unpack offsets of any pixel format and for vertex data
+    const size_t ALIGNMENT = 16;
+
+    size_t Align(size_t _bytes) { return ( _bytes + ALIGNMENT - 1 ) / ALIGNMENT * ALIGNMENT; }
+
+    size_t CalcPixelBytes(GLenum _format) {
+        switch ( _format ) {
+            case GL_RED: return 1;
+            case GL_RG: return 2;
+            case GL_RGB: return 3;
+            default: return 4;
+        }
+    }
+}
+
+StagingRegion::StagingRegion() : data(nullptr), offset(0), size(0), block(0), generation(0) {  }
+
+StagingRegion::~StagingRegion() { Release(); }
+
+StagingRegion::StagingRegion(StagingRegion&& _other) noexcept : data(_other.data), offset(_other.offset), size(_other.size),
+        block(_other.block), generation(_other.generation) {
+    _other.data = nullptr;
+}
+
+StagingRegion& StagingRegion::operator=(StagingRegion&& _other) noexcept {
+    if ( this != &_other ) {
+        Release();
+
+        data = _other.data;
+        offset = _other.offset;
+        size = _other.size;
+        block = _other.block;
+        generation = _other.generation;
+
+        _other.data = nullptr;
+    }
+
+    return *this;
+}
+
+bool StagingRegion::IsValid() const { return data != nullptr; }
+
+unsigned char* StagingRegion::GetData() const { return data; }
+
+size_t StagingRegion::GetSize() const { return size; }
+
+void StagingRegion::Release() {
+    if ( !data ) return;
+
+    UploadManager::Get().Release(*this);
+    data = nullptr;
+}
+
+UploadManager& UploadManager::Get() {
+    static UploadManager manager;
+    return manager;
+}
+
+UploadManager::UploadManager() : buffer(0), mapped(nullptr), stagingBytes(0), frameBytes(0), head(0), used(0), firstBlock(0), generation(1),
+        queuedBytes(0), nextTicket(1), issuedTicket(0), nextFence(1), signalledFence(0), frameIssuedBytes(0) {  }
+
+// The buffer belongs to the context, Destroy has to run before it goes away
+UploadManager::~UploadManager() = default;
+
+void UploadManager::Create(size_t _stagingBytes, size_t _frameBytes) {
+    std::lock_guard<std::mutex> lock(mutex);
+
+    stagingBytes = Align(_stagingBytes);
+    frameBytes = _frameBytes;
+
+    GLbitfield flags = GL_MAP_WRITE_BIT | GL_MAP_PERSISTENT_BIT | GL_MAP_COHERENT_BIT;
+
+    glGenBuffers(1, &buffer);
+    GLState::Get().BindBuffer(GL_COPY_READ_BUFFER, buffer);
+
+    // glBufferStorage — written by the CPU while the GPU copies out of other parts of it, coherent so writes need no flush
+    glBufferStorage(GL_COPY_READ_BUFFER, stagingBytes, nullptr, flags);
+    mapped = static_cast<unsigned char*>(glMapBufferRange(GL_COPY_READ_BUFFER, 0, stagingBytes, flags));
+
+    GLState::Get().BindBuffer(GL_COPY_READ_BUFFER, 0);
+
+    GpuMemory::Get().TrackBuffer(buffer, stagingBytes, GpuMemoryCategory::Staging, "UploadManager");
+
+    // glPixelStorei — rows are tightly packed here and in every client-memory image, RGB ones included
+    glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+
+    if ( !mapped ) std::cerr << "Failed to map the upload staging buffer\n";
+}
+
+void UploadManager::Destroy() {
+    // Whatever is still queued goes out first, the objects waiting for it would stay empty otherwise
+    Flush(nextTicket - 1);
+
+    std::lock_guard<std::mutex> lock(mutex);
+
+    for ( auto& fence : fences ) {
+        glDeleteSync(fence.sync);
+    }
+
+    fences.clear();
+
+    if ( buffer ) {
+        GLState::Get().BindBuffer(GL_COPY_READ_BUFFER, buffer);
+        glUnmapBuffer(GL_COPY_READ_BUFFER);
+        GLState::Get().BindBuffer(GL_COPY_READ_BUFFER, 0);
+
+        GpuMemory::Get().ReleaseBuffer(buffer);
+        GLState::Get().DeleteBuffers(1, &buffer);
+    }
+
+    // Regions still held somewhere belong to the old buffer, releasing them later must not touch the new blocks
+    blocks.clear();
+    firstBlock = 0;
+    generation++;
+
+    buffer = 0;
+    mapped = nullptr;
+    head = used = 0;
+}
+
+StagingRegion UploadManager::Allocate(size_t _bytes) {
+    StagingRegion region;
+    size_t size = Align(_bytes);
+
+    std::lock_guard<std::mutex> lock(mutex);
+
+    if ( !mapped || size == 0 || size > stagingBytes ) return region;
+
+    // Blocks are handed out in ring order and come back in the same order, the free space is after the newest
+    // block up to the oldest one, wrapping around the end
+    size_t offset = 0;
+
+    if ( blocks.empty() ) {
+        offset = 0;
+    } else {
+        size_t tail = blocks.front().offset;
+
+        if ( head > tail ) {
+            if ( stagingBytes - head >= size ) {
+                offset = head;
+            } else if ( tail >= size ) {
+                offset = 0;
+            } else {
+                return region;
+            }
+        } else if ( tail - head >= size ) {
+            offset = head;
+        } else {
+            return region;
+        }
+    }
+
+    blocks.push_back({ offset, size, false, 0, 0 });
+    head = offset + size;
+    used += size;
+
+    region.data = mapped + offset;
+    region.offset = offset;
+    region.size = _bytes;
+    region.block = firstBlock + blocks.size() - 1;
+    region.generation = generation;
+
+    return region;
+}
+
+StagingRegion UploadManager::Stage(const void* _data, size_t _bytes) {
+    StagingRegion region = Allocate(_bytes);
+
+    if ( region.IsValid() ) std::memcpy(region.GetData(), _data, _bytes);
+
+    return region;
+}
+
+uint64_t UploadManager::CopyToBuffer(const StagingRegion& _region, size_t _sourceOffset, size_t _bytes, GLuint _buffer, GLintptr _offset) {
+    return Enqueue(_region, { CopyKind::Buffer, 0, _sourceOffset, _bytes, _buffer, GL_COPY_WRITE_BUFFER, _offset, 0, 0, 0, 0, GL_NONE, 0 });
+}
+
+uint64_t UploadManager::CopyToTexture(const StagingRegion& _region, size_t _sourceOffset, GLuint _texture, GLenum _target, GLint _level,
+        GLint _layer, GLsizei _width, GLsizei _height, GLenum _format) {
+    size_t bytes = static_cast<size_t>(_width) * _height * CalcPixelBytes(_format);
+
+    return Enqueue(_region, { CopyKind::Texture, 0, _sourceOffset, bytes, _texture, _target, 0, _level, _layer, _width, _height, _format, 0 });
+}
+
+uint64_t UploadManager::GenerateMipmap(GLuint _texture, GLenum _target) {
+    std::lock_guard<std::mutex> lock(mutex);
+
+    // No staging behind it, it only has to run after the copies queued before it
+    queue.push_back({ CopyKind::Mipmap, 0, 0, 0, _texture, _target, 0, 0, 0, 0, 0, GL_NONE, nextTicket });
+
+    return nextTicket++;
+}
+
+bool UploadManager::IsDone(uint64_t _ticket) const { return _ticket <= issuedTicket; }
+
+void UploadManager::Flush(uint64_t _ticket) {
+    if ( IsDone(_ticket) ) return;
+
+    std::lock_guard<std::mutex> lock(mutex);
+
+    while ( !queue.empty() && queue.front().ticket <= _ticket ) {
+        Issue(queue.front());
+        queue.pop_front();
+    }
+
+    // Left bound, the next client-memory glTexSubImage would read its pointer as an offset into the arena
+    GLState::Get().BindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+}
+
+void UploadManager::Update() {
+    std::lock_guard<std::mutex> lock(mutex);
+
+    Retire();
+
+    // Oldest first, always at least one copy a frame so an image larger than the whole budget still goes. Mipmap
+    // generation moves no staging memory and follows its texture in the same frame.
+    while ( !queue.empty() && ( frameIssuedBytes == 0 || frameIssuedBytes + queue.front().bytes <= frameBytes || queue.front().bytes == 0 ) ) {
+        Issue(queue.front());
+        queue.pop_front();
+    }
+
+    GLState::Get().BindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+
+    // glFenceSync — one fence covers every copy issued since the last one, Flush calls included
+    if ( frameIssuedBytes > 0 ) {
+        fences.push_back({ glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0), nextFence++ });
+    }
+
+    frameIssuedBytes = 0;
+}
+
+size_t UploadManager::GetQueuedBytes() const {
+    std::lock_guard<std::mutex> lock(mutex);
+    return queuedBytes;
+}
+
+size_t UploadManager::GetStagingBytes() const { return stagingBytes; }
+
+size_t UploadManager::GetUsedBytes() const {
+    std::lock_guard<std::mutex> lock(mutex);
+    return used;
+}
+
+uint64_t UploadManager::Enqueue(const StagingRegion& _region, Copy _copy) {
+    std::lock_guard<std::mutex> lock(mutex);
+
+    if ( !_region.IsValid() || _region.generation != generation ) return 0;
+
+    blocks[_region.block - firstBlock].pendingCopies++;
+
+    _copy.block = _region.block;
+    _copy.source += _region.offset;
+    _copy.ticket = nextTicket++;
+
+    queuedBytes += _copy.bytes;
+    queue.push_back(_copy);
+
+    return _copy.ticket;
+}
+
+void UploadManager::Issue(const Copy& _copy) {
+    bool cubeFace = _copy.target >= GL_TEXTURE_CUBE_MAP_POSITIVE_X && _copy.target <= GL_TEXTURE_CUBE_MAP_NEGATIVE_Z;
+    GLenum bindTarget = cubeFace ? GL_TEXTURE_CUBE_MAP : _copy.target;
+    const void* source = reinterpret_cast<const void*>(_copy.source);
+
+    switch ( _copy.kind ) {
+        case CopyKind::Buffer:
+            GLState::Get().BindBuffer(GL_COPY_READ_BUFFER, buffer);
+            GLState::Get().BindBuffer(GL_COPY_WRITE_BUFFER, _copy.object);
+
+            // glCopyBufferSubData — GPU side copy into the destination's storage, no client memory involved
+            glCopyBufferSubData(GL_COPY_READ_BUFFER, GL_COPY_WRITE_BUFFER, _copy.source, _copy.destination, _copy.bytes);
+            break;
+
+        case CopyKind::Texture:
+            GLState::Get().BindBuffer(GL_PIXEL_UNPACK_BUFFER, buffer);
+            GLState::Get().BindTexture(bindTarget, _copy.object);
+
+            // With a pixel unpack buffer bound the data pointer is an offset into it, the transfer runs asynchronously
+            if ( _copy.target == GL_TEXTURE_2D_ARRAY ) {
+                glTexSubImage3D(GL_TEXTURE_2D_ARRAY, _copy.level, 0, 0, _copy.layer, _copy.width, _copy.height, 1, _copy.format,
+                        GL_UNSIGNED_BYTE, source);
+            } else {
+                glTexSubImage2D(_copy.target, _copy.level, 0, 0, _copy.width, _copy.height, _copy.format, GL_UNSIGNED_BYTE, source);
+            }
+
+            GLState::Get().BindTexture(bindTarget, 0);
+            break;
+
+        case CopyKind::Mipmap:
+            GLState::Get().BindTexture(bindTarget, _copy.object);
+            glGenerateMipmap(bindTarget);
+            GLState::Get().BindTexture(bindTarget, 0);
+            break;
+    }
+
+    if ( _copy.kind != CopyKind::Mipmap ) {
+        Block& block = blocks[_copy.block - firstBlock];
+        block.pendingCopies--;
+        block.fence = nextFence;
+    }
+
+    queuedBytes -= _copy.bytes;
+    frameIssuedBytes += _copy.bytes;
+    issuedTicket = _copy.ticket;
+}
+
+void UploadManager::Retire() {
+    while ( !fences.empty() ) {
+        // glClientWaitSync — only polled, a frame never waits for the copies
+        GLenum result = glClientWaitSync(fences.front().sync, 0, 0);
+
+        if ( result != GL_ALREADY_SIGNALED && result != GL_CONDITION_SATISFIED ) break;
+
+        signalledFence = fences.front().serial;
+        glDeleteSync(fences.front().sync);
+        fences.pop_front();
+    }
+
+    while ( !blocks.empty() ) {
+        const Block& block = blocks.front();
+
+        if ( !block.released || block.pendingCopies || block.fence > signalledFence ) break;
+
+        used -= block.size;
+        blocks.pop_front();
+        firstBlock++;
+    }
+
+    if ( blocks.empty() ) head = 0;
+}
+
+void UploadManager::Release(const StagingRegion& _region) {
+    std::lock_guard<std::mutex> lock(mutex);
+
+    if ( _region.generation != generation ) return;
+
+    blocks[_region.block - firstBlock].released = true;
+}
\ No newline at end of file
@@ -0,0 +1,117 @@
+#ifndef UPLOAD_MANAGER_H
+#define UPLOAD_MANAGER_H
+
+#include <deque>
+#include <mutex>
+#include <cstddef>
+#include <cstdint>
+
+#include <GL/glew.h>
+
+// A piece of the staging arena, writable from any thread. Copies queued from it keep its memory alive until the
+// GPU has read it, the region itself only has to live until the last copy is queued.
+class StagingRegion {
+    public:
+        StagingRegion();
+        ~StagingRegion();
+        StagingRegion(StagingRegion&& _other) noexcept;
+        StagingRegion& operator=(StagingRegion&& _other) noexcept;
+        StagingRegion(const StagingRegion&) = delete;
+        StagingRegion& operator=(const StagingRegion&) = delete;
+        bool IsValid() const;
+        unsigned char* GetData() const;
+        size_t GetSize() const;
+
+    private:
+        friend class UploadManager;
+
+        unsigned char* data;
+        size_t offset, size;
+        uint64_t block;
+        uint64_t generation;
+
+        void Release();
+};
+
+// Moves texture and buffer data to the GPU through one persistently mapped buffer instead of client memory. Workers
+// write decoded pixels and vertices straight into regions of it and queue copies, Update issues them on the GL
+// thread from the pixel unpack or copy read binding, a few megabytes a frame so a burst of loads spreads over
+// several frames. The memory goes back to the ring once the fence of the frame that read it has signalled.
+// Every copy gets a ticket, owners check it before drawing with the object. Until Create, and whenever the
+// ring is full, Allocate hands out invalid regions and callers upload from client memory as before.
+class UploadManager {
+    public:
+        static UploadManager& Get();
+        void Create(size_t _stagingBytes, size_t _frameBytes);
+        void Destroy();
+        StagingRegion Allocate(size_t _bytes);
+        StagingRegion Stage(const void* _data, size_t _bytes);
+        uint64_t CopyToBuffer(const StagingRegion& _region, size_t _sourceOffset, size_t _bytes, GLuint _buffer, GLintptr _offset);
+        uint64_t CopyToTexture(const StagingRegion& _region, size_t _sourceOffset, GLuint _texture, GLenum _target, GLint _level,
+                GLint _layer, GLsizei _width, GLsizei _height, GLenum _format);
+        uint64_t GenerateMipmap(GLuint _texture, GLenum _target);
+        bool IsDone(uint64_t _ticket) const;
+        void Flush(uint64_t _ticket);
+        void Update();
+        size_t GetQueuedBytes() const;
+        size_t GetStagingBytes() const;
+        size_t GetUsedBytes() const;
+
+    private:
+        friend class StagingRegion;
+
+        enum class CopyKind {
+            Buffer,
+            Texture,
+            Mipmap
+        };
+
+        struct Copy {
+            CopyKind kind;
+            uint64_t block;
+            size_t source, bytes;
+            GLuint object;
+            GLenum target;
+            GLintptr destination;
+            GLint level, layer;
+            GLsizei width, height;
+            GLenum format;
+            uint64_t ticket;
+        };
+
+        struct Block {
+            size_t offset, size;
+            bool released;
+            size_t pendingCopies;
+            uint64_t fence;         // serial of the fence after the last copy out of it
+        };
+
+        struct Fence {
+            GLsync sync;
+            uint64_t serial;
+        };
+
+        GLuint buffer;
+        unsigned char* mapped;
+        size_t stagingBytes, frameBytes;
+        size_t head, used;
+        std::deque<Block> blocks;
+        uint64_t firstBlock;
+        uint64_t generation;
+        std::deque<Copy> queue;
+        size_t queuedBytes;
+        uint64_t nextTicket, issuedTicket;
+        std::deque<Fence> fences;
+        uint64_t nextFence, signalledFence;
+        size_t frameIssuedBytes;
+        mutable std::mutex mutex;
+
+        UploadManager();
+        ~UploadManager();
+        uint64_t Enqueue(const StagingRegion& _region, Copy _copy);
+        void Issue(const Copy& _copy);
+        void Retire();
+        void Release(const StagingRegion& _region);
+};
+
+#endif
\ No newline at end of file
@@ -1,4 +1,5 @@
 #include "Window.h"
+#include "GLState.h"
 
 Window::Window() : widht(800), height(600), xChange(0.0f), yChange(0.0f) {  }
 
@@ -64,10 +65,10 @@ void Window::Initialise() {
     }
 
     // glEnable — enable or disable server-side GL capabilities
-    glEnable(GL_DEPTH_TEST);
+    GLState::Get().Enable(GL_DEPTH_TEST);
 
     // Setup Viewport size
-    glViewport(0, 0, bufferWidth, bufferHeight);
+    GLState::Get().Viewport(0, 0, bufferWidth, bufferHeight);
 
     // glViewport specifies the affine transformation of x and y from normalized device coordinates to window coordinates. Let x nd y nd be normalized device coordinates.
     glfwSetWindowUserPointer(window, this);
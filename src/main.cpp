@@ -1,24 +1,49 @@
+#include <iostream>
 #include <vector>
 #include <memory>
+#include <unordered_map>
+#include <cmath>
+#include <algorithm>
+#include <cassert>
 
 #include "glm/glm.hpp"
 #include "glm/gtc/matrix_transform.hpp"
 #include "glm/gtc/type_ptr.hpp"
 
 #include "Mesh.h"
+#include "NormalGenerator.h"
 #include "Window.h"
 #include "Camera.h"
 #include "Shader.h"
+#include "ShaderBatch.h"
+#include "ShaderPermutations.h"
 #include "DirectionalLight.h"
 #include "Material.h"
 #include "Constans.h"
 #include "PointLight.h"
 #include "SpotLight.h"
 #include "Texture.h"
+#include "TextureStreamer.h"
+#include "TextureArrays.h"
 #include "Model.h"
+#include "ModelLoader.h"
 #include "ShadowMap.h"
 #include "OmniShadowMap.h"
+#include "CascadedShadowMap.h"
+#include "ShadowBlur.h"
 #include "SkyBox.h"
+#include "LightClusters.h"
+#include "DeferredRenderer.h"
+#include "FrameGraph.h"
+#include "GpuMemory.h"
+#include "DynamicRingBuffer.h"
+#include "GLState.h"
+#include "UploadManager.h"
+#include "SceneBVH.h"
+#include "OcclusionCuller.h"
+#include "ShadowScheduler.h"
+#include "AllocationCounter.h"
+#include "FileSystem.h"
 
 const float toRadians = 3.14159265f / 180.0f;
 
@@ -26,12 +51,24 @@ std::unique_ptr<Window> window;
 
 std::vector<Mesh*> meshList;
 
-std::vector<Shader*> shaderList;
+std::unique_ptr<ShaderPermutations> mainShaders;
 Shader* directionalShadowShader;
 Shader* omniShadowShader;
+std::unique_ptr<ShadowBlur> shadowBlur;
 
 std::unique_ptr<Camera> camera;
 
+// Declared ahead of the textures so it outlives them
+std::unique_ptr<TextureStreamer> textureStreamer;
+const size_t TEXTURE_BUDGET = 64 * 1024 * 1024;
+
+// Staging memory for every texture and buffer upload, and how much of it the upload queue sends per frame
+const size_t STAGING_BYTES = 32 * 1024 * 1024;
+const size_t UPLOAD_BYTES_PER_FRAME = 4 * 1024 * 1024;
+
+// Built by AssetPacker from Shaders, Models and Textures, without it everything is read from the loose files
+const char* const ASSET_PACK = "Assets.pak";
+
 std::unique_ptr<Texture> brickTexture;
 std::unique_ptr<Texture> plainTexture;
 
@@ -39,57 +76,116 @@ std::unique_ptr<Material> shinyMaterial;
 std::unique_ptr<Material> dullMaterial;
 
 DirectionalLight* directionalLight;
-UniformDirectionalLight* uniformDirectionalLight;
 
 std::vector<PointLight> pointLights;
-std::vector<UniformPointLight> uniformPointLight;
 
 std::vector<SpotLight> spotLights;
-std::vector<UniformSpotLight> uniformSpotLight;
 
-std::vector<UniformOmniShadowMap> uniformOmniShadowMap;
+// Shadowless fill lights, only limited by MAX_CLUSTERED_LIGHTS since each fragment walks just its own cluster
+std::vector<ClusterLight> clusteredLights;
+std::vector<ClusterLight> animatedLights;
+std::unique_ptr<LightClusters> lightClusters;
+bool clusteredLightsEnabled = true;
 
-std::unique_ptr<Model> xwing;
-std::unique_ptr<Model> blackhack;
+// Units 0-2 hold the skybox, the diffuse texture and the directional shadow map, the omni maps follow from 3
+const GLuint CLUSTER_TEXTURE_UNIT = 3 + MAX_POINT_LIGHTS + MAX_SPOT_LIGHTS;
+const GLuint MATERIAL_ARRAY_TEXTURE_UNIT = CLUSTER_TEXTURE_UNIT + 3;
 
-std::unique_ptr<SkyBox> skyBox;
+// Uniform locations differ between permutations, so each main shader variant gets its own tables
+struct MainShaderUniforms {
+    UniformDirectionalLight directionalLight{};
+    std::vector<UniformPointLight> pointLights;
+    std::vector<UniformSpotLight> spotLights;
+    std::vector<UniformOmniShadowMap> omniShadowMaps;
+};
 
-GLfloat deltaTime = 0.0f;
-GLfloat lastTime = 0.0f;
+std::unordered_map<Shader*, MainShaderUniforms> mainShaderUniforms;
 
-GLfloat blackHawkAngle = 0.0f;
+std::unique_ptr<DeferredRenderer> deferredRenderer;
+std::unique_ptr<FrameGraph> frameGraph;
+bool deferredEnabled = false;
 
-GLuint uniformModel = 0, uniformProjection = 0, unifornmView = 0, uniformEyePosition = 0;
-GLuint uniformSpecularIntesity = 0, uniformShininess = 0;
+// Prints a line whenever the tracked GPU memory changes
+bool memoryReportEnabled = false;
 
-void calcAverageNormals(const std::vector<GLuint>& indices, std::vector<Shape>& vertices) {
-    for ( size_t i = 0; i < indices.size(); i += 3 ) {
-        unsigned int in0 = indices[i];
-        unsigned int in1 = indices[i + 1];
-        unsigned int in2 = indices[i + 2];
+// Prints how many state changes the cache let through and how many it dropped over the last frame
+bool stateReportEnabled = false;
 
-        glm::vec3 v1(vertices[in1].position.x - vertices[in0].position.x,
-                     vertices[in1].position.y - vertices[in0].position.y,
-                     vertices[in1].position.z - vertices[in0].position.z);
+// Builds with TRACK_ALLOCATIONS check that a frame makes no heap allocation on the main thread once the scene has
+// settled. Loads, texture streaming and whatever a key switches on allocate for what they bring in, so they start the
+// warm-up over.
+const unsigned int ALLOCATION_WARM_UP_FRAMES = 120;
+unsigned int settledFrames = 0;
 
-        glm::vec3 v2(vertices[in2].position.x - vertices[in0].position.x,
-                     vertices[in2].position.y - vertices[in0].position.y,
-                     vertices[in2].position.z - vertices[in0].position.z);
+bool shadowsEnabled = true;
+int pcfQuality = DEFAULT_PCF_QUALITY;
 
-        glm::vec3 normal = glm::cross(v1, v2);
-        normal = glm::normalize(normal);
+// The shadow maps are kept from frame to frame, each frame redraws the stale cascades and cube faces that fit the budget
+std::unique_ptr<ShadowScheduler> shadowScheduler;
+const double SHADOW_BUDGET_MS = 2.0;
+int directionalLightShadow = 0;
+std::vector<int> pointLightShadows;
+std::vector<int> spotLightShadows;
 
-        vertices[in0].normal.x += normal.x; vertices[in0].normal.y += normal.y; vertices[in0].normal.z += normal.z;
-        vertices[in1].normal.x += normal.x; vertices[in1].normal.y += normal.y; vertices[in1].normal.z += normal.z;
-        vertices[in2].normal.x += normal.x; vertices[in2].normal.y += normal.y; vertices[in2].normal.z += normal.z;
-    }
+// Each light's cube map is sized every frame from how much of the screen its range covers, K halves them to 16 bit depth
+int omniShadowQuality = DEFAULT_OMNI_SHADOW_QUALITY;
+bool omniShadowDepth16 = false;
 
-    for (auto & vertice : vertices) {
-        glm::vec3 vec(vertice.normal.x, vertice.normal.y, vertice.normal.z);
-        vec = glm::normalize(vec);
-        vertice.normal.x = vec.x; vertice.normal.y = vec.y; vertice.normal.z = vec.z;
-    }
-}
+// The models' textures, declared ahead of the models since they hold a pointer to it
+std::unique_ptr<TextureArrays> textureArrays;
+
+// Declared ahead of the models, destroying them cancels their loads
+std::unique_ptr<ModelLoader> modelLoader;
+const double MODEL_UPLOAD_BUDGET_MS = 2.0;
+
+std::unique_ptr<Model> xwing;
+std::unique_ptr<Model> blackhack;
+
+std::unique_ptr<SkyBox> skyBox;
+
+GLfloat deltaTime = 0.0f;
+GLfloat lastTime = 0.0f;
+
+GLfloat blackHawkAngle = 0.0f;
+
+// Everything RenderScene can draw, the values are what the scene BVH hands back from its queries
+enum SceneObject : uint32_t { PYRAMID, FLOOR, XWING, BLACKHAWK, SCENE_OBJECT_COUNT };
+
+// Each pass only draws what its frustum or light range finds in here
+std::unique_ptr<SceneBVH> sceneBVH;
+int sceneProxies[SCENE_OBJECT_COUNT];
+glm::mat4 sceneTransforms[SCENE_OBJECT_COUNT];
+size_t sceneMeshCounts[SCENE_OBJECT_COUNT];
+std::vector<uint32_t> visibleObjects;
+
+// Big meshes that hide what's behind them, the camera passes skip objects they cover. Kept on the CPU since the
+// culler rasterizes them every frame.
+struct Occluder {
+    SceneObject object;
+    std::vector<glm::vec3> positions;
+    std::vector<GLuint> indices;
+};
+
+std::vector<Occluder> occluders;
+std::unique_ptr<OcclusionCuller> occlusionCuller;
+bool occlusionCullingEnabled = true;
+
+// Pixels covered by one world unit one unit away from the camera, only set by the camera passes so shadow
+// passes don't ask for texture detail
+GLfloat detailScale = 0.0f;
+
+GLuint uniformProjection = 0, unifornmView = 0, uniformEyePosition = 0;
+
+// Mirrors the DrawData block in Shaders/DrawData.glsl (std140)
+struct DrawData {
+    glm::mat4 model;
+    glm::mat4 normalMatrix;
+    glm::vec4 material;
+};
+
+// Room for about 250 draws per frame at a 256 byte offset alignment, grows if a frame needs more
+const size_t DRAW_DATA_REGION_BYTES = 64 * 1024;
+std::unique_ptr<DynamicRingBuffer> drawDataRing;
 
 void createObjects() {
     std::vector<GLuint> indices {
@@ -118,7 +214,7 @@ void createObjects() {
             {10.0f, 0.0f, 10.0f,		10.0f, 10.0f,	0.0f, -1.0f, 0.0f}
     };
 
-    calcAverageNormals(indices,vertices);
+    NormalGenerator::Generate(indices, vertices, NormalWeighting::Angle);
 
     Mesh* mesh = new Mesh();
     mesh->CreateMesh(vertices, indices);
@@ -127,99 +223,476 @@ void createObjects() {
     Mesh* mesh2 = new Mesh();
     mesh2->CreateMesh(floorVertices, floorIndices);
     meshList.push_back(mesh2);
+
+    Occluder floor { FLOOR, {}, floorIndices };
+
+    for ( const Shape& vertex : floorVertices ) {
+        floor.positions.push_back(vertex.position);
+    }
+
+    occluders.push_back(std::move(floor));
+}
+
+void CreateLights() {
+    // Three 1024 cascades take less memory than the single 2048 map they replace
+    directionalLight = new DirectionalLight(1024, 1024, glm::vec3(1.0f, 0.53f, 0.3f),
+            0.1f, 0.9f, glm::vec3(-10.0f, -12.0f, 18.5f));
+
+    pointLights = {
+            { glm::vec2(1024, 1024), glm::vec2(0.1f, 100.0f), glm::vec3(0.0f, 0.0f, 1.0f), 0.0f, 1.0f,
+              glm::vec3(5.0f, 2.0f, 0.0f), 0.3f, 0.1f, 0.1f },
+            { glm::vec2(1024, 1024), glm::vec2(0.1f, 100.0f), glm::vec3(0.0f, 1.0f, 0.0f), 0.0f, 1.0f,
+              glm::vec3(-4.0f, 3.0f, 0.0f), 0.3f, 0.1f, 0.1f }
+    };
+
+    spotLights = {
+            { glm::vec2(1024, 1024), glm::vec2(0.1f, 100.0f), glm::vec3(1.0f, 1.0f, 1.0f), 0.0f,
+              2.0f, glm::vec3(0.0f, 0.0f, 0.0f), 1.0f, 0.0f, 0.0f, glm::vec3(0.0f, -1.0f, 0.0f), 20.0f },
+            { glm::vec2(1024, 1024), glm::vec2(0.1f, 100.0f), glm::vec3(1.0f, 1.0f, 1.0f),0.0f,
+              1.0f, glm::vec3(0.0f, -1.5f, 0.0f), 1.0f, 0.0f, 0.0f, glm::vec3(-100.0f, -1.0f, 0.0f), 20.0f }
+    };
+
+    // A 16x16 field of small coloured lights hovering over the floor
+    for ( int x = 0; x < 16; x++ ) {
+        for ( int z = 0; z < 16; z++ ) {
+            float hue = ( x * 16 + z ) * 0.618034f;
+            glm::vec3 colour(0.5f + 0.5f * std::cos(hue * 6.2831853f),
+                             0.5f + 0.5f * std::cos(( hue + 0.333f ) * 6.2831853f),
+                             0.5f + 0.5f * std::cos(( hue + 0.667f ) * 6.2831853f));
+
+            clusteredLights.push_back({ glm::vec3(-9.5f + x * 1.25f, -1.5f, -9.5f + z * 1.25f), colour, 0.4f,
+                                        1.0f, 0.7f, 1.8f, glm::vec3(0.0f, -1.0f, 0.0f), 0.0f });
+        }
+    }
+
+    animatedLights = clusteredLights;
+
+    shadowScheduler = std::make_unique<ShadowScheduler>(SHADOW_BUDGET_MS);
+    directionalLightShadow = shadowScheduler->AddShadow(SHADOW_CASCADES);
+
+    for ( size_t i = 0; i < pointLights.size(); i++ ) {
+        pointLightShadows.push_back(shadowScheduler->AddShadow(6));
+    }
+
+    for ( size_t i = 0; i < spotLights.size(); i++ ) {
+        spotLightShadows.push_back(shadowScheduler->AddShadow(6));
+    }
+}
+
+void UpdateClusteredLights(GLfloat _time, const glm::mat4& _viewMatrix) {
+    for ( size_t i = 0; i < clusteredLights.size(); i++ ) {
+        animatedLights[i].position.y = clusteredLights[i].position.y + 0.4f * std::sin(_time * 1.5f + i * 0.37f);
+    }
+
+    static const std::vector<ClusterLight> noLights;
+
+    lightClusters->Assign(_viewMatrix, clusteredLightsEnabled ? animatedLights : noLights);
+    lightClusters->Upload();
+}
+
+ShaderPermutationKey CurrentPermutation() {
+    // The main pass only uploads the spot lights, point lights just cast shadows (see RenderPass)
+    return { 0, static_cast<int>(spotLights.size()), shadowsEnabled, pcfQuality };
+}
+
+MainShaderUniforms& GetMainShaderUniforms(Shader* _shader) {
+    auto found = mainShaderUniforms.find(_shader);
+
+    if ( found != mainShaderUniforms.end() ) return found->second;
+
+    MainShaderUniforms& uniforms = mainShaderUniforms[_shader];
+
+    DirectionalLight::GetUDirectionalLight(*_shader, uniforms.directionalLight);
+
+    uniforms.pointLights = std::vector<UniformPointLight>(MAX_POINT_LIGHTS);
+    PointLight::GetUPointLight(*_shader, uniforms.pointLights);
+
+    uniforms.spotLights = std::vector<UniformSpotLight>(MAX_SPOT_LIGHTS);
+    SpotLight::GetUPointLight(*_shader, uniforms.spotLights);
+
+    uniforms.omniShadowMaps = std::vector<UniformOmniShadowMap>(MAX_POINT_LIGHTS + MAX_SPOT_LIGHTS);
+    OmniShadowMap::GetUniformsOmniShadowMap(uniforms.omniShadowMaps, _shader);
+
+    return uniforms;
 }
 
 void CreateShaders() {
-    auto shader = new Shader();
-    shader->CreateFormFiles( "Shaders/shader.vert", "Shaders/shader.frag");
-    shaderList.push_back(shader);
+    // Compiled by the driver in the background while the textures and models load, each pass starts once its program is ready
+    ShaderBatch batch;
+
+    // Every variant the H and P toggles can reach, the startup one first so it's the first to link
+    mainShaders = std::make_unique<ShaderPermutations>("Shaders/shader.vert", "Shaders/shader.frag");
+    mainShaders->Precompile(CurrentPermutation());
+
+    for ( int quality = 0; quality < PCF_QUALITY_COUNT; quality++ ) {
+        mainShaders->Precompile({ 0, static_cast<int>(spotLights.size()), true, quality });
+        mainShaders->Precompile({ 0, static_cast<int>(spotLights.size()), false, quality });
+    }
 
     directionalShadowShader = new Shader();
-    directionalShadowShader->CreateFormFiles("Shaders/directionalShadowMap.vert", "Shaders/directionalShadowMap.frag");
+    batch.Add(directionalShadowShader, "Shaders/directionalShadowMap.vert", "Shaders/directionalShadowMap.frag");
 
     omniShadowShader = new Shader();
-    omniShadowShader->CreateFormFiles("Shaders/omniShadowMap.vert", "Shaders/omniShadowMap.geom", "Shaders/omniShadowMap.frag");
+    batch.Add(omniShadowShader, "Shaders/omniShadowMap.vert", "Shaders/omniShadowMap.geom", "Shaders/omniShadowMap.frag");
+
+    shadowBlur = std::make_unique<ShadowBlur>();
+    shadowBlur->CreateShaders(batch);
+
+    deferredRenderer = std::make_unique<DeferredRenderer>(window->GetBufferWidth(), window->GetBufferHeight());
+    deferredRenderer->CreateShaders(batch);
 }
 
-void RenderScene() {
-    glm::mat4 model(1.0f);
-    model = glm::translate(model, glm::vec3(0.0f, 0.0f, -2.5f));
-    glUniformMatrix4fv(uniformModel, 1, GL_FALSE, glm::value_ptr(model));
-    brickTexture->UseTexture();
-    shinyMaterial->UseMateril(uniformSpecularIntesity, uniformShininess);
-    meshList[0]->RenderMesh();
-
-    model = glm::mat4(1.0f);
-    model = glm::translate(model, glm::vec3(0.0f, -2.0f, 0.0f));
-    glUniformMatrix4fv(uniformModel, 1, GL_FALSE, glm::value_ptr(model));
-    plainTexture->UseTexture();
-    dullMaterial->UseMateril(uniformSpecularIntesity, uniformShininess);
-    meshList[1]->RenderMesh();
-
-    model = glm::mat4(1.0f);
-    model = glm::translate(model, glm::vec3(-10.0f, 0.0f, 15.0f));
-    model = glm::scale(model, glm::vec3(0.01f, 0.01f, 0.01f));
-    glUniformMatrix4fv(uniformModel, 1, GL_FALSE, glm::value_ptr(model));
-    shinyMaterial->UseMateril(uniformSpecularIntesity, uniformShininess);
-    xwing->RenderModel();
-
-    blackHawkAngle += 0.1f;
+// World space bounding sphere of an object space box
+void CalcBoundingSphere(const glm::mat4& _model, const glm::vec3& _boundsMin, const glm::vec3& _boundsMax, glm::vec3& _center,
+        GLfloat& _radius) {
+    float scale = std::max(glm::length(glm::vec3(_model[0])), std::max(glm::length(glm::vec3(_model[1])), glm::length(glm::vec3(_model[2]))));
 
-    if ( blackHawkAngle > 360.f ) blackHawkAngle = 0.1f;
+    _center = glm::vec3(_model * glm::vec4(( _boundsMin + _boundsMax ) * 0.5f, 1.0f));
+    _radius = glm::length(_boundsMax - _boundsMin) * 0.5f * scale;
+}
+
+// World space box around an object space box, the transformed extents are summed per axis so it stays tight under rotation
+void CalcWorldBounds(const glm::mat4& _model, const glm::vec3& _boundsMin, const glm::vec3& _boundsMax, glm::vec3& _worldMin,
+        glm::vec3& _worldMax) {
+    glm::vec3 center = glm::vec3(_model * glm::vec4(( _boundsMin + _boundsMax ) * 0.5f, 1.0f));
+    glm::vec3 extent = ( _boundsMax - _boundsMin ) * 0.5f;
+    glm::vec3 worldExtent = glm::abs(glm::vec3(_model[0])) * extent.x + glm::abs(glm::vec3(_model[1])) * extent.y
+                          + glm::abs(glm::vec3(_model[2])) * extent.z;
+
+    _worldMin = center - worldExtent;
+    _worldMax = center + worldExtent;
+}
+
+void GetSceneObjectBounds(uint32_t _object, glm::vec3& _boundsMin, glm::vec3& _boundsMax) {
+    switch ( _object ) {
+        case PYRAMID:
+            _boundsMin = meshList[0]->GetBoundsMin();
+            _boundsMax = meshList[0]->GetBoundsMax();
+            break;
+        case FLOOR:
+            _boundsMin = meshList[1]->GetBoundsMin();
+            _boundsMax = meshList[1]->GetBoundsMax();
+            break;
+        case XWING:
+            _boundsMin = xwing->GetBoundsMin();
+            _boundsMax = xwing->GetBoundsMax();
+            break;
+        default:
+            _boundsMin = blackhack->GetBoundsMin();
+            _boundsMax = blackhack->GetBoundsMax();
+            break;
+    }
+}
+
+// Models fill in a sub-mesh at a time, each one that arrives casts shadows the maps don't have yet
+size_t CountSceneObjectMeshes(SceneObject _object) {
+    switch ( _object ) {
+        case XWING:
+            return xwing->GetMeshCount();
+        case BLACKHAWK:
+            return blackhack->GetMeshCount();
+        default:
+            return 1;
+    }
+}
 
-    model = glm::mat4(1.0f);
+// Moves an object's box in the scene BVH to its transform, only the nodes above it are refit and nothing at all when
+// the box is unchanged, which is also how a model picks up its real bounds once its load finishes
+void PlaceSceneObject(SceneObject _object, const glm::mat4& _model) {
+    glm::vec3 boundsMin, boundsMax, worldMin, worldMax;
+    GetSceneObjectBounds(_object, boundsMin, boundsMax);
+    CalcWorldBounds(_model, boundsMin, boundsMax, worldMin, worldMax);
+
+    size_t meshes = CountSceneObjectMeshes(_object);
+
+    if ( sceneProxies[_object] == SceneBVH::NO_PROXY ) {
+        sceneProxies[_object] = sceneBVH->Insert(worldMin, worldMax, _object);
+    } else {
+        // The shadows it leaves are as stale as the ones it moves into
+        if ( _model != sceneTransforms[_object] || meshes != sceneMeshCounts[_object] ) {
+            glm::vec3 oldMin, oldMax;
+            sceneBVH->GetBounds(sceneProxies[_object], oldMin, oldMax);
+
+            shadowScheduler->Invalidate(oldMin, oldMax);
+            shadowScheduler->Invalidate(worldMin, worldMax);
+        }
+
+        sceneBVH->Update(sceneProxies[_object], worldMin, worldMax);
+    }
+
+    sceneTransforms[_object] = _model;
+    sceneMeshCounts[_object] = meshes;
+}
+
+glm::mat4 CalcBlackHawkTransform() {
+    glm::mat4 model(1.0f);
     model = glm::rotate(model, -blackHawkAngle * toRadians, glm::vec3(0.0f, 1.0f, 0.0f));
     model = glm::translate(model, glm::vec3(-8.0f, 2.0f, 5.0f));
     model = glm::rotate(model, -20.0f * toRadians, glm::vec3(0.0f, 0.0f, 1.0f));
     model = glm::rotate(model, -90.0f * toRadians, glm::vec3(1.0f, 0.0f, 0.0f));
     model = glm::scale(model, glm::vec3(0.4f, 0.4f, 0.4f));
-    glUniformMatrix4fv(uniformModel, 1, GL_FALSE, glm::value_ptr(model));
-    shinyMaterial->UseMateril(uniformSpecularIntesity, uniformShininess);
-    blackhack->RenderModel();
+
+    return model;
+}
+
+// Prints which model the camera looks at, tested against their triangles rather than their boxes
+void ReportLookAt() {
+    struct {
+        SceneObject object;
+        const Model* model;
+        const char* name;
+    } models[] = { { XWING, xwing.get(), "x-wing" }, { BLACKHAWK, blackhack.get(), "blackhawk" } };
+
+    glm::vec3 origin = camera->getCameraPosition();
+    glm::vec3 direction = camera->getCameraDirection();
+    GLfloat closest = 100.0f;
+    const char* seen = nullptr;
+
+    for ( const auto& entry : models ) {
+        // The direction isn't normalised again in object space, so the hit distance stays in world units
+        glm::mat4 toObject = glm::inverse(sceneTransforms[entry.object]);
+        RayHit hit;
+
+        if ( entry.model->Raycast(glm::vec3(toObject * glm::vec4(origin, 1.0f)), glm::vec3(toObject * glm::vec4(direction, 0.0f)), closest, hit) ) {
+            closest = hit.distance;
+            seen = entry.name;
+        }
+    }
+
+    if ( seen ) {
+        std::cout << "Looking at the " << seen << ", " << closest << " units away" << std::endl;
+    } else {
+        std::cout << "Looking at neither model" << std::endl;
+    }
+}
+
+// The occluders as the camera sees them this frame, rasterized on the worker threads before any pass is recorded
+void UpdateOcclusion(const glm::mat4& _viewProjection) {
+    occlusionCuller->Begin(_viewProjection);
+
+    for ( const auto& occluder : occluders ) {
+        occlusionCuller->AddOccluder(occluder.positions, occluder.indices, sceneTransforms[occluder.object]);
+    }
+
+    occlusionCuller->Rasterize();
+}
+
+// Picks the tier of the light's cube map for this frame, a new size takes a texture of that tier from the scheduler's pool
+// and redraws every face
+void UpdateOmniShadowSize(PointLight& _light, const glm::mat4& _projection) {
+    auto* shadowMap = static_cast<OmniShadowMap*>(_light.GetShadowMap().get());
+
+    GLfloat range = std::min(_light.CalcRange(), _light.GetFarPlane());
+    GLfloat distance = glm::length(_light.GetPosition() - camera->getCameraPosition());
+    GLfloat screenSize = static_cast<GLfloat>(std::max(window->GetBufferWidth(), window->GetBufferHeight()));
+
+    // Pixels across the light's range on screen, all of them once the camera is inside it
+    if ( distance > range ) {
+        screenSize = std::min(screenSize, range / distance * _projection[1][1] * window->GetBufferHeight());
+    }
+
+    GLuint size = OmniShadowMap::CalcResolution(screenSize, shadowMap->GetShadowWidth(), OMNI_SHADOW_QUALITIES[omniShadowQuality]);
+    shadowMap->SetResolution(size, omniShadowDepth16 ? GL_DEPTH_COMPONENT16 : GL_DEPTH_COMPONENT24);
+}
+
+// Whether a lighting pass reads the light's cube map this frame, see BuildFrame. Only those take a target from the
+// scheduler or change size. One nobody reads keeps the texture it last drew into, a target that went back to the pool
+// would leave a name in the shadow map that the lighting binds after another light got it or the pool deleted it.
+bool IsOmniShadowRead(bool _isSpot, bool _isOn) {
+    if ( !shadowsEnabled ) return false;
+
+    // The forward path only uploads the spot lights (see RenderPass)
+    if ( !_isSpot ) return deferredEnabled && deferredRenderer->IsReady();
+
+    return _isOn;
+}
+
+// Tells the shadow scheduler where this frame's cascade windows and omni lights are, whatever moved is stale
+void UpdateShadowSlices(const glm::mat4& _projection) {
+    for ( GLuint i = 0; i < SHADOW_CASCADES; i++ ) {
+        GLfloat start = i == 0 ? 0.0f : directionalLight->GetCascade(i - 1).splitDepth;
+        shadowScheduler->SetCascade(directionalLightShadow, i, directionalLight->GetCascade(i).transform, start);
+    }
+
+    for ( size_t i = 0; i < pointLights.size(); i++ ) {
+        if ( IsOmniShadowRead(false, true) ) UpdateOmniShadowSize(pointLights[i], _projection);
+        shadowScheduler->SetOmni(pointLightShadows[i], pointLights[i].GetPosition(), pointLights[i].GetFarPlane());
+    }
+
+    for ( size_t i = 0; i < spotLights.size(); i++ ) {
+        if ( IsOmniShadowRead(true, spotLights[i].IsOn()) ) UpdateOmniShadowSize(spotLights[i], _projection);
+        shadowScheduler->SetOmni(spotLightShadows[i], spotLights[i].GetPosition(), spotLights[i].GetFarPlane());
+    }
+}
+
+void CreateSceneObjects() {
+    sceneBVH = std::make_unique<SceneBVH>();
+
+    occlusionCuller = std::make_unique<OcclusionCuller>();
+
+    for ( int& proxy : sceneProxies ) proxy = SceneBVH::NO_PROXY;
+
+    PlaceSceneObject(PYRAMID, glm::translate(glm::mat4(1.0f), glm::vec3(0.0f, 0.0f, -2.5f)));
+    PlaceSceneObject(FLOOR, glm::translate(glm::mat4(1.0f), glm::vec3(0.0f, -2.0f, 0.0f)));
+    PlaceSceneObject(XWING, glm::scale(glm::translate(glm::mat4(1.0f), glm::vec3(-10.0f, 0.0f, 15.0f)), glm::vec3(0.01f, 0.01f, 0.01f)));
+    PlaceSceneObject(BLACKHAWK, CalcBlackHawkTransform());
+}
+
+// On-screen diameter in pixels, what the texture streamer picks mips by
+GLfloat CalcScreenSize(const glm::mat4& _model, const glm::vec3& _boundsMin, const glm::vec3& _boundsMax) {
+    glm::vec3 center;
+    GLfloat radius;
+    CalcBoundingSphere(_model, _boundsMin, _boundsMax, center, radius);
+
+    GLfloat distance = std::max(glm::length(center - camera->getCameraPosition()) - radius, 0.1f);
+
+    return 2.0f * radius / distance * detailScale;
+}
+
+void RequestTextureDetail(const Texture* _texture, const glm::mat4& _model, const Mesh* _mesh) {
+    if ( detailScale > 0.0f ) textureStreamer->Request(_texture, CalcScreenSize(_model, _mesh->GetBoundsMin(), _mesh->GetBoundsMax()));
+}
+
+void RequestTextureDetail(const Model* _model, const glm::mat4& _modelMatrix) {
+    if ( detailScale > 0.0f ) _model->RequestTextures(*textureStreamer, CalcScreenSize(_modelMatrix, _model->GetBoundsMin(), _model->GetBoundsMax()));
+}
+
+// Writes a draw's matrices and material into this frame's slice of the ring and points the DrawData block at it
+void SetDrawData(const glm::mat4& _model, const Material& _material, bool _textureArrays = false) {
+    DrawData data{ _model, glm::transpose(glm::inverse(_model)),
+                   glm::vec4(_material.GetSpecularIntensity(), _material.GetShininess(), _textureArrays ? 1.0f : 0.0f, 0.0f) };
+
+    GLintptr offset = drawDataRing->Write(&data, sizeof(data));
+    drawDataRing->BindRange(DRAW_DATA_BINDING, offset, sizeof(data));
 }
 
-void DirectionalShadowMapPass(DirectionalLight* _light) {
-    directionalShadowShader->UseShader();
+void DrawSceneObject(uint32_t _object) {
+    const glm::mat4& model = sceneTransforms[_object];
+
+    switch ( _object ) {
+        case PYRAMID:
+            SetDrawData(model, *shinyMaterial);
+            brickTexture->UseTexture();
+            RequestTextureDetail(brickTexture.get(), model, meshList[0]);
+            meshList[0]->RenderMesh();
+            break;
+        case FLOOR:
+            SetDrawData(model, *dullMaterial);
+            plainTexture->UseTexture();
+            RequestTextureDetail(plainTexture.get(), model, meshList[1]);
+            meshList[1]->RenderMesh();
+            break;
+        case XWING:
+            SetDrawData(model, *shinyMaterial, xwing->UsesTextureArrays());
+            xwing->RenderModel();
+            RequestTextureDetail(xwing.get(), model);
+            break;
+        case BLACKHAWK:
+            SetDrawData(model, *shinyMaterial, blackhack->UsesTextureArrays());
+            blackhack->RenderModel();
+            RequestTextureDetail(blackhack.get(), model);
+            break;
+    }
+}
+
+// The blackhawk turns once per frame before anything is drawn, so every pass and the shadow scheduler see it in the
+// same place. The step is about what the passes of a frame used to add up to.
+void AnimateScene() {
+    blackHawkAngle += 0.4f;
+
+    if ( blackHawkAngle > 360.f ) blackHawkAngle = 0.1f;
+
+    PlaceSceneObject(BLACKHAWK, CalcBlackHawkTransform());
+}
+
+// Draws what the scene BVH finds inside a view-projection's frustum, a camera or a shadow cascade. The camera passes
+// also leave out what the occluders hide.
+void RenderScene(const Frustum& _frustum, const OcclusionCuller* _occlusion = nullptr) {
+    sceneBVH->Query(_frustum, visibleObjects);
+
+    if ( _occlusion ) {
+        visibleObjects.erase(std::remove_if(visibleObjects.begin(), visibleObjects.end(), [_occlusion](uint32_t _object) {
+            glm::vec3 boundsMin, boundsMax;
+            sceneBVH->GetBounds(sceneProxies[_object], boundsMin, boundsMax);
 
-    glViewport(0, 0, _light->GetShadowMap()->GetShadowWidth(), _light->GetShadowMap()->GetShadowHeight());
+            return !_occlusion->IsVisible(boundsMin, boundsMax);
+        }), visibleObjects.end());
+    }
 
-    _light->GetShadowMap()->Write();
-    glClear(GL_DEPTH_BUFFER_BIT);
+    for ( uint32_t object : visibleObjects ) {
+        DrawSceneObject(object);
+    }
+}
 
-    uniformModel = directionalShadowShader->GetModelLocation();
+// Draws what the scene BVH finds within a light's reach, all six faces of an omni shadow map at once
+void RenderScene(const glm::vec3& _center, GLfloat _radius) {
+    sceneBVH->Query(_center, _radius, visibleObjects);
 
-    ShadowMap::SetDirectionalLightTransform(_light->CalcLightTransform(), directionalShadowShader);
+    for ( uint32_t object : visibleObjects ) {
+        DrawSceneObject(object);
+    }
+}
+
+// Redraws the cascades in the mask, false when nothing could be drawn
+bool DirectionalShadowMapPass(DirectionalLight* _light, GLuint _cascades) {
+    if ( !directionalShadowShader->UseShader() ) return false;
+
+    auto* shadowMap = static_cast<CascadedShadowMap*>(_light->GetShadowMap().get());
+
+    GLState::Get().Viewport(0, 0, shadowMap->GetShadowWidth(), shadowMap->GetShadowHeight());
 
     directionalShadowShader->Validate();
 
-    RenderScene();
+    bool complete = true;
+
+    for ( GLuint i = 0; i < SHADOW_CASCADES; i++ ) {
+        if ( !( _cascades & ( 1u << i ) ) ) continue;
 
-    glBindFramebuffer(GL_FRAMEBUFFER, 0);
+        if ( !shadowMap->WriteLayer(i) ) {
+            complete = false;
+            break;
+        }
+
+        const ShadowCascade& cascade = _light->GetCascade(i);
+        ShadowMap::SetDirectionalLightTransform(cascade.transform, directionalShadowShader);
+
+        RenderScene(Frustum(cascade.transform));
+
+        _light->CommitCascade(i);
+    }
+
+    GLState::Get().BindFramebuffer(GL_FRAMEBUFFER, 0);
+
+    return complete;
 }
 
-void OmniShadowMapPass(PointLight* _light) {
-    omniShadowShader->UseShader();
+// Redraws the cube faces in the mask, the geometry shader skips the others
+bool OmniShadowMapPass(PointLight* _light, GLuint _faces) {
+    if ( !omniShadowShader->UseShader() ) return false;
 
-    glViewport(0, 0, _light->GetShadowMap()->GetShadowWidth(), _light->GetShadowMap()->GetShadowHeight());
+    auto* shadowMap = static_cast<OmniShadowMap*>(_light->GetShadowMap().get());
 
-    _light->GetShadowMap()->Write();
-    glClear(GL_DEPTH_BUFFER_BIT);
+    GLState::Get().Viewport(0, 0, shadowMap->GetShadowWidth(), shadowMap->GetShadowHeight());
 
-    uniformModel = omniShadowShader->GetModelLocation();
+    shadowMap->Write();
+    shadowMap->ClearFaces(_faces);
 
+    glUniform1i(omniShadowShader->GetUniformLocation("faceMask"), _faces);
     glUniform3f(omniShadowShader->GetUniformLocation("lightPos"), _light->GetPosition().x, _light->GetPosition().y, _light->GetPosition().z);
     glUniform1f(omniShadowShader->GetUniformLocation("farPlane"), _light->GetFarPlane());
     OmniShadowMap::SetLightMatrices(omniShadowShader, _light->CalcLightTransform());
 
     omniShadowShader->Validate();
 
-    RenderScene();
+    RenderScene(_light->GetPosition(), _light->GetFarPlane());
 
-    glBindFramebuffer(GL_FRAMEBUFFER, 0);
+    GLState::Get().BindFramebuffer(GL_FRAMEBUFFER, 0);
+
+    return true;
 }
 
 void RenderPass(const glm::mat4& _projection, const glm::mat4 _viewMatrix) {
-    glViewport(0, 0, 1366, 768);
+    GLState::Get().Viewport(0, 0, 1366, 768);
 
     // glClearColor — specify clear values for the color buffers
     glClearColor(0.0f, 0.0f, 0.0f, 1.0f);
@@ -230,94 +703,282 @@ void RenderPass(const glm::mat4& _projection, const glm::mat4 _viewMatrix) {
 
     skyBox->DrawSkyBox(_viewMatrix, _projection);
 
-    shaderList[0]->UseShader();
+    // Picks the variant with the current light counts and shadow settings baked in, compiling it on first use
+    Shader* shader = mainShaders->Get(CurrentPermutation());
+
+    if ( !shader->UseShader() ) return;
 
-    uniformModel = shaderList[0]->GetModelLocation();
-    uniformProjection = shaderList[0]->GetProjectionLocation();
-    unifornmView = shaderList[0]->GetViewLocation();
-    uniformEyePosition = shaderList[0]->GetUniformLocation("eyePosition");
-    uniformSpecularIntesity = shaderList[0]->GetUniformLocation("material.specularIntensity");
-    uniformShininess = shaderList[0]->GetUniformLocation("material.shininess");
+    MainShaderUniforms& uniforms = GetMainShaderUniforms(shader);
+
+    uniformProjection = shader->GetProjectionLocation();
+    unifornmView = shader->GetViewLocation();
+    uniformEyePosition = shader->GetUniformLocation("eyePosition");
 
     glUniformMatrix4fv(uniformProjection, 1, GL_FALSE, glm::value_ptr(_projection));
     glUniformMatrix4fv(unifornmView, 1, GL_FALSE, glm::value_ptr(_viewMatrix));
     glUniform3f(uniformEyePosition, camera->getCameraPosition().x, camera->getCameraPosition().y, camera->getCameraPosition().z);
 
-    DirectionalLight::SetDirectionalLight(*directionalLight, *uniformDirectionalLight);
+    lightClusters->Bind(CLUSTER_TEXTURE_UNIT, window->GetBufferWidth(), window->GetBufferHeight(), shader);
+
+    DirectionalLight::SetDirectionalLight(*directionalLight, uniforms.directionalLight);
 
-//    PointLight::SetPointLights(pointLights, uniformPointLight, shaderList[0]->GetUniformLocation("pointLightCount"),
-//            3, 0, uniformOmniShadowMap);
+//    PointLight::SetPointLights(pointLights, uniforms.pointLights, shader->GetUniformLocation("pointLightCount"),
+//            3, 0, uniforms.omniShadowMaps);
 
-    SpotLight::SetPointLights(spotLights, uniformSpotLight, shaderList[0]->GetUniformLocation("spotLightCount"),
-            3 + pointLights.size(), pointLights.size(), uniformOmniShadowMap);
+    SpotLight::SetPointLights(spotLights, uniforms.spotLights, shader->GetUniformLocation("spotLightCount"),
+            3 + pointLights.size(), pointLights.size(), uniforms.omniShadowMaps);
 
-    ShadowMap::SetDirectionalLightTransform(directionalLight->CalcLightTransform(),shaderList[0]);
+    directionalLight->UseCascades(shader);
 
     directionalLight->GetShadowMap()->Read(GL_TEXTURE2);
-    ShadowMap::SetTexture(1, shaderList[0]);
-    ShadowMap::SetDirectionalShadowMap(2, shaderList[0]);
+    ShadowMap::SetTexture(1, shader);
+    ShadowMap::SetDirectionalShadowMap(2, shader);
+    glUniform1i(shader->GetUniformLocation("materialTextures"), MATERIAL_ARRAY_TEXTURE_UNIT);
+
+    shader->Validate();
+
+    detailScale = _projection[1][1] * window->GetBufferHeight() * 0.5f;
+    RenderScene(Frustum(_projection * _viewMatrix), occlusionCullingEnabled ? occlusionCuller.get() : nullptr);
+    detailScale = 0.0f;
+}
+
+void DeferredGeometryPass(const glm::mat4& _projection, const glm::mat4& _viewMatrix) {
+    Shader* shader = deferredRenderer->BeginGeometryPass(_projection, _viewMatrix);
+
+    if ( !shader ) return;
+
+    glUniform1i(shader->GetUniformLocation("materialTextures"), MATERIAL_ARRAY_TEXTURE_UNIT);
+
+    detailScale = _projection[1][1] * window->GetBufferHeight() * 0.5f;
+    RenderScene(Frustum(_projection * _viewMatrix), occlusionCullingEnabled ? occlusionCuller.get() : nullptr);
+    detailScale = 0.0f;
+}
+
+// Returns what the lighting passes sample: the depth array, or the blurred moments for a prefiltered quality. Both are
+// kept by the shadow scheduler, the pass only redraws the cascades it picked for this frame.
+FrameResource AddDirectionalShadowPass(FrameGraph& _graph) {
+    auto* cascades = static_cast<CascadedShadowMap*>(directionalLight->GetShadowMap().get());
+
+    GLuint depth = shadowScheduler->GetTarget(directionalLightShadow, ShadowScheduler::DEPTH_TARGET, cascades->GetDescription());
+    FrameResource shadowMap = _graph.Import("DirectionalShadowMap", false, depth);
+
+    if ( !PCF_QUALITIES[pcfQuality].prefiltered ) {
+        // Going back to a prefiltered quality starts the moments over. Dropped from the shadow map right away, the
+        // texture may go to another user or be deleted by the pool.
+        shadowScheduler->ReleaseTarget(directionalLightShadow, ShadowScheduler::MOMENTS_TARGET);
+        cascades->AttachMoments(0, false);
+
+        _graph.AddPass("DirectionalShadow", {}, { shadowMap }, [shadowMap, cascades](FrameGraph& _frame) {
+            bool newDepth = shadowScheduler->ConsumeNewTarget(directionalLightShadow, ShadowScheduler::DEPTH_TARGET);
+            cascades->Attach(_frame.GetTexture(shadowMap), newDepth);
+
+            GLuint update = shadowScheduler->GetUpdateMask(directionalLightShadow);
+            if ( !update ) return;
+
+            shadowScheduler->BeginUpdate(directionalLightShadow);
+            shadowScheduler->EndUpdate(directionalLightShadow, DirectionalShadowMapPass(directionalLight, update));
+        });
+
+        return shadowMap;
+    }
+
+    FrameTextureDesc momentsDesc = cascades->GetMomentsDescription();
+    GLuint momentsTexture = shadowScheduler->GetTarget(directionalLightShadow, ShadowScheduler::MOMENTS_TARGET, momentsDesc);
+    FrameResource moments = _graph.Import("DirectionalShadowMoments", false, momentsTexture);
+    FrameResource scratch = _graph.Create("ShadowBlurScratch", ShadowBlur::GetScratchDescription(momentsDesc));
+
+    _graph.AddPass("DirectionalShadow", {}, { shadowMap, moments }, [shadowMap, moments, cascades](FrameGraph& _frame) {
+        bool newDepth = shadowScheduler->ConsumeNewTarget(directionalLightShadow, ShadowScheduler::DEPTH_TARGET);
+        bool newMoments = shadowScheduler->ConsumeNewTarget(directionalLightShadow, ShadowScheduler::MOMENTS_TARGET);
+        cascades->Attach(_frame.GetTexture(shadowMap), newDepth);
+        cascades->AttachMoments(_frame.GetTexture(moments), newMoments);
+
+        GLuint update = shadowScheduler->GetUpdateMask(directionalLightShadow);
+        if ( !update ) return;
+
+        shadowScheduler->BeginUpdate(directionalLightShadow);
+        shadowScheduler->EndUpdate(directionalLightShadow, DirectionalShadowMapPass(directionalLight, update));
+    });
+
+    _graph.AddPass("ShadowBlur", { moments }, { moments, scratch }, [moments, scratch, momentsDesc](FrameGraph& _frame) {
+        shadowBlur->Blur(_frame.GetTexture(moments), _frame.GetTexture(scratch), momentsDesc,
+                shadowScheduler->GetUpdateMask(directionalLightShadow));
+    });
+
+    return moments;
+}
+
+// The light's cube map is kept by the shadow scheduler, the pass only redraws the faces it picked for this frame
+FrameResource AddOmniShadowPass(FrameGraph& _graph, PointLight* _light, int _shadow) {
+    GLuint texture = shadowScheduler->GetTarget(_shadow, ShadowScheduler::DEPTH_TARGET, _light->GetShadowMap()->GetDescription());
+    FrameResource shadowMap = _graph.Import("OmniShadowMap", false, texture);
+
+    _graph.AddPass("OmniShadow", {}, { shadowMap }, [shadowMap, _light, _shadow](FrameGraph& _frame) {
+        bool newStorage = shadowScheduler->ConsumeNewTarget(_shadow, ShadowScheduler::DEPTH_TARGET);
+        _light->GetShadowMap()->Attach(_frame.GetTexture(shadowMap), newStorage);
+
+        GLuint faces = shadowScheduler->GetUpdateMask(_shadow);
+        if ( !faces ) return;
+
+        shadowScheduler->BeginUpdate(_shadow);
+        shadowScheduler->EndUpdate(_shadow, OmniShadowMapPass(_light, faces));
+    });
+
+    return shadowMap;
+}
+
+void BuildFrame(FrameGraph& _graph, const glm::mat4& _projection, const glm::mat4& _viewMatrix) {
+    FrameResource backBuffer = _graph.Import("BackBuffer", true);
+
+    // Only the shadows a lighting pass reads this frame are declared and handed to the scheduler. The others keep the
+    // target they have, taking or resizing one would release a texture their shadow map still names.
+    FrameResource directionalShadow = 0;
+
+    if ( shadowsEnabled ) {
+        directionalShadow = AddDirectionalShadowPass(_graph);
+        shadowScheduler->Request(directionalLightShadow);
+    }
+
+    if ( deferredEnabled && deferredRenderer->IsReady() ) {
+        FrameResource gBuffer = _graph.Import("GBuffer", false);
+
+        _graph.AddPass("GBuffer", {}, { gBuffer }, [_projection, _viewMatrix](FrameGraph&) {
+            DeferredGeometryPass(_projection, _viewMatrix);
+        });
+
+        // Light counts don't matter here, every shadowed light gets its own draw
+        ShaderPermutationKey key { 0, 0, shadowsEnabled, pcfQuality };
+        glm::vec3 eyePosition = camera->getCameraPosition();
+
+        FrameResource reads[] { gBuffer, directionalShadow };
+
+        _graph.AddPass("DeferredDirectional", { reads, shadowsEnabled ? 2u : 1u }, { gBuffer }, [=](FrameGraph&) {
+            DeferredLights lights { directionalLight, lightClusters.get(), CLUSTER_TEXTURE_UNIT };
+            deferredRenderer->DirectionalPass(lights, key, _projection, _viewMatrix, eyePosition, skyBox.get());
+        });
+
+        // Each shadow pass is declared right before the light that reads it
+        auto addLight = [&](PointLight* _light, int _shadow, bool _isSpot) {
+            FrameResource lightReads[] { gBuffer, 0 };
+            size_t lightReadCount = 1;
+
+            if ( IsOmniShadowRead(_isSpot, true) ) {
+                lightReads[lightReadCount++] = AddOmniShadowPass(_graph, _light, _shadow);
+                shadowScheduler->Request(_shadow);
+            }
+
+            _graph.AddPass("DeferredLight", { lightReads, lightReadCount }, { gBuffer }, [=](FrameGraph&) {
+                deferredRenderer->LightPass(*_light, _isSpot, key, _projection, _viewMatrix, eyePosition);
+            });
+        };
 
-    glm::vec3 lowerLight = camera->getCameraPosition();
-    lowerLight.y -= 0.3f;
-    spotLights[0].SetFlash(lowerLight, camera->getCameraDirection());
+        for ( size_t i = 0; i < pointLights.size(); i++ ) {
+            addLight(&pointLights[i], pointLightShadows[i], false);
+        }
+
+        for ( size_t i = 0; i < spotLights.size(); i++ ) {
+            if ( spotLights[i].IsOn() ) addLight(&spotLights[i], spotLightShadows[i], true);
+        }
+
+        _graph.AddPass("Present", { gBuffer }, { backBuffer }, [](FrameGraph&) {
+            deferredRenderer->Present(window->GetBufferWidth(), window->GetBufferHeight());
+        });
+    } else {
+        FrameResource reads[MAX_SPOT_LIGHTS + 1];
+        size_t readCount = 0;
+
+        // The point lights aren't uploaded here (see RenderPass), they don't get a shadow pass at all
+        // An unlit spot light still has a sampler in the forward shader, but its contribution is zero whatever it reads
+        for ( size_t i = 0; i < spotLights.size(); i++ ) {
+            if ( IsOmniShadowRead(true, spotLights[i].IsOn()) ) {
+                reads[readCount++] = AddOmniShadowPass(_graph, &spotLights[i], spotLightShadows[i]);
+                shadowScheduler->Request(spotLightShadows[i]);
+            }
+        }
+
+        if ( shadowsEnabled ) reads[readCount++] = directionalShadow;
+
+        _graph.AddPass("Forward", { reads, readCount }, { backBuffer }, [_projection, _viewMatrix](FrameGraph&) {
+            RenderPass(_projection, _viewMatrix);
+        });
+    }
+}
 
-    shaderList[0]->Validate();
+// True once per press, the key is let go so holding it down doesn't toggle every frame
+bool ConsumeKey(int _key) {
+    if ( !window->getKeys()[_key] ) return false;
 
-    RenderScene();
+    window->getKeys()[_key] = false;
+    settledFrames = 0;
+
+    return true;
+}
+
+// Counts the frame's allocations towards the warm-up, or reports them once the scene has settled
+void CheckFrameAllocations(size_t _allocations) {
+    bool loading = modelLoader->GetPendingCount() > 0 || textureStreamer->GetPendingCount() > 0
+            || UploadManager::Get().GetQueuedBytes() > 0;
+
+    if ( loading ) {
+        settledFrames = 0;
+        return;
+    }
+
+    if ( settledFrames < ALLOCATION_WARM_UP_FRAMES ) {
+        settledFrames++;
+        return;
+    }
+
+    if ( _allocations > 0 ) {
+        std::cerr << "Settled frame made " << _allocations << " heap allocations" << std::endl;
+        assert(_allocations == 0);
+    }
 }
 
 int main() {
+    // Ahead of every load, the file system isn't locked once the loader threads read through it
+    FileSystem::Get().Mount(ASSET_PACK);
+
     window = std::make_unique<Window>(1366, 768);
     window->Initialise();
 
+    // Before anything uploads, the meshes created next already go through it
+    UploadManager::Get().Create(STAGING_BYTES, UPLOAD_BYTES_PER_FRAME);
+
     createObjects();
+    CreateLights();
     CreateShaders();
 
     camera = std::make_unique<Camera>(glm::vec3(0.0f, 0.0f, 0.0f), glm::vec3(0.0f, 1.0f, 0.0f), -90.0f, 0.0f, 5.0f, 0.5f);
 
+    // Only the small mip tails are uploaded before the first frame, the rest streams in while the scene is visible
+    textureStreamer = std::make_unique<TextureStreamer>(TEXTURE_BUDGET);
+
     brickTexture = std::make_unique<Texture>("Textures/brick.png");
-    brickTexture->LoadTextureA();
+    brickTexture->StreamTexture(*textureStreamer);
 
     plainTexture = std::make_unique<Texture>("Textures/dirt.png");
-    plainTexture->LoadTextureA();
+    plainTexture->StreamTexture(*textureStreamer);
 
     shinyMaterial = std::make_unique<Material>(4.0f, 256);
     dullMaterial = std::make_unique<Material>(0.3f, 4);
 
-    xwing = std::make_unique<Model>();
-    xwing->LoadModel("Models/x-wing.obj");
+    // Each model draws once per texture size tier instead of once per sub-mesh, the arrays share TEXTURE_BUDGET with the streamer
+    textureArrays = std::make_unique<TextureArrays>(MATERIAL_ARRAY_TEXTURE_UNIT, *textureStreamer);
 
-    blackhack = std::make_unique<Model>();
-    blackhack->LoadModel("Models/uh60.obj");
+    // The models import in the background and appear a sub-mesh at a time once the first frames are up
+    modelLoader = std::make_unique<ModelLoader>(MODEL_UPLOAD_BUDGET_MS);
 
-    directionalLight = new DirectionalLight(2048, 2048, glm::vec3(1.0f, 0.53f, 0.3f),
-            0.1f, 0.9f, glm::vec3(-10.0f, -12.0f, 18.5f));
-
-    uniformDirectionalLight = new UniformDirectionalLight();
-    DirectionalLight::GetUDirectionalLight(*shaderList[0], *uniformDirectionalLight);
-
-    pointLights = {
-            { glm::vec2(1024, 1024), glm::vec2(0.1f, 100.0f), glm::vec3(0.0f, 0.0f, 1.0f), 0.0f, 1.0f,
-              glm::vec3(5.0f, 2.0f, 0.0f), 0.3f, 0.1f, 0.1f },
-            { glm::vec2(1024, 1024), glm::vec2(0.1f, 100.0f), glm::vec3(0.0f, 1.0f, 0.0f), 0.0f, 1.0f,
-              glm::vec3(-4.0f, 3.0f, 0.0f), 0.3f, 0.1f, 0.1f }
-    };
-
-    uniformPointLight = std::vector<UniformPointLight>(MAX_POINT_LIGHTS);
-    PointLight::GetUPointLight(*shaderList[0], uniformPointLight);
-
-    spotLights = {
-            { glm::vec2(1024, 1024), glm::vec2(0.1f, 100.0f), glm::vec3(1.0f, 1.0f, 1.0f), 0.0f,
-              2.0f, glm::vec3(0.0f, 0.0f, 0.0f), 1.0f, 0.0f, 0.0f, glm::vec3(0.0f, -1.0f, 0.0f), 20.0f },
-            { glm::vec2(1024, 1024), glm::vec2(0.1f, 100.0f), glm::vec3(1.0f, 1.0f, 1.0f),0.0f,
-              1.0f, glm::vec3(0.0f, -1.5f, 0.0f), 1.0f, 0.0f, 0.0f, glm::vec3(-100.0f, -1.0f, 0.0f), 20.0f }
-    };
+    // Both keep a triangle BVH for ray queries, see ReportLookAt
+    xwing = std::make_unique<Model>();
+    xwing->SetKeepTriangles(true);
+    modelLoader->Load(*xwing, "Models/x-wing.obj", *textureArrays);
 
-    uniformSpotLight = std::vector<UniformSpotLight>(MAX_POINT_LIGHTS);
-    SpotLight::GetUPointLight(*shaderList[0], uniformSpotLight);
+    blackhack = std::make_unique<Model>();
+    blackhack->SetKeepTriangles(true);
+    modelLoader->Load(*blackhack, "Models/uh60.obj", *textureArrays);
 
-    uniformOmniShadowMap = std::vector<UniformOmniShadowMap>(MAX_POINT_LIGHTS + MAX_SPOT_LIGHTS);
-    OmniShadowMap::GetUniformsOmniShadowMap(uniformOmniShadowMap, shaderList[0]);
+    CreateSceneObjects();
 
     skyBox = std::make_unique<SkyBox>( std::vector<std::string> {
         "Textures/Skybox/cupertin-lake_rt.tga",
@@ -331,8 +992,16 @@ int main() {
     glm::mat4 projection = glm::perspective(glm::radians(60.0f),
             static_cast<GLfloat>(window->GetBufferWidth()) / static_cast<GLfloat>(window->GetBufferHeight()),0.1f, 100.0f);
 
+    frameGraph = std::make_unique<FrameGraph>();
+
+    drawDataRing = std::make_unique<DynamicRingBuffer>(GL_UNIFORM_BUFFER, DRAW_DATA_REGION_BYTES);
+
+    lightClusters = std::make_unique<LightClusters>();
+    lightClusters->SetProjection(projection, 0.1f, 100.0f);
+
     // Loop until window closed
     while ( window->getShouldClose() ) {
+        size_t allocationsBefore = AllocationCounter::GetThreadCount();
 
         // This function returns the value of the GLFW timer.
         GLfloat now = glfwGetTime();
@@ -346,39 +1015,106 @@ int main() {
         camera->KeyControl(window->getKeys(), deltaTime);
         camera->MouseControl(window->getXChange(), window->getYChange());
 
-        if ( window->getKeys()[GLFW_KEY_L] ) {
-            spotLights[0].Toggle();
-            window->getKeys()[GLFW_KEY_L] = false;
-        }
+        if ( ConsumeKey(GLFW_KEY_L) ) spotLights[0].Toggle();
 
-        DirectionalShadowMapPass(directionalLight);
+        if ( ConsumeKey(GLFW_KEY_H) ) shadowsEnabled = !shadowsEnabled;
 
-        for ( auto& pointLight : pointLights ) {
-            OmniShadowMapPass(&pointLight);
-        }
+        if ( ConsumeKey(GLFW_KEY_P) ) pcfQuality = ( pcfQuality + 1 ) % PCF_QUALITY_COUNT;
+
+        if ( ConsumeKey(GLFW_KEY_J) ) omniShadowQuality = ( omniShadowQuality + 1 ) % OMNI_SHADOW_QUALITY_COUNT;
+
+        if ( ConsumeKey(GLFW_KEY_K) ) omniShadowDepth16 = !omniShadowDepth16;
 
-        for ( auto& spotLight : spotLights ) {
-            OmniShadowMapPass(&spotLight);
+        if ( ConsumeKey(GLFW_KEY_C) ) clusteredLightsEnabled = !clusteredLightsEnabled;
+
+        if ( ConsumeKey(GLFW_KEY_R) ) deferredEnabled = !deferredEnabled;
+
+        if ( ConsumeKey(GLFW_KEY_M) ) {
+            memoryReportEnabled = !memoryReportEnabled;
+            if ( memoryReportEnabled ) GpuMemory::Get().Dump(std::cout);
         }
 
-        RenderPass(projection, camera->calculateViewMatrix());
+        if ( ConsumeKey(GLFW_KEY_G) ) stateReportEnabled = !stateReportEnabled;
+
+        if ( ConsumeKey(GLFW_KEY_O) ) occlusionCullingEnabled = !occlusionCullingEnabled;
+
+        if ( ConsumeKey(GLFW_KEY_T) ) ReportLookAt();
+
+        glm::vec3 lowerLight = camera->getCameraPosition();
+        lowerLight.y -= 0.3f;
+        spotLights[0].SetFlash(lowerLight, camera->getCameraDirection());
+
+        glm::mat4 viewMatrix = camera->calculateViewMatrix();
+
+        UpdateClusteredLights(now, viewMatrix);
+        directionalLight->UpdateCascades(projection, viewMatrix, 0.1f, 100.0f);
+        textureStreamer->Update();
+        modelLoader->Update();
+        UploadManager::Get().Update();
+
+        // The models' bounds grow as their meshes arrive, a refit that finds the same box returns straight away
+        PlaceSceneObject(XWING, sceneTransforms[XWING]);
+
+        AnimateScene();
+        UpdateShadowSlices(projection);
+
+        if ( occlusionCullingEnabled ) UpdateOcclusion(projection * viewMatrix);
+
+        drawDataRing->BeginFrame();
+
+        BuildFrame(*frameGraph, projection, viewMatrix);
+
+        // After BuildFrame, which told the scheduler what the frame reads, and before the passes ask what to redraw
+        shadowScheduler->Schedule(projection, viewMatrix);
+        frameGraph->Execute();
+
+        drawDataRing->EndFrame();
+
+        if ( memoryReportEnabled ) GpuMemory::Get().EndFrame(std::cout);
 
         // glUseProgram — Installs a program object as part of current rendering state
-        glUseProgram(0);
+        GLState::Get().UseProgram(0);
+
+        GLState::Get().EndFrame();
+
+        if ( stateReportEnabled ) {
+            std::cout << "GL state: " << GLState::Get().GetIssuedCount() << " issued, "
+                      << GLState::Get().GetSkippedCount() << " skipped" << std::endl;
+        }
 
         window->SwapBuffers();
+
+        CheckFrameAllocations(AllocationCounter::GetThreadCount() - allocationsBefore);
     }
 
     for ( auto& mesh : meshList ) {
         delete mesh;
     }
 
-    for ( auto& shader : shaderList ) {
-        delete shader;
-    }
+    mainShaders.reset();
+    shadowBlur.reset();
+    shadowScheduler.reset();
+    lightClusters.reset();
+    deferredRenderer.reset();
+    frameGraph.reset();
+    drawDataRing.reset();
+    delete directionalShadowShader;
+    delete omniShadowShader;
 
     delete directionalLight;
-    delete uniformDirectionalLight;
+
+    // Everything owning GL memory is gone by now, the streamer last since the textures hand their storage back to it
+    xwing.reset();
+    blackhack.reset();
+    modelLoader.reset();
+    skyBox.reset();
+    brickTexture.reset();
+    plainTexture.reset();
+    textureArrays.reset();
+    textureStreamer.reset();
+    UploadManager::Get().Destroy();
+
+    GpuMemory::Get().ReportLeaks(std::cerr);
 
     return 0;
 }
\ No newline at end of file
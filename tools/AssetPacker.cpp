@@ -0,0 +1,114 @@
+#include <iostream>
+#include <string>
+#include <vector>
+#include <cstring>
+
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <dirent.h>
+#include <sys/stat.h>
+#endif
+
+#include "AssetPack.h"
+#include "FileSystem.h"
+
+// Packs files and whole directories into one archive the game mounts at startup:
+//   AssetPacker [--store] <out.pak> <file|directory>...
+// Paths are stored as given on the command line, run it from the directory the game runs in. --store skips
+// compression for every entry.
+namespace {
+    void ListFiles(const std::string& _path, std::vector<std::string>& _files) {
+#ifdef _WIN32
+        DWORD attributes = GetFileAttributesA(_path.c_str());
+
+        if ( attributes == INVALID_FILE_ATTRIBUTES ) {
+            std::cerr << "Fail to find " << _path << std::endl;
+            return;
+        }
+
+        if ( !( attributes & FILE_ATTRIBUTE_DIRECTORY ) ) {
+            _files.push_back(_path);
+            return;
+        }
+
+        WIN32_FIND_DATAA found;
+        HANDLE search = FindFirstFileA(( _path + "\\*" ).c_str(), &found);
+
+        if ( search == INVALID_HANDLE_VALUE ) return;
+
+        do {
+            if ( std::strcmp(found.cFileName, ".") && std::strcmp(found.cFileName, "..") ) {
+                ListFiles(FileSystem::JoinPath(_path, found.cFileName), _files);
+            }
+        } while ( FindNextFileA(search, &found) );
+
+        FindClose(search);
+#else
+        struct stat status {};
+
+        if ( stat(_path.c_str(), &status) != 0 ) {
+            std::cerr << "Fail to find " << _path << std::endl;
+            return;
+        }
+
+        if ( !S_ISDIR(status.st_mode) ) {
+            _files.push_back(_path);
+            return;
+        }
+
+        DIR* directory = opendir(_path.c_str());
+
+        if ( !directory ) return;
+
+        while ( dirent* entry = readdir(directory) ) {
+            if ( std::strcmp(entry->d_name, ".") && std::strcmp(entry->d_name, "..") ) {
+                ListFiles(FileSystem::JoinPath(_path, entry->d_name), _files);
+            }
+        }
+
+        closedir(directory);
+#endif
+    }
+}
+
+int main(int _argc, char** _argv) {
+    bool compress = true;
+    int first = 1;
+
+    if ( first < _argc && std::strcmp(_argv[first], "--store") == 0 ) {
+        compress = false;
+        first++;
+    }
+
+    if ( _argc - first < 2 ) {
+        std::cerr << "Usage: AssetPacker [--store] <out.pak> <file|directory>..." << std::endl;
+        return 1;
+    }
+
+    std::vector<std::string> files;
+
+    for ( int i = first + 1; i < _argc; i++ ) {
+        ListFiles(_argv[i], files);
+    }
+
+    AssetPackWriter writer;
+
+    for ( const std::string& file : files ) {
+        std::vector<unsigned char> data;
+
+        if ( !FileSystem::ReadLooseFile(file, data) ) {
+            std::cerr << "Fail to read " << file << " file" << std::endl;
+            return 1;
+        }
+
+        writer.Add(file, std::move(data), compress);
+    }
+
+    if ( !writer.Write(_argv[first]) ) return 1;
+
+    std::cout << "Packed " << files.size() << " files, " << writer.GetOriginalBytes() << " bytes stored in "
+              << writer.GetStoredBytes() << std::endl;
+
+    return 0;
+}
\ No newline at end of file